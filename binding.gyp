@@ -2,7 +2,30 @@
   "targets": [{
     "target_name": "evmc",
     "sources": [
-      "src/evmc.c"
+      "src/evmc.c",
+      "src/account_cache.c",
+      "src/arena.c",
+      "src/bn256.c",
+      "src/completion.c",
+      "src/field.c",
+      "src/handoff.c",
+      "src/hash.c",
+      "src/intern.c",
+      "src/precompiles.c",
+      "src/prewarm.c",
+      "src/profiler.c",
+      "src/result_cache.c",
+      "src/rlp.c",
+      "src/scheduler.c",
+      "src/secp256k1.c",
+      "src/snapshot.c",
+      "src/state.c",
+      "src/tiering.c",
+      "src/trace.c",
+      "src/transaction.c",
+      "src/trie.c",
+      "src/witness.c",
+      "src/write_set.c"
     ],
     "libraries": ["-L<(module_root_dir)/libbuild/evmc/lib/loader", "-levmc-loader"],
     "include_dirs": 
@@ -0,0 +1,275 @@
+#include "account_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <uv.h>
+
+#define NONE UINT32_MAX
+
+struct evmc_account_cache_entry {
+  evmc_address address;
+  /** The evmc_account_cache_field bits which are filled in. */
+  uint8_t known;
+  bool exists;
+  evmc_uint256be balance;
+  evmc_bytes32 code_hash;
+  size_t code_size;
+  /** Next entry in the same bucket, or in the free list. */
+  uint32_t chain;
+  /** Neighbours in recency order, most recent first. */
+  uint32_t prev;
+  uint32_t next;
+};
+
+struct evmc_account_cache {
+  uv_mutex_t lock;
+  struct evmc_account_cache_entry* entries;
+  uint32_t capacity;
+  uint32_t* buckets;
+  uint32_t bucket_mask;
+  uint32_t head;
+  uint32_t tail;
+  uint32_t free_list;
+  uint32_t count;
+  /**
+   * Bumped by every invalidation. A miss remembers it so that the response
+   * can be dropped if any invalidation happened while the host was asked;
+   * invalidating one address also drops unrelated in-flight responses, which
+   * is only a missed fill.
+   */
+  uint64_t generation;
+  struct evmc_account_cache_stats stats;
+  int refs;
+};
+
+static uint32_t hash_address(const evmc_address* address) {
+  uint64_t a, b;
+  memcpy(&a, address->bytes, sizeof(a));
+  memcpy(&b, address->bytes + 12, sizeof(b));
+  uint64_t h = (a ^ b) * 0x9e3779b97f4a7c15ULL;
+  return (uint32_t) (h >> 32);
+}
+
+static void reset(struct evmc_account_cache* cache) {
+  uint32_t i;
+  for (i = 0; i <= cache->bucket_mask; i++) {
+    cache->buckets[i] = NONE;
+  }
+  for (i = 0; i < cache->capacity; i++) {
+    cache->entries[i].chain = i + 1 < cache->capacity ? i + 1 : NONE;
+  }
+  cache->free_list = 0;
+  cache->head = NONE;
+  cache->tail = NONE;
+  cache->count = 0;
+}
+
+struct evmc_account_cache* evmc_account_cache_create(size_t budget) {
+  // Buckets are at most two per entry.
+  size_t per_entry = sizeof(struct evmc_account_cache_entry) + 2 * sizeof(uint32_t);
+  size_t capacity = budget / per_entry;
+  if (capacity == 0) {
+    return NULL;
+  }
+  if (capacity > NONE - 1) {
+    capacity = NONE - 1;
+  }
+  size_t bucket_count = 1;
+  while (bucket_count < capacity) {
+    bucket_count <<= 1;
+  }
+
+  struct evmc_account_cache* cache = (struct evmc_account_cache*) calloc(1, sizeof(struct evmc_account_cache));
+  cache->entries = (struct evmc_account_cache_entry*) malloc(capacity * sizeof(struct evmc_account_cache_entry));
+  cache->buckets = (uint32_t*) malloc(bucket_count * sizeof(uint32_t));
+  if (cache->entries == NULL || cache->buckets == NULL) {
+    free(cache->entries);
+    free(cache->buckets);
+    free(cache);
+    return NULL;
+  }
+
+  cache->capacity = (uint32_t) capacity;
+  cache->bucket_mask = (uint32_t) (bucket_count - 1);
+  cache->stats.capacity = capacity;
+  cache->stats.memory_usage = capacity * sizeof(struct evmc_account_cache_entry) +
+                              bucket_count * sizeof(uint32_t);
+  cache->refs = 1;
+  uv_mutex_init(&cache->lock);
+  reset(cache);
+  return cache;
+}
+
+void evmc_account_cache_retain(struct evmc_account_cache* cache) {
+  __atomic_add_fetch(&cache->refs, 1, __ATOMIC_RELAXED);
+}
+
+void evmc_account_cache_release(struct evmc_account_cache* cache) {
+  if (__atomic_sub_fetch(&cache->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    uv_mutex_destroy(&cache->lock);
+    free(cache->entries);
+    free(cache->buckets);
+    free(cache);
+  }
+}
+
+static uint32_t find(struct evmc_account_cache* cache, const evmc_address* address) {
+  uint32_t i = cache->buckets[hash_address(address) & cache->bucket_mask];
+  while (i != NONE && memcmp(&cache->entries[i].address, address, sizeof(evmc_address)) != 0) {
+    i = cache->entries[i].chain;
+  }
+  return i;
+}
+
+static void unlink_recent(struct evmc_account_cache* cache, uint32_t i) {
+  struct evmc_account_cache_entry* entry = &cache->entries[i];
+  if (entry->prev != NONE) {
+    cache->entries[entry->prev].next = entry->next;
+  } else {
+    cache->head = entry->next;
+  }
+  if (entry->next != NONE) {
+    cache->entries[entry->next].prev = entry->prev;
+  } else {
+    cache->tail = entry->prev;
+  }
+}
+
+static void push_recent(struct evmc_account_cache* cache, uint32_t i) {
+  struct evmc_account_cache_entry* entry = &cache->entries[i];
+  entry->prev = NONE;
+  entry->next = cache->head;
+  if (cache->head != NONE) {
+    cache->entries[cache->head].prev = i;
+  } else {
+    cache->tail = i;
+  }
+  cache->head = i;
+}
+
+static void remove_entry(struct evmc_account_cache* cache, uint32_t i) {
+  uint32_t* link = &cache->buckets[hash_address(&cache->entries[i].address) & cache->bucket_mask];
+  while (*link != i) {
+    link = &cache->entries[*link].chain;
+  }
+  *link = cache->entries[i].chain;
+
+  unlink_recent(cache, i);
+  cache->entries[i].chain = cache->free_list;
+  cache->free_list = i;
+  cache->count--;
+}
+
+bool evmc_account_cache_lookup(struct evmc_account_cache* cache, const evmc_address* address,
+                               enum evmc_account_cache_field field,
+                               struct evmc_account_cache_value* value, uint64_t* generation) {
+  uv_mutex_lock(&cache->lock);
+  uint32_t i = find(cache, address);
+  if (i == NONE || !(cache->entries[i].known & field)) {
+    cache->stats.misses++;
+    *generation = cache->generation;
+    uv_mutex_unlock(&cache->lock);
+    return false;
+  }
+
+  struct evmc_account_cache_entry* entry = &cache->entries[i];
+  switch (field) {
+    case EVMC_ACCOUNT_CACHE_EXISTS:
+      value->exists = entry->exists;
+      break;
+    case EVMC_ACCOUNT_CACHE_BALANCE:
+      value->balance = entry->balance;
+      break;
+    case EVMC_ACCOUNT_CACHE_CODE_SIZE:
+      value->code_size = entry->code_size;
+      break;
+    case EVMC_ACCOUNT_CACHE_CODE_HASH:
+      value->code_hash = entry->code_hash;
+      break;
+  }
+  if (cache->head != i) {
+    unlink_recent(cache, i);
+    push_recent(cache, i);
+  }
+  cache->stats.hits++;
+  uv_mutex_unlock(&cache->lock);
+  return true;
+}
+
+void evmc_account_cache_store(struct evmc_account_cache* cache, uint64_t generation,
+                              const evmc_address* address, enum evmc_account_cache_field field,
+                              const struct evmc_account_cache_value* value) {
+  uv_mutex_lock(&cache->lock);
+  if (generation != cache->generation) {
+    uv_mutex_unlock(&cache->lock);
+    return;
+  }
+
+  uint32_t i = find(cache, address);
+  if (i == NONE) {
+    if (cache->free_list == NONE) {
+      remove_entry(cache, cache->tail);
+      cache->stats.evictions++;
+    }
+    i = cache->free_list;
+    struct evmc_account_cache_entry* entry = &cache->entries[i];
+    cache->free_list = entry->chain;
+
+    entry->address = *address;
+    entry->known = 0;
+    uint32_t* bucket = &cache->buckets[hash_address(address) & cache->bucket_mask];
+    entry->chain = *bucket;
+    *bucket = i;
+    push_recent(cache, i);
+    cache->count++;
+  } else if (cache->head != i) {
+    unlink_recent(cache, i);
+    push_recent(cache, i);
+  }
+
+  struct evmc_account_cache_entry* entry = &cache->entries[i];
+  entry->known |= field;
+  switch (field) {
+    case EVMC_ACCOUNT_CACHE_EXISTS:
+      entry->exists = value->exists;
+      break;
+    case EVMC_ACCOUNT_CACHE_BALANCE:
+      entry->balance = value->balance;
+      break;
+    case EVMC_ACCOUNT_CACHE_CODE_SIZE:
+      entry->code_size = value->code_size;
+      break;
+    case EVMC_ACCOUNT_CACHE_CODE_HASH:
+      entry->code_hash = value->code_hash;
+      break;
+  }
+  uv_mutex_unlock(&cache->lock);
+}
+
+void evmc_account_cache_invalidate(struct evmc_account_cache* cache, const evmc_address* address) {
+  uv_mutex_lock(&cache->lock);
+  cache->generation++;
+  cache->stats.invalidations++;
+  uint32_t i = find(cache, address);
+  if (i != NONE) {
+    remove_entry(cache, i);
+  }
+  uv_mutex_unlock(&cache->lock);
+}
+
+void evmc_account_cache_invalidate_all(struct evmc_account_cache* cache) {
+  uv_mutex_lock(&cache->lock);
+  cache->generation++;
+  cache->stats.invalidations++;
+  reset(cache);
+  uv_mutex_unlock(&cache->lock);
+}
+
+void evmc_account_cache_get_stats(struct evmc_account_cache* cache,
+                                  struct evmc_account_cache_stats* stats) {
+  uv_mutex_lock(&cache->lock);
+  *stats = cache->stats;
+  stats->entries = cache->count;
+  uv_mutex_unlock(&cache->lock);
+}
@@ -0,0 +1,82 @@
+#ifndef EVMC_JS_ACCOUNT_CACHE_H
+#define EVMC_JS_ACCOUNT_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "evmc/evmc.h"
+
+/**
+ * Least recently used cache of account metadata: existence, balance, code size
+ * and code hash. Each field of an entry is filled independently from host
+ * responses and dropped with the whole entry on invalidation.
+ *
+ * All entries are allocated up front from a memory budget, and a cache may be
+ * used from any number of threads at once.
+ */
+
+enum evmc_account_cache_field {
+  EVMC_ACCOUNT_CACHE_EXISTS = 1,
+  EVMC_ACCOUNT_CACHE_BALANCE = 2,
+  EVMC_ACCOUNT_CACHE_CODE_SIZE = 4,
+  EVMC_ACCOUNT_CACHE_CODE_HASH = 8
+};
+
+struct evmc_account_cache_value {
+  bool exists;
+  evmc_uint256be balance;
+  size_t code_size;
+  evmc_bytes32 code_hash;
+};
+
+struct evmc_account_cache_stats {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+  uint64_t invalidations;
+  size_t entries;
+  size_t capacity;
+  /** Bytes allocated for entries and buckets. */
+  size_t memory_usage;
+};
+
+struct evmc_account_cache;
+
+/**
+ * Creates a cache holding as many entries as fit in budget bytes. Returns NULL
+ * if the budget is too small for a single entry. The returned cache holds one
+ * reference.
+ */
+struct evmc_account_cache* evmc_account_cache_create(size_t budget);
+
+void evmc_account_cache_retain(struct evmc_account_cache* cache);
+
+/** Drops a reference, freeing the cache once the last one is gone. */
+void evmc_account_cache_release(struct evmc_account_cache* cache);
+
+/**
+ * Looks up one field of the account at address, copying it into value on a
+ * hit. On a miss, sets *generation for a later evmc_account_cache_store.
+ */
+bool evmc_account_cache_lookup(struct evmc_account_cache* cache, const evmc_address* address,
+                               enum evmc_account_cache_field field,
+                               struct evmc_account_cache_value* value, uint64_t* generation);
+
+/**
+ * Stores one field of the account at address, unless the cache has been
+ * invalidated since generation was returned by the lookup which missed. This
+ * keeps responses which raced with an invalidation out of the cache.
+ */
+void evmc_account_cache_store(struct evmc_account_cache* cache, uint64_t generation,
+                              const evmc_address* address, enum evmc_account_cache_field field,
+                              const struct evmc_account_cache_value* value);
+
+void evmc_account_cache_invalidate(struct evmc_account_cache* cache, const evmc_address* address);
+
+void evmc_account_cache_invalidate_all(struct evmc_account_cache* cache);
+
+void evmc_account_cache_get_stats(struct evmc_account_cache* cache,
+                                  struct evmc_account_cache_stats* stats);
+
+#endif
@@ -0,0 +1,152 @@
+#include "arena.h"
+
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/** Size of the first chunk, which holds most executions. */
+#define FIRST_CHUNK_SIZE 8192
+/** Arenas holding more than this give back all but their first chunk on release. */
+#define RETAIN_MAX (256 * 1024)
+/** Released arenas kept per thread. */
+#define FREE_LIST_MAX 16
+
+#define ALIGNMENT alignof(max_align_t)
+
+struct evmc_arena_chunk {
+  struct evmc_arena_chunk* next;
+  size_t size;
+  size_t used;
+  alignas(max_align_t) uint8_t data[];
+};
+
+struct evmc_arena {
+  /** The chunk being allocated from, followed by those already full */
+  struct evmc_arena_chunk* current;
+  /** Chunks emptied by a release, to be used before allocating more */
+  struct evmc_arena_chunk* spare;
+  size_t reserved;
+  struct evmc_arena* next_free;
+};
+
+static _Thread_local struct evmc_arena* free_list;
+static _Thread_local size_t free_count;
+
+static struct evmc_arena_stats stats;
+static int64_t reserved_change;
+
+static struct evmc_arena_chunk* create_chunk(struct evmc_arena* arena, size_t size) {
+  struct evmc_arena_chunk* chunk =
+      (struct evmc_arena_chunk*) malloc(sizeof(struct evmc_arena_chunk) + size);
+  if (chunk == NULL) {
+    return NULL;
+  }
+  chunk->next = NULL;
+  chunk->size = size;
+  chunk->used = 0;
+  arena->reserved += size;
+  __atomic_add_fetch(&stats.chunks, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&stats.reserved, size, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&reserved_change, (int64_t) size, __ATOMIC_RELAXED);
+  return chunk;
+}
+
+static void free_chunks(struct evmc_arena* arena, struct evmc_arena_chunk* chunk) {
+  while (chunk != NULL) {
+    struct evmc_arena_chunk* next = chunk->next;
+    arena->reserved -= chunk->size;
+    __atomic_sub_fetch(&stats.reserved, chunk->size, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&reserved_change, (int64_t) chunk->size, __ATOMIC_RELAXED);
+    free(chunk);
+    chunk = next;
+  }
+}
+
+struct evmc_arena* evmc_arena_acquire(void) {
+  struct evmc_arena* arena = free_list;
+  if (arena != NULL) {
+    free_list = arena->next_free;
+    free_count--;
+    __atomic_add_fetch(&stats.reuses, 1, __ATOMIC_RELAXED);
+    return arena;
+  }
+
+  arena = (struct evmc_arena*) malloc(sizeof(struct evmc_arena));
+  arena->reserved = 0;
+  arena->spare = NULL;
+  arena->current = create_chunk(arena, FIRST_CHUNK_SIZE);
+  __atomic_add_fetch(&stats.arenas, 1, __ATOMIC_RELAXED);
+  return arena;
+}
+
+void* evmc_arena_alloc(struct evmc_arena* arena, size_t size) {
+  __atomic_add_fetch(&stats.allocations, 1, __ATOMIC_RELAXED);
+  size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+  struct evmc_arena_chunk* chunk = arena->current;
+  if (chunk->size - chunk->used < size) {
+    // Take a spare chunk if it is large enough, or allocate one which is at
+    // least twice the previous one, so a growing execution allocates rarely.
+    struct evmc_arena_chunk* spare = arena->spare;
+    if (spare != NULL && spare->size >= size) {
+      arena->spare = spare->next;
+      chunk = spare;
+    } else {
+      size_t chunk_size = chunk->size * 2;
+      chunk = create_chunk(arena, chunk_size > size ? chunk_size : size);
+      if (chunk == NULL) {
+        return NULL;
+      }
+    }
+    chunk->next = arena->current;
+    arena->current = chunk;
+  }
+
+  void* out = chunk->data + chunk->used;
+  chunk->used += size;
+  return out;
+}
+
+void evmc_arena_release(struct evmc_arena* arena) {
+  // Chunks go back in the order they were used, so the next execution fills
+  // them in the same order.
+  struct evmc_arena_chunk* chunk = arena->current;
+  struct evmc_arena_chunk* spare = arena->spare;
+  while (chunk->next != NULL) {
+    struct evmc_arena_chunk* next = chunk->next;
+    chunk->used = 0;
+    chunk->next = spare;
+    spare = chunk;
+    chunk = next;
+  }
+  chunk->used = 0;
+  arena->current = chunk;
+  arena->spare = spare;
+
+  if (arena->reserved > RETAIN_MAX) {
+    free_chunks(arena, arena->spare);
+    arena->spare = NULL;
+  }
+
+  if (free_count == FREE_LIST_MAX) {
+    free_chunks(arena, arena->spare);
+    free_chunks(arena, arena->current);
+    free(arena);
+    return;
+  }
+  arena->next_free = free_list;
+  free_list = arena;
+  free_count++;
+}
+
+int64_t evmc_arena_take_reserved_change(void) {
+  return __atomic_exchange_n(&reserved_change, 0, __ATOMIC_RELAXED);
+}
+
+void evmc_arena_get_stats(struct evmc_arena_stats* out) {
+  out->arenas = __atomic_load_n(&stats.arenas, __ATOMIC_RELAXED);
+  out->reuses = __atomic_load_n(&stats.reuses, __ATOMIC_RELAXED);
+  out->allocations = __atomic_load_n(&stats.allocations, __ATOMIC_RELAXED);
+  out->chunks = __atomic_load_n(&stats.chunks, __ATOMIC_RELAXED);
+  out->reserved = __atomic_load_n(&stats.reserved, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,47 @@
+#ifndef EVMC_JS_ARENA_H
+#define EVMC_JS_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Bump allocator owning everything an execution allocates, which is all freed
+ * at once when the execution completes.
+ *
+ * Released arenas keep their memory and are recycled through a free list of
+ * the releasing thread, so executions of a steady size stop allocating at all.
+ * An arena is used by one thread at a time, and must be acquired and released
+ * on the same thread.
+ */
+
+struct evmc_arena_stats {
+  /** Arenas created, including those since freed. */
+  uint64_t arenas;
+  /** Arenas acquired from a free list instead of created. */
+  uint64_t reuses;
+  uint64_t allocations;
+  /** Chunks of memory allocated from the system. */
+  uint64_t chunks;
+  /** Bytes held by arenas, in use or free. */
+  uint64_t reserved;
+};
+
+struct evmc_arena;
+
+struct evmc_arena* evmc_arena_acquire(void);
+
+/** Returns size bytes aligned for any type, valid until the arena is released. */
+void* evmc_arena_alloc(struct evmc_arena* arena, size_t size);
+
+/** Frees all allocations, and gives the arena to the thread's free list. */
+void evmc_arena_release(struct evmc_arena* arena);
+
+/**
+ * Returns the change in bytes held by arenas since the last call, for
+ * reporting to the garbage collector.
+ */
+int64_t evmc_arena_take_reserved_change(void);
+
+void evmc_arena_get_stats(struct evmc_arena_stats* stats);
+
+#endif
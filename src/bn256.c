@@ -0,0 +1,752 @@
+#include "bn256.h"
+
+#include <string.h>
+
+#include "field.h"
+
+static const uint64_t bn256_p[4] = {0x3c208c16d87cfd47ULL, 0x97816a916871ca8dULL,
+                                    0xb85045b68181585dULL, 0x30644e72e131a029ULL};
+/** The order of G1 and G2. */
+static const uint64_t bn256_order[4] = {0x43e1f593f0000001ULL, 0x2833e84879b97091ULL,
+                                        0xb85045b68181585dULL, 0x30644e72e131a029ULL};
+/** The BN curve parameter. */
+static const uint64_t bn256_u = 0x44e992b44a6909f1ULL;
+
+/** a + b i, with i^2 = -1. */
+typedef struct {
+  fe a;
+  fe b;
+} fp2;
+
+/** c0 + c1 v + c2 v^2, with v^3 = xi. */
+typedef struct {
+  fp2 c0;
+  fp2 c1;
+  fp2 c2;
+} fp6;
+
+/** c0 + c1 w, with w^2 = v. */
+typedef struct {
+  fp6 c0;
+  fp6 c1;
+} fp12;
+
+/** A point on the twist y^2 = x^3 + 3 / xi, in Jacobian coordinates. */
+struct g2_point {
+  fp2 x;
+  fp2 y;
+  fp2 z;
+};
+
+static struct field fp;
+static fe g1_b;
+static fe nine;
+static fp2 xi;
+static fp2 g2_b;
+static uint8_t order_bytes[32];
+/** xi^(e (p - 1) / 6), the Frobenius coefficient of w^e. */
+static fp2 frobenius_p[6];
+/** xi^(e (p^2 - 1) / 6), the squared Frobenius coefficient of w^e. */
+static fe frobenius_p2[6];
+
+static void fp2_zero(fp2* o) {
+  memset(o, 0, sizeof(*o));
+}
+
+static void fp2_one(fp2* o) {
+  o->a = fp.one;
+  memset(&o->b, 0, sizeof(o->b));
+}
+
+static bool fp2_is_zero(const fp2* a) {
+  return fe_is_zero(&a->a) && fe_is_zero(&a->b);
+}
+
+static bool fp2_eq(const fp2* a, const fp2* b) {
+  return fe_eq(&a->a, &b->a) && fe_eq(&a->b, &b->b);
+}
+
+static void fp2_add(fp2* o, const fp2* x, const fp2* y) {
+  fe_add(&fp, &o->a, &x->a, &y->a);
+  fe_add(&fp, &o->b, &x->b, &y->b);
+}
+
+static void fp2_sub(fp2* o, const fp2* x, const fp2* y) {
+  fe_sub(&fp, &o->a, &x->a, &y->a);
+  fe_sub(&fp, &o->b, &x->b, &y->b);
+}
+
+static void fp2_neg(fp2* o, const fp2* x) {
+  fe_neg(&fp, &o->a, &x->a);
+  fe_neg(&fp, &o->b, &x->b);
+}
+
+static void fp2_conj(fp2* o, const fp2* x) {
+  o->a = x->a;
+  fe_neg(&fp, &o->b, &x->b);
+}
+
+static void fp2_mul(fp2* o, const fp2* x, const fp2* y) {
+  fe t0, t1, t2, t3;
+  fe_mul(&fp, &t0, &x->a, &y->a);
+  fe_mul(&fp, &t1, &x->b, &y->b);
+  fe_add(&fp, &t2, &x->a, &x->b);
+  fe_add(&fp, &t3, &y->a, &y->b);
+  fe_mul(&fp, &t2, &t2, &t3);
+  fe_sub(&fp, &t2, &t2, &t0);
+  fe_sub(&fp, &o->b, &t2, &t1);
+  fe_sub(&fp, &o->a, &t0, &t1);
+}
+
+static void fp2_sqr(fp2* o, const fp2* x) {
+  fe t0, t1, t2;
+  fe_add(&fp, &t0, &x->a, &x->b);
+  fe_sub(&fp, &t1, &x->a, &x->b);
+  fe_mul(&fp, &t2, &x->a, &x->b);
+  fe_mul(&fp, &o->a, &t0, &t1);
+  fe_add(&fp, &o->b, &t2, &t2);
+}
+
+static void fp2_mul_fe(fp2* o, const fp2* x, const fe* y) {
+  fe_mul(&fp, &o->a, &x->a, y);
+  fe_mul(&fp, &o->b, &x->b, y);
+}
+
+/** Multiplies by xi = 9 + i. */
+static void fp2_mul_xi(fp2* o, const fp2* x) {
+  fe t0, t1;
+  fe_mul(&fp, &t0, &x->a, &nine);
+  fe_sub(&fp, &t0, &t0, &x->b);
+  fe_mul(&fp, &t1, &x->b, &nine);
+  fe_add(&fp, &o->b, &t1, &x->a);
+  o->a = t0;
+}
+
+static void fp2_inv(fp2* o, const fp2* x) {
+  fe t0, t1;
+  fe_sqr(&fp, &t0, &x->a);
+  fe_sqr(&fp, &t1, &x->b);
+  fe_add(&fp, &t0, &t0, &t1);
+  fe_inv(&fp, &t0, &t0);
+  fe_mul(&fp, &o->a, &x->a, &t0);
+  fe_mul(&fp, &t1, &x->b, &t0);
+  fe_neg(&fp, &o->b, &t1);
+}
+
+static void fp2_pow(fp2* o, const fp2* x, const uint64_t e[4]) {
+  fp2 result, base = *x;
+  fp2_one(&result);
+  int i;
+  for (i = 255; i >= 0; i--) {
+    fp2_sqr(&result, &result);
+    if ((e[i / 64] >> (i % 64)) & 1) {
+      fp2_mul(&result, &result, &base);
+    }
+  }
+  *o = result;
+}
+
+static void fp6_add(fp6* o, const fp6* x, const fp6* y) {
+  fp2_add(&o->c0, &x->c0, &y->c0);
+  fp2_add(&o->c1, &x->c1, &y->c1);
+  fp2_add(&o->c2, &x->c2, &y->c2);
+}
+
+static void fp6_sub(fp6* o, const fp6* x, const fp6* y) {
+  fp2_sub(&o->c0, &x->c0, &y->c0);
+  fp2_sub(&o->c1, &x->c1, &y->c1);
+  fp2_sub(&o->c2, &x->c2, &y->c2);
+}
+
+static void fp6_neg(fp6* o, const fp6* x) {
+  fp2_neg(&o->c0, &x->c0);
+  fp2_neg(&o->c1, &x->c1);
+  fp2_neg(&o->c2, &x->c2);
+}
+
+static void fp6_mul(fp6* o, const fp6* x, const fp6* y) {
+  fp2 t0, t1, t2, s0, s1, r0, r1, r2;
+  fp2_mul(&t0, &x->c0, &y->c0);
+  fp2_mul(&t1, &x->c1, &y->c1);
+  fp2_mul(&t2, &x->c2, &y->c2);
+
+  // r0 = t0 + xi ((x1 + x2)(y1 + y2) - t1 - t2)
+  fp2_add(&s0, &x->c1, &x->c2);
+  fp2_add(&s1, &y->c1, &y->c2);
+  fp2_mul(&r0, &s0, &s1);
+  fp2_sub(&r0, &r0, &t1);
+  fp2_sub(&r0, &r0, &t2);
+  fp2_mul_xi(&r0, &r0);
+  fp2_add(&r0, &r0, &t0);
+
+  // r1 = (x0 + x1)(y0 + y1) - t0 - t1 + xi t2
+  fp2_add(&s0, &x->c0, &x->c1);
+  fp2_add(&s1, &y->c0, &y->c1);
+  fp2_mul(&r1, &s0, &s1);
+  fp2_sub(&r1, &r1, &t0);
+  fp2_sub(&r1, &r1, &t1);
+  fp2_mul_xi(&s0, &t2);
+  fp2_add(&r1, &r1, &s0);
+
+  // r2 = (x0 + x2)(y0 + y2) - t0 - t2 + t1
+  fp2_add(&s0, &x->c0, &x->c2);
+  fp2_add(&s1, &y->c0, &y->c2);
+  fp2_mul(&r2, &s0, &s1);
+  fp2_sub(&r2, &r2, &t0);
+  fp2_sub(&r2, &r2, &t2);
+  fp2_add(&r2, &r2, &t1);
+
+  o->c0 = r0;
+  o->c1 = r1;
+  o->c2 = r2;
+}
+
+/** Multiplies by v. */
+static void fp6_mul_v(fp6* o, const fp6* x) {
+  fp2 t;
+  fp2_mul_xi(&t, &x->c2);
+  o->c2 = x->c1;
+  o->c1 = x->c0;
+  o->c0 = t;
+}
+
+static void fp6_inv(fp6* o, const fp6* x) {
+  fp2 a, b, c, t, f;
+
+  // a = x0^2 - xi x1 x2
+  fp2_sqr(&a, &x->c0);
+  fp2_mul(&t, &x->c1, &x->c2);
+  fp2_mul_xi(&t, &t);
+  fp2_sub(&a, &a, &t);
+
+  // b = xi x2^2 - x0 x1
+  fp2_sqr(&b, &x->c2);
+  fp2_mul_xi(&b, &b);
+  fp2_mul(&t, &x->c0, &x->c1);
+  fp2_sub(&b, &b, &t);
+
+  // c = x1^2 - x0 x2
+  fp2_sqr(&c, &x->c1);
+  fp2_mul(&t, &x->c0, &x->c2);
+  fp2_sub(&c, &c, &t);
+
+  // f = x0 a + xi (x2 b + x1 c)
+  fp2_mul(&f, &x->c2, &b);
+  fp2_mul(&t, &x->c1, &c);
+  fp2_add(&f, &f, &t);
+  fp2_mul_xi(&f, &f);
+  fp2_mul(&t, &x->c0, &a);
+  fp2_add(&f, &f, &t);
+  fp2_inv(&f, &f);
+
+  fp2_mul(&o->c0, &a, &f);
+  fp2_mul(&o->c1, &b, &f);
+  fp2_mul(&o->c2, &c, &f);
+}
+
+static void fp12_one(fp12* o) {
+  memset(o, 0, sizeof(*o));
+  fp2_one(&o->c0.c0);
+}
+
+static bool fp12_is_one(const fp12* x) {
+  fp12 one;
+  fp12_one(&one);
+  return memcmp(x, &one, sizeof(one)) == 0;
+}
+
+static void fp12_mul(fp12* o, const fp12* x, const fp12* y) {
+  fp6 t0, t1, s0, s1;
+  fp6_mul(&t0, &x->c0, &y->c0);
+  fp6_mul(&t1, &x->c1, &y->c1);
+  fp6_add(&s0, &x->c0, &x->c1);
+  fp6_add(&s1, &y->c0, &y->c1);
+  fp6_mul(&s0, &s0, &s1);
+  fp6_sub(&s0, &s0, &t0);
+  fp6_sub(&o->c1, &s0, &t1);
+  fp6_mul_v(&t1, &t1);
+  fp6_add(&o->c0, &t0, &t1);
+}
+
+static void fp12_sqr(fp12* o, const fp12* x) {
+  fp12_mul(o, x, x);
+}
+
+static void fp12_conj(fp12* o, const fp12* x) {
+  o->c0 = x->c0;
+  fp6_neg(&o->c1, &x->c1);
+}
+
+static void fp12_inv(fp12* o, const fp12* x) {
+  fp6 t0, t1;
+  fp6_mul(&t0, &x->c0, &x->c0);
+  fp6_mul(&t1, &x->c1, &x->c1);
+  fp6_mul_v(&t1, &t1);
+  fp6_sub(&t0, &t0, &t1);
+  fp6_inv(&t0, &t0);
+  fp6_mul(&o->c0, &x->c0, &t0);
+  fp6_mul(&t1, &x->c1, &t0);
+  fp6_neg(&o->c1, &t1);
+}
+
+/** Raises x to the power p. The coefficient of w^e picks up xi^(e (p - 1) / 6). */
+static void fp12_frobenius(fp12* o, const fp12* x) {
+  fp2_conj(&o->c0.c0, &x->c0.c0);
+  fp2_conj(&o->c0.c1, &x->c0.c1);
+  fp2_mul(&o->c0.c1, &o->c0.c1, &frobenius_p[2]);
+  fp2_conj(&o->c0.c2, &x->c0.c2);
+  fp2_mul(&o->c0.c2, &o->c0.c2, &frobenius_p[4]);
+  fp2_conj(&o->c1.c0, &x->c1.c0);
+  fp2_mul(&o->c1.c0, &o->c1.c0, &frobenius_p[1]);
+  fp2_conj(&o->c1.c1, &x->c1.c1);
+  fp2_mul(&o->c1.c1, &o->c1.c1, &frobenius_p[3]);
+  fp2_conj(&o->c1.c2, &x->c1.c2);
+  fp2_mul(&o->c1.c2, &o->c1.c2, &frobenius_p[5]);
+}
+
+/** Raises x to the power p^2. */
+static void fp12_frobenius_p2(fp12* o, const fp12* x) {
+  o->c0.c0 = x->c0.c0;
+  fp2_mul_fe(&o->c0.c1, &x->c0.c1, &frobenius_p2[2]);
+  fp2_mul_fe(&o->c0.c2, &x->c0.c2, &frobenius_p2[4]);
+  fp2_mul_fe(&o->c1.c0, &x->c1.c0, &frobenius_p2[1]);
+  fp2_mul_fe(&o->c1.c1, &x->c1.c1, &frobenius_p2[3]);
+  fp2_mul_fe(&o->c1.c2, &x->c1.c2, &frobenius_p2[5]);
+}
+
+static void fp12_pow_u(fp12* o, const fp12* x) {
+  fp12 result, base = *x;
+  fp12_one(&result);
+  int i;
+  for (i = 63; i >= 0; i--) {
+    fp12_sqr(&result, &result);
+    if ((bn256_u >> i) & 1) {
+      fp12_mul(&result, &result, &base);
+    }
+  }
+  *o = result;
+}
+
+static void g2_set_infinity(struct g2_point* o) {
+  fp2_one(&o->x);
+  fp2_one(&o->y);
+  fp2_zero(&o->z);
+}
+
+static bool g2_is_infinity(const struct g2_point* p) {
+  return fp2_is_zero(&p->z);
+}
+
+static void g2_double(struct g2_point* o, const struct g2_point* p) {
+  if (g2_is_infinity(p) || fp2_is_zero(&p->y)) {
+    g2_set_infinity(o);
+    return;
+  }
+
+  // dbl-2009-l, as ec_double.
+  fp2 a, b, c, d, e, f, t;
+  fp2_sqr(&a, &p->x);
+  fp2_sqr(&b, &p->y);
+  fp2_sqr(&c, &b);
+  fp2_add(&d, &p->x, &b);
+  fp2_sqr(&d, &d);
+  fp2_sub(&d, &d, &a);
+  fp2_sub(&d, &d, &c);
+  fp2_add(&d, &d, &d);
+  fp2_add(&e, &a, &a);
+  fp2_add(&e, &e, &a);
+  fp2_sqr(&f, &e);
+
+  struct g2_point r;
+  fp2_add(&t, &d, &d);
+  fp2_sub(&r.x, &f, &t);
+
+  fp2_add(&c, &c, &c);
+  fp2_add(&c, &c, &c);
+  fp2_add(&c, &c, &c);
+  fp2_sub(&t, &d, &r.x);
+  fp2_mul(&r.y, &e, &t);
+  fp2_sub(&r.y, &r.y, &c);
+
+  fp2_mul(&r.z, &p->y, &p->z);
+  fp2_add(&r.z, &r.z, &r.z);
+  *o = r;
+}
+
+static void g2_add(struct g2_point* o, const struct g2_point* p, const struct g2_point* q) {
+  if (g2_is_infinity(p)) {
+    *o = *q;
+    return;
+  }
+  if (g2_is_infinity(q)) {
+    *o = *p;
+    return;
+  }
+
+  // add-2007-bl, as ec_add.
+  fp2 z1z1, z2z2, u1, u2, s1, s2, h, i, j, r, v, t;
+  fp2_sqr(&z1z1, &p->z);
+  fp2_sqr(&z2z2, &q->z);
+  fp2_mul(&u1, &p->x, &z2z2);
+  fp2_mul(&u2, &q->x, &z1z1);
+  fp2_mul(&s1, &p->y, &q->z);
+  fp2_mul(&s1, &s1, &z2z2);
+  fp2_mul(&s2, &q->y, &p->z);
+  fp2_mul(&s2, &s2, &z1z1);
+  fp2_sub(&h, &u2, &u1);
+  fp2_sub(&r, &s2, &s1);
+
+  if (fp2_is_zero(&h)) {
+    if (fp2_is_zero(&r)) {
+      g2_double(o, p);
+    } else {
+      g2_set_infinity(o);
+    }
+    return;
+  }
+
+  fp2_add(&i, &h, &h);
+  fp2_sqr(&i, &i);
+  fp2_mul(&j, &h, &i);
+  fp2_add(&r, &r, &r);
+  fp2_mul(&v, &u1, &i);
+
+  struct g2_point out;
+  fp2_sqr(&out.x, &r);
+  fp2_sub(&out.x, &out.x, &j);
+  fp2_sub(&out.x, &out.x, &v);
+  fp2_sub(&out.x, &out.x, &v);
+
+  fp2_sub(&t, &v, &out.x);
+  fp2_mul(&out.y, &r, &t);
+  fp2_mul(&t, &s1, &j);
+  fp2_add(&t, &t, &t);
+  fp2_sub(&out.y, &out.y, &t);
+
+  fp2_add(&out.z, &p->z, &q->z);
+  fp2_sqr(&out.z, &out.z);
+  fp2_sub(&out.z, &out.z, &z1z1);
+  fp2_sub(&out.z, &out.z, &z2z2);
+  fp2_mul(&out.z, &out.z, &h);
+  *o = out;
+}
+
+static void g2_mul(struct g2_point* o, const struct g2_point* p, const uint8_t scalar[32]) {
+  struct g2_point r;
+  g2_set_infinity(&r);
+  int i;
+  for (i = 0; i < 256; i++) {
+    g2_double(&r, &r);
+    if ((scalar[i / 8] >> (7 - i % 8)) & 1) {
+      g2_add(&r, &r, p);
+    }
+  }
+  *o = r;
+}
+
+/** Divides a 256-bit number by a small divisor, which must divide it exactly. */
+static void div_small(uint64_t out[4], const uint64_t in[4], uint64_t divisor) {
+  unsigned __int128 rem = 0;
+  int i;
+  for (i = 3; i >= 0; i--) {
+    unsigned __int128 cur = (rem << 64) | in[i];
+    out[i] = (uint64_t) (cur / divisor);
+    rem = cur % divisor;
+  }
+}
+
+void bn256_init(void) {
+  field_init(&fp, bn256_p);
+
+  fe_from_u64(&fp, &g1_b, 3);
+  fe_from_u64(&fp, &nine, 9);
+  fe_from_u64(&fp, &xi.a, 9);
+  xi.b = fp.one;
+
+  // The twist is y^2 = x^3 + 3 / xi.
+  fp2 b;
+  fp2_inv(&g2_b, &xi);
+  b.a = g1_b;
+  memset(&b.b, 0, sizeof(b.b));
+  fp2_mul(&g2_b, &g2_b, &b);
+
+  int i;
+  for (i = 0; i < 4; i++) {
+    int j;
+    for (j = 0; j < 8; j++) {
+      order_bytes[(3 - i) * 8 + j] = (uint8_t) (bn256_order[i] >> (56 - 8 * j));
+    }
+  }
+
+  uint64_t pm1[4];
+  memcpy(pm1, bn256_p, sizeof(pm1));
+  pm1[0] -= 1;
+  uint64_t exponent[4];
+  div_small(exponent, pm1, 6);
+
+  fp2 delta;
+  fp2_pow(&delta, &xi, exponent);
+
+  // xi^((p^2 - 1) / 6) = delta^(p + 1) = conj(delta) delta, which lies in Fp.
+  fp2 gamma;
+  fp2_conj(&gamma, &delta);
+  fp2_mul(&gamma, &gamma, &delta);
+
+  fp2_one(&frobenius_p[0]);
+  frobenius_p2[0] = fp.one;
+  for (i = 1; i < 6; i++) {
+    fp2_mul(&frobenius_p[i], &frobenius_p[i - 1], &delta);
+    fe_mul(&fp, &frobenius_p2[i], &frobenius_p2[i - 1], &gamma.a);
+  }
+}
+
+static bool g1_decode(struct ec_point* out, const uint8_t in[64]) {
+  fe x, y;
+  if (!fe_from_bytes(&fp, &x, in) || !fe_from_bytes(&fp, &y, in + 32)) {
+    return false;
+  }
+  if (fe_is_zero(&x) && fe_is_zero(&y)) {
+    ec_set_infinity(&fp, out);
+    return true;
+  }
+  if (!ec_is_on_curve(&fp, &g1_b, &x, &y)) {
+    return false;
+  }
+  ec_set_affine(&fp, out, &x, &y);
+  return true;
+}
+
+static void g1_encode(uint8_t out[64], const struct ec_point* p) {
+  if (ec_is_infinity(p)) {
+    memset(out, 0, 64);
+    return;
+  }
+  fe x, y;
+  ec_to_affine(&fp, &x, &y, p);
+  fe_to_bytes(&fp, out, &x);
+  fe_to_bytes(&fp, out + 32, &y);
+}
+
+/** Decodes a G2 point, checking it is on the twist and in the r-torsion. */
+static bool g2_decode(struct g2_point* out, const uint8_t in[128]) {
+  fp2 x, y;
+  if (!fe_from_bytes(&fp, &x.b, in) || !fe_from_bytes(&fp, &x.a, in + 32) ||
+      !fe_from_bytes(&fp, &y.b, in + 64) || !fe_from_bytes(&fp, &y.a, in + 96)) {
+    return false;
+  }
+  if (fp2_is_zero(&x) && fp2_is_zero(&y)) {
+    g2_set_infinity(out);
+    return true;
+  }
+
+  fp2 lhs, rhs;
+  fp2_sqr(&lhs, &y);
+  fp2_sqr(&rhs, &x);
+  fp2_mul(&rhs, &rhs, &x);
+  fp2_add(&rhs, &rhs, &g2_b);
+  if (!fp2_eq(&lhs, &rhs)) {
+    return false;
+  }
+
+  out->x = x;
+  out->y = y;
+  fp2_one(&out->z);
+
+  struct g2_point check;
+  g2_mul(&check, out, order_bytes);
+  return g2_is_infinity(&check);
+}
+
+bool bn256_add(const uint8_t in[128], uint8_t out[64]) {
+  struct ec_point a, b;
+  if (!g1_decode(&a, in) || !g1_decode(&b, in + 64)) {
+    return false;
+  }
+  ec_add(&fp, &a, &a, &b);
+  g1_encode(out, &a);
+  return true;
+}
+
+bool bn256_scalar_mul(const uint8_t in[96], uint8_t out[64]) {
+  struct ec_point a;
+  if (!g1_decode(&a, in)) {
+    return false;
+  }
+  ec_mul(&fp, &a, &a, in + 64);
+  g1_encode(out, &a);
+  return true;
+}
+
+/**
+ * Evaluates at P the line through the twist point T with slope lambda. On the
+ * untwisted curve T is (xt w^2, yt w^3) and the slope is lambda w, so the line
+ * is yp - lambda xp w + (lambda xt - yt) w^3. Vertical lines are omitted, as
+ * they lie in a subfield killed by the final exponentiation.
+ */
+static void line_evaluate(fp12* l, const fp2* lambda, const fp2* xt, const fp2* yt,
+                          const fe* xp, const fe* yp) {
+  memset(l, 0, sizeof(*l));
+  l->c0.c0.a = *yp;
+  fp2_mul_fe(&l->c1.c0, lambda, xp);
+  fp2_neg(&l->c1.c0, &l->c1.c0);
+  fp2_mul(&l->c1.c1, lambda, xt);
+  fp2_sub(&l->c1.c1, &l->c1.c1, yt);
+}
+
+/** Multiplies f by the line through T and Q at P, and sets T to T + Q. */
+static void miller_add_step(fp12* f, fp2* xt, fp2* yt, const fp2* xq, const fp2* yq,
+                            const fe* xp, const fe* yp) {
+  fp2 lambda, t, x3;
+  fp2_sub(&lambda, yq, yt);
+  fp2_sub(&t, xq, xt);
+  fp2_inv(&t, &t);
+  fp2_mul(&lambda, &lambda, &t);
+
+  fp12 l;
+  line_evaluate(&l, &lambda, xt, yt, xp, yp);
+  fp12_mul(f, f, &l);
+
+  fp2_sqr(&x3, &lambda);
+  fp2_sub(&x3, &x3, xt);
+  fp2_sub(&x3, &x3, xq);
+  fp2_sub(&t, xt, &x3);
+  fp2_mul(&t, &t, &lambda);
+  fp2_sub(yt, &t, yt);
+  *xt = x3;
+}
+
+/** Squares f, multiplies it by the tangent at T evaluated at P, and doubles T. */
+static void miller_double_step(fp12* f, fp2* xt, fp2* yt, const fe* xp, const fe* yp) {
+  fp2 lambda, t, x3;
+  fp2_sqr(&lambda, xt);
+  fp2_add(&t, &lambda, &lambda);
+  fp2_add(&lambda, &lambda, &t);
+  fp2_add(&t, yt, yt);
+  fp2_inv(&t, &t);
+  fp2_mul(&lambda, &lambda, &t);
+
+  fp12 l;
+  line_evaluate(&l, &lambda, xt, yt, xp, yp);
+  fp12_sqr(f, f);
+  fp12_mul(f, f, &l);
+
+  fp2_sqr(&x3, &lambda);
+  fp2_sub(&x3, &x3, xt);
+  fp2_sub(&x3, &x3, xt);
+  fp2_sub(&t, xt, &x3);
+  fp2_mul(&t, &t, &lambda);
+  fp2_sub(yt, &t, yt);
+  *xt = x3;
+}
+
+/** The optimal ate Miller loop, f_{6u+2,Q}(P) times the two Frobenius lines. */
+static void miller_loop(fp12* f, const fe* xp, const fe* yp, const fp2* xq, const fp2* yq) {
+  unsigned __int128 loop = (unsigned __int128) bn256_u * 6 + 2;
+  int top = 127;
+  while (!((loop >> top) & 1)) {
+    top--;
+  }
+
+  fp2 xt = *xq, yt = *yq;
+  fp12_one(f);
+  int i;
+  for (i = top - 1; i >= 0; i--) {
+    miller_double_step(f, &xt, &yt, xp, yp);
+    if ((loop >> i) & 1) {
+      miller_add_step(f, &xt, &yt, xq, yq, xp, yp);
+    }
+  }
+
+  // Q1 = pi(Q) and Q2 = -pi^2(Q), mapped back onto the twist.
+  fp2 x1, y1, x2, y2;
+  fp2_conj(&x1, xq);
+  fp2_mul(&x1, &x1, &frobenius_p[2]);
+  fp2_conj(&y1, yq);
+  fp2_mul(&y1, &y1, &frobenius_p[3]);
+  miller_add_step(f, &xt, &yt, &x1, &y1, xp, yp);
+
+  fp2_mul_fe(&x2, xq, &frobenius_p2[2]);
+  fp2_mul_fe(&y2, yq, &frobenius_p2[3]);
+  fp2_neg(&y2, &y2);
+  miller_add_step(f, &xt, &yt, &x2, &y2, xp, yp);
+}
+
+/** Raises f to (p^12 - 1) / r. */
+static void final_exponentiation(fp12* out, const fp12* f) {
+  fp12 t0, t1, t2, inv;
+
+  // Easy part: f^((p^6 - 1)(p^2 + 1)).
+  fp12_conj(&t1, f);
+  fp12_inv(&inv, f);
+  fp12_mul(&t1, &t1, &inv);
+  fp12_frobenius_p2(&t2, &t1);
+  fp12_mul(&t1, &t1, &t2);
+
+  // Hard part: (p^4 - p^2 + 1) / r, using the addition chain of Devegili,
+  // Scott and Dahab in terms of u.
+  fp12 fp1, fp2_, fp3, fu, fu2, fu3, y0, y1, y2, y3, y4, y5, y6, fu2p, fu3p;
+  fp12_frobenius(&fp1, &t1);
+  fp12_frobenius_p2(&fp2_, &t1);
+  fp12_frobenius(&fp3, &fp2_);
+
+  fp12_pow_u(&fu, &t1);
+  fp12_pow_u(&fu2, &fu);
+  fp12_pow_u(&fu3, &fu2);
+
+  fp12_frobenius(&y3, &fu);
+  fp12_frobenius(&fu2p, &fu2);
+  fp12_frobenius(&fu3p, &fu3);
+  fp12_frobenius_p2(&y2, &fu2);
+
+  fp12_mul(&y0, &fp1, &fp2_);
+  fp12_mul(&y0, &y0, &fp3);
+
+  fp12_conj(&y1, &t1);
+  fp12_conj(&y5, &fu2);
+  fp12_conj(&y3, &y3);
+  fp12_mul(&y4, &fu, &fu2p);
+  fp12_conj(&y4, &y4);
+  fp12_mul(&y6, &fu3, &fu3p);
+  fp12_conj(&y6, &y6);
+
+  fp12_sqr(&t0, &y6);
+  fp12_mul(&t0, &t0, &y4);
+  fp12_mul(&t0, &t0, &y5);
+  fp12_mul(&t1, &y3, &y5);
+  fp12_mul(&t1, &t1, &t0);
+  fp12_mul(&t0, &t0, &y2);
+  fp12_sqr(&t1, &t1);
+  fp12_mul(&t1, &t1, &t0);
+  fp12_sqr(&t1, &t1);
+  fp12_mul(&t0, &t1, &y1);
+  fp12_mul(&t1, &t1, &y0);
+  fp12_sqr(&t0, &t0);
+  fp12_mul(out, &t0, &t1);
+}
+
+bool bn256_pairing_check(const uint8_t* in, size_t pair_count, bool* result) {
+  fp12 acc;
+  fp12_one(&acc);
+
+  size_t i;
+  for (i = 0; i < pair_count; i++) {
+    struct ec_point p;
+    struct g2_point q;
+    if (!g1_decode(&p, in + i * 192) || !g2_decode(&q, in + i * 192 + 64)) {
+      return false;
+    }
+    // Pairings with the point at infinity are one.
+    if (ec_is_infinity(&p) || g2_is_infinity(&q)) {
+      continue;
+    }
+
+    fp12 f;
+    miller_loop(&f, &p.x, &p.y, &q.x, &q.y);
+    fp12_mul(&acc, &acc, &f);
+  }
+
+  fp12 e;
+  final_exponentiation(&e, &acc);
+  *result = fp12_is_one(&e);
+  return true;
+}
@@ -0,0 +1,29 @@
+#ifndef EVMC_JS_BN256_H
+#define EVMC_JS_BN256_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The alt_bn128 (BN254) curve operations of EIP-196 and EIP-197. Points are
+ * big-endian: G1 as x || y, G2 as x_im || x_re || y_im || y_re, with all zeros
+ * encoding the point at infinity.
+ */
+
+/** Sets up the curve and tower constants. Must be called once before use. */
+void bn256_init(void);
+
+/** Adds two G1 points. Returns false if an input is not a valid point. */
+bool bn256_add(const uint8_t in[128], uint8_t out[64]);
+
+/** Multiplies a G1 point by a scalar. Returns false for an invalid point. */
+bool bn256_scalar_mul(const uint8_t in[96], uint8_t out[64]);
+
+/**
+ * Checks whether the product of the pairings of pair_count (G1, G2) pairs,
+ * 192 bytes each, is one. Returns false if any input point is invalid.
+ */
+bool bn256_pairing_check(const uint8_t* in, size_t pair_count, bool* result);
+
+#endif
@@ -0,0 +1,89 @@
+#include "completion.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <uv.h>
+
+struct evmc_completion_queue {
+  uv_mutex_t lock;
+  struct evmc_completion* head;
+  struct evmc_completion* tail;
+  /** If the main thread has been woken and not yet found the queue empty */
+  bool scheduled;
+  struct evmc_completion_stats stats;
+};
+
+struct evmc_completion_queue* evmc_completion_queue_create(void) {
+  struct evmc_completion_queue* queue =
+      (struct evmc_completion_queue*) calloc(1, sizeof(struct evmc_completion_queue));
+  if (queue == NULL) {
+    return NULL;
+  }
+  uv_mutex_init(&queue->lock);
+  return queue;
+}
+
+void evmc_completion_queue_destroy(struct evmc_completion_queue* queue) {
+  uv_mutex_destroy(&queue->lock);
+  free(queue);
+}
+
+bool evmc_completion_queue_push(struct evmc_completion_queue* queue,
+                                struct evmc_completion* completion) {
+  bool wake;
+  completion->next = NULL;
+
+  uv_mutex_lock(&queue->lock);
+  if (queue->tail == NULL) {
+    queue->head = completion;
+  } else {
+    queue->tail->next = completion;
+  }
+  queue->tail = completion;
+  wake = !queue->scheduled;
+  queue->scheduled = true;
+  uv_mutex_unlock(&queue->lock);
+
+  return wake;
+}
+
+size_t evmc_completion_queue_take(struct evmc_completion_queue* queue,
+                                  struct evmc_completion* batch[EVMC_COMPLETION_BATCH_MAX],
+                                  bool* more) {
+  size_t count = 0;
+  size_t bucket = 0;
+
+  uv_mutex_lock(&queue->lock);
+  while (queue->head != NULL && count < EVMC_COMPLETION_BATCH_MAX) {
+    batch[count++] = queue->head;
+    queue->head = queue->head->next;
+  }
+  if (queue->head == NULL) {
+    queue->tail = NULL;
+  }
+  *more = queue->head != NULL;
+  queue->scheduled = *more;
+
+  if (count != 0) {
+    while ((count >> (bucket + 1)) != 0 && bucket + 1 < EVMC_COMPLETION_HISTOGRAM_SIZE) {
+      bucket++;
+    }
+    queue->stats.completions += count;
+    queue->stats.batches++;
+    queue->stats.histogram[bucket]++;
+    if (count > queue->stats.largest_batch) {
+      queue->stats.largest_batch = count;
+    }
+  }
+  uv_mutex_unlock(&queue->lock);
+
+  return count;
+}
+
+void evmc_completion_queue_get_stats(struct evmc_completion_queue* queue,
+                                     struct evmc_completion_stats* stats) {
+  uv_mutex_lock(&queue->lock);
+  memcpy(stats, &queue->stats, sizeof(*stats));
+  uv_mutex_unlock(&queue->lock);
+}
@@ -0,0 +1,65 @@
+#ifndef EVMC_JS_COMPLETION_H
+#define EVMC_JS_COMPLETION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Gathers finished executions from worker threads so the main thread can hand
+ * them back to JS in batches, with one wakeup per batch instead of one per
+ * execution.
+ *
+ * Workers push completions, and only the push which finds the queue idle has
+ * to wake the main thread. The main thread then takes completions in batches
+ * of bounded size, and must run again for as long as some are left, so
+ * completions keep flowing even while workers keep pushing. A queue may be
+ * pushed to from any number of threads at once.
+ */
+
+/** Largest number of completions taken at once. */
+#define EVMC_COMPLETION_BATCH_MAX 64
+
+/** Batches are counted by size in buckets of 1, 2-3, 4-7, ... up to the maximum. */
+#define EVMC_COMPLETION_HISTOGRAM_SIZE 7
+
+/** Link of a completion, embedded in whatever has completed. */
+struct evmc_completion {
+  struct evmc_completion* next;
+};
+
+struct evmc_completion_stats {
+  uint64_t completions;
+  uint64_t batches;
+  uint64_t largest_batch;
+  /** Batches counted by the power of two their size falls in. */
+  uint64_t histogram[EVMC_COMPLETION_HISTOGRAM_SIZE];
+};
+
+struct evmc_completion_queue;
+
+struct evmc_completion_queue* evmc_completion_queue_create(void);
+
+void evmc_completion_queue_destroy(struct evmc_completion_queue* queue);
+
+/**
+ * Appends a completion. Returns true if the queue was idle, in which case the
+ * caller must wake the main thread to take it.
+ */
+bool evmc_completion_queue_push(struct evmc_completion_queue* queue,
+                                struct evmc_completion* completion);
+
+/**
+ * Takes up to EVMC_COMPLETION_BATCH_MAX completions in the order they were
+ * pushed. Returns how many were taken, and sets *more if some are left, in
+ * which case the caller must take again later. Otherwise the queue is idle
+ * until the next push.
+ */
+size_t evmc_completion_queue_take(struct evmc_completion_queue* queue,
+                                  struct evmc_completion* batch[EVMC_COMPLETION_BATCH_MAX],
+                                  bool* more);
+
+void evmc_completion_queue_get_stats(struct evmc_completion_queue* queue,
+                                     struct evmc_completion_stats* stats);
+
+#endif
@@ -1,5 +1,6 @@
 import * as benchmark from 'benchmark';
 import * as path from 'path';
+import {PerformanceObserver} from 'perf_hooks';
 import * as process from 'process';
 import * as util from 'util';
 
@@ -13,6 +14,18 @@ interface BenchmarkRun {
   stats: benchmark.Stats;
 }
 
+// Time spent in garbage collection, and async test runs, since the last cycle.
+let gcNanos = 0;
+let asyncRuns = 0;
+// Garbage collections since the start.
+let gcCount = 0;
+new PerformanceObserver(list => {
+  for (const entry of list.getEntries()) {
+    gcNanos += entry.duration * 1000000;
+    gcCount++;
+  }
+}).observe({entryTypes: ['gc']});
+
 // This file contains the benchmark test suite. It includes the benchmark and
 // some lightweight boilerplate code for running benchmark.js. To
 // run the benchmarks, execute `npm run benchmark` from the package directory.
@@ -30,9 +43,15 @@ const runSuite =
           const ops = benchmarkRun.hz.toFixed(benchmarkRun.hz < 100 ? 2 : 0);
           const err = stats.rme.toFixed(2);
 
-          console.log(
-              `${benchmarkRun.name}: ${ops}±${err}% ops/s ${meanInNanos}±${
-                  stdDevInNanos} ns/op (${runs} run${runs === 0 ? '' : 's'})`);
+          const gc = asyncRuns === 0 ?
+              '' :
+              ` gc ${(gcNanos / asyncRuns).toFixed(2)} ns/op`;
+          gcNanos = 0;
+          asyncRuns = 0;
+
+          console.log(`${benchmarkRun.name}: ${ops}±${err}% ops/s ${
+              meanInNanos}±${stdDevInNanos} ns/op${gc} (${runs} run${
+              runs === 0 ? '' : 's'})`);
         });
 
         suite.on('complete', () => {
@@ -75,6 +94,7 @@ const addAsyncTest = <T>(
       }
     },
     fn: (deferred: BenchmarkDeferrable) => {
+      asyncRuns++;
       asyncTest(state).then(() => deferred.resolve());
     }
   });
@@ -140,17 +160,20 @@ const EVM_MESSAGE = {
 
 
 class TestEVM extends Evmc {
+  /** If storage is read synchronously, as from memory, or from a promise. */
+  syncStorage = false;
+
   async getAccountExists(account: bigint) {
     // Accounts always exist
     return true;
   }
 
-  async getStorage(account: bigint, key: bigint) {
+  getStorage(account: bigint, key: bigint): Promise<bigint>|bigint {
     // Our "test" storage always returns the magic number
-    if (key === STORAGE_ADDRESS) {
-      return STORAGE_VALUE;
+    if (key !== STORAGE_ADDRESS) {
+      throw new Error(`Invalid test addresss (got ${key.toString(16)}`);
     }
-    throw new Error(`Invalid test addresss (got ${key.toString(16)}`);
+    return this.syncStorage ? STORAGE_VALUE : Promise.resolve(STORAGE_VALUE);
   }
 
   async setStorage(account: bigint, key: bigint, val: bigint) {
@@ -326,11 +349,135 @@ addAsyncTest('parallel execute 10x store contract', async () => {
   }));
 });
 
+// PUSH1 0x42 SLOAD POP, repeated, then STOP
+const SLOAD_COUNT = 32;
+const SLOAD_CONTRACT = Buffer.from('60425450'.repeat(SLOAD_COUNT), 'hex');
+
+/**
+ * Measures the round trip of synchronously answered host calls, with the main
+ * loop either idle or kept busy by 50us tasks in between.
+ */
+const measureHostCalls =
+    async (name: string, e: TestEVM, busy: boolean): Promise<void> => {
+  let stopped = false;
+  const burn = () => {
+    const end = process.hrtime.bigint() + 50000n;
+    while (process.hrtime.bigint() < end) {
+      // The task keeps the loop from running callbacks.
+    }
+    if (!stopped) {
+      setImmediate(burn);
+    }
+  };
+  if (busy) {
+    setImmediate(burn);
+  }
+  const runs = 500;
+  const before = Evmc.handoffStats;
+  const start = process.hrtime.bigint();
+  for (let i = 0; i < runs; i++) {
+    await e.execute(SIMPLE_MESSAGE, SLOAD_CONTRACT);
+  }
+  const nanos = Number(process.hrtime.bigint() - start);
+  stopped = true;
+  const after = Evmc.handoffStats;
+  const calls = after.waits - before.waits;
+  console.log(`${name}: ${(nanos / calls).toFixed(2)} ns/call (${
+      after.spun - before.spun}/${calls} answered while spinning)`);
+};
+
+const hostCallLatencyRun = async () => {
+  console.log('\nRunning host call latency...');
+  const e = new TestEVM(alethPath);
+  e.syncStorage = true;
+  for (const spinNs of [0, 20000]) {
+    e.useHandoffSpin(spinNs);
+    // Warm up the thread pool and the VM.
+    await measureHostCalls(`warmup spin ${spinNs}ns`, e, false);
+    await measureHostCalls(`idle loop, spin ${spinNs}ns`, e, false);
+    await measureHostCalls(`busy loop, spin ${spinNs}ns`, e, true);
+  }
+  e.release();
+};
+
+// Reads the balance of the destination and slot 0x42 of it, 8 times each,
+// then STOP
+const ACCOUNT_READ_CONTRACT = Buffer.from(
+    `73${TX_DESTINATION.toString(16).padStart(40, '0')}3150${
+        '60425450'}`.repeat(8) +
+        '00',
+    'hex');
+
+/**
+ * Counts the BigInts created for callback arguments, and the garbage
+ * collections they cause, with interning off and on.
+ */
+const internRun = async () => {
+  console.log('\nRunning BigInt interning...');
+  const e = new TestEVM(alethPath);
+  e.syncStorage = true;
+  const runs = 5000;
+  for (const capacity of [0, 256]) {
+    e.useInterning(capacity);
+    // Warm up the thread pool and the VM.
+    for (let i = 0; i < 100; i++) {
+      await e.execute(SIMPLE_MESSAGE, ACCOUNT_READ_CONTRACT);
+    }
+    const before = e.internStats;
+    const gcBefore = gcCount;
+    const start = process.hrtime.bigint();
+    for (let i = 0; i < runs; i++) {
+      await e.execute(SIMPLE_MESSAGE, ACCOUNT_READ_CONTRACT);
+    }
+    const nanos = Number(process.hrtime.bigint() - start);
+    // Let the observer catch up with the last collections.
+    await new Promise(resolve => setImmediate(resolve));
+    const after = e.internStats;
+    const created = after.misses - before.misses;
+    const reused = after.hits - before.hits;
+    console.log(`interning ${capacity} slots: ${
+        (created / runs).toFixed(2)} BigInts created/op, ${
+        (reused / runs).toFixed(2)} reused/op, ${
+        ((gcCount - gcBefore) * 1000 / runs).toFixed(2)} gcs/1000 ops, ${
+        (nanos / runs).toFixed(2)} ns/op`);
+  }
+  e.release();
+};
+
+/**
+ * Measures the time from creating an EVM to the end of its first execution,
+ * which includes starting pool threads and setting up callbacks, first cold
+ * and then after a prewarm.
+ */
+const startupRun = async () => {
+  console.log('\nRunning startup...');
+  const timeToFirstExecution = async (name: string) => {
+    const start = process.hrtime.bigint();
+    const e = new TestEVM(alethPath);
+    const created = process.hrtime.bigint();
+    await e.execute(SIMPLE_MESSAGE, SINGLE_STORE_CONTRACT);
+    const executed = process.hrtime.bigint();
+    e.release();
+    console.log(`${name}: create ${Number(created - start) / 1e6}ms, first execution ${
+        Number(executed - created) / 1e6}ms, time to first execution ${
+        Number(executed - start) / 1e6}ms`);
+  };
+  // Runs before anything has executed, so the thread pool is still cold.
+  await timeToFirstExecution('cold');
+  const stats = await Evmc.prewarm(alethPath, {instances: 1});
+  console.log(`prewarm: ${Number(stats.elapsedNs) / 1e6}ms, ${
+      stats.pooled} instances pooled, ${stats.threads} threads`);
+  await timeToFirstExecution('prewarmed');
+};
+
 const evmExeuctionRun = async () => {
+  await startupRun();
   await runSuite(suite, 'evmc_execution');
   evm.map(e => {
     e.release();
   });
+  await hostCallLatencyRun();
+  await internRun();
 };
 
 evmExeuctionRun();
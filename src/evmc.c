@@ -9,35 +9,203 @@
 #include "evmc/evmc.h"
 #include "evmc/loader.h"
 
+#include "account_cache.h"
+#include "arena.h"
+#include "completion.h"
+#include "handoff.h"
+#include "intern.h"
+#include "precompiles.h"
+#include "prewarm.h"
+#include "profiler.h"
+#include "result_cache.h"
+#include "rlp.h"
+#include "scheduler.h"
+#include "snapshot.h"
+#include "state.h"
+#include "tiering.h"
+#include "trace.h"
+#include "transaction.h"
+#include "witness.h"
+#include "write_set.h"
+
+struct js_continuation;
 
 struct evmc_js_context
 {
-    /** The Host interface. */
-    const struct evmc_host_interface* host;
-
     /** The EVMC instance. */
     struct evmc_instance* instance;
 
     /** Reference to evm object */
     napi_ref object;
 
-    /** callbacks **/
-    napi_threadsafe_function account_exists_fn;
-    napi_threadsafe_function get_storage_fn;
-    napi_threadsafe_function set_storage_fn;
-    napi_threadsafe_function get_balance_fn;
-    napi_threadsafe_function get_code_size_fn;
-    napi_threadsafe_function get_code_hash_fn;
-    napi_threadsafe_function copy_code_fn;
-    napi_threadsafe_function selfdestruct_fn;
-    napi_threadsafe_function call_fn;
-    napi_threadsafe_function get_tx_context_fn;
-    napi_threadsafe_function get_block_hash_fn;
-    napi_threadsafe_function emit_log_fn;
+    /** The object holding the callbacks, which are bound on first use, see get_host_callback */
+    napi_ref callbacks;
+    napi_ref host_callbacks[EVMC_HOST_CALL_COUNT];
+    /** Carries host calls to the callbacks, created with the first execution, see host_call_js */
+    napi_threadsafe_function host_call_fn;
+    /** Created with the first execution, like host_call_fn */
     napi_threadsafe_function completer;
 
+    /** Continuations not waiting on a promise, to be reused */
+    struct js_continuation* free_continuations;
+    /** Continuations waiting on a promise, which outlive the EVM if it is collected first */
+    struct js_continuation* waiting_continuations;
+
+    /** Snapshot used by new executions, if any */
+    struct evmc_snapshot* snapshot;
+
+    /** If calls to precompiled contracts are answered without calling JS */
+    bool native_precompiles;
+
+    /** Account metadata cache shared by all executions, if any */
+    struct evmc_account_cache* account_cache;
+
+    /** Cache of static execution results shared by all executions, if any */
+    struct evmc_result_cache* result_cache;
+
+    /** Trace new executions are recorded to, if any */
+    struct evmc_trace_writer* recorder;
+
+    /** Profiler new executions are counted in, if any */
+    struct evmc_profiler* profiler;
+
+    /** VMs new executions are routed between, with instance as the base */
+    struct evmc_tiering* tiering;
+
+    /** Finished executions waiting to be handed back to JS by completer */
+    struct evmc_completion_queue* completions;
+
+    /** Queues executions for the thread pool by priority */
+    struct evmc_scheduler* scheduler;
+
+    /** How long a host call spins for its answer before sleeping, in nanoseconds */
+    uint64_t handoff_spin_ns;
+
+    /** Addresses and keys recently passed to callbacks, if interning, see create_interned_bigint */
+    struct evmc_intern_table* intern_table;
+    /** Array of the BigInt of each slot of intern_table */
+    napi_ref interned;
+    /** Callback arguments found interned, and those which had to be created */
+    uint64_t intern_hits;
+    uint64_t intern_misses;
+
     /** if freed */
     bool released;
+    /** Replays running on the thread pool, which keep the VM until they complete */
+    size_t replays;
+
+    /** The environment the EVM was created in */
+    napi_env env;
+};
+
+/** A log of the top-level message of a transaction, kept for its receipt */
+struct js_log {
+  struct js_log* next;
+  evmc_address address;
+  uint8_t* data;
+  size_t data_size;
+  evmc_bytes32* topics;
+  size_t topics_count;
+};
+
+/** What an execution of a whole transaction adds, see execute_transaction */
+struct js_transaction {
+  uint64_t nonce;
+  evmc_uint256be gas_price;
+  int64_t gas_limit;
+  /** Refunds counted from the host's answers while the message runs */
+  int64_t refund;
+  bool selfdestructed;
+  /** Logs in the order they were emitted, in the arena of the execution */
+  struct js_log* logs;
+  struct js_log** last_log;
+  /** Why the transaction could not run, or NULL if it ran */
+  const char* error;
+  int64_t gas_used;
+  int64_t gas_refund;
+  evmc_uint256be fee;
+};
+
+struct js_execution_context {
+  /** The Host interface. Must come first, as this is the evmc_context of the execution. */
+  const struct evmc_host_interface* host;
+
+  /** Owns the context itself, the code and input, and nested call outputs */
+  struct evmc_arena* arena;
+
+  struct evmc_js_context* context;
+  struct evmc_message message;
+  enum evmc_revision revision;
+  struct evmc_result result;
+  
+  uint8_t* code;
+  size_t code_size;
+
+  /** Snapshot serving state reads for this execution, or NULL to ask JS */
+  struct evmc_snapshot* snapshot;
+
+  /** Witness serving all state reads of a stateless execution, or NULL */
+  struct evmc_witness* witness;
+  /** The first proof the witness was missing, which fails the execution */
+  char* witness_error;
+
+  /** Write set the storage writes and self-destructs are journaled in, or NULL */
+  struct evmc_write_set* write_set;
+
+  /** Flag set to abort the execution, or NULL if it cannot be aborted */
+  struct js_abort_handle* abort;
+  napi_ref abort_ref;
+  /** The host call waiting on a promise, which an abort answers at once. Main thread only. */
+  struct js_continuation* awaiting;
+  /** If the execution had been aborted when it finished */
+  bool aborted;
+  enum evmc_priority priority;
+
+  /** Account metadata cache used by this execution, if any */
+  struct evmc_account_cache* account_cache;
+
+  /** Result cache this execution's writes invalidate, and which may answer it if it is static */
+  struct evmc_result_cache* result_cache;
+  /** What a static execution run on the memoizing host has read, see memo_host_interface */
+  struct evmc_read_set read_set;
+
+  /** VMs this execution may run on */
+  struct evmc_tiering* tiering;
+
+  /** Trace this execution is appended to once done, if any */
+  struct evmc_trace_writer* recorder;
+  /** The recorded execution so far */
+  struct evmc_trace_buffer trace;
+
+  /** Profiler this execution is counted in once done, if any */
+  struct evmc_profiler* profiler;
+  /** Host time and calls of the current run, gathered only when profiled */
+  struct evmc_profile_sample profile;
+
+  /** The state view the execution runs on, if any */
+  struct evmc_state* state;
+  /** If this is a gas estimate, which runs the execution several times */
+  bool estimate;
+  /** The lowest gas limit a gas estimate may return */
+  int64_t gas_low;
+  /** The highest gas limit of a gas estimate, and then the estimate */
+  int64_t gas_high;
+  /** If the deadline passed before the execution started, so it never ran */
+  bool expired;
+  /** The transaction run around the message, if this is one */
+  struct js_transaction* transaction;
+
+  /** The object passed to every callback of the execution, see get_execution_handle */
+  napi_ref handle;
+  /** If the execution brought its own transaction context, which is then never asked for */
+  bool has_tx_context;
+  struct evmc_tx_context tx_context;
+  
+  napi_deferred deferred;
+  napi_value promise;
+
+  /** Link in the completion queue once finished */
+  struct evmc_completion completion;
 };
 
 
@@ -66,8 +234,47 @@ void create_bigint_from_evmc_address(napi_env env, const evmc_address* address,
   assert(status == napi_ok);
 }
 
+/**
+ * Creates the BigInt of a callback argument, or reuses the one last created
+ * for the same value if the EVM interns them. Only called on the thread of the
+ * EVM, from callbacks.
+ */
+void create_interned_bigint(napi_env env, struct evmc_js_context* ctx, const evmc_bytes32* bytes,
+                            napi_value* out) {
+  if (ctx->intern_table == NULL) {
+    ctx->intern_misses++;
+    create_bigint_from_evmc_bytes32(env, bytes, out);
+    return;
+  }
+
+  napi_status status;
+  napi_value interned;
+  status = napi_get_reference_value(env, ctx->interned, &interned);
+  assert(status == napi_ok);
+
+  uint32_t slot;
+  if (evmc_intern_table_find(ctx->intern_table, bytes, &slot)) {
+    ctx->intern_hits++;
+    status = napi_get_element(env, interned, slot, out);
+    assert(status == napi_ok);
+    return;
+  }
+  ctx->intern_misses++;
+  create_bigint_from_evmc_bytes32(env, bytes, out);
+  status = napi_set_element(env, interned, slot, *out);
+  assert(status == napi_ok);
+}
+
+void create_interned_bigint_from_evmc_address(napi_env env, struct evmc_js_context* ctx,
+                                              const evmc_address* address, napi_value* out) {
+  evmc_bytes32 padded = {{0}};
+  memcpy(padded.bytes + sizeof(padded.bytes) - sizeof(address->bytes), address->bytes, sizeof(address->bytes));
+  create_interned_bigint(env, ctx, &padded, out);
+}
+
 void get_evmc_bytes32_from_bigint(napi_env env, napi_value in, evmc_bytes32* out) {
-  uint64_t temp[4];
+  // Zero has no words at all.
+  uint64_t temp[4] = {0};
   size_t result_word_count = 4;
   int sign_bit = 0;
 
@@ -103,53 +310,416 @@ void get_evmc_address_from_bigint(napi_env env, napi_value in, evmc_address* out
   *((uint32_t*)(out->bytes + 16)) = __builtin_bswap32(*(uint32_t*)(tempAsBytes));
 }
 
+/*
+ * Messages passed to the call callback and results of executions are
+ * instances of classes defined once per environment, so V8 sees a single
+ * shape for each. Their fields are accessors on the prototype which convert
+ * from a native copy on access, and the Buffers, the only fields worth
+ * keeping, are created once on first access.
+ */
+
+struct js_addon_data {
+  napi_ref message_class;
+  napi_ref result_class;
+};
+
+enum js_message_field {
+  JS_MESSAGE_KIND,
+  JS_MESSAGE_FLAGS,
+  JS_MESSAGE_DEPTH,
+  JS_MESSAGE_GAS,
+  JS_MESSAGE_SENDER,
+  JS_MESSAGE_DESTINATION,
+  JS_MESSAGE_INPUT_DATA,
+  JS_MESSAGE_VALUE
+};
+
+struct js_message {
+  struct evmc_message message;
+  /** The input data Buffer, once created */
+  napi_ref input_data;
+  uint8_t input[];
+};
+
+enum js_result_field {
+  JS_RESULT_STATUS_CODE,
+  JS_RESULT_GAS_LEFT,
+  JS_RESULT_OUTPUT_DATA,
+  JS_RESULT_CREATE_ADDRESS
+};
+
+struct js_result {
+  enum evmc_status_code status_code;
+  int64_t gas_left;
+  evmc_address create_address;
+  size_t output_size;
+  /** The output data Buffer, once created */
+  napi_ref output_data;
+  uint8_t output[];
+};
+
+napi_value js_construct(napi_env env, napi_callback_info info) {
+  napi_value self;
+  napi_status status = napi_get_cb_info(env, info, NULL, NULL, &self, NULL);
+  assert(status == napi_ok);
+  return self;
+}
+
+/** Returns the Buffer behind ref, creating it from bytes the first time. */
+napi_value get_lazy_buffer(napi_env env, napi_ref* ref, const uint8_t* bytes, size_t size) {
+  napi_status status;
+  napi_value buffer;
+  if (*ref != NULL) {
+    status = napi_get_reference_value(env, *ref, &buffer);
+    assert(status == napi_ok);
+    return buffer;
+  }
+  void* data;
+  status = napi_create_buffer_copy(env, size, bytes, &data, &buffer);
+  assert(status == napi_ok);
+  status = napi_create_reference(env, buffer, 1, ref);
+  assert(status == napi_ok);
+  return buffer;
+}
+
+napi_value js_message_get(napi_env env, napi_callback_info info) {
+  napi_status status;
+  napi_value self;
+  void* field;
+  status = napi_get_cb_info(env, info, NULL, NULL, &self, &field);
+  assert(status == napi_ok);
+
+  struct js_message* wrapped;
+  status = napi_unwrap(env, self, (void**) &wrapped);
+  if (status != napi_ok) {
+    napi_throw_error(env, "EINVAL", "Messages are only created by the binding");
+    return NULL;
+  }
+  const struct evmc_message* msg = &wrapped->message;
+
+  napi_value out;
+  switch ((enum js_message_field) (intptr_t) field) {
+    case JS_MESSAGE_KIND:
+      status = napi_create_int32(env, msg->kind, &out);
+      break;
+    case JS_MESSAGE_FLAGS:
+      status = napi_create_uint32(env, msg->flags, &out);
+      break;
+    case JS_MESSAGE_DEPTH:
+      status = napi_create_int32(env, msg->depth, &out);
+      break;
+    case JS_MESSAGE_GAS:
+      status = napi_create_bigint_int64(env, msg->gas, &out);
+      break;
+    case JS_MESSAGE_SENDER:
+      create_bigint_from_evmc_address(env, &msg->sender, &out);
+      break;
+    case JS_MESSAGE_DESTINATION:
+      create_bigint_from_evmc_address(env, &msg->destination, &out);
+      break;
+    case JS_MESSAGE_INPUT_DATA:
+      out = get_lazy_buffer(env, &wrapped->input_data, msg->input_data, msg->input_size);
+      break;
+    case JS_MESSAGE_VALUE:
+      create_bigint_from_evmc_bytes32(env, &msg->value, &out);
+      break;
+  }
+  assert(status == napi_ok);
+  return out;
+}
+
+napi_value js_result_get(napi_env env, napi_callback_info info) {
+  napi_status status;
+  napi_value self;
+  void* field;
+  status = napi_get_cb_info(env, info, NULL, NULL, &self, &field);
+  assert(status == napi_ok);
+
+  struct js_result* wrapped;
+  status = napi_unwrap(env, self, (void**) &wrapped);
+  if (status != napi_ok) {
+    napi_throw_error(env, "EINVAL", "Results are only created by the binding");
+    return NULL;
+  }
+
+  napi_value out;
+  switch ((enum js_result_field) (intptr_t) field) {
+    case JS_RESULT_STATUS_CODE:
+      status = napi_create_int32(env, wrapped->status_code, &out);
+      break;
+    case JS_RESULT_GAS_LEFT:
+      status = napi_create_bigint_int64(env, wrapped->gas_left, &out);
+      break;
+    case JS_RESULT_OUTPUT_DATA:
+      out = get_lazy_buffer(env, &wrapped->output_data, wrapped->output, wrapped->output_size);
+      break;
+    case JS_RESULT_CREATE_ADDRESS:
+      // Only successful creates have an address.
+      if (wrapped->status_code == EVMC_SUCCESS) {
+        create_bigint_from_evmc_address(env, &wrapped->create_address, &out);
+      } else {
+        status = napi_get_undefined(env, &out);
+      }
+      break;
+  }
+  assert(status == napi_ok);
+  return out;
+}
+
+void js_message_finalize(napi_env env, void* finalize_data, void* finalize_hint) {
+  struct js_message* wrapped = (struct js_message*) finalize_data;
+  if (wrapped->input_data != NULL) {
+    napi_delete_reference(env, wrapped->input_data);
+  }
+  free(wrapped);
+}
+
+void js_result_finalize(napi_env env, void* finalize_data, void* finalize_hint) {
+  struct js_result* wrapped = (struct js_result*) finalize_data;
+  if (wrapped->output_data != NULL) {
+    napi_delete_reference(env, wrapped->output_data);
+  }
+  free(wrapped);
+}
+
+void js_addon_data_finalize(napi_env env, void* finalize_data, void* finalize_hint) {
+  struct js_addon_data* addon = (struct js_addon_data*) finalize_data;
+  napi_delete_reference(env, addon->message_class);
+  napi_delete_reference(env, addon->result_class);
+  free(addon);
+}
+
+/** Slots of the interning table of a new EVM, see create_interned_bigint */
+#define DEFAULT_INTERN_CAPACITY 256
+
+#define JS_FIELD(name, getter, field) \
+  { name, NULL, NULL, getter, NULL, NULL, napi_enumerable, (void*) (intptr_t) (field) }
+
+/** Defines the message and result classes of this environment. */
+void define_classes(napi_env env) {
+  napi_status status;
+  struct js_addon_data* addon = (struct js_addon_data*) malloc(sizeof(struct js_addon_data));
+
+  napi_property_descriptor message_fields[] = {
+    JS_FIELD("kind", js_message_get, JS_MESSAGE_KIND),
+    JS_FIELD("flags", js_message_get, JS_MESSAGE_FLAGS),
+    JS_FIELD("depth", js_message_get, JS_MESSAGE_DEPTH),
+    JS_FIELD("gas", js_message_get, JS_MESSAGE_GAS),
+    JS_FIELD("sender", js_message_get, JS_MESSAGE_SENDER),
+    JS_FIELD("destination", js_message_get, JS_MESSAGE_DESTINATION),
+    JS_FIELD("inputData", js_message_get, JS_MESSAGE_INPUT_DATA),
+    JS_FIELD("value", js_message_get, JS_MESSAGE_VALUE),
+  };
+  napi_value message_class;
+  status = napi_define_class(env, "EvmcMessage", NAPI_AUTO_LENGTH, js_construct, NULL,
+                             sizeof(message_fields) / sizeof(message_fields[0]), message_fields,
+                             &message_class);
+  assert(status == napi_ok);
+  status = napi_create_reference(env, message_class, 1, &addon->message_class);
+  assert(status == napi_ok);
+
+  napi_property_descriptor result_fields[] = {
+    JS_FIELD("statusCode", js_result_get, JS_RESULT_STATUS_CODE),
+    JS_FIELD("gasLeft", js_result_get, JS_RESULT_GAS_LEFT),
+    JS_FIELD("outputData", js_result_get, JS_RESULT_OUTPUT_DATA),
+    JS_FIELD("createAddress", js_result_get, JS_RESULT_CREATE_ADDRESS),
+  };
+  napi_value result_class;
+  status = napi_define_class(env, "EvmcResult", NAPI_AUTO_LENGTH, js_construct, NULL,
+                             sizeof(result_fields) / sizeof(result_fields[0]), result_fields,
+                             &result_class);
+  assert(status == napi_ok);
+  status = napi_create_reference(env, result_class, 1, &addon->result_class);
+  assert(status == napi_ok);
+
+  status = napi_set_instance_data(env, addon, js_addon_data_finalize, NULL);
+  assert(status == napi_ok);
+}
+
+/** Creates an instance of a class defined by define_classes, wrapping native. */
+napi_value create_wrapped(napi_env env, bool result, void* native, napi_finalize finalize) {
+  napi_status status;
+  struct js_addon_data* addon;
+  status = napi_get_instance_data(env, (void**) &addon);
+  assert(status == napi_ok);
+
+  napi_value constructor;
+  status = napi_get_reference_value(env, result ? addon->result_class : addon->message_class, &constructor);
+  assert(status == napi_ok);
+
+  napi_value out;
+  status = napi_new_instance(env, constructor, 0, NULL, &out);
+  assert(status == napi_ok);
+  status = napi_wrap(env, out, native, finalize, NULL, NULL);
+  assert(status == napi_ok);
+  return out;
+}
+
+/** Creates an EvmcMessage holding a copy of msg. */
+napi_value create_message_object(napi_env env, const struct evmc_message* msg) {
+  struct js_message* wrapped = (struct js_message*) malloc(sizeof(struct js_message) + msg->input_size);
+  wrapped->message = *msg;
+  if (msg->input_size != 0) {
+    memcpy(wrapped->input, msg->input_data, msg->input_size);
+  }
+  wrapped->message.input_data = wrapped->input;
+  wrapped->input_data = NULL;
+  return create_wrapped(env, false, wrapped, js_message_finalize);
+}
+
+/** Creates an EvmcResult holding a copy of result, which may then be released. */
+napi_value create_result_object(napi_env env, const struct evmc_result* result) {
+  struct js_result* wrapped = (struct js_result*) malloc(sizeof(struct js_result) + result->output_size);
+  wrapped->status_code = result->status_code;
+  wrapped->gas_left = result->gas_left;
+  wrapped->create_address = result->create_address;
+  wrapped->output_size = result->output_size;
+  if (result->output_size != 0) {
+    memcpy(wrapped->output, result->output_data, result->output_size);
+  }
+  wrapped->output_data = NULL;
+  return create_wrapped(env, true, wrapped, js_result_finalize);
+}
+
 typedef void (*converter_fn)(napi_env env, napi_value value, void* data);
 
 struct js_call {
-  uv_sem_t sem;
+  /** Which callback answers the call */
+  enum evmc_host_call type;
+  /** Signaled once the answer is in */
+  struct evmc_handoff* handoff;
   converter_fn converter;
+  /** The execution making the call */
+  struct js_execution_context* execution;
+};
+
+/** The flag behind an EvmcAbort, which aborts the execution it is given to */
+struct js_abort_handle {
+  /** Set on the main thread, read by the execution's thread */
+  int aborted;
+  /** The execution while it has not been handed back, on the main thread only */
+  struct js_execution_context* execution;
 };
 
-void js_call_and_wait(napi_threadsafe_function fn, struct js_call* calldata) {
+bool execution_aborted(struct js_execution_context* execution) {
+  return execution->abort != NULL && __atomic_load_n(&execution->abort->aborted, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Makes a host call and waits for its answer. An aborted execution no longer
+ * calls out, and leaves the answer as the caller zeroed it.
+ */
+void js_call_and_wait(struct js_execution_context* execution, enum evmc_host_call type,
+                      struct js_call* calldata) {
   napi_status status;
+  if (execution_aborted(execution)) {
+    return;
+  }
+  uint64_t start = execution->profiler != NULL ? uv_hrtime() : 0;
+
+  calldata->type = type;
+  calldata->execution = execution;
+  napi_threadsafe_function fn = execution->context->host_call_fn;
+
+  calldata->handoff = evmc_handoff_arm();
 
   status = napi_acquire_threadsafe_function(fn);
   assert(status == napi_ok);
 
-  int uv_status;
-  uv_status = uv_sem_init(&calldata->sem, 0);
-  assert(uv_status == 0);
-
   status = napi_call_threadsafe_function(fn, calldata, napi_tsfn_blocking); 
   assert(status == napi_ok);
 
-  uv_sem_wait(&calldata->sem);
-  uv_sem_destroy(&calldata->sem);
+  evmc_handoff_wait(calldata->handoff, execution->context->handoff_spin_ns);
 
   status = napi_release_threadsafe_function(fn, napi_tsfn_release);
   assert(status == napi_ok);
+
+  if (execution->profiler != NULL) {
+    execution->profile.host_ns += uv_hrtime() - start;
+    execution->profile.host_calls[type]++;
+  }
+}
+
+
+/**
+ * Gets the object identifying the execution making a call, which is passed to
+ * the callback after its own arguments, so that executions running at once on
+ * one EVM can be told apart.
+ */
+void get_execution_handle(napi_env env, struct js_call* data, napi_value* out) {
+  napi_status status;
+  if (data->execution->handle == NULL) {
+    status = napi_get_undefined(env, out);
+  } else {
+    status = napi_get_reference_value(env, data->execution->handle, out);
+  }
+  assert(status == napi_ok);
 }
 
+/**
+ * A function which hands the value of an awaited promise back to the host call
+ * waiting for it. Continuations are created once and reused for every promise
+ * after, so awaiting creates no function objects.
+ */
+struct js_continuation {
+  napi_ref function;
+  /** The EVM, or NULL once it has been collected while the promise was pending */
+  struct evmc_js_context* context;
+  /** The call waiting, while the continuation is in use */
+  struct js_call* call;
+  /** Links in the free or the waiting list of the EVM */
+  struct js_continuation* next;
+  struct js_continuation* prev;
+};
 
-napi_value js_return_or_await_success(napi_env env, napi_callback_info info) {
+napi_value js_continue(napi_env env, napi_callback_info info) {
     napi_value argv[1];
     napi_status status;
-    struct js_call* data;
+    struct js_continuation* continuation;
     size_t argc = 1;
 
-    status = napi_get_cb_info(env, info, &argc, argv, NULL, (void**) &data);
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, (void**) &continuation);
     assert(status == napi_ok);
-  
+
+    struct js_call* data = continuation->call;
+    continuation->call = NULL;
+    // A continuation is only reused once its promise settles, even if an
+    // abort already answered the call it was waiting for.
+    struct evmc_js_context* context = continuation->context;
+    if (context != NULL) {
+      if (continuation->prev != NULL) {
+        continuation->prev->next = continuation->next;
+      } else {
+        context->waiting_continuations = continuation->next;
+      }
+      if (continuation->next != NULL) {
+        continuation->next->prev = continuation->prev;
+      }
+    }
+    if (context == NULL || context->released) {
+      status = napi_delete_reference(env, continuation->function);
+      assert(status == napi_ok);
+      free(continuation);
+    } else {
+      continuation->next = context->free_continuations;
+      context->free_continuations = continuation;
+    }
+
+    if (data == NULL) {
+      return NULL;
+    }
+    data->execution->awaiting = NULL;
+
     if (data->converter != NULL) {
       data->converter(env, argv[0], data);
     }
     
-    uv_sem_post(&data->sem);
+    evmc_handoff_signal(data->handoff);
 
     return NULL;
 }
 
-void js_return_or_await(napi_env env, napi_value result, struct js_call* data, converter_fn converter) {
+void js_return_or_await(napi_env env, struct evmc_js_context* ctx, napi_value result, struct js_call* data, converter_fn converter) {
     napi_status status;
     bool is_promise = false;
     status = napi_is_promise(env, result, &is_promise);
@@ -159,20 +729,42 @@ void js_return_or_await(napi_env env, napi_value result, struct js_call* data, c
       if (converter != NULL) {
         converter(env, result, data);
       }
-      uv_sem_post(&data->sem);
+      evmc_handoff_signal(data->handoff);
+    } else if (execution_aborted(data->execution)) {
+      // Not worth waiting for, see evmc_abort.
+      evmc_handoff_signal(data->handoff);
     } else {
       data->converter = converter;
 
+      struct js_continuation* continuation = ctx->free_continuations;
+      napi_value continue_callback;
+      if (continuation != NULL) {
+        ctx->free_continuations = continuation->next;
+        status = napi_get_reference_value(env, continuation->function, &continue_callback);
+        assert(status == napi_ok);
+      } else {
+        continuation = (struct js_continuation*) malloc(sizeof(struct js_continuation));
+        continuation->context = ctx;
+        status = napi_create_function(env, NULL, 0, js_continue, continuation, &continue_callback);
+        assert(status == napi_ok);
+        status = napi_create_reference(env, continue_callback, 1, &continuation->function);
+        assert(status == napi_ok);
+      }
+      continuation->call = data;
+      continuation->prev = NULL;
+      continuation->next = ctx->waiting_continuations;
+      if (continuation->next != NULL) {
+        continuation->next->prev = continuation;
+      }
+      ctx->waiting_continuations = continuation;
+      data->execution->awaiting = continuation;
+
       napi_value then_callback;
       status = napi_get_named_property(env, result, "then", &then_callback);
       assert(status == napi_ok);
 
-      napi_value success_callback;
-      status = napi_create_function(env, NULL, 0, js_return_or_await_success, data, &success_callback);
-      assert(status == napi_ok);
-
       napi_value args[1];
-      args[0] = success_callback;
+      args[0] = continue_callback;
       status = napi_call_function(env, result, then_callback, 1, args, NULL);
       assert(status == napi_ok);
     }
@@ -202,33 +794,139 @@ void set_storage_js(napi_env env, napi_value js_callback, struct evmc_js_context
     status = napi_get_reference_value(env, ctx->object, &object);
     assert(status == napi_ok);
 
-    napi_value values[3];
+    napi_value values[4];
 
-    create_bigint_from_evmc_address(env, data->address, &values[0]);
-    create_bigint_from_evmc_bytes32(env, data->key, &values[1]);
+    create_interned_bigint_from_evmc_address(env, ctx, data->address, &values[0]);
+    create_interned_bigint(env, ctx, data->key, &values[1]);
     create_bigint_from_evmc_bytes32(env, data->value, &values[2]);
 
+    get_execution_handle(env, (struct js_call*) data, &values[3]);
+
     napi_value result;
-    status = napi_call_function(env, object, js_callback, 3, values, &result);
+    status = napi_call_function(env, object, js_callback, 4, values, &result);
     assert(status == napi_ok);
 
-    js_return_or_await(env, result, (struct js_call*) data, (converter_fn) set_storage_js_converter);
+    js_return_or_await(env, ctx, result, (struct js_call*) data, (converter_fn) set_storage_js_converter);
 }
 
-enum evmc_storage_status set_storage(struct evmc_js_context* context,
+/** Drops what the caches know of an account the host has moved value or deployed code for. */
+void forget_account(struct js_execution_context* execution, const evmc_address* address) {
+  if (execution->account_cache != NULL) {
+    evmc_account_cache_invalidate(execution->account_cache, address);
+  }
+  if (execution->result_cache != NULL) {
+    evmc_result_cache_invalidate(execution->result_cache, address);
+  }
+}
+
+/** Journals a storage write of the execution, if it has a write set. */
+void journal_storage(struct js_execution_context* execution, const evmc_address* address,
+                     const evmc_bytes32* key, const evmc_bytes32* value) {
+  if (execution->write_set == NULL) {
+    return;
+  }
+  struct evmc_write write;
+  memset(&write, 0, sizeof(write));
+  write.type = EVMC_WRITE_STORAGE;
+  write.address = *address;
+  write.key = *key;
+  write.value = *value;
+  evmc_write_set_append(execution->write_set, &write);
+}
+
+enum evmc_storage_status set_storage(struct js_execution_context* execution,
                                             const evmc_address* address,
                                             const evmc_bytes32* key,
                                             const evmc_bytes32* value) {
      struct js_set_storage_call callinfo;
+     memset(&callinfo, 0, sizeof(callinfo));
      callinfo.address = address;
      callinfo.key = key;
      callinfo.value = value;
 
-     js_call_and_wait(context->set_storage_fn, (struct js_call*) &callinfo);
+     js_call_and_wait(execution, EVMC_HOST_SET_STORAGE, (struct js_call*) &callinfo);
+     journal_storage(execution, address, key, value);
+
+     if (execution->result_cache != NULL) {
+       evmc_result_cache_invalidate(execution->result_cache, address);
+     }
+
+     if (execution->transaction != NULL) {
+       execution->transaction->refund += evmc_tx_storage_refund(callinfo.result);
+     }
 
      return callinfo.result;
 }
 
+/** Writes bytes as 0x-prefixed hex to out, which has room for 2 * size + 3 characters. */
+void format_hex(char* out, const uint8_t* bytes, size_t size) {
+  static const char digits[] = "0123456789abcdef";
+  size_t i;
+  *out++ = '0';
+  *out++ = 'x';
+  for (i = 0; i < size; i++) {
+    *out++ = digits[bytes[i] >> 4];
+    *out++ = digits[bytes[i] & 0x0f];
+  }
+  *out = '\0';
+}
+
+/**
+ * Fails a stateless execution with the first proof its witness is missing. The
+ * VM cannot be stopped, so every later lookup is answered with zero, and the
+ * execution is rejected once the VM returns.
+ */
+void fail_witness(struct js_execution_context* execution, const char* format,
+                  const evmc_address* address, const evmc_bytes32* key) {
+  if (execution->witness_error != NULL) {
+    return;
+  }
+  char account[2 * sizeof(address->bytes) + 3];
+  char slot[2 * sizeof(key->bytes) + 3] = "";
+  format_hex(account, address->bytes, sizeof(address->bytes));
+  if (key != NULL) {
+    format_hex(slot, key->bytes, sizeof(key->bytes));
+  }
+  size_t size = strlen(format) + sizeof(account) + sizeof(slot);
+  execution->witness_error = (char*) evmc_arena_alloc(execution->arena, size);
+  if (key != NULL) {
+    snprintf(execution->witness_error, size, format, slot, account);
+  } else {
+    snprintf(execution->witness_error, size, format, account);
+  }
+}
+
+/** Looks up an account of a stateless execution, which is all zero unless found. */
+enum evmc_witness_result witness_get_account(struct js_execution_context* execution,
+                                             const evmc_address* address,
+                                             struct evmc_witness_account* account) {
+  if (execution->witness_error != NULL) {
+    memset(account, 0, sizeof(*account));
+    return EVMC_WITNESS_MISSING;
+  }
+  enum evmc_witness_result result = evmc_witness_get_account(execution->witness, address, account);
+  if (result == EVMC_WITNESS_MISSING) {
+    fail_witness(execution, "No proof of account %s", address, NULL);
+  }
+  return result;
+}
+
+/** Looks up the code of an account of a stateless execution, which is empty unless found. */
+const uint8_t* witness_get_code(struct js_execution_context* execution,
+                                const evmc_address* address, size_t* size) {
+  struct evmc_witness_account account;
+  *size = 0;
+  if (witness_get_account(execution, address, &account) != EVMC_WITNESS_FOUND) {
+    return NULL;
+  }
+  const uint8_t* code = evmc_witness_get_code(execution->witness, &account.code_hash, size);
+  if (code == NULL) {
+    *size = 0;
+    fail_witness(execution, "No code of account %s in the witness", address, NULL);
+  }
+  return code;
+}
+
 struct js_storage_call {
   struct js_call;
   const evmc_address* address;
@@ -247,26 +945,48 @@ void get_storage_js(napi_env env, napi_value js_callback, struct evmc_js_context
     status = napi_get_reference_value(env, ctx->object, &object);
     assert(status == napi_ok);
 
-    napi_value values[2];
+    napi_value values[3];
+
+    create_interned_bigint_from_evmc_address(env, ctx, data->address, &values[0]);
+    create_interned_bigint(env, ctx, data->key, &values[1]);
 
-    create_bigint_from_evmc_address(env, data->address, &values[0]);
-    create_bigint_from_evmc_bytes32(env, data->key, &values[1]);
+    get_execution_handle(env, (struct js_call*) data, &values[2]);
 
     napi_value result;
-    status = napi_call_function(env, object, js_callback, 2, values, &result);
+    status = napi_call_function(env, object, js_callback, 3, values, &result);
     assert(status == napi_ok);
 
-    js_return_or_await(env, result, (struct js_call*) data, (converter_fn) get_storage_js_converter);
+    js_return_or_await(env, ctx, result, (struct js_call*) data, (converter_fn) get_storage_js_converter);
 }
 
- evmc_bytes32 get_storage(struct evmc_js_context* context,
+ evmc_bytes32 get_storage(struct js_execution_context* execution,
                                             const evmc_address* address,
                                             const evmc_bytes32* key) {
+     if (execution->witness != NULL) {
+       struct evmc_witness_account account;
+       evmc_bytes32 value = {{0}};
+       if (witness_get_account(execution, address, &account) == EVMC_WITNESS_FOUND &&
+           evmc_witness_get_storage(execution->witness, &account, key, &value) == EVMC_WITNESS_MISSING) {
+         fail_witness(execution, "No proof of storage slot %s of account %s", address, key);
+       }
+       return value;
+     }
+
+     if (execution->snapshot != NULL) {
+       const struct evmc_snapshot_account* account = evmc_snapshot_find_account(execution->snapshot, address);
+       if (account == NULL) {
+         evmc_bytes32 zero = {{0}};
+         return zero;
+       }
+       return evmc_snapshot_get_storage(execution->snapshot, account, key);
+     }
+
      struct js_storage_call callinfo;
+     memset(&callinfo, 0, sizeof(callinfo));
      callinfo.address = address;
      callinfo.key = key;
 
-     js_call_and_wait(context->get_storage_fn, (struct js_call*) &callinfo);
+     js_call_and_wait(execution, EVMC_HOST_GET_STORAGE, (struct js_call*) &callinfo);
 
      return callinfo.result;
 }
@@ -290,23 +1010,47 @@ void account_exists_js(napi_env env, napi_value js_callback, struct evmc_js_cont
     status = napi_get_reference_value(env, ctx->object, &object);
     assert(status == napi_ok);
 
-    napi_value values[1];
+    napi_value values[2];
+
+    create_interned_bigint_from_evmc_address(env, ctx, data->address, &values[0]);
 
-    create_bigint_from_evmc_address(env, data->address, &values[0]);
+    get_execution_handle(env, (struct js_call*) data, &values[1]);
 
     napi_value result;
-    status = napi_call_function(env, object, js_callback, 1, values, &result);
+    status = napi_call_function(env, object, js_callback, 2, values, &result);
     assert(status == napi_ok);
 
-    js_return_or_await(env, result, (struct js_call*) data, (converter_fn) account_exists_js_converter);
+    js_return_or_await(env, ctx, result, (struct js_call*) data, (converter_fn) account_exists_js_converter);
 }
 
-bool account_exists(struct evmc_js_context* context,
+bool account_exists(struct js_execution_context* execution,
   const evmc_address* address) {
+    if (execution->witness != NULL) {
+      struct evmc_witness_account account;
+      return witness_get_account(execution, address, &account) == EVMC_WITNESS_FOUND;
+    }
+
+    if (execution->snapshot != NULL) {
+      return evmc_snapshot_find_account(execution->snapshot, address) != NULL;
+    }
+
+    struct evmc_account_cache_value cached;
+    uint64_t generation;
+    if (execution->account_cache != NULL &&
+        evmc_account_cache_lookup(execution->account_cache, address, EVMC_ACCOUNT_CACHE_EXISTS, &cached, &generation)) {
+      return cached.exists;
+    }
+
     struct js_account_exists_call callinfo;
+    memset(&callinfo, 0, sizeof(callinfo));
     callinfo.address = address;
   
-    js_call_and_wait(context->account_exists_fn, (struct js_call*) &callinfo);
+    js_call_and_wait(execution, EVMC_HOST_ACCOUNT_EXISTS, (struct js_call*) &callinfo);
+
+    if (execution->account_cache != NULL) {
+      cached.exists = callinfo.result;
+      evmc_account_cache_store(execution->account_cache, generation, address, EVMC_ACCOUNT_CACHE_EXISTS, &cached);
+    }
 
     return callinfo.result;
 }
@@ -330,23 +1074,53 @@ void get_balance_js(napi_env env, napi_value js_callback, struct evmc_js_context
     status = napi_get_reference_value(env, ctx->object, &object);
     assert(status == napi_ok);
 
-    napi_value values[1];
+    napi_value values[2];
+
+    create_interned_bigint_from_evmc_address(env, ctx, data->address, &values[0]);
 
-    create_bigint_from_evmc_address(env, data->address, &values[0]);
+    get_execution_handle(env, (struct js_call*) data, &values[1]);
 
     napi_value result;
-    status = napi_call_function(env, object, js_callback, 1, values, &result);
+    status = napi_call_function(env, object, js_callback, 2, values, &result);
     assert(status == napi_ok);
 
-    js_return_or_await(env, result, (struct js_call*) data, (converter_fn) get_balance_js_converter);
+    js_return_or_await(env, ctx, result, (struct js_call*) data, (converter_fn) get_balance_js_converter);
 }
 
-evmc_bytes32 get_balance(struct evmc_js_context* context,
+evmc_bytes32 get_balance(struct js_execution_context* execution,
   const evmc_address* address) {
+    if (execution->witness != NULL) {
+      struct evmc_witness_account account;
+      witness_get_account(execution, address, &account);
+      return account.balance;
+    }
+
+    if (execution->snapshot != NULL) {
+      const struct evmc_snapshot_account* account = evmc_snapshot_find_account(execution->snapshot, address);
+      if (account == NULL) {
+        evmc_bytes32 zero = {{0}};
+        return zero;
+      }
+      return account->balance;
+    }
+
+    struct evmc_account_cache_value cached;
+    uint64_t generation;
+    if (execution->account_cache != NULL &&
+        evmc_account_cache_lookup(execution->account_cache, address, EVMC_ACCOUNT_CACHE_BALANCE, &cached, &generation)) {
+      return cached.balance;
+    }
+
     struct js_get_balance_call callinfo;
+    memset(&callinfo, 0, sizeof(callinfo));
     callinfo.address = address;
 
-    js_call_and_wait(context->get_balance_fn, (struct js_call*) &callinfo);
+    js_call_and_wait(execution, EVMC_HOST_GET_BALANCE, (struct js_call*) &callinfo);
+
+    if (execution->account_cache != NULL) {
+      cached.balance = callinfo.result;
+      evmc_account_cache_store(execution->account_cache, generation, address, EVMC_ACCOUNT_CACHE_BALANCE, &cached);
+    }
 
     return callinfo.result;
 }
@@ -371,23 +1145,49 @@ void get_code_size_js(napi_env env, napi_value js_callback, struct evmc_js_conte
     status = napi_get_reference_value(env, ctx->object, &object);
     assert(status == napi_ok);
 
-    napi_value values[1];
+    napi_value values[2];
+
+    create_interned_bigint_from_evmc_address(env, ctx, data->address, &values[0]);
 
-    create_bigint_from_evmc_address(env, data->address, &values[0]);
+    get_execution_handle(env, (struct js_call*) data, &values[1]);
 
     napi_value result;
-    status = napi_call_function(env, object, js_callback, 1, values, &result);
+    status = napi_call_function(env, object, js_callback, 2, values, &result);
     assert(status == napi_ok);
 
-    js_return_or_await(env, result, (struct js_call*) data, (converter_fn) get_code_size_js_converter);
+    js_return_or_await(env, ctx, result, (struct js_call*) data, (converter_fn) get_code_size_js_converter);
 }
 
-size_t get_code_size(struct evmc_js_context* context,
+size_t get_code_size(struct js_execution_context* execution,
   const evmc_address* address) {
+    if (execution->witness != NULL) {
+      size_t code_size;
+      witness_get_code(execution, address, &code_size);
+      return code_size;
+    }
+
+    if (execution->snapshot != NULL) {
+      const struct evmc_snapshot_account* account = evmc_snapshot_find_account(execution->snapshot, address);
+      return account == NULL ? 0 : account->code_size;
+    }
+
+    struct evmc_account_cache_value cached;
+    uint64_t generation;
+    if (execution->account_cache != NULL &&
+        evmc_account_cache_lookup(execution->account_cache, address, EVMC_ACCOUNT_CACHE_CODE_SIZE, &cached, &generation)) {
+      return cached.code_size;
+    }
+
     struct js_get_code_size_call callinfo;
+    memset(&callinfo, 0, sizeof(callinfo));
     callinfo.address = address;
   
-    js_call_and_wait(context->get_code_size_fn, (struct js_call*) &callinfo);
+    js_call_and_wait(execution, EVMC_HOST_GET_CODE_SIZE, (struct js_call*) &callinfo);
+
+    if (execution->account_cache != NULL) {
+      cached.code_size = callinfo.result;
+      evmc_account_cache_store(execution->account_cache, generation, address, EVMC_ACCOUNT_CACHE_CODE_SIZE, &cached);
+    }
 
     return callinfo.result;
 }
@@ -409,24 +1209,53 @@ void get_code_hash_js(napi_env env, napi_value js_callback, struct evmc_js_conte
     status = napi_get_reference_value(env, ctx->object, &object);
     assert(status == napi_ok);
 
-    napi_value values[1];
+    napi_value values[2];
+
+    create_interned_bigint_from_evmc_address(env, ctx, data->address, &values[0]);
 
-    create_bigint_from_evmc_address(env, data->address, &values[0]);
+    get_execution_handle(env, (struct js_call*) data, &values[1]);
 
     napi_value result;
-    status = napi_call_function(env, object, js_callback, 1, values, &result);
+    status = napi_call_function(env, object, js_callback, 2, values, &result);
     assert(status == napi_ok);
 
-    js_return_or_await(env, result, (struct js_call*) data, (converter_fn) get_code_hash_js_converter);
+    js_return_or_await(env, ctx, result, (struct js_call*) data, (converter_fn) get_code_hash_js_converter);
 }
 
-evmc_bytes32 get_code_hash(struct evmc_js_context* context,
+evmc_bytes32 get_code_hash(struct js_execution_context* execution,
   const evmc_address* address) {
+    if (execution->witness != NULL) {
+      struct evmc_witness_account account;
+      witness_get_account(execution, address, &account);
+      return account.code_hash;
+    }
+
+    if (execution->snapshot != NULL) {
+      const struct evmc_snapshot_account* account = evmc_snapshot_find_account(execution->snapshot, address);
+      if (account == NULL) {
+        evmc_bytes32 zero = {{0}};
+        return zero;
+      }
+      return account->code_hash;
+    }
+
+    struct evmc_account_cache_value cached;
+    uint64_t generation;
+    if (execution->account_cache != NULL &&
+        evmc_account_cache_lookup(execution->account_cache, address, EVMC_ACCOUNT_CACHE_CODE_HASH, &cached, &generation)) {
+      return cached.code_hash;
+    }
 
     struct js_get_code_hash_call callinfo;
+    memset(&callinfo, 0, sizeof(callinfo));
     callinfo.address = address;
   
-    js_call_and_wait(context->get_code_hash_fn, (struct js_call*) &callinfo);
+    js_call_and_wait(execution, EVMC_HOST_GET_CODE_HASH, (struct js_call*) &callinfo);
+
+    if (execution->account_cache != NULL) {
+      cached.code_hash = callinfo.result;
+      evmc_account_cache_store(execution->account_cache, generation, address, EVMC_ACCOUNT_CACHE_CODE_HASH, &cached);
+    }
 
     return callinfo.result;
 }
@@ -460,9 +1289,9 @@ void copy_code_js(napi_env env, napi_value js_callback, struct evmc_js_context*
     status = napi_get_reference_value(env, ctx->object, &object);
     assert(status == napi_ok);
 
-    napi_value values[3];
+    napi_value values[4];
 
-    create_bigint_from_evmc_address(env, data->address, &values[0]);
+    create_interned_bigint_from_evmc_address(env, ctx, data->address, &values[0]);
 
     status = napi_create_int64(env, data->code_offset, &values[1]);
     assert(status == napi_ok);
@@ -470,26 +1299,56 @@ void copy_code_js(napi_env env, napi_value js_callback, struct evmc_js_context*
     status = napi_create_int64(env, data->buffer_size, &values[2]);
     assert(status == napi_ok);
 
+    get_execution_handle(env, (struct js_call*) data, &values[3]);
+
     napi_value result;
-    status = napi_call_function(env, object, js_callback, 3, values, &result);
+    status = napi_call_function(env, object, js_callback, 4, values, &result);
     assert(status == napi_ok);
 
-    js_return_or_await(env, result, (struct js_call*) data, (converter_fn) copy_code_js_converter);
+    js_return_or_await(env, ctx, result, (struct js_call*) data, (converter_fn) copy_code_js_converter);
 }
 
-size_t copy_code(struct evmc_js_context* context,
+size_t copy_code(struct js_execution_context* execution,
     const evmc_address* address,
     size_t code_offset,
     uint8_t* buffer_data,
     size_t buffer_size) {
+    if (execution->witness != NULL) {
+      size_t code_size;
+      const uint8_t* code = witness_get_code(execution, address, &code_size);
+      if (code == NULL || code_offset >= code_size) {
+        return 0;
+      }
+      size_t bytes_written = code_size - code_offset;
+      if (bytes_written > buffer_size) {
+        bytes_written = buffer_size;
+      }
+      memcpy(buffer_data, code + code_offset, bytes_written);
+      return bytes_written;
+    }
+
+    if (execution->snapshot != NULL) {
+      const struct evmc_snapshot_account* account = evmc_snapshot_find_account(execution->snapshot, address);
+      const uint8_t* code = account == NULL ? NULL : evmc_snapshot_get_code(execution->snapshot, account);
+      if (code == NULL || code_offset >= account->code_size) {
+        return 0;
+      }
+      size_t bytes_written = account->code_size - code_offset;
+      if (bytes_written > buffer_size) {
+        bytes_written = buffer_size;
+      }
+      memcpy(buffer_data, code + code_offset, bytes_written);
+      return bytes_written;
+    }
     
     struct js_copy_code_call callinfo;
+    memset(&callinfo, 0, sizeof(callinfo));
     callinfo.address = address;
     callinfo.code_offset = code_offset;
     callinfo.buffer_data = buffer_data;
     callinfo.buffer_size = buffer_size;
   
-    js_call_and_wait(context->copy_code_fn, (struct js_call*) &callinfo);
+    js_call_and_wait(execution, EVMC_HOST_COPY_CODE, (struct js_call*) &callinfo);
 
     return callinfo.result;
 }
@@ -507,41 +1366,56 @@ void selfdestruct_js(napi_env env, napi_value js_callback, struct evmc_js_contex
     status = napi_get_reference_value(env, ctx->object, &object);
     assert(status == napi_ok);
 
-    napi_value values[2];
+    napi_value values[3];
 
-    create_bigint_from_evmc_address(env, data->address, &values[0]);
-    create_bigint_from_evmc_address(env, data->beneficiary, &values[1]);
+    create_interned_bigint_from_evmc_address(env, ctx, data->address, &values[0]);
+    create_interned_bigint_from_evmc_address(env, ctx, data->beneficiary, &values[1]);
+
+    get_execution_handle(env, (struct js_call*) data, &values[2]);
 
     napi_value result;
-    status = napi_call_function(env, object, js_callback, 2, values, &result);
+    status = napi_call_function(env, object, js_callback, 3, values, &result);
     assert(status == napi_ok);
 
-    js_return_or_await(env, result, (struct js_call*) data, NULL);
+    js_return_or_await(env, ctx, result, (struct js_call*) data, NULL);
 }
 
-void selfdestruct(struct evmc_js_context* context,
+void selfdestruct(struct js_execution_context* execution,
     const evmc_address* address,
     const evmc_address* beneficiary) {
     
     struct js_selfdestruct_call callinfo;
+    memset(&callinfo, 0, sizeof(callinfo));
     callinfo.address = address;
     callinfo.beneficiary = beneficiary;
   
-    js_call_and_wait(context->selfdestruct_fn, (struct js_call*) &callinfo);
+    js_call_and_wait(execution, EVMC_HOST_SELFDESTRUCT, (struct js_call*) &callinfo);
+
+    if (execution->write_set != NULL) {
+      struct evmc_write write;
+      memset(&write, 0, sizeof(write));
+      write.type = EVMC_WRITE_DELETE;
+      write.address = *address;
+      evmc_write_set_append(execution->write_set, &write);
+    }
+
+    if (execution->transaction != NULL && !execution->transaction->selfdestructed) {
+      execution->transaction->selfdestructed = true;
+      execution->transaction->refund += EVMC_SELFDESTRUCT_REFUND;
+    }
+
+    forget_account(execution, address);
+    forget_account(execution, beneficiary);
 }
 
 struct js_call_call {
   struct js_call;
   const struct evmc_message* msg;
   struct evmc_result* result;
+  /** The arena of the calling execution, which owns the output */
+  struct evmc_arena* arena;
 };
 
-void call_free_result(const struct evmc_result* result) {
-  if (result->output_size > 0) {
-    free((void*)result->output_data);
-  }
-}
-
 void call_js_converter(napi_env env, napi_value result, struct js_call_call* data) {
   napi_status status;
       napi_value node_status_code;
@@ -569,10 +1443,9 @@ void call_js_converter(napi_env env, napi_value result, struct js_call_call* dat
       
       data->result->output_size = outputData_size;
       if (outputData_size > 0) {
-        data->result->output_data = (uint8_t*) malloc(outputData_size);
+        data->result->output_data = (uint8_t*) evmc_arena_alloc(data->arena, outputData_size);
         memcpy((void*)data->result->output_data, outputData, outputData_size);
-        data->result->release = call_free_result;
-      } 
+      }
 
       napi_value node_create_address;
       status = napi_get_named_property(env, result, "createAddress", &node_create_address);
@@ -594,66 +1467,38 @@ void call_js(napi_env env, napi_value js_callback, struct evmc_js_context* ctx,
     status = napi_get_reference_value(env, ctx->object, &object);
     assert(status == napi_ok);
 
-    napi_value values[1];
-
-    // create message object
-    status = napi_create_object(env, &values[0]);
-    assert(status == napi_ok);
-
-    napi_value node_gas;
-    status = napi_create_bigint_int64(env, data->msg->gas, &node_gas);
-    assert(status == napi_ok);
-    status = napi_set_named_property(env, values[0], "gas", node_gas);
-    assert(status == napi_ok);
-
-    napi_value node_depth;
-    status = napi_create_int32(env, data->msg->depth, &node_depth);
-    assert(status == napi_ok);
-    status = napi_set_named_property(env, values[0], "depth", node_depth);
-    assert(status == napi_ok);
-
-    napi_value node_flags;
-    status = napi_create_uint32(env, data->msg->depth, &node_flags);
-    assert(status == napi_ok);
-    status = napi_set_named_property(env, values[0], "flags", node_flags);
-    assert(status == napi_ok);
-
-    napi_value node_kind;
-    status = napi_create_int64(env, data->msg->kind, &node_kind);
-    assert(status == napi_ok);
-    status = napi_set_named_property(env, values[0], "kind", node_kind);
-    assert(status == napi_ok);
-
-    napi_value node_destination;
-    create_bigint_from_evmc_address(env, &data->msg->destination, &node_destination);
-    status = napi_set_named_property(env, values[0], "destination", node_destination);
-    assert(status == napi_ok);
+    napi_value values[2];
+    values[0] = create_message_object(env, data->msg);
 
-    napi_value node_sender;
-    create_bigint_from_evmc_address(env, &data->msg->sender, &node_sender);
-    status = napi_set_named_property(env, values[0], "sender", node_sender);
-    assert(status == napi_ok);
+    get_execution_handle(env, (struct js_call*) data, &values[1]);
 
-    napi_value node_input;
-    void* input_node_buf;
-    status = napi_create_buffer_copy(env, data->msg->input_size, data->msg->input_data, &input_node_buf, &node_input);
-    assert(status == napi_ok);
-    status = napi_set_named_property(env, values[0], "inputData", node_input);
+    napi_value result;
+    status = napi_call_function(env, object, js_callback, 2, values, &result);
     assert(status == napi_ok);
 
-    napi_value node_value;
-    create_bigint_from_evmc_bytes32(env, &data->msg->value, &node_value);
-    status = napi_set_named_property(env, values[0], "value", node_value);
-    assert(status == napi_ok);
+    js_return_or_await(env, ctx, result, (struct js_call*) data, (converter_fn) call_js_converter);
+}
 
-    napi_value result;
-    status = napi_call_function(env, object, js_callback, 1, values, &result);
-    assert(status == napi_ok);
+bool is_zero_bytes32(const evmc_bytes32* bytes) {
+  size_t i;
+  for (i = 0; i < sizeof(bytes->bytes); i++) {
+    if (bytes->bytes[i] != 0) {
+      return false;
+    }
+  }
+  return true;
+}
 
-    js_return_or_await(env, result, (struct js_call*) data, (converter_fn) call_js_converter);
+/** If the message is to a precompiled contract which is answered without calling JS. */
+bool calls_native_precompile(struct js_execution_context* execution, const struct evmc_message* msg) {
+  // Value transfers to a precompile still go to JS, which moves the balance.
+  return execution->context->native_precompiles &&
+         msg->kind != EVMC_CREATE && msg->kind != EVMC_CREATE2 &&
+         is_zero_bytes32(&msg->value) &&
+         precompile_is_active(&msg->destination, execution->revision);
 }
 
-struct evmc_result call(struct evmc_js_context* context,
+struct evmc_result call(struct js_execution_context* execution,
   const struct evmc_message* msg) {
     struct evmc_result result;
     result.status_code = 0;
@@ -661,12 +1506,44 @@ struct evmc_result call(struct evmc_js_context* context,
     result.output_size = 0;
     result.gas_left = 0;
     result.release = NULL;
+    memset(&result.create_address, 0, sizeof(result.create_address));
+
+    // A stateless execution which is already failed, or an aborted one, does
+    // not go on to call out.
+    if (execution->witness_error != NULL || execution_aborted(execution)) {
+      result.status_code = EVMC_FAILURE;
+      return result;
+    }
+
+    if (calls_native_precompile(execution, msg)) {
+      return precompile_execute(msg, execution->revision);
+    }
 
     struct js_call_call callinfo;
+    memset(&callinfo, 0, sizeof(callinfo));
     callinfo.msg = msg;
     callinfo.result = &result;
+    callinfo.arena = execution->arena;
   
-    js_call_and_wait(context->call_fn, (struct js_call*) &callinfo);
+    js_call_and_wait(execution, EVMC_HOST_CALL, (struct js_call*) &callinfo);
+
+    // The answer may never have come.
+    if (execution_aborted(execution)) {
+      result.status_code = EVMC_FAILURE;
+      result.gas_left = 0;
+      return result;
+    }
+
+    // The host has moved value or deployed code, so drop what it told us before.
+    if (msg->kind == EVMC_CREATE || msg->kind == EVMC_CREATE2) {
+      forget_account(execution, &msg->sender);
+      if (result.status_code == EVMC_SUCCESS) {
+        forget_account(execution, &result.create_address);
+      }
+    } else if (msg->kind != EVMC_DELEGATECALL && !is_zero_bytes32(&msg->value)) {
+      forget_account(execution, &msg->sender);
+      forget_account(execution, &msg->destination);
+    }
 
     return result;
 }
@@ -729,18 +1606,26 @@ void get_tx_context_js(napi_env env, napi_value js_callback, struct evmc_js_cont
   status = napi_get_reference_value(env, ctx->object, &object);
   assert(status == napi_ok);
 
+  napi_value values[1];
+  get_execution_handle(env, (struct js_call*) data, &values[0]);
+
   napi_value result;
-  status = napi_call_function(env, object, js_callback, 0, NULL, &result);
+  status = napi_call_function(env, object, js_callback, 1, values, &result);
   assert(status == napi_ok);
 
-  js_return_or_await(env, result, (struct js_call*) data, (converter_fn) get_tx_context_js_converter);
+  js_return_or_await(env, ctx, result, (struct js_call*) data, (converter_fn) get_tx_context_js_converter);
 }
 
 
-struct evmc_tx_context get_tx_context(struct evmc_js_context* context) {
+struct evmc_tx_context get_tx_context(struct js_execution_context* execution) {
+    if (execution->has_tx_context) {
+      return execution->tx_context;
+    }
+
     struct js_tx_context_call callinfo;
-    
-    js_call_and_wait(context->get_tx_context_fn, (struct js_call*) &callinfo);
+    memset(&callinfo, 0, sizeof(callinfo));
+
+    js_call_and_wait(execution, EVMC_HOST_GET_TX_CONTEXT, (struct js_call*) &callinfo);
 
     return callinfo.result;
 }
@@ -764,23 +1649,26 @@ void get_block_hash_js(napi_env env, napi_value js_callback, struct evmc_js_cont
     assert(status == napi_ok);
     
 
-    napi_value values[1];
+    napi_value values[2];
 
     status = napi_create_bigint_int64(env, data->number, &values[0]);
     assert(status == napi_ok);
 
+    get_execution_handle(env, (struct js_call*) data, &values[1]);
+
     napi_value result;
-    status = napi_call_function(env, object, js_callback, 1, values, &result);
+    status = napi_call_function(env, object, js_callback, 2, values, &result);
     assert(status == napi_ok);
 
-    js_return_or_await(env, result, (struct js_call*) data, (converter_fn) get_block_hash_js_converter);
+    js_return_or_await(env, ctx, result, (struct js_call*) data, (converter_fn) get_block_hash_js_converter);
 }
 
-evmc_bytes32 get_block_hash(struct evmc_js_context* context, uint64_t number) {
+evmc_bytes32 get_block_hash(struct js_execution_context* execution, uint64_t number) {
     struct js_get_block_hash_call callinfo;
+    memset(&callinfo, 0, sizeof(callinfo));
     callinfo.number = number;
   
-    js_call_and_wait(context->get_block_hash_fn, (struct js_call*) &callinfo);
+    js_call_and_wait(execution, EVMC_HOST_GET_BLOCK_HASH, (struct js_call*) &callinfo);
 
     return callinfo.result;
 }
@@ -802,9 +1690,9 @@ void emit_log_js(napi_env env, napi_value js_callback, struct evmc_js_context* c
     status = napi_get_reference_value(env, ctx->object, &object);
     assert(status == napi_ok);
 
-    napi_value values[3];
+    napi_value values[4];
 
-    create_bigint_from_evmc_address(env, data->address, &values[0]);
+    create_interned_bigint_from_evmc_address(env, ctx, data->address, &values[0]);
   
     uint8_t* buffer;
     status = napi_create_buffer_copy(env, data->data_size, (void*) data->data, (void**) &buffer, &values[1]);
@@ -816,297 +1704,1316 @@ void emit_log_js(napi_env env, napi_value js_callback, struct evmc_js_context* c
     size_t i;
     for (i = 0; i < data->topics_count; i++) {
       napi_value topic;
-      create_bigint_from_evmc_bytes32(env, &data->topics[i], &topic);
+      create_interned_bigint(env, ctx, &data->topics[i], &topic);
       status = napi_set_element(env, values[2], i, topic);
       assert(status == napi_ok);
     }
 
+    get_execution_handle(env, (struct js_call*) data, &values[3]);
+
     napi_value result;
-    status = napi_call_function(env, object, js_callback, 3, values, &result);
+    status = napi_call_function(env, object, js_callback, 4, values, &result);
     assert(status == napi_ok);
 
     bool isPromise = false;
     status = napi_is_promise(env, result, &isPromise);
     assert(status == napi_ok);
 
-    js_return_or_await(env, result, (struct js_call*) data, NULL);
+    js_return_or_await(env, ctx, result, (struct js_call*) data, NULL);
 }
 
-void emit_log(struct evmc_js_context* context,
+void emit_log(struct js_execution_context* execution,
                                  const evmc_address* address,
                                  const uint8_t* data,
                                  size_t data_size,
                                  const evmc_bytes32 topics[],
                                  size_t topics_count) {
     struct js_emit_log_call callinfo;
+    memset(&callinfo, 0, sizeof(callinfo));
     callinfo.address = address;
     callinfo.data = data;
     callinfo.data_size = data_size;
     callinfo.topics = topics;
     callinfo.topics_count = topics_count;
   
-    js_call_and_wait(context->emit_log_fn, (struct js_call*) &callinfo);               
+    js_call_and_wait(execution, EVMC_HOST_EMIT_LOG, (struct js_call*) &callinfo);               
+
+    if (execution->transaction != NULL) {
+      struct js_log* log = (struct js_log*) evmc_arena_alloc(execution->arena, sizeof(struct js_log));
+      log->next = NULL;
+      log->address = *address;
+      log->data = (uint8_t*) evmc_arena_alloc(execution->arena, data_size);
+      memcpy(log->data, data, data_size);
+      log->data_size = data_size;
+      log->topics = (evmc_bytes32*) evmc_arena_alloc(execution->arena, topics_count * sizeof(evmc_bytes32));
+      memcpy(log->topics, topics, topics_count * sizeof(evmc_bytes32));
+      log->topics_count = topics_count;
+      *execution->transaction->last_log = log;
+      execution->transaction->last_log = &log->next;
+    }
 }
 
-struct js_execution_context {
-  struct evmc_js_context* context;
-  struct evmc_message message;
-  enum evmc_revision revision;
-  struct evmc_result result;
-  
-  uint8_t* code;
-  size_t code_size;
-  
-  napi_deferred deferred;
-  napi_value promise;
+struct js_transfer_call {
+  struct js_call;
+  const evmc_address* from;
+  const evmc_address* to;
+  const evmc_uint256be* value;
 };
 
-// Forward declaration
-void completer_js(napi_env env, napi_value js_callback, void* context, struct js_execution_context* data);
-
-void create_callbacks_from_context(napi_env env, struct evmc_js_context* ctx, napi_value node_context) {
-  napi_status status;
-    
-  napi_value unnamed;
-  status = napi_create_string_utf8(env, "unnamed", NAPI_AUTO_LENGTH, &unnamed);
-  assert(status == napi_ok);
+void transfer_js(napi_env env, napi_value js_callback, struct evmc_js_context* ctx, struct js_transfer_call* data) {
+    napi_status status;
+    napi_value object;
 
-  napi_value account_exists_callback;
-  status = napi_get_named_property(env, node_context, "getAccountExists", &account_exists_callback);
-  assert(status == napi_ok); 
+    status = napi_get_reference_value(env, ctx->object, &object);
+    assert(status == napi_ok);
 
-  status = napi_create_threadsafe_function(env, account_exists_callback, NULL, unnamed, 0, 1, NULL, NULL, (void*) ctx, (napi_threadsafe_function_call_js) account_exists_js, &ctx->account_exists_fn);
-  assert(status == napi_ok);
+    napi_value values[4];
 
-  napi_value storage_callback;
-  status = napi_get_named_property(env, node_context, "getStorage", &storage_callback);
-  assert(status == napi_ok); 
+    // Gas bought for a transaction is taken from no account and given to none.
+    if (data->from != NULL) {
+      create_interned_bigint_from_evmc_address(env, ctx, data->from, &values[0]);
+    } else {
+      status = napi_get_undefined(env, &values[0]);
+      assert(status == napi_ok);
+    }
+    if (data->to != NULL) {
+      create_interned_bigint_from_evmc_address(env, ctx, data->to, &values[1]);
+    } else {
+      status = napi_get_undefined(env, &values[1]);
+      assert(status == napi_ok);
+    }
+    create_bigint_from_evmc_bytes32(env, data->value, &values[2]);
 
-  status = napi_create_threadsafe_function(env, storage_callback, NULL, unnamed, 0, 1, NULL, NULL, (void*) ctx,(napi_threadsafe_function_call_js) get_storage_js, &ctx->get_storage_fn);
-  assert(status == napi_ok);
+    get_execution_handle(env, (struct js_call*) data, &values[3]);
 
-  napi_value set_storage_callback;
-  status = napi_get_named_property(env, node_context, "setStorage", &set_storage_callback);
-  assert(status == napi_ok); 
+    napi_value result;
+    status = napi_call_function(env, object, js_callback, 4, values, &result);
+    assert(status == napi_ok);
 
-  status = napi_create_threadsafe_function(env, set_storage_callback, NULL, unnamed, 0, 1, NULL, NULL, (void*) ctx, (napi_threadsafe_function_call_js) set_storage_js, &ctx->set_storage_fn);
-  assert(status == napi_ok);
-    
-  napi_value get_balance_callback;
-  status = napi_get_named_property(env, node_context, "getBalance", &get_balance_callback);
-  assert(status == napi_ok); 
+    js_return_or_await(env, ctx, result, (struct js_call*) data, NULL);
+}
 
-  status = napi_create_threadsafe_function(env, get_balance_callback, NULL, unnamed, 0, 1, NULL, NULL, (void*) ctx, (napi_threadsafe_function_call_js) get_balance_js, &ctx->get_balance_fn);
-  assert(status == napi_ok);
+/**
+ * Moves value between accounts through the host, which EVMC leaves to it.
+ * Either account may be NULL, to only take or only give the value.
+ */
+void transfer(struct js_execution_context* execution, const evmc_address* from,
+              const evmc_address* to, const evmc_uint256be* value) {
+    struct js_transfer_call callinfo;
+    memset(&callinfo, 0, sizeof(callinfo));
+    callinfo.from = from;
+    callinfo.to = to;
+    callinfo.value = value;
+
+    js_call_and_wait(execution, EVMC_HOST_TRANSFER, (struct js_call*) &callinfo);
+
+    if (from != NULL) {
+      forget_account(execution, from);
+    }
+    if (to != NULL) {
+      forget_account(execution, to);
+    }
+}
 
-  napi_value get_code_size_callback;
-  status = napi_get_named_property(env, node_context, "getCodeSize", &get_code_size_callback);
-  assert(status == napi_ok); 
+// Forward declaration
+void completer_js(napi_env env, napi_value js_callback, struct evmc_js_context* ctx, void* data);
+
+typedef void (*host_call_js_fn)(napi_env env, napi_value js_callback, struct evmc_js_context* ctx, void* data);
+
+/** The property of the callbacks object answering each host call, and how it is called */
+static const struct {
+  const char* name;
+  host_call_js_fn call_js;
+} host_callbacks[EVMC_HOST_CALL_COUNT] = {
+  [EVMC_HOST_ACCOUNT_EXISTS] = {"getAccountExists", (host_call_js_fn) account_exists_js},
+  [EVMC_HOST_GET_STORAGE] = {"getStorage", (host_call_js_fn) get_storage_js},
+  [EVMC_HOST_SET_STORAGE] = {"setStorage", (host_call_js_fn) set_storage_js},
+  [EVMC_HOST_GET_BALANCE] = {"getBalance", (host_call_js_fn) get_balance_js},
+  [EVMC_HOST_GET_CODE_SIZE] = {"getCodeSize", (host_call_js_fn) get_code_size_js},
+  [EVMC_HOST_GET_CODE_HASH] = {"getCodeHash", (host_call_js_fn) get_code_hash_js},
+  [EVMC_HOST_COPY_CODE] = {"copyCode", (host_call_js_fn) copy_code_js},
+  [EVMC_HOST_SELFDESTRUCT] = {"selfDestruct", (host_call_js_fn) selfdestruct_js},
+  [EVMC_HOST_CALL] = {"call", (host_call_js_fn) call_js},
+  [EVMC_HOST_GET_TX_CONTEXT] = {"getTxContext", (host_call_js_fn) get_tx_context_js},
+  [EVMC_HOST_GET_BLOCK_HASH] = {"getBlockHash", (host_call_js_fn) get_block_hash_js},
+  [EVMC_HOST_EMIT_LOG] = {"emitLog", (host_call_js_fn) emit_log_js},
+  [EVMC_HOST_TRANSFER] = {"transfer", (host_call_js_fn) transfer_js},
+};
 
-  status = napi_create_threadsafe_function(env, get_code_size_callback, NULL, unnamed, 0, 1, NULL, NULL, (void*) ctx, (napi_threadsafe_function_call_js) get_code_size_js, &ctx->get_code_size_fn);
+/**
+ * Gets the callback answering a type of host call, binding it the first time
+ * it is asked for, so that callbacks a workload never uses are never bound.
+ */
+void get_host_callback(napi_env env, struct evmc_js_context* ctx, enum evmc_host_call type, napi_value* out) {
+  napi_status status;
+  if (ctx->host_callbacks[type] == NULL) {
+    napi_value callbacks;
+    status = napi_get_reference_value(env, ctx->callbacks, &callbacks);
+    assert(status == napi_ok);
+    status = napi_get_named_property(env, callbacks, host_callbacks[type].name, out);
+    assert(status == napi_ok);
+    status = napi_create_reference(env, *out, 1, &ctx->host_callbacks[type]);
+    assert(status == napi_ok);
+    return;
+  }
+  status = napi_get_reference_value(env, ctx->host_callbacks[type], out);
   assert(status == napi_ok);
+}
 
-  napi_value get_code_hash_callback;
-  status = napi_get_named_property(env, node_context, "getCodeHash", &get_code_hash_callback);
-  assert(status == napi_ok); 
-
-  status = napi_create_threadsafe_function(env, get_code_hash_callback, NULL, unnamed, 0, 1, NULL, NULL, (void*) ctx, (napi_threadsafe_function_call_js) get_code_hash_js, &ctx->get_code_hash_fn);
+/** Hosts which never execute transactions need not move value. */
+bool has_transfer_callback(napi_env env, struct evmc_js_context* ctx) {
+  napi_value callback;
+  get_host_callback(env, ctx, EVMC_HOST_TRANSFER, &callback);
+  napi_valuetype type;
+  napi_status status = napi_typeof(env, callback, &type);
   assert(status == napi_ok);
+  return type == napi_function;
+}
 
-  napi_value copy_code_callback;
-  status = napi_get_named_property(env, node_context, "copyCode", &copy_code_callback);
-  assert(status == napi_ok); 
-
-  status = napi_create_threadsafe_function(env, copy_code_callback, NULL, unnamed, 0, 1, NULL, NULL, (void*) ctx, (napi_threadsafe_function_call_js) copy_code_js, &ctx->copy_code_fn);
-  assert(status == napi_ok);
+void host_call_js(napi_env env, napi_value unused, struct evmc_js_context* ctx, struct js_call* data) {
+  napi_value js_callback;
+  get_host_callback(env, ctx, data->type, &js_callback);
+  host_callbacks[data->type].call_js(env, js_callback, ctx, data);
+}
 
-  napi_value self_destruct_callback;
-  status = napi_get_named_property(env, node_context, "selfDestruct", &self_destruct_callback);
-  assert(status == napi_ok); 
+void create_callbacks_from_context(napi_env env, struct evmc_js_context* ctx, napi_value node_context) {
+  napi_status status;
 
-  status = napi_create_threadsafe_function(env, self_destruct_callback, NULL, unnamed, 0, 1, NULL, NULL, (void*) ctx, (napi_threadsafe_function_call_js) selfdestruct_js, &ctx->selfdestruct_fn);
+  status = napi_create_reference(env, node_context, 1, &ctx->callbacks);
   assert(status == napi_ok);
+  memset(ctx->host_callbacks, 0, sizeof(ctx->host_callbacks));
+  ctx->host_call_fn = NULL;
+  ctx->completer = NULL;
+}
 
-  napi_value call_callback;
-  status = napi_get_named_property(env, node_context, "call", &call_callback);
-  assert(status == napi_ok); 
+/**
+ * Creates the threadsafe functions executions call back through, before the
+ * first execution of the EVM, so that EVMs which are created ahead of time
+ * or never run do not pay for them.
+ */
+void ensure_threadsafe_functions(napi_env env, struct evmc_js_context* ctx) {
+  napi_status status;
+  if (ctx->host_call_fn != NULL) {
+    return;
+  }
 
-  status = napi_create_threadsafe_function(env, call_callback, NULL, unnamed, 0, 1, NULL, NULL, (void*) ctx, (napi_threadsafe_function_call_js) call_js, &ctx->call_fn);
+  napi_value unnamed;
+  status = napi_create_string_utf8(env, "unnamed", NAPI_AUTO_LENGTH, &unnamed);
   assert(status == napi_ok);
 
-  napi_value tx_context_callback;
-  status = napi_get_named_property(env, node_context, "getTxContext", &tx_context_callback);
-  assert(status == napi_ok); 
+  status = napi_create_threadsafe_function(env, NULL, NULL, unnamed, 0, 1, NULL, NULL, (void*) ctx, (napi_threadsafe_function_call_js) host_call_js, &ctx->host_call_fn);
+  assert(status == napi_ok);
 
-  status = napi_create_threadsafe_function(env, tx_context_callback, NULL, unnamed, 0, 1, NULL, NULL, (void*) ctx, (napi_threadsafe_function_call_js) get_tx_context_js, &ctx->get_tx_context_fn);
+  status = napi_create_threadsafe_function(env, NULL, NULL, unnamed, 0, 1, NULL, NULL, (void*) ctx, (napi_threadsafe_function_call_js) completer_js, &ctx->completer);
   assert(status == napi_ok);
+}
 
-  napi_value get_block_hash_callback;
-  status = napi_get_named_property(env, node_context, "getBlockHash", &get_block_hash_callback);
-  assert(status == napi_ok); 
+void release_callbacks_from_context(napi_env env, struct evmc_js_context* ctx) {
+  napi_status status;
 
-  status = napi_create_threadsafe_function(env, get_block_hash_callback, NULL, unnamed, 0, 1, NULL, NULL, (void*) ctx, (napi_threadsafe_function_call_js) get_block_hash_js, &ctx->get_block_hash_fn);
-  assert(status == napi_ok);
+  if (ctx->host_call_fn != NULL) {
+    status = napi_release_threadsafe_function(ctx->host_call_fn, napi_tsfn_release);
+    assert(status == napi_ok);
 
-  napi_value emit_log_callback;
-  status = napi_get_named_property(env, node_context, "emitLog", &emit_log_callback);
-  assert(status == napi_ok); 
+    status = napi_release_threadsafe_function(ctx->completer, napi_tsfn_release);
+    assert(status == napi_ok);
+  }
 
-  status = napi_create_threadsafe_function(env, emit_log_callback, NULL, unnamed, 0, 1, NULL, NULL, (void*) ctx, (napi_threadsafe_function_call_js) emit_log_js, &ctx->emit_log_fn);
-  assert(status == napi_ok);
+  // Continuations still waiting on a promise free themselves once it
+  // settles, see evmc_cleanup_evm.
+  while (ctx->free_continuations != NULL) {
+    struct js_continuation* continuation = ctx->free_continuations;
+    ctx->free_continuations = continuation->next;
+    status = napi_delete_reference(env, continuation->function);
+    assert(status == napi_ok);
+    free(continuation);
+  }
 
-  napi_value execute_complete_callback;
-  status = napi_get_named_property(env, node_context, "executeComplete", &execute_complete_callback);
-  assert(status == napi_ok); 
+}
 
-  status = napi_create_threadsafe_function(env, execute_complete_callback, NULL, unnamed, 0, 1, NULL, NULL, (void*) ctx, (napi_threadsafe_function_call_js) completer_js, &ctx->completer);
-  assert(status == napi_ok);
+/**
+ * Resolves the promise of a finished execution with its result, or rejects it
+ * if the execution expired.
+ */
+void release_execution_handle(napi_env env, struct js_execution_context* data) {
+  napi_status status;
+  if (data->handle != NULL) {
+    status = napi_delete_reference(env, data->handle);
+    assert(status == napi_ok);
+  }
+  if (data->abort != NULL) {
+    data->abort->execution = NULL;
+    status = napi_delete_reference(env, data->abort_ref);
+    assert(status == napi_ok);
+  }
 }
 
-void release_callbacks_from_context(napi_env env, struct evmc_js_context* ctx) {
+/** Rejects the promise of an execution which never ran. */
+void reject_execution(napi_env env, struct js_execution_context* data, const char* code,
+                      const char* message) {
   napi_status status;
 
-  status = napi_release_threadsafe_function(ctx->account_exists_fn, napi_tsfn_release);
+  if (data->state != NULL) {
+    evmc_state_end(data->state);
+    evmc_state_release(data->state);
+  }
+
+  napi_value node_code;
+  status = napi_create_string_utf8(env, code, NAPI_AUTO_LENGTH, &node_code);
   assert(status == napi_ok);
-  
-  status = napi_release_threadsafe_function(ctx->get_storage_fn, napi_tsfn_release);
+  napi_value node_message;
+  status = napi_create_string_utf8(env, message, NAPI_AUTO_LENGTH, &node_message);
   assert(status == napi_ok);
-  
-  status = napi_release_threadsafe_function(ctx->set_storage_fn, napi_tsfn_release);
+  napi_value error;
+  status = napi_create_error(env, node_code, node_message, &error);
   assert(status == napi_ok);
-
-  status = napi_release_threadsafe_function(ctx->get_balance_fn, napi_tsfn_release);
+  status = napi_reject_deferred(env, data->deferred, error);
   assert(status == napi_ok);
 
-  status = napi_release_threadsafe_function(ctx->get_code_size_fn, napi_tsfn_release);
-  assert(status == napi_ok);
+  release_execution_handle(env, data);
+  evmc_arena_release(data->arena);
+}
 
-  status = napi_release_threadsafe_function(ctx->get_code_hash_fn, napi_tsfn_release);
+/** Builds the receipt of a transaction which ran, see execute_transaction. */
+napi_value create_receipt_object(napi_env env, struct js_execution_context* data) {
+  napi_status status;
+  struct js_transaction* tx = data->transaction;
+
+  napi_value out;
+  status = napi_create_object(env, &out);
   assert(status == napi_ok);
 
-  status = napi_release_threadsafe_function(ctx->copy_code_fn, napi_tsfn_release);
+  napi_value value;
+  status = napi_create_int32(env, data->result.status_code, &value);
+  assert(status == napi_ok);
+  status = napi_set_named_property(env, out, "statusCode", value);
   assert(status == napi_ok);
 
-  status = napi_release_threadsafe_function(ctx->selfdestruct_fn, napi_tsfn_release);
+  status = napi_create_bigint_int64(env, tx->gas_used, &value);
+  assert(status == napi_ok);
+  status = napi_set_named_property(env, out, "gasUsed", value);
   assert(status == napi_ok);
 
-  status = napi_release_threadsafe_function(ctx->call_fn, napi_tsfn_release);
+  status = napi_create_bigint_int64(env, tx->gas_refund, &value);
+  assert(status == napi_ok);
+  status = napi_set_named_property(env, out, "gasRefund", value);
   assert(status == napi_ok);
 
-  status = napi_release_threadsafe_function(ctx->get_tx_context_fn, napi_tsfn_release);
+  create_bigint_from_evmc_bytes32(env, &tx->fee, &value);
+  status = napi_set_named_property(env, out, "fee", value);
   assert(status == napi_ok);
 
-  status = napi_release_threadsafe_function(ctx->get_block_hash_fn, napi_tsfn_release);
+  status = napi_create_buffer_copy(env, data->result.output_size, data->result.output_data, NULL, &value);
+  assert(status == napi_ok);
+  status = napi_set_named_property(env, out, "outputData", value);
   assert(status == napi_ok);
 
-  status = napi_release_threadsafe_function(ctx->emit_log_fn, napi_tsfn_release);
+  if (data->message.kind == EVMC_CREATE && data->result.status_code == EVMC_SUCCESS) {
+    create_bigint_from_evmc_address(env, &data->result.create_address, &value);
+    status = napi_set_named_property(env, out, "createAddress", value);
+    assert(status == napi_ok);
+  }
+
+  napi_value logs;
+  status = napi_create_array(env, &logs);
   assert(status == napi_ok);
+  uint32_t index = 0;
+  struct js_log* log;
+  for (log = tx->logs; log != NULL; log = log->next) {
+    napi_value node_log;
+    status = napi_create_object(env, &node_log);
+    assert(status == napi_ok);
+
+    create_bigint_from_evmc_address(env, &log->address, &value);
+    status = napi_set_named_property(env, node_log, "address", value);
+    assert(status == napi_ok);
+
+    status = napi_create_buffer_copy(env, log->data_size, log->data, NULL, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, node_log, "data", value);
+    assert(status == napi_ok);
+
+    napi_value topics;
+    status = napi_create_array_with_length(env, log->topics_count, &topics);
+    assert(status == napi_ok);
+    size_t i;
+    for (i = 0; i < log->topics_count; i++) {
+      create_bigint_from_evmc_bytes32(env, &log->topics[i], &value);
+      status = napi_set_element(env, topics, (uint32_t) i, value);
+      assert(status == napi_ok);
+    }
+    status = napi_set_named_property(env, node_log, "topics", topics);
+    assert(status == napi_ok);
 
-  status = napi_release_threadsafe_function(ctx->completer, napi_tsfn_release);
+    status = napi_set_element(env, logs, index++, node_log);
+    assert(status == napi_ok);
+  }
+  status = napi_set_named_property(env, out, "logs", logs);
   assert(status == napi_ok);
 
+  return out;
 }
 
-void completer_js(napi_env env, napi_value js_callback, void* context, struct js_execution_context* data) {
+void resolve_execution(napi_env env, struct js_execution_context* data) {
   napi_status status;
   napi_value out;
 
-  status = napi_create_object(env, &out);
-  assert(status == napi_ok);
+  if (data->expired) {
+    reject_execution(env, data, "ETIMEDOUT", "Execution deadline passed before it started");
+    return;
+  }
 
-  napi_value statusCode;
-  status = napi_create_int32(env, data->result.status_code, &statusCode);
-  assert(status == napi_ok);
-  status = napi_set_named_property(env, out, "statusCode", statusCode);
-  assert(status == napi_ok);
+  if (data->aborted) {
+    if (data->result.release != NULL) {
+      data->result.release(&data->result);
+    }
+    evmc_scheduler_count_aborted(data->context->scheduler, data->priority);
+    reject_execution(env, data, "ECANCELED", "Execution was aborted");
+    return;
+  }
 
-  napi_value gasLeft;
-  status = napi_create_bigint_int64(env, data->result.gas_left, &gasLeft);
-  assert(status == napi_ok);
-  status = napi_set_named_property(env, out, "gasLeft", gasLeft);
-  assert(status == napi_ok);
+  // A missing proof may also be why a transaction looked invalid.
+  if (data->witness_error != NULL) {
+    if (data->result.release != NULL) {
+      data->result.release(&data->result);
+    }
+    reject_execution(env, data, "EWITNESS", data->witness_error);
+    return;
+  }
 
-  napi_value outputData;
-  void* outputDataBuffer;
-  status = napi_create_buffer_copy(env, data->result.output_size, data->result.output_data, &outputDataBuffer, &outputData);
-  assert(status == napi_ok);
-  status = napi_set_named_property(env, out, "outputData", outputData);
-  assert(status == napi_ok);
+  if (data->transaction != NULL && data->transaction->error != NULL) {
+    reject_execution(env, data, "EINVALIDTX", data->transaction->error);
+    return;
+  }
 
-  if (data->result.status_code == EVMC_SUCCESS) {
-    napi_value createAddress;
-    status = napi_create_bigint_words(env, 0, 4, (uint64_t*) data->result.create_address.bytes, &createAddress);
+  if (data->transaction != NULL) {
+    out = create_receipt_object(env, data);
+  } else {
+    out = create_result_object(env, &data->result);
+  }
+  if (data->result.release != NULL) {
+    data->result.release(&data->result);
+  }
+
+  if (data->estimate) {
+    napi_value estimate;
+    status = napi_create_object(env, &estimate);
     assert(status == napi_ok);
-    status = napi_set_named_property(env, out, "createAddress", createAddress);
+
+    napi_value gas;
+    status = napi_create_bigint_int64(env, data->gas_high, &gas);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, estimate, "gas", gas);
     assert(status == napi_ok);
+    status = napi_set_named_property(env, estimate, "result", out);
+    assert(status == napi_ok);
+
+    out = estimate;
+  }
+
+  if (data->state != NULL) {
+    evmc_state_end(data->state);
+    evmc_state_release(data->state);
   }
 
   status = napi_resolve_deferred(env, data->deferred, out);
   assert(status == napi_ok);
 
-  free(data);
+  release_execution_handle(env, data);
+  evmc_arena_release(data->arena);
 }
 
-void execute_done(uv_work_t* work, int status) {
-  free(work);
+/** Tells the garbage collector how much native memory executions hold. */
+void report_arena_memory(napi_env env) {
+  int64_t change = evmc_arena_take_reserved_change();
+  if (change != 0) {
+    int64_t total;
+    napi_status status = napi_adjust_external_memory(env, change, &total);
+    assert(status == napi_ok);
+  }
 }
 
-void execute(uv_work_t* work) {
-  struct js_execution_context* data = (struct js_execution_context*) work->data;
-  data->result = data->context->instance->execute(data->context->instance, (struct evmc_context*) data->context, data->revision, &data->message, data->code, data->code_size);
-  if (data->code_size != 0) {
-    free(data->code);
+/**
+ * Resolves a batch of finished executions. Microtasks run once the whole batch
+ * is resolved, and the rest of the queue waits for the next call, so the event
+ * loop gets a turn between batches.
+ */
+void completer_js(napi_env env, napi_value js_callback, struct evmc_js_context* ctx, void* data) {
+  napi_status status;
+  struct evmc_completion* batch[EVMC_COMPLETION_BATCH_MAX];
+  bool more;
+  size_t count = evmc_completion_queue_take(ctx->completions, batch, &more);
+
+  size_t i;
+  for (i = 0; i < count; i++) {
+    napi_handle_scope scope;
+    status = napi_open_handle_scope(env, &scope);
+    assert(status == napi_ok);
+    resolve_execution(env, (struct js_execution_context*)
+        ((char*) batch[i] - offsetof(struct js_execution_context, completion)));
+    status = napi_close_handle_scope(env, scope);
+    assert(status == napi_ok);
   }
-  if (data->message.input_size != 0) {
-    free((void*) data->message.input_data);
+
+  if (more) {
+    napi_call_threadsafe_function(ctx->completer, NULL, napi_tsfn_nonblocking);
   }
-  napi_call_threadsafe_function(data->context->completer, data, napi_tsfn_blocking);
+
+  report_arena_memory(env);
 }
 
-struct evmc_host_interface host_interface;
+/** Releases what the execution retained, and hands it back to JS. */
+void finish_execution(struct js_execution_context* data) {
+  data->aborted = execution_aborted(data);
+  evmc_tiering_release(data->tiering);
+  if (data->recorder != NULL) {
+    if (!data->expired && !data->aborted) {
+      evmc_trace_put_u8(&data->trace, EVMC_TRACE_END);
+      evmc_trace_put_result(&data->trace, &data->result);
+      evmc_trace_writer_append(data->recorder, &data->trace);
+    }
+    evmc_trace_buffer_free(&data->trace);
+    evmc_trace_writer_release(data->recorder);
+  }
+  if (data->account_cache != NULL) {
+    evmc_account_cache_release(data->account_cache);
+  }
+  if (data->result_cache != NULL) {
+    evmc_read_set_free(&data->read_set);
+    evmc_result_cache_release(data->result_cache);
+  }
+  if (data->profiler != NULL) {
+    evmc_profiler_release(data->profiler);
+  }
+  if (data->snapshot != NULL) {
+    evmc_snapshot_release(data->snapshot);
+  }
+  if (data->witness != NULL) {
+    evmc_witness_release(data->witness);
+  }
+  if (data->write_set != NULL) {
+    evmc_write_set_release(data->write_set);
+  }
+  struct evmc_js_context* context = data->context;
+  if (evmc_completion_queue_push(context->completions, &data->completion)) {
+    napi_call_threadsafe_function(context->completer, NULL, napi_tsfn_blocking);
+  }
+}
 
-napi_value evmc_execute_evm(napi_env env, napi_callback_info info) {
-  napi_value argv[2];
-  napi_status status;
+/*
+ * The memoizing host answers like the regular one, and notes in the read set
+ * of the execution what each answer depends on, so that the result of a
+ * static execution can be stored and served again while its reads hold. Calls
+ * which reach JS make the result uncacheable, as what they read is unknown.
+ */
 
-  size_t argc = 2;
+bool memo_account_exists(struct js_execution_context* execution, const evmc_address* address) {
+  evmc_read_set_account(execution->result_cache, &execution->read_set, address);
+  return account_exists(execution, address);
+}
 
-  status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
-  assert(status == napi_ok);
+evmc_bytes32 memo_get_storage(struct js_execution_context* execution, const evmc_address* address,
+                              const evmc_bytes32* key) {
+  evmc_read_set_account(execution->result_cache, &execution->read_set, address);
+  return get_storage(execution, address, key);
+}
 
-  if (argc < 2) {
-    napi_throw_error(env, "EINVAL", "Too few arguments");
-    return NULL;
-  }
+enum evmc_storage_status memo_set_storage(struct js_execution_context* execution, const evmc_address* address,
+                                          const evmc_bytes32* key, const evmc_bytes32* value) {
+  execution->read_set.uncacheable = true;
+  return set_storage(execution, address, key, value);
+}
 
-  // this needs to run on another thread, apparently, so we need to return a promise
-  struct js_execution_context* js_ctx = (struct js_execution_context*) malloc(sizeof(struct js_execution_context));
+evmc_bytes32 memo_get_balance(struct js_execution_context* execution, const evmc_address* address) {
+  evmc_read_set_account(execution->result_cache, &execution->read_set, address);
+  return get_balance(execution, address);
+}
 
-  status = napi_get_value_external(env, argv[0], (void*) &js_ctx->context);
-  assert(status == napi_ok);
- 
-  napi_value node_revision;
-  status = napi_get_named_property(env, argv[1], "revision", &node_revision);
-  assert(status == napi_ok);
-  status = napi_get_value_int32(env, node_revision, (int32_t*) &js_ctx->revision);
-  assert(status == napi_ok);
+size_t memo_get_code_size(struct js_execution_context* execution, const evmc_address* address) {
+  evmc_read_set_account(execution->result_cache, &execution->read_set, address);
+  return get_code_size(execution, address);
+}
 
-  napi_value node_message;
-  status = napi_get_named_property(env, argv[1], "message", &node_message);
-  assert(status == napi_ok);
+evmc_bytes32 memo_get_code_hash(struct js_execution_context* execution, const evmc_address* address) {
+  evmc_read_set_account(execution->result_cache, &execution->read_set, address);
+  return get_code_hash(execution, address);
+}
 
-  napi_value node_message_gas;
-  status = napi_get_named_property(env, node_message, "gas", &node_message_gas);
-  assert(status == napi_ok);
-  bool node_message_gas_lossless;
-  status = napi_get_value_bigint_int64(env, node_message_gas, &js_ctx->message.gas, &node_message_gas_lossless);
-  assert(status == napi_ok);
+size_t memo_copy_code(struct js_execution_context* execution, const evmc_address* address,
+                      size_t code_offset, uint8_t* buffer_data, size_t buffer_size) {
+  evmc_read_set_account(execution->result_cache, &execution->read_set, address);
+  return copy_code(execution, address, code_offset, buffer_data, buffer_size);
+}
 
-  napi_value node_message_depth;
-  status = napi_get_named_property(env, node_message, "depth", &node_message_depth);
-  assert(status == napi_ok);
-  status = napi_get_value_int32(env, node_message_depth, &js_ctx->message.depth);
-  assert(status == napi_ok);
+void memo_selfdestruct(struct js_execution_context* execution, const evmc_address* address,
+                       const evmc_address* beneficiary) {
+  execution->read_set.uncacheable = true;
+  selfdestruct(execution, address, beneficiary);
+}
+
+struct evmc_result memo_call(struct js_execution_context* execution, const struct evmc_message* msg) {
+  if (!calls_native_precompile(execution, msg)) {
+    execution->read_set.uncacheable = true;
+  }
+  return call(execution, msg);
+}
+
+struct evmc_tx_context memo_get_tx_context(struct js_execution_context* execution) {
+  struct evmc_tx_context result = get_tx_context(execution);
+  evmc_read_set_tx_context(&execution->read_set, &result);
+  return result;
+}
+
+evmc_bytes32 memo_get_block_hash(struct js_execution_context* execution, uint64_t number) {
+  evmc_bytes32 result = get_block_hash(execution, number);
+  evmc_read_set_block_hash(&execution->read_set, number, &result);
+  return result;
+}
+
+void memo_emit_log(struct js_execution_context* execution, const evmc_address* address,
+                   const uint8_t* data, size_t data_size, const evmc_bytes32 topics[], size_t topics_count) {
+  execution->read_set.uncacheable = true;
+  emit_log(execution, address, data, data_size, topics, topics_count);
+}
+
+struct evmc_host_interface memo_host_interface;
+
+bool tx_context_equal(const struct evmc_tx_context* a, const struct evmc_tx_context* b) {
+  return memcmp(&a->tx_gas_price, &b->tx_gas_price, sizeof(a->tx_gas_price)) == 0 &&
+         memcmp(&a->tx_origin, &b->tx_origin, sizeof(a->tx_origin)) == 0 &&
+         memcmp(&a->block_coinbase, &b->block_coinbase, sizeof(a->block_coinbase)) == 0 &&
+         a->block_number == b->block_number &&
+         a->block_timestamp == b->block_timestamp &&
+         a->block_gas_limit == b->block_gas_limit &&
+         memcmp(&a->block_difficulty, &b->block_difficulty, sizeof(a->block_difficulty)) == 0;
+}
+
+/**
+ * Answers a static execution with the result stored under key, if the
+ * accounts, transaction context and block hashes it read are unchanged.
+ * Returns false if the execution has to run.
+ */
+bool serve_cached_result(struct js_execution_context* data, const evmc_bytes32* key) {
+  const struct evmc_cached_result* cached = evmc_result_cache_lookup(data->result_cache, key);
+  if (cached == NULL) {
+    return false;
+  }
+
+  // The context and hashes are asked for as the execution would.
+  bool valid = true;
+  if (cached->reads_tx_context) {
+    struct evmc_tx_context tx_context = get_tx_context(data);
+    valid = tx_context_equal(&tx_context, &cached->tx_context);
+  }
+  size_t i;
+  for (i = 0; valid && i < cached->block_hash_count; i++) {
+    evmc_bytes32 hash = get_block_hash(data, cached->block_hashes[i].number);
+    valid = memcmp(&hash, &cached->block_hashes[i].hash, sizeof(hash)) == 0;
+  }
+
+  // An execution aborted while asking is rejected without a result.
+  if (execution_aborted(data)) {
+    evmc_cached_result_release(cached);
+    return true;
+  }
+  evmc_result_cache_settle(data->result_cache, cached, valid);
+  if (valid) {
+    memset(&data->result, 0, sizeof(data->result));
+    data->result.status_code = cached->status_code;
+    data->result.gas_left = cached->gas_left;
+    if (cached->output_size > 0) {
+      uint8_t* output = (uint8_t*) evmc_arena_alloc(data->arena, cached->output_size);
+      memcpy(output, cached->output_data, cached->output_size);
+      data->result.output_data = output;
+      data->result.output_size = cached->output_size;
+    }
+  }
+  evmc_cached_result_release(cached);
+  return valid;
+}
+
+/** Stores the result of a static execution with what it read, if it can be served again. */
+void store_result(struct js_execution_context* data, const evmc_bytes32* key) {
+  if (data->witness_error != NULL || execution_aborted(data) ||
+      data->result.status_code < 0 || data->result.status_code == EVMC_REJECTED) {
+    return;
+  }
+  evmc_result_cache_store(data->result_cache, key, &data->read_set, &data->result);
+}
+
+/** Runs the execution once on the VM, counting the run if it is profiled. */
+struct evmc_result run_profiled(struct js_execution_context* data) {
+  if (data->profiler == NULL) {
+    return evmc_tiering_execute(data->tiering, (struct evmc_context*) data, data->revision, &data->message, data->code, data->code_size);
+  }
+  memset(&data->profile, 0, sizeof(data->profile));
+  uint64_t start = uv_hrtime();
+  struct evmc_result result = evmc_tiering_execute(data->tiering, (struct evmc_context*) data, data->revision, &data->message, data->code, data->code_size);
+  uint64_t gas_used = result.gas_left < data->message.gas ? data->message.gas - result.gas_left : 0;
+  evmc_profiler_record(data->profiler, data->code, data->code_size, gas_used, uv_hrtime() - start,
+                       &data->profile);
+  return result;
+}
+
+/**
+ * Runs the execution once, dropping the writes it journaled, including those
+ * of executions nested in it, and those it made to its state view, if it
+ * fails or is aborted. The code created by a transaction is charged for
+ * first, as a create which cannot pay for it fails.
+ */
+struct evmc_result run_vm(struct js_execution_context* data) {
+  size_t mark = data->write_set != NULL ? evmc_write_set_mark(data->write_set) : 0;
+  struct evmc_result result = run_profiled(data);
+  if (data->transaction != NULL && data->message.kind == EVMC_CREATE &&
+      result.status_code == EVMC_SUCCESS && evmc_tx_deposit_code(data->revision, &result)) {
+    result.create_address = data->message.destination;
+  }
+  if (result.status_code != EVMC_SUCCESS || execution_aborted(data)) {
+    if (data->write_set != NULL) {
+      evmc_write_set_revert(data->write_set, mark);
+    }
+    if (data->state != NULL) {
+      evmc_state_revert(data->state);
+    }
+  }
+  return result;
+}
+
+void execute(struct js_execution_context* data, bool expired) {
+  if (expired || execution_aborted(data)) {
+    data->expired = expired;
+    finish_execution(data);
+    return;
+  }
+  if (data->host != &memo_host_interface) {
+    data->result = run_vm(data);
+    finish_execution(data);
+    return;
+  }
+
+  evmc_bytes32 key;
+  evmc_result_cache_key(&data->message, data->revision, data->code, data->code_size, &key);
+  if (!serve_cached_result(data, &key)) {
+    data->result = run_vm(data);
+    store_result(data, &key);
+  }
+  finish_execution(data);
+}
+
+/**
+ * Checks the transaction can be paid for, charges its intrinsic gas, buys its
+ * gas from the sender, fetches the code to run and moves the value. Returns
+ * false if the transaction is invalid, which then never runs.
+ */
+bool begin_transaction(struct js_execution_context* data) {
+  struct js_transaction* tx = data->transaction;
+  bool create = data->message.kind == EVMC_CREATE;
+
+  int64_t intrinsic_gas = evmc_tx_intrinsic_gas(data->revision, create, data->message.input_data,
+                                                data->message.input_size);
+  if (intrinsic_gas > data->message.gas) {
+    tx->error = "Intrinsic gas exceeds the gas limit";
+    return false;
+  }
+  tx->gas_limit = data->message.gas;
+  data->message.gas -= intrinsic_gas;
+
+  evmc_uint256be cost;
+  evmc_uint256be balance = data->host->get_balance((struct evmc_context*) data, &data->message.sender);
+  if (!evmc_tx_upfront_cost(tx->gas_limit, &tx->gas_price, &data->message.value, &cost) ||
+      evmc_uint256be_compare(&balance, &cost) < 0) {
+    tx->error = "Sender balance does not cover the gas limit and value";
+    return false;
+  }
+
+  // The whole gas limit is paid for before the message runs, so it sees the
+  // sender's balance without it.
+  evmc_uint256be gas_cost;
+  evmc_tx_fee(tx->gas_limit, &tx->gas_price, &gas_cost);
+  if (!is_zero_bytes32(&gas_cost)) {
+    transfer(data, &data->message.sender, NULL, &gas_cost);
+  }
+
+  if (create) {
+    // The data is the init code, which runs without input.
+    evmc_tx_create_address(&data->message.sender, tx->nonce, &data->message.destination);
+    data->code = (uint8_t*) data->message.input_data;
+    data->code_size = data->message.input_size;
+    data->message.input_data = NULL;
+    data->message.input_size = 0;
+  } else {
+    data->code = NULL;
+    data->code_size = data->host->get_code_size((struct evmc_context*) data, &data->message.destination);
+    if (data->code_size > 0) {
+      data->code = (uint8_t*) evmc_arena_alloc(data->arena, data->code_size);
+      data->code_size = data->host->copy_code((struct evmc_context*) data, &data->message.destination,
+                                              0, data->code, data->code_size);
+    }
+  }
+
+  if (!is_zero_bytes32(&data->message.value)) {
+    transfer(data, &data->message.sender, &data->message.destination, &data->message.value);
+  }
+  return true;
+}
+
+/**
+ * Settles gas and refunds, gives the value back if the message failed,
+ * returns the unused and refunded gas to the sender, and pays the fee to the
+ * coinbase. Created code has been deposited by run_vm.
+ */
+void end_transaction(struct js_execution_context* data) {
+  struct js_transaction* tx = data->transaction;
+
+  bool success = data->result.status_code == EVMC_SUCCESS;
+  tx->gas_used = tx->gas_limit - data->result.gas_left;
+  // Refunds of a failed message are discarded with its writes.
+  tx->gas_refund = success ? evmc_tx_capped_refund(tx->refund, tx->gas_used) : 0;
+  tx->gas_used -= tx->gas_refund;
+  if (!success) {
+    tx->logs = NULL;
+  }
+
+  if (!success && !is_zero_bytes32(&data->message.value)) {
+    transfer(data, &data->message.destination, &data->message.sender, &data->message.value);
+  }
+
+  evmc_uint256be unused;
+  evmc_tx_fee(tx->gas_limit - tx->gas_used, &tx->gas_price, &unused);
+  if (!is_zero_bytes32(&unused)) {
+    transfer(data, NULL, &data->message.sender, &unused);
+  }
+  evmc_tx_fee(tx->gas_used, &tx->gas_price, &tx->fee);
+  if (!is_zero_bytes32(&tx->fee)) {
+    struct evmc_tx_context context = data->host->get_tx_context((struct evmc_context*) data);
+    transfer(data, NULL, &context.block_coinbase, &tx->fee);
+  }
+}
+
+/** Runs a whole transaction around its message, see begin_transaction and end_transaction. */
+void execute_transaction(struct js_execution_context* data, bool expired) {
+  if (expired || execution_aborted(data)) {
+    data->expired = expired;
+    finish_execution(data);
+    return;
+  }
+  if (begin_transaction(data)) {
+    data->result = run_vm(data);
+    end_transaction(data);
+  }
+  finish_execution(data);
+}
+
+/**
+ * Finds the lowest gas limit the execution succeeds with by binary search,
+ * reverting the state between runs. Only the first run asks JS for state.
+ */
+void estimate(struct js_execution_context* data, bool expired) {
+  if (expired || execution_aborted(data)) {
+    data->expired = expired;
+    finish_execution(data);
+    return;
+  }
+
+  data->message.gas = data->gas_high;
+  data->result = run_vm(data);
+
+  if (data->result.status_code == EVMC_SUCCESS) {
+    // Everything below low is known to fail, and high is known to succeed.
+    int64_t low = data->gas_low - 1;
+    int64_t high = data->gas_high;
+    while (low + 1 < high && !execution_aborted(data)) {
+      int64_t mid = low + (high - low) / 2;
+      evmc_state_revert(data->state);
+      data->message.gas = mid;
+      struct evmc_result result = run_vm(data);
+      if (result.status_code == EVMC_SUCCESS) {
+        high = mid;
+        if (data->result.release != NULL) {
+          data->result.release(&data->result);
+        }
+        data->result = result;
+      } else {
+        low = mid;
+        if (result.release != NULL) {
+          result.release(&result);
+        }
+      }
+    }
+    data->gas_high = high;
+  }
+
+  finish_execution(data);
+}
+
+struct evmc_host_interface host_interface;
+
+/*
+ * The recording host answers like the regular one, wherever the answer comes
+ * from, and appends each call and its answer to the execution's trace.
+ */
+
+bool record_account_exists(struct js_execution_context* execution, const evmc_address* address) {
+  bool result = account_exists(execution, address);
+  evmc_trace_put_u8(&execution->trace, EVMC_TRACE_ACCOUNT_EXISTS);
+  evmc_trace_put_bytes(&execution->trace, address, sizeof(*address));
+  evmc_trace_put_u8(&execution->trace, result);
+  return result;
+}
+
+evmc_bytes32 record_get_storage(struct js_execution_context* execution, const evmc_address* address,
+                                const evmc_bytes32* key) {
+  evmc_bytes32 result = get_storage(execution, address, key);
+  evmc_trace_put_u8(&execution->trace, EVMC_TRACE_GET_STORAGE);
+  evmc_trace_put_bytes(&execution->trace, address, sizeof(*address));
+  evmc_trace_put_bytes(&execution->trace, key, sizeof(*key));
+  evmc_trace_put_bytes(&execution->trace, &result, sizeof(result));
+  return result;
+}
+
+enum evmc_storage_status record_set_storage(struct js_execution_context* execution, const evmc_address* address,
+                                            const evmc_bytes32* key, const evmc_bytes32* value) {
+  enum evmc_storage_status result = set_storage(execution, address, key, value);
+  evmc_trace_put_u8(&execution->trace, EVMC_TRACE_SET_STORAGE);
+  evmc_trace_put_bytes(&execution->trace, address, sizeof(*address));
+  evmc_trace_put_bytes(&execution->trace, key, sizeof(*key));
+  evmc_trace_put_bytes(&execution->trace, value, sizeof(*value));
+  evmc_trace_put_u8(&execution->trace, (uint8_t) result);
+  return result;
+}
+
+evmc_bytes32 record_get_balance(struct js_execution_context* execution, const evmc_address* address) {
+  evmc_bytes32 result = get_balance(execution, address);
+  evmc_trace_put_u8(&execution->trace, EVMC_TRACE_GET_BALANCE);
+  evmc_trace_put_bytes(&execution->trace, address, sizeof(*address));
+  evmc_trace_put_bytes(&execution->trace, &result, sizeof(result));
+  return result;
+}
+
+size_t record_get_code_size(struct js_execution_context* execution, const evmc_address* address) {
+  size_t result = get_code_size(execution, address);
+  evmc_trace_put_u8(&execution->trace, EVMC_TRACE_GET_CODE_SIZE);
+  evmc_trace_put_bytes(&execution->trace, address, sizeof(*address));
+  evmc_trace_put_u64(&execution->trace, result);
+  return result;
+}
+
+evmc_bytes32 record_get_code_hash(struct js_execution_context* execution, const evmc_address* address) {
+  evmc_bytes32 result = get_code_hash(execution, address);
+  evmc_trace_put_u8(&execution->trace, EVMC_TRACE_GET_CODE_HASH);
+  evmc_trace_put_bytes(&execution->trace, address, sizeof(*address));
+  evmc_trace_put_bytes(&execution->trace, &result, sizeof(result));
+  return result;
+}
+
+size_t record_copy_code(struct js_execution_context* execution, const evmc_address* address,
+                        size_t code_offset, uint8_t* buffer_data, size_t buffer_size) {
+  size_t result = copy_code(execution, address, code_offset, buffer_data, buffer_size);
+  evmc_trace_put_u8(&execution->trace, EVMC_TRACE_COPY_CODE);
+  evmc_trace_put_bytes(&execution->trace, address, sizeof(*address));
+  evmc_trace_put_u64(&execution->trace, code_offset);
+  evmc_trace_put_u64(&execution->trace, buffer_size);
+  evmc_trace_put_u64(&execution->trace, result);
+  evmc_trace_put_bytes(&execution->trace, buffer_data, result);
+  return result;
+}
+
+void record_selfdestruct(struct js_execution_context* execution, const evmc_address* address,
+                         const evmc_address* beneficiary) {
+  selfdestruct(execution, address, beneficiary);
+  evmc_trace_put_u8(&execution->trace, EVMC_TRACE_SELFDESTRUCT);
+  evmc_trace_put_bytes(&execution->trace, address, sizeof(*address));
+  evmc_trace_put_bytes(&execution->trace, beneficiary, sizeof(*beneficiary));
+}
+
+struct evmc_result record_call(struct js_execution_context* execution, const struct evmc_message* msg) {
+  struct evmc_result result = call(execution, msg);
+  evmc_trace_put_u8(&execution->trace, EVMC_TRACE_CALL);
+  evmc_trace_put_message(&execution->trace, msg);
+  evmc_trace_put_result(&execution->trace, &result);
+  return result;
+}
+
+struct evmc_tx_context record_get_tx_context(struct js_execution_context* execution) {
+  struct evmc_tx_context result = get_tx_context(execution);
+  evmc_trace_put_u8(&execution->trace, EVMC_TRACE_GET_TX_CONTEXT);
+  evmc_trace_put_tx_context(&execution->trace, &result);
+  return result;
+}
+
+evmc_bytes32 record_get_block_hash(struct js_execution_context* execution, uint64_t number) {
+  evmc_bytes32 result = get_block_hash(execution, number);
+  evmc_trace_put_u8(&execution->trace, EVMC_TRACE_GET_BLOCK_HASH);
+  evmc_trace_put_u64(&execution->trace, number);
+  evmc_trace_put_bytes(&execution->trace, &result, sizeof(result));
+  return result;
+}
+
+void record_emit_log(struct js_execution_context* execution, const evmc_address* address,
+                     const uint8_t* data, size_t data_size, const evmc_bytes32 topics[], size_t topics_count) {
+  emit_log(execution, address, data, data_size, topics, topics_count);
+  evmc_trace_put_u8(&execution->trace, EVMC_TRACE_EMIT_LOG);
+  evmc_trace_put_bytes(&execution->trace, address, sizeof(*address));
+  evmc_trace_put_u32(&execution->trace, (uint32_t) data_size);
+  evmc_trace_put_bytes(&execution->trace, data, data_size);
+  evmc_trace_put_u32(&execution->trace, (uint32_t) topics_count);
+  evmc_trace_put_bytes(&execution->trace, topics, topics_count * sizeof(evmc_bytes32));
+}
+
+struct evmc_host_interface recording_host_interface;
+
+/*
+ * The state host answers reads from the execution's state, asking the regular
+ * host only the first time they are made, and keeps storage writes to itself.
+ * Everything else goes to the regular host.
+ */
+
+bool state_account_exists(struct js_execution_context* execution, const evmc_address* address) {
+  struct evmc_account_cache_value value;
+  if (!evmc_state_get_account(execution->state, address, EVMC_ACCOUNT_CACHE_EXISTS, &value)) {
+    value.exists = account_exists(execution, address);
+    evmc_state_fill_account(execution->state, address, EVMC_ACCOUNT_CACHE_EXISTS, &value);
+  }
+  return value.exists;
+}
+
+evmc_bytes32 state_get_storage(struct js_execution_context* execution, const evmc_address* address,
+                                  const evmc_bytes32* key) {
+  evmc_bytes32 value;
+  if (!evmc_state_get_storage(execution->state, address, key, &value)) {
+    value = get_storage(execution, address, key);
+    evmc_state_fill_storage(execution->state, address, key, &value);
+  }
+  return value;
+}
+
+enum evmc_storage_status state_set_storage(struct js_execution_context* execution, const evmc_address* address,
+                                              const evmc_bytes32* key, const evmc_bytes32* value) {
+  // The status depends on the original value, so it has to be known.
+  state_get_storage(execution, address, key);
+  journal_storage(execution, address, key, value);
+  enum evmc_storage_status status = evmc_state_set_storage(execution->state, address, key, value);
+  if (execution->transaction != NULL) {
+    execution->transaction->refund += evmc_tx_storage_refund(status);
+  }
+  return status;
+}
+
+evmc_bytes32 state_get_balance(struct js_execution_context* execution, const evmc_address* address) {
+  struct evmc_account_cache_value value;
+  if (!evmc_state_get_account(execution->state, address, EVMC_ACCOUNT_CACHE_BALANCE, &value)) {
+    value.balance = get_balance(execution, address);
+    evmc_state_fill_account(execution->state, address, EVMC_ACCOUNT_CACHE_BALANCE, &value);
+  }
+  return value.balance;
+}
+
+size_t state_get_code_size(struct js_execution_context* execution, const evmc_address* address) {
+  struct evmc_account_cache_value value;
+  if (!evmc_state_get_account(execution->state, address, EVMC_ACCOUNT_CACHE_CODE_SIZE, &value)) {
+    value.code_size = get_code_size(execution, address);
+    evmc_state_fill_account(execution->state, address, EVMC_ACCOUNT_CACHE_CODE_SIZE, &value);
+  }
+  return value.code_size;
+}
+
+evmc_bytes32 state_get_code_hash(struct js_execution_context* execution, const evmc_address* address) {
+  struct evmc_account_cache_value value;
+  if (!evmc_state_get_account(execution->state, address, EVMC_ACCOUNT_CACHE_CODE_HASH, &value)) {
+    value.code_hash = get_code_hash(execution, address);
+    evmc_state_fill_account(execution->state, address, EVMC_ACCOUNT_CACHE_CODE_HASH, &value);
+  }
+  return value.code_hash;
+}
+
+size_t state_copy_code(struct js_execution_context* execution, const evmc_address* address,
+                          size_t code_offset, uint8_t* buffer_data, size_t buffer_size) {
+  size_t code_size;
+  const uint8_t* code = evmc_state_get_code(execution->state, address, &code_size);
+  if (code == NULL) {
+    // Fetch the whole code once, rather than each slice asked for.
+    size_t size = state_get_code_size(execution, address);
+    uint8_t* buffer = (uint8_t*) malloc(size > 0 ? size : 1);
+    size = copy_code(execution, address, 0, buffer, size);
+    evmc_state_fill_code(execution->state, address, buffer, size);
+    free(buffer);
+    code = evmc_state_get_code(execution->state, address, &code_size);
+  }
+
+  if (code_offset >= code_size) {
+    return 0;
+  }
+  size_t bytes_written = code_size - code_offset;
+  if (bytes_written > buffer_size) {
+    bytes_written = buffer_size;
+  }
+  memcpy(buffer_data, code + code_offset, bytes_written);
+  return bytes_written;
+}
+
+struct evmc_host_interface state_host_interface;
+
+/*
+ * The estimating host is the state host, but also keeps logs and self
+ * destructs to itself, so the same transaction can run again with another gas
+ * limit.
+ */
+
+void estimate_selfdestruct(struct js_execution_context* execution, const evmc_address* address,
+                           const evmc_address* beneficiary) {
+}
+
+struct evmc_tx_context state_get_tx_context(struct js_execution_context* execution) {
+  // The state is shared with other executions, which may have contexts of their own.
+  if (execution->has_tx_context) {
+    return execution->tx_context;
+  }
+  struct evmc_tx_context context;
+  if (!evmc_state_get_tx_context(execution->state, &context)) {
+    context = get_tx_context(execution);
+    evmc_state_fill_tx_context(execution->state, &context);
+  }
+  return context;
+}
+
+evmc_bytes32 state_get_block_hash(struct js_execution_context* execution, uint64_t number) {
+  evmc_bytes32 hash;
+  if (!evmc_state_get_block_hash(execution->state, (int64_t) number, &hash)) {
+    hash = get_block_hash(execution, number);
+    evmc_state_fill_block_hash(execution->state, (int64_t) number, &hash);
+  }
+  return hash;
+}
+
+void estimate_emit_log(struct js_execution_context* execution, const evmc_address* address,
+                       const uint8_t* data, size_t data_size, const evmc_bytes32 topics[], size_t topics_count) {
+}
+
+struct evmc_host_interface estimate_host_interface;
+
+char* get_string_from_value(napi_env env, napi_value value) {
+  napi_status status;
+  size_t size;
+
+  status = napi_get_value_string_utf8(env, value, NULL, 0, &size);
+  assert(status == napi_ok);
+  // size excludes NULL terminator
+  char* out = (char*) malloc(size + 1);
+  status = napi_get_value_string_utf8(env, value, out, size + 1, &size);
+  assert(status == napi_ok);
+  return out;
+}
+
+/**
+ * Reads the priority and deadline of an execution from its parameters, and
+ * checks that its priority class has room for it. Throws and returns false
+ * otherwise.
+ */
+bool get_schedule(napi_env env, napi_value handle, napi_value parameters,
+                  enum evmc_priority* priority, uint64_t* deadline) {
+  napi_status status;
+
+  struct evmc_js_context* context;
+  status = napi_get_value_external(env, handle, (void**) &context);
+  assert(status == napi_ok);
+
+  *priority = EVMC_PRIORITY_NORMAL;
+  napi_value node_priority;
+  status = napi_get_named_property(env, parameters, "priority", &node_priority);
+  assert(status == napi_ok);
+  napi_valuetype type;
+  status = napi_typeof(env, node_priority, &type);
+  assert(status == napi_ok);
+  if (type != napi_undefined) {
+    int32_t value;
+    status = napi_get_value_int32(env, node_priority, &value);
+    if (status != napi_ok || value < 0 || value >= EVMC_PRIORITY_COUNT) {
+      napi_throw_error(env, "EINVAL", "Invalid priority");
+      return false;
+    }
+    *priority = (enum evmc_priority) value;
+  }
+
+  *deadline = 0;
+  napi_value node_deadline;
+  status = napi_get_named_property(env, parameters, "deadline", &node_deadline);
+  assert(status == napi_ok);
+  status = napi_typeof(env, node_deadline, &type);
+  assert(status == napi_ok);
+  if (type != napi_undefined) {
+    double milliseconds;
+    status = napi_get_value_double(env, node_deadline, &milliseconds);
+    if (status != napi_ok || !(milliseconds >= 0)) {
+      napi_throw_error(env, "EINVAL", "Invalid deadline");
+      return false;
+    }
+    *deadline = uv_hrtime() + (uint64_t) (milliseconds * 1e6);
+  }
+
+  if (!evmc_scheduler_admit(context->scheduler, *priority)) {
+    napi_throw_error(env, "EBUSY", "Execution queue is full");
+    return false;
+  }
+  return true;
+}
+
+/** The witness behind an EvmcWitness, which is NULL once released */
+struct js_witness_handle {
+  struct evmc_witness* witness;
+};
+
+/** The write set behind an EvmcWriteSet, which is NULL once released */
+struct js_write_set_handle {
+  struct evmc_write_set* write_set;
+};
+
+/** Copies the parameters of an execution, retaining what it will use. */
+struct js_execution_context* create_execution_context(napi_env env, napi_value handle, napi_value parameters) {
+  napi_status status;
+
+  // this needs to run on another thread, apparently, so we need to return a promise
+  struct evmc_arena* arena = evmc_arena_acquire();
+  struct js_execution_context* js_ctx =
+      (struct js_execution_context*) evmc_arena_alloc(arena, sizeof(struct js_execution_context));
+  js_ctx->arena = arena;
+
+  status = napi_get_value_external(env, handle, (void*) &js_ctx->context);
+  assert(status == napi_ok);
+  ensure_threadsafe_functions(env, js_ctx->context);
+
+  js_ctx->host = &host_interface;
+
+  // The snapshot is fixed for the lifetime of the execution, even if another
+  // one is set on the EVM while it runs.
+  js_ctx->snapshot = js_ctx->context->snapshot;
+  if (js_ctx->snapshot != NULL) {
+    evmc_snapshot_retain(js_ctx->snapshot);
+  }
+
+  js_ctx->account_cache = js_ctx->context->account_cache;
+  if (js_ctx->account_cache != NULL) {
+    evmc_account_cache_retain(js_ctx->account_cache);
+  }
+
+  js_ctx->result_cache = js_ctx->context->result_cache;
+  if (js_ctx->result_cache != NULL) {
+    evmc_result_cache_retain(js_ctx->result_cache);
+  }
+  memset(&js_ctx->read_set, 0, sizeof(js_ctx->read_set));
+
+  js_ctx->tiering = js_ctx->context->tiering;
+  evmc_tiering_retain(js_ctx->tiering);
+
+  js_ctx->profiler = js_ctx->context->profiler;
+  if (js_ctx->profiler != NULL) {
+    evmc_profiler_retain(js_ctx->profiler);
+  }
+
+  js_ctx->recorder = NULL;
+  js_ctx->state = NULL;
+  js_ctx->estimate = false;
+  js_ctx->expired = false;
+  js_ctx->transaction = NULL;
+  js_ctx->witness = NULL;
+  js_ctx->witness_error = NULL;
+  js_ctx->result.release = NULL;
+
+  napi_valuetype type;
+  napi_value node_witness;
+  status = napi_get_named_property(env, parameters, "witness", &node_witness);
+  assert(status == napi_ok);
+  status = napi_typeof(env, node_witness, &type);
+  assert(status == napi_ok);
+  if (type == napi_external) {
+    struct js_witness_handle* witness_handle;
+    status = napi_get_value_external(env, node_witness, (void**) &witness_handle);
+    assert(status == napi_ok);
+    js_ctx->witness = witness_handle->witness;
+    if (js_ctx->witness != NULL) {
+      evmc_witness_retain(js_ctx->witness);
+    }
+  }
+
+  js_ctx->abort = NULL;
+  js_ctx->awaiting = NULL;
+  js_ctx->aborted = false;
+  js_ctx->priority = EVMC_PRIORITY_NORMAL;
+  napi_value node_abort;
+  status = napi_get_named_property(env, parameters, "abort", &node_abort);
+  assert(status == napi_ok);
+  status = napi_typeof(env, node_abort, &type);
+  assert(status == napi_ok);
+  if (type == napi_external) {
+    status = napi_get_value_external(env, node_abort, (void**) &js_ctx->abort);
+    assert(status == napi_ok);
+    // The reference keeps the flag until the execution is handed back.
+    status = napi_create_reference(env, node_abort, 1, &js_ctx->abort_ref);
+    assert(status == napi_ok);
+    js_ctx->abort->execution = js_ctx;
+  }
+
+  js_ctx->write_set = NULL;
+  napi_value node_write_set;
+  status = napi_get_named_property(env, parameters, "writeSet", &node_write_set);
+  assert(status == napi_ok);
+  status = napi_typeof(env, node_write_set, &type);
+  assert(status == napi_ok);
+  if (type == napi_external) {
+    struct js_write_set_handle* write_set_handle;
+    status = napi_get_value_external(env, node_write_set, (void**) &write_set_handle);
+    assert(status == napi_ok);
+    js_ctx->write_set = write_set_handle->write_set;
+    if (js_ctx->write_set != NULL) {
+      evmc_write_set_retain(js_ctx->write_set);
+    }
+  }
+
+  napi_value node_execution;
+  status = napi_get_named_property(env, parameters, "execution", &node_execution);
+  assert(status == napi_ok);
+  status = napi_typeof(env, node_execution, &type);
+  assert(status == napi_ok);
+  if (type == napi_undefined) {
+    js_ctx->handle = NULL;
+  } else {
+    status = napi_create_reference(env, node_execution, 1, &js_ctx->handle);
+    assert(status == napi_ok);
+  }
+
+  napi_value node_tx_context;
+  status = napi_get_named_property(env, parameters, "txContext", &node_tx_context);
+  assert(status == napi_ok);
+  status = napi_typeof(env, node_tx_context, &type);
+  assert(status == napi_ok);
+  js_ctx->has_tx_context = type != napi_undefined;
+  if (js_ctx->has_tx_context) {
+    struct js_tx_context_call tx_context;
+    get_tx_context_js_converter(env, node_tx_context, &tx_context);
+    js_ctx->tx_context = tx_context.result;
+  }
+
+  napi_value node_revision;
+  status = napi_get_named_property(env, parameters, "revision", &node_revision);
+  assert(status == napi_ok);
+  status = napi_get_value_int32(env, node_revision, (int32_t*) &js_ctx->revision);
+  assert(status == napi_ok);
+
+  napi_value node_message;
+  status = napi_get_named_property(env, parameters, "message", &node_message);
+  assert(status == napi_ok);
+
+  napi_value node_message_gas;
+  status = napi_get_named_property(env, node_message, "gas", &node_message_gas);
+  assert(status == napi_ok);
+  bool node_message_gas_lossless;
+  status = napi_get_value_bigint_int64(env, node_message_gas, &js_ctx->message.gas, &node_message_gas_lossless);
+  assert(status == napi_ok);
+
+  napi_value node_message_depth;
+  status = napi_get_named_property(env, node_message, "depth", &node_message_depth);
+  assert(status == napi_ok);
+  status = napi_get_value_int32(env, node_message_depth, &js_ctx->message.depth);
+  assert(status == napi_ok);
   
   napi_value node_message_flags;
   status = napi_get_named_property(env, node_message, "flags", &node_message_flags);
@@ -1116,128 +3023,2796 @@ napi_value evmc_execute_evm(napi_env env, napi_callback_info info) {
   status = napi_get_value_uint32(env, node_message_flags, &js_ctx->message.flags);
   assert(status == napi_ok);
 
-  napi_value node_message_destination;
-  status = napi_get_named_property(env, node_message, "destination", &node_message_destination);
-  assert(status == napi_ok);
-  get_evmc_address_from_bigint(env, node_message_destination, &js_ctx->message.destination);
+  napi_value node_message_destination;
+  status = napi_get_named_property(env, node_message, "destination", &node_message_destination);
+  assert(status == napi_ok);
+  get_evmc_address_from_bigint(env, node_message_destination, &js_ctx->message.destination);
+
+  napi_value node_message_sender;
+  status = napi_get_named_property(env, node_message, "sender", &node_message_sender);
+  assert(status == napi_ok);
+  get_evmc_address_from_bigint(env, node_message_sender, &js_ctx->message.sender);
+
+  napi_value node_message_input_data;
+  status = napi_get_named_property(env, node_message, "inputData", &node_message_input_data);
+  assert(status == napi_ok);
+  uint8_t* input_buffer;
+  status = napi_get_buffer_info(env, node_message_input_data, (void**) &input_buffer, &js_ctx->message.input_size);
+  assert(status == napi_ok);
+  if (js_ctx->message.input_size != 0 ){
+    js_ctx->message.input_data = (uint8_t*) evmc_arena_alloc(arena, js_ctx->message.input_size);
+    memcpy((void*) js_ctx->message.input_data, input_buffer, js_ctx->message.input_size);
+  } else {
+    js_ctx->message.input_data = NULL;
+  }
+
+  napi_value node_message_value;
+  status = napi_get_named_property(env, node_message, "value", &node_message_value);
+  assert(status == napi_ok);
+  get_evmc_bytes32_from_bigint(env, node_message_value, &js_ctx->message.value);
+
+  napi_value node_message_kind;
+  status = napi_get_named_property(env, node_message, "kind", &node_message_kind);
+  assert(status == napi_ok);
+  int64_t message_kind;
+  status = napi_get_value_int64(env, node_message_kind, &message_kind);
+  assert(status == napi_ok);
+  js_ctx->message.kind = (enum evmc_call_kind) message_kind;
+  memset(&js_ctx->message.create2_salt, 0, sizeof(js_ctx->message.create2_salt));
+
+  size_t code_size;
+  uint8_t* code;
+  napi_value node_code;
+
+  status = napi_get_named_property(env, parameters, "code", &node_code);
+  assert(status == napi_ok);
+
+  status = napi_get_buffer_info(env, node_code, (void**) &code, &code_size);
+  assert(status == napi_ok);
+
+  js_ctx->code_size = code_size;
+  if (code_size > 0) {
+    js_ctx->code = (uint8_t*) evmc_arena_alloc(arena, code_size);
+    memcpy(js_ctx->code, code, code_size);
+  } else {
+    js_ctx->code = NULL;
+  }
+
+  report_arena_memory(env);
+
+  return js_ctx;
+}
+
+/** Wraps a state view for JS, so it can be released before it is collected. */
+struct js_state_view {
+  struct evmc_state* state;
+};
+
+void evmc_cleanup_state_view(napi_env env, void* finalize_data, void* finalize_hint) {
+  struct js_state_view* view = (struct js_state_view*) finalize_data;
+  if (view->state != NULL) {
+    evmc_state_release(view->state);
+  }
+  free(view);
+}
+
+napi_value create_state_view_handle(napi_env env, struct evmc_state* state) {
+  napi_status status;
+  napi_value out;
+
+  struct js_state_view* view = (struct js_state_view*) malloc(sizeof(struct js_state_view));
+  view->state = state;
+  status = napi_create_external(env, view, evmc_cleanup_state_view, NULL, &out);
+  assert(status == napi_ok);
+  return out;
+}
+
+napi_value evmc_create_state_view(napi_env env, napi_callback_info info) {
+  return create_state_view_handle(env, evmc_state_create());
+}
+
+/** Gets the state of the view passed as the only argument, or throws. */
+struct evmc_state* get_state_view_argument(napi_env env, napi_callback_info info) {
+  napi_status status;
+
+  size_t argc = 1;
+  napi_value argv[1];
+
+  status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+  assert(status == napi_ok);
+
+  if (argc != 1) {
+    napi_throw_error(env, "EINVAL", "Expected 1 argument");
+    return NULL;
+  }
+
+  struct js_state_view* view;
+  status = napi_get_value_external(env, argv[0], (void**) &view);
+  assert(status == napi_ok);
+
+  if (view->state == NULL) {
+    napi_throw_error(env, "EINVAL", "State view has been released");
+  }
+  return view->state;
+}
+
+napi_value evmc_fork_state_view(napi_env env, napi_callback_info info) {
+  struct evmc_state* state = get_state_view_argument(env, info);
+  if (state == NULL) {
+    return NULL;
+  }
+
+  struct evmc_state* child = evmc_state_fork(state);
+  if (child == NULL) {
+    napi_throw_error(env, "EINVAL", "State view is in use");
+    return NULL;
+  }
+  return create_state_view_handle(env, child);
+}
+
+napi_value evmc_get_state_view_memory_usage(napi_env env, napi_callback_info info) {
+  napi_status status;
+  napi_value out;
+
+  struct evmc_state* state = get_state_view_argument(env, info);
+  if (state == NULL) {
+    return NULL;
+  }
+
+  status = napi_create_int64(env, evmc_state_memory_usage(state), &out);
+  assert(status == napi_ok);
+  return out;
+}
+
+napi_value evmc_release_state_view(napi_env env, napi_callback_info info) {
+  napi_status status;
+
+  size_t argc = 1;
+  napi_value argv[1];
+
+  status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+  assert(status == napi_ok);
+
+  if (argc != 1) {
+    napi_throw_error(env, "EINVAL", "Expected 1 argument");
+    return NULL;
+  }
+
+  struct js_state_view* view;
+  status = napi_get_value_external(env, argv[0], (void**) &view);
+  assert(status == napi_ok);
+
+  // Children and running executions keep their own references.
+  if (view->state != NULL) {
+    evmc_state_release(view->state);
+    view->state = NULL;
+  }
+  return NULL;
+}
+
+napi_value evmc_execute_evm(napi_env env, napi_callback_info info) {
+  napi_value argv[2];
+  napi_status status;
+
+  size_t argc = 2;
+
+  status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+  assert(status == napi_ok);
+
+  if (argc < 2) {
+    napi_throw_error(env, "EINVAL", "Too few arguments");
+    return NULL;
+  }
+
+  enum evmc_priority priority;
+  uint64_t deadline;
+  if (!get_schedule(env, argv[0], argv[1], &priority, &deadline)) {
+    return NULL;
+  }
+
+  struct evmc_state* state = NULL;
+  napi_value node_state;
+  status = napi_get_named_property(env, argv[1], "state", &node_state);
+  assert(status == napi_ok);
+  napi_valuetype state_type;
+  status = napi_typeof(env, node_state, &state_type);
+  assert(status == napi_ok);
+  if (state_type == napi_external) {
+    struct js_state_view* view;
+    status = napi_get_value_external(env, node_state, (void**) &view);
+    assert(status == napi_ok);
+    if (view->state == NULL) {
+      napi_throw_error(env, "EINVAL", "State view has been released");
+      return NULL;
+    }
+    if (!evmc_state_begin(view->state)) {
+      napi_throw_error(env, "EINVAL", "State view is in use or has been forked");
+      return NULL;
+    }
+    state = view->state;
+    evmc_state_retain(state);
+  }
+
+  struct js_execution_context* js_ctx = create_execution_context(env, argv[0], argv[1]);
+  js_ctx->priority = priority;
+
+  if (state != NULL) {
+    // Executions on a state view are not recorded, as their reads do not
+    // all reach the host.
+    js_ctx->host = &state_host_interface;
+    js_ctx->state = state;
+  }
+
+  js_ctx->recorder = state == NULL ? js_ctx->context->recorder : NULL;
+  if (js_ctx->recorder != NULL) {
+    evmc_trace_writer_retain(js_ctx->recorder);
+    js_ctx->host = &recording_host_interface;
+    evmc_trace_buffer_init(&js_ctx->trace);
+    evmc_trace_put_u32(&js_ctx->trace, (uint32_t) js_ctx->revision);
+    evmc_trace_put_message(&js_ctx->trace, &js_ctx->message);
+    evmc_trace_put_u32(&js_ctx->trace, (uint32_t) js_ctx->code_size);
+    evmc_trace_put_bytes(&js_ctx->trace, js_ctx->code, js_ctx->code_size);
+  }
+
+  // Static executions answered by the callbacks may be answered from the
+  // result cache instead. Recorded ones always run, so that the trace has
+  // their host calls.
+  if (js_ctx->host == &host_interface && js_ctx->result_cache != NULL &&
+      (js_ctx->message.flags & EVMC_STATIC) != 0 &&
+      js_ctx->snapshot == NULL && js_ctx->witness == NULL) {
+    js_ctx->host = &memo_host_interface;
+    evmc_read_set_begin(js_ctx->result_cache, &js_ctx->read_set);
+  }
+
+  status = napi_create_promise(env, &js_ctx->deferred, &js_ctx->promise);
+  assert(status == napi_ok);
+
+  evmc_scheduler_submit(js_ctx->context->scheduler, priority, deadline,
+                        (evmc_scheduler_run_fn) execute, js_ctx);
+  
+  return js_ctx->promise;
+}
+
+napi_value evmc_execute_transaction(napi_env env, napi_callback_info info) {
+  napi_value argv[2];
+  napi_status status;
+
+  size_t argc = 2;
+
+  status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+  assert(status == napi_ok);
+
+  if (argc < 2) {
+    napi_throw_error(env, "EINVAL", "Too few arguments");
+    return NULL;
+  }
+
+  struct evmc_js_context* context;
+  status = napi_get_value_external(env, argv[0], (void**) &context);
+  assert(status == napi_ok);
+  if (!has_transfer_callback(env, context)) {
+    napi_throw_error(env, "EINVAL", "Executing transactions needs a transfer callback");
+    return NULL;
+  }
+
+  uint64_t nonce;
+  bool lossless;
+  napi_value node_nonce;
+  status = napi_get_named_property(env, argv[1], "nonce", &node_nonce);
+  assert(status == napi_ok);
+  status = napi_get_value_bigint_uint64(env, node_nonce, &nonce, &lossless);
+  if (status != napi_ok || !lossless) {
+    napi_throw_error(env, "EINVAL", "Expected a 64-bit nonce");
+    return NULL;
+  }
+
+  enum evmc_priority priority;
+  uint64_t deadline;
+  if (!get_schedule(env, argv[0], argv[1], &priority, &deadline)) {
+    return NULL;
+  }
+
+  struct js_execution_context* js_ctx = create_execution_context(env, argv[0], argv[1]);
+  js_ctx->priority = priority;
+
+  // Transactions are not recorded, as a trace replays the message alone.
+  struct js_transaction* tx =
+      (struct js_transaction*) evmc_arena_alloc(js_ctx->arena, sizeof(struct js_transaction));
+  memset(tx, 0, sizeof(*tx));
+  tx->nonce = nonce;
+  tx->last_log = &tx->logs;
+  napi_value node_gas_price;
+  status = napi_get_named_property(env, argv[1], "gasPrice", &node_gas_price);
+  assert(status == napi_ok);
+  get_evmc_bytes32_from_bigint(env, node_gas_price, &tx->gas_price);
+  js_ctx->transaction = tx;
+
+  status = napi_create_promise(env, &js_ctx->deferred, &js_ctx->promise);
+  assert(status == napi_ok);
+
+  evmc_scheduler_submit(js_ctx->context->scheduler, priority, deadline,
+                        (evmc_scheduler_run_fn) execute_transaction, js_ctx);
+
+  return js_ctx->promise;
+}
+
+napi_value evmc_estimate_gas(napi_env env, napi_callback_info info) {
+  napi_value argv[4];
+  napi_status status;
+
+  size_t argc = 4;
+
+  status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+  assert(status == napi_ok);
+
+  if (argc < 4) {
+    napi_throw_error(env, "EINVAL", "Too few arguments");
+    return NULL;
+  }
+
+  int64_t gas_low;
+  int64_t gas_high;
+  bool lossless;
+  status = napi_get_value_bigint_int64(env, argv[2], &gas_low, &lossless);
+  if (status != napi_ok || !lossless || gas_low < 0) {
+    napi_throw_error(env, "EINVAL", "Expected a lower gas bound");
+    return NULL;
+  }
+  status = napi_get_value_bigint_int64(env, argv[3], &gas_high, &lossless);
+  if (status != napi_ok || !lossless || gas_high < gas_low) {
+    napi_throw_error(env, "EINVAL", "Expected an upper gas bound of at least the lower bound");
+    return NULL;
+  }
+
+  enum evmc_priority priority;
+  uint64_t deadline;
+  if (!get_schedule(env, argv[0], argv[1], &priority, &deadline)) {
+    return NULL;
+  }
+
+  struct js_execution_context* js_ctx = create_execution_context(env, argv[0], argv[1]);
+  js_ctx->priority = priority;
+  js_ctx->host = &estimate_host_interface;
+  js_ctx->state = evmc_state_create();
+  js_ctx->estimate = true;
+  evmc_state_begin(js_ctx->state);
+  js_ctx->gas_low = gas_low;
+  js_ctx->gas_high = gas_high;
+
+  status = napi_create_promise(env, &js_ctx->deferred, &js_ctx->promise);
+  assert(status == napi_ok);
+
+  evmc_scheduler_submit(js_ctx->context->scheduler, priority, deadline,
+                        (evmc_scheduler_run_fn) estimate, js_ctx);
+
+  return js_ctx->promise;
+}
+
+/**
+ * Replaces the interning table of an EVM with an empty one of capacity slots,
+ * or stops interning if capacity is 0. Returns false if the table could not
+ * be created, leaving the EVM without one.
+ */
+bool set_intern_capacity(napi_env env, struct evmc_js_context* context, size_t capacity) {
+    napi_status status;
+
+    if (context->intern_table != NULL) {
+      evmc_intern_table_free(context->intern_table);
+      context->intern_table = NULL;
+      status = napi_delete_reference(env, context->interned);
+      assert(status == napi_ok);
+    }
+    if (capacity == 0) {
+      return true;
+    }
+
+    struct evmc_intern_table* table = evmc_intern_table_create(capacity);
+    if (table == NULL) {
+      return false;
+    }
+    napi_value interned;
+    status = napi_create_array_with_length(env, evmc_intern_table_capacity(table), &interned);
+    assert(status == napi_ok);
+    status = napi_create_reference(env, interned, 1, &context->interned);
+    assert(status == napi_ok);
+    context->intern_table = table;
+    return true;
+}
+
+void release_evm(napi_env env, struct evmc_js_context* context) {
+    if (!context->released) {
+      // A replay still running destroys the VM once it completes.
+      if (context->replays == 0) {
+        context->instance->destroy(context->instance);
+      }
+      release_callbacks_from_context(env, context);
+      evmc_tiering_release(context->tiering);
+      context->tiering = NULL;
+      context->released = true;
+    }
+}
+
+/**
+ * Releases an EVM still in use when its environment is torn down, as when the
+ * worker it was created on exits, while its callbacks can still be released.
+ */
+void evmc_cleanup_env(void* data) {
+    struct evmc_js_context* context = (struct evmc_js_context*) data;
+    release_evm(context->env, context);
+}
+
+void evmc_cleanup_evm(napi_env env, void* finalize_data, void* finalize_hint) {
+    struct evmc_js_context* context = (struct evmc_js_context*) finalize_data;
+
+    napi_status status = napi_remove_env_cleanup_hook(env, evmc_cleanup_env, context);
+    assert(status == napi_ok);
+    release_evm(env, context);
+    status = napi_delete_reference(env, context->object);
+    assert(status == napi_ok);
+    // Continuations still waiting on a promise outlive the EVM, and free
+    // themselves once it settles.
+    struct js_continuation* continuation;
+    for (continuation = context->waiting_continuations; continuation != NULL;
+         continuation = continuation->next) {
+      continuation->context = NULL;
+    }
+    // Kept until now, as calls queued before the EVM was released still run.
+    status = napi_delete_reference(env, context->callbacks);
+    assert(status == napi_ok);
+    int type;
+    for (type = 0; type < EVMC_HOST_CALL_COUNT; type++) {
+      if (context->host_callbacks[type] != NULL) {
+        status = napi_delete_reference(env, context->host_callbacks[type]);
+        assert(status == napi_ok);
+      }
+    }
+    set_intern_capacity(env, context, 0);
+
+    if (context->snapshot != NULL) {
+      evmc_snapshot_release(context->snapshot);
+    }
+
+    if (context->account_cache != NULL) {
+      evmc_account_cache_release(context->account_cache);
+    }
+
+    if (context->result_cache != NULL) {
+      evmc_result_cache_release(context->result_cache);
+    }
+
+    if (context->recorder != NULL) {
+      evmc_trace_writer_release(context->recorder);
+    }
+
+    if (context->profiler != NULL) {
+      evmc_profiler_release(context->profiler);
+    }
+
+    if (context->tiering != NULL) {
+      evmc_tiering_release(context->tiering);
+    }
+
+    evmc_completion_queue_destroy(context->completions);
+    evmc_scheduler_destroy(context->scheduler);
+    free(context);
+}
+
+napi_value evmc_create_evm(napi_env env, napi_callback_info info) {
+    napi_status status;
+    napi_value out;
+    
+    size_t argc = 3;
+    napi_value argv[3];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 3) {
+      status = napi_throw_error(env, "EINVAL", "Expected 3 arguments");
+    }
+
+    char* path = get_string_from_value(env, argv[0]);
+    
+    enum evmc_loader_error_code error_code;
+    struct evmc_instance* instance = evmc_prewarm_take(path, &error_code);
+    assert(error_code == EVMC_LOADER_SUCCESS);
+    free((void*) path);
+
+    struct evmc_js_context* context = (struct evmc_js_context*) malloc(sizeof(struct evmc_js_context));
+    context->instance = instance;
+    context->snapshot = NULL;
+    context->native_precompiles = true;
+    context->account_cache = NULL;
+    context->result_cache = NULL;
+    context->recorder = NULL;
+    context->profiler = NULL;
+    context->tiering = evmc_tiering_create(instance);
+    context->free_continuations = NULL;
+    context->waiting_continuations = NULL;
+    context->completions = evmc_completion_queue_create();
+    // Executions are started on the loop of the thread creating the EVM,
+    // which may be a worker.
+    uv_loop_t* loop;
+    status = napi_get_uv_event_loop(env, &loop);
+    assert(status == napi_ok);
+    context->scheduler = evmc_scheduler_create(loop);
+    context->handoff_spin_ns = 0;
+    context->intern_table = NULL;
+    context->intern_hits = 0;
+    context->intern_misses = 0;
+    set_intern_capacity(env, context, DEFAULT_INTERN_CAPACITY);
+    context->released = false;
+    context->replays = 0;
+
+    // This creates a WEAK reference, which is OK because we only use the refrence from execute() which requires
+    // an instance of the EVM object itself.
+    napi_create_reference(env, argv[2], 0, &context->object);
+
+    create_callbacks_from_context(env, context, argv[1]);
+
+    // Added after the callbacks, so that it runs before they are torn down.
+    context->env = env;
+    status = napi_add_env_cleanup_hook(env, evmc_cleanup_env, context);
+    assert(status == napi_ok);
+
+    status = napi_create_external(env, context, evmc_cleanup_evm, NULL, &out);
+    assert(status == napi_ok);
+    return out;
+}
+
+
+napi_value evmc_release_evm(napi_env env, napi_callback_info info) {
+    napi_status status;
+    
+    size_t argc = 1;
+    napi_value argv[1];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 1) {
+      status = napi_throw_error(env, "EINVAL", "Expected 1 argument");
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+
+    release_evm(env, context);
+
+    return NULL;
+}
+
+/** Wraps a snapshot for JS, so it can be closed before it is collected. */
+struct js_snapshot_handle {
+  struct evmc_snapshot* snapshot;
+};
+
+void evmc_cleanup_snapshot(napi_env env, void* finalize_data, void* finalize_hint) {
+    struct js_snapshot_handle* handle = (struct js_snapshot_handle*) finalize_data;
+
+    if (handle->snapshot != NULL) {
+      evmc_snapshot_release(handle->snapshot);
+    }
+
+    free(handle);
+}
+
+napi_value evmc_open_snapshot(napi_env env, napi_callback_info info) {
+    napi_status status;
+    napi_value out;
+
+    size_t argc = 1;
+    napi_value argv[1];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 1) {
+      napi_throw_error(env, "EINVAL", "Expected 1 argument");
+      return NULL;
+    }
+
+    char* path = get_string_from_value(env, argv[0]);
+    const char* error = NULL;
+    struct evmc_snapshot* snapshot = evmc_snapshot_open(path, &error);
+    free((void*) path);
+
+    if (snapshot == NULL) {
+      napi_throw_error(env, "EINVAL", error);
+      return NULL;
+    }
+
+    struct js_snapshot_handle* handle = (struct js_snapshot_handle*) malloc(sizeof(struct js_snapshot_handle));
+    handle->snapshot = snapshot;
+
+    status = napi_create_external(env, handle, evmc_cleanup_snapshot, NULL, &out);
+    assert(status == napi_ok);
+    return out;
+}
+
+napi_value evmc_close_snapshot(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 1;
+    napi_value argv[1];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 1) {
+      napi_throw_error(env, "EINVAL", "Expected 1 argument");
+      return NULL;
+    }
+
+    struct js_snapshot_handle* handle;
+    status = napi_get_value_external(env, argv[0], (void**) &handle);
+    assert(status == napi_ok);
+
+    // Executions and EVMs still using the snapshot keep it mapped.
+    if (handle->snapshot != NULL) {
+      evmc_snapshot_release(handle->snapshot);
+      handle->snapshot = NULL;
+    }
+
+    return NULL;
+}
+
+napi_value evmc_get_snapshot_info(napi_env env, napi_callback_info info) {
+    napi_status status;
+    napi_value out;
+
+    size_t argc = 1;
+    napi_value argv[1];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 1) {
+      napi_throw_error(env, "EINVAL", "Expected 1 argument");
+      return NULL;
+    }
+
+    struct js_snapshot_handle* handle;
+    status = napi_get_value_external(env, argv[0], (void**) &handle);
+    assert(status == napi_ok);
+
+    if (handle->snapshot == NULL) {
+      napi_throw_error(env, "EINVAL", "Snapshot has been closed");
+      return NULL;
+    }
+
+    status = napi_create_object(env, &out);
+    assert(status == napi_ok);
+
+    napi_value value;
+    status = napi_create_int64(env, evmc_snapshot_account_count(handle->snapshot), &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "accountCount", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, evmc_snapshot_slot_count(handle->snapshot), &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "slotCount", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, evmc_snapshot_code_size(handle->snapshot), &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "codeSize", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, evmc_snapshot_mapped_size(handle->snapshot), &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "mappedSize", value);
+    assert(status == napi_ok);
+
+    return out;
+}
+
+napi_value evmc_set_snapshot(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 2;
+    napi_value argv[2];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 2) {
+      napi_throw_error(env, "EINVAL", "Expected 2 arguments");
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
+
+    struct evmc_snapshot* snapshot = NULL;
+    napi_valuetype type;
+    status = napi_typeof(env, argv[1], &type);
+    assert(status == napi_ok);
+
+    if (type == napi_external) {
+      struct js_snapshot_handle* handle;
+      status = napi_get_value_external(env, argv[1], (void**) &handle);
+      assert(status == napi_ok);
+      if (handle->snapshot == NULL) {
+        napi_throw_error(env, "EINVAL", "Snapshot has been closed");
+        return NULL;
+      }
+      snapshot = handle->snapshot;
+      evmc_snapshot_retain(snapshot);
+    }
+
+    if (context->snapshot != NULL) {
+      evmc_snapshot_release(context->snapshot);
+    }
+    context->snapshot = snapshot;
+
+    return NULL;
+}
+
+napi_value evmc_set_native_precompiles(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 2;
+    napi_value argv[2];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 2) {
+      napi_throw_error(env, "EINVAL", "Expected 2 arguments");
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
+
+    bool enabled;
+    status = napi_get_value_bool(env, argv[1], &enabled);
+    if (status != napi_ok) {
+      napi_throw_error(env, "EINVAL", "Expected a boolean");
+      return NULL;
+    }
+    context->native_precompiles = enabled;
+
+    return NULL;
+}
+
+napi_value evmc_set_account_cache(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 2;
+    napi_value argv[2];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 2) {
+      napi_throw_error(env, "EINVAL", "Expected 2 arguments");
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
+
+    int64_t budget;
+    status = napi_get_value_int64(env, argv[1], &budget);
+    if (status != napi_ok || budget < 0) {
+      napi_throw_error(env, "EINVAL", "Expected a memory budget in bytes");
+      return NULL;
+    }
+
+    struct evmc_account_cache* cache = NULL;
+    if (budget > 0) {
+      cache = evmc_account_cache_create((size_t) budget);
+      if (cache == NULL) {
+        napi_throw_error(env, "EINVAL", "Memory budget is too small for the account cache");
+        return NULL;
+      }
+    }
+
+    // Executions already running keep the cache they started with.
+    if (context->account_cache != NULL) {
+      evmc_account_cache_release(context->account_cache);
+    }
+    context->account_cache = cache;
+
+    return NULL;
+}
+
+napi_value evmc_invalidate_accounts(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 2;
+    napi_value argv[2];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 2) {
+      napi_throw_error(env, "EINVAL", "Expected 2 arguments");
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
+
+    if (context->account_cache == NULL && context->result_cache == NULL) {
+      return NULL;
+    }
+
+    uint32_t length;
+    status = napi_get_array_length(env, argv[1], &length);
+    if (status != napi_ok) {
+      napi_throw_error(env, "EINVAL", "Expected an array of addresses");
+      return NULL;
+    }
+
+    uint32_t i;
+    for (i = 0; i < length; i++) {
+      napi_value node_address;
+      status = napi_get_element(env, argv[1], i, &node_address);
+      assert(status == napi_ok);
+
+      evmc_address address;
+      get_evmc_address_from_bigint(env, node_address, &address);
+      if (context->account_cache != NULL) {
+        evmc_account_cache_invalidate(context->account_cache, &address);
+      }
+      if (context->result_cache != NULL) {
+        evmc_result_cache_invalidate(context->result_cache, &address);
+      }
+    }
+
+    return NULL;
+}
+
+napi_value evmc_invalidate_all_accounts(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 1;
+    napi_value argv[1];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 1) {
+      napi_throw_error(env, "EINVAL", "Expected 1 argument");
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
+
+    if (context->account_cache != NULL) {
+      evmc_account_cache_invalidate_all(context->account_cache);
+    }
+    if (context->result_cache != NULL) {
+      evmc_result_cache_invalidate_all(context->result_cache);
+    }
+
+    return NULL;
+}
+
+napi_value evmc_get_account_cache_stats(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 1;
+    napi_value argv[1];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 1) {
+      napi_throw_error(env, "EINVAL", "Expected 1 argument");
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
+
+    struct evmc_account_cache_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    if (context->account_cache != NULL) {
+      evmc_account_cache_get_stats(context->account_cache, &stats);
+    }
+
+    napi_value out;
+    status = napi_create_object(env, &out);
+    assert(status == napi_ok);
+
+    napi_value value;
+    status = napi_create_int64(env, stats.hits, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "hits", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.misses, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "misses", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.evictions, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "evictions", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.invalidations, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "invalidations", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.entries, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "entries", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.capacity, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "capacity", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.memory_usage, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "memoryUsage", value);
+    assert(status == napi_ok);
+
+    return out;
+}
+
+napi_value evmc_set_result_cache(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 2;
+    napi_value argv[2];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 2) {
+      napi_throw_error(env, "EINVAL", "Expected 2 arguments");
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
+
+    int64_t budget;
+    status = napi_get_value_int64(env, argv[1], &budget);
+    if (status != napi_ok || budget < 0) {
+      napi_throw_error(env, "EINVAL", "Expected a memory budget in bytes");
+      return NULL;
+    }
+
+    struct evmc_result_cache* cache = NULL;
+    if (budget > 0) {
+      cache = evmc_result_cache_create((size_t) budget);
+      if (cache == NULL) {
+        napi_throw_error(env, "EINVAL", "Memory budget is too small for the result cache");
+        return NULL;
+      }
+    }
+
+    // Executions already running keep the cache they started with.
+    if (context->result_cache != NULL) {
+      evmc_result_cache_release(context->result_cache);
+    }
+    context->result_cache = cache;
+
+    return NULL;
+}
+
+napi_value evmc_get_result_cache_stats(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 1;
+    napi_value argv[1];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 1) {
+      napi_throw_error(env, "EINVAL", "Expected 1 argument");
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
+
+    struct evmc_result_cache_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    if (context->result_cache != NULL) {
+      evmc_result_cache_get_stats(context->result_cache, &stats);
+    }
+
+    napi_value out;
+    status = napi_create_object(env, &out);
+    assert(status == napi_ok);
+
+    napi_value value;
+    status = napi_create_int64(env, stats.hits, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "hits", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.misses, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "misses", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.stale, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "stale", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.uncacheable, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "uncacheable", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.evictions, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "evictions", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.invalidations, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "invalidations", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.entries, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "entries", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.budget, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "budget", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.memory_usage, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "memoryUsage", value);
+    assert(status == napi_ok);
+
+    return out;
+}
+
+napi_value evmc_write_snapshot(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 2;
+    napi_value argv[2];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 2) {
+      napi_throw_error(env, "EINVAL", "Expected 2 arguments");
+      return NULL;
+    }
+
+    uint32_t account_count;
+    status = napi_get_array_length(env, argv[1], &account_count);
+    assert(status == napi_ok);
+
+    // Code buffers are only borrowed: nothing can run JS until the write is done.
+    struct evmc_snapshot_input_account* accounts =
+        (struct evmc_snapshot_input_account*) calloc(account_count + 1, sizeof(struct evmc_snapshot_input_account));
+
+    uint32_t i;
+    for (i = 0; i < account_count; i++) {
+      napi_value node_account;
+      status = napi_get_element(env, argv[1], i, &node_account);
+      assert(status == napi_ok);
+
+      napi_value node_address;
+      status = napi_get_named_property(env, node_account, "address", &node_address);
+      assert(status == napi_ok);
+      get_evmc_address_from_bigint(env, node_address, &accounts[i].address);
+
+      napi_value node_balance;
+      status = napi_get_named_property(env, node_account, "balance", &node_balance);
+      assert(status == napi_ok);
+      get_evmc_bytes32_from_bigint(env, node_balance, &accounts[i].balance);
+
+      napi_value node_code_hash;
+      status = napi_get_named_property(env, node_account, "codeHash", &node_code_hash);
+      assert(status == napi_ok);
+      get_evmc_bytes32_from_bigint(env, node_code_hash, &accounts[i].code_hash);
+
+      napi_value node_code;
+      status = napi_get_named_property(env, node_account, "code", &node_code);
+      assert(status == napi_ok);
+      status = napi_get_buffer_info(env, node_code, (void**) &accounts[i].code, &accounts[i].code_size);
+      assert(status == napi_ok);
+
+      napi_value node_storage;
+      status = napi_get_named_property(env, node_account, "storage", &node_storage);
+      assert(status == napi_ok);
+      uint32_t slot_count;
+      status = napi_get_array_length(env, node_storage, &slot_count);
+      assert(status == napi_ok);
+
+      accounts[i].slot_count = slot_count;
+      accounts[i].slots = (struct evmc_snapshot_slot*) malloc(sizeof(struct evmc_snapshot_slot) * (slot_count + 1));
+
+      uint32_t j;
+      for (j = 0; j < slot_count; j++) {
+        napi_value node_slot;
+        status = napi_get_element(env, node_storage, j, &node_slot);
+        assert(status == napi_ok);
+
+        napi_value node_key;
+        status = napi_get_element(env, node_slot, 0, &node_key);
+        assert(status == napi_ok);
+        get_evmc_bytes32_from_bigint(env, node_key, &accounts[i].slots[j].key);
+
+        napi_value node_value;
+        status = napi_get_element(env, node_slot, 1, &node_value);
+        assert(status == napi_ok);
+        get_evmc_bytes32_from_bigint(env, node_value, &accounts[i].slots[j].value);
+      }
+    }
+
+    char* path = get_string_from_value(env, argv[0]);
+    const char* error = evmc_snapshot_write(path, accounts, account_count);
+    free((void*) path);
+
+    for (i = 0; i < account_count; i++) {
+      free(accounts[i].slots);
+    }
+    free(accounts);
+
+    if (error != NULL) {
+      napi_throw_error(env, "EINVAL", error);
+    }
+
+    return NULL;
+}
+
+napi_value evmc_start_recording(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 2;
+    napi_value argv[2];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 2) {
+      napi_throw_error(env, "EINVAL", "Expected 2 arguments");
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
+
+    char* path = get_string_from_value(env, argv[1]);
+    const char* error;
+    struct evmc_trace_writer* recorder = evmc_trace_writer_open(path, &error);
+    free(path);
+
+    if (recorder == NULL) {
+      napi_throw_error(env, "EINVAL", error);
+      return NULL;
+    }
+
+    if (context->recorder != NULL) {
+      evmc_trace_writer_release(context->recorder);
+    }
+    context->recorder = recorder;
+
+    return NULL;
+}
+
+napi_value evmc_stop_recording(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 1;
+    napi_value argv[1];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 1) {
+      napi_throw_error(env, "EINVAL", "Expected 1 argument");
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
+
+    if (context->recorder == NULL) {
+      return NULL;
+    }
+
+    // Executions still running append themselves, then close the file.
+    bool ok = evmc_trace_writer_ok(context->recorder);
+    evmc_trace_writer_release(context->recorder);
+    context->recorder = NULL;
+
+    if (!ok) {
+      napi_throw_error(env, "EIO", "Unable to write trace");
+    }
+    return NULL;
+}
+
+struct js_replay_work {
+  napi_async_work work;
+  napi_deferred deferred;
+  struct evmc_js_context* context;
+  /** Keeps the EVM from being collected until the replay completes */
+  napi_ref handle;
+  char* path;
+  const char* error;
+  struct evmc_trace_replay_stats stats;
+};
+
+void replay_execute(napi_env env, void* data) {
+  struct js_replay_work* replay = (struct js_replay_work*) data;
+  replay->error = evmc_trace_replay(replay->path, replay->context->instance, &replay->stats);
+}
+
+void replay_complete(napi_env env, napi_status work_status, void* data) {
+  struct js_replay_work* replay = (struct js_replay_work*) data;
+  napi_status status;
+
+  if (replay->error != NULL) {
+    napi_value message;
+    status = napi_create_string_utf8(env, replay->error, NAPI_AUTO_LENGTH, &message);
+    assert(status == napi_ok);
+    napi_value error;
+    status = napi_create_error(env, NULL, message, &error);
+    assert(status == napi_ok);
+    status = napi_reject_deferred(env, replay->deferred, error);
+    assert(status == napi_ok);
+  } else {
+    napi_value out;
+    status = napi_create_object(env, &out);
+    assert(status == napi_ok);
+
+    napi_value value;
+    status = napi_create_int64(env, replay->stats.executions, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "executions", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, replay->stats.host_calls, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "hostCalls", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, replay->stats.divergences, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "divergences", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, replay->stats.mismatches, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "mismatches", value);
+    assert(status == napi_ok);
+
+    status = napi_create_bigint_uint64(env, replay->stats.elapsed_ns, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "elapsedNs", value);
+    assert(status == napi_ok);
+
+    status = napi_resolve_deferred(env, replay->deferred, out);
+    assert(status == napi_ok);
+  }
+
+  struct evmc_js_context* context = replay->context;
+  context->replays--;
+  if (context->released && context->replays == 0) {
+    context->instance->destroy(context->instance);
+  }
+  status = napi_delete_reference(env, replay->handle);
+  assert(status == napi_ok);
+
+  napi_delete_async_work(env, replay->work);
+  free(replay->path);
+  free(replay);
+}
+
+napi_value evmc_replay(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 2;
+    napi_value argv[2];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 2) {
+      napi_throw_error(env, "EINVAL", "Expected 2 arguments");
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
+
+    struct js_replay_work* replay = (struct js_replay_work*) malloc(sizeof(struct js_replay_work));
+    replay->context = context;
+    status = napi_create_reference(env, argv[0], 1, &replay->handle);
+    assert(status == napi_ok);
+    context->replays++;
+    replay->path = get_string_from_value(env, argv[1]);
+    replay->error = NULL;
+
+    napi_value promise;
+    status = napi_create_promise(env, &replay->deferred, &promise);
+    assert(status == napi_ok);
+
+    napi_value name;
+    status = napi_create_string_utf8(env, "evmc_replay", NAPI_AUTO_LENGTH, &name);
+    assert(status == napi_ok);
+    status = napi_create_async_work(env, NULL, name, replay_execute, replay_complete, replay, &replay->work);
+    assert(status == napi_ok);
+    status = napi_queue_async_work(env, replay->work);
+    assert(status == napi_ok);
+
+    return promise;
+}
+
+/** One of the tasks of a prewarm, which run on the thread pool at once */
+struct js_prewarm_task {
+  napi_async_work work;
+  struct js_prewarm* prewarm;
+  size_t index;
+  uv_thread_t thread;
+};
+
+struct js_prewarm {
+  napi_deferred deferred;
+  char* path;
+  size_t instances;
+  size_t task_count;
+  /** Tasks which have started, on the pool threads */
+  size_t started;
+  /** Tasks which have completed, on the main thread */
+  size_t completed;
+  enum evmc_loader_error_code error;
+  uint64_t start;
+  struct js_prewarm_task tasks[];
+};
+
+/** How long a prewarm task waits for the others to start, so that they spread over threads */
+#define PREWARM_RENDEZVOUS_NS 10000000
+
+void prewarm_execute(napi_env env, void* data) {
+  struct js_prewarm_task* task = (struct js_prewarm_task*) data;
+  struct js_prewarm* prewarm = task->prewarm;
+  uint64_t deadline = uv_hrtime() + PREWARM_RENDEZVOUS_NS;
+
+  __atomic_add_fetch(&prewarm->started, 1, __ATOMIC_ACQ_REL);
+  task->thread = uv_thread_self();
+  evmc_prewarm_stack();
+  if (task->index < prewarm->instances) {
+    enum evmc_loader_error_code error = evmc_prewarm_load(prewarm->path);
+    if (error != EVMC_LOADER_SUCCESS) {
+      __atomic_store_n(&prewarm->error, error, __ATOMIC_RELAXED);
+    }
+  }
+  // Holding the thread until the other tasks have started keeps them from
+  // all running one after the other on the same thread.
+  while (__atomic_load_n(&prewarm->started, __ATOMIC_ACQUIRE) < prewarm->task_count &&
+         uv_hrtime() < deadline) {
+  }
+}
+
+void prewarm_complete(napi_env env, napi_status work_status, void* data) {
+  struct js_prewarm_task* task = (struct js_prewarm_task*) data;
+  struct js_prewarm* prewarm = task->prewarm;
+  napi_status status;
+
+  napi_delete_async_work(env, task->work);
+  if (++prewarm->completed < prewarm->task_count) {
+    return;
+  }
+
+  if (prewarm->error != EVMC_LOADER_SUCCESS) {
+    napi_value message;
+    status = napi_create_string_utf8(env, "Unable to load VM", NAPI_AUTO_LENGTH, &message);
+    assert(status == napi_ok);
+    napi_value error;
+    status = napi_create_error(env, NULL, message, &error);
+    assert(status == napi_ok);
+    status = napi_reject_deferred(env, prewarm->deferred, error);
+    assert(status == napi_ok);
+  } else {
+    size_t threads = 0;
+    size_t i, j;
+    for (i = 0; i < prewarm->task_count; i++) {
+      for (j = 0; j < i && !uv_thread_equal(&prewarm->tasks[i].thread, &prewarm->tasks[j].thread); j++) {
+      }
+      if (j == i) {
+        threads++;
+      }
+    }
+
+    napi_value out;
+    status = napi_create_object(env, &out);
+    assert(status == napi_ok);
+
+    napi_value value;
+    status = napi_create_int64(env, evmc_prewarm_pooled(), &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "pooled", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, threads, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "threads", value);
+    assert(status == napi_ok);
+
+    status = napi_create_bigint_uint64(env, uv_hrtime() - prewarm->start, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "elapsedNs", value);
+    assert(status == napi_ok);
+
+    status = napi_resolve_deferred(env, prewarm->deferred, out);
+    assert(status == napi_ok);
+  }
+
+  free(prewarm->path);
+  free(prewarm);
+}
+
+napi_value evmc_prewarm(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 3;
+    napi_value argv[3];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 3) {
+      napi_throw_error(env, "EINVAL", "Expected 3 arguments");
+      return NULL;
+    }
+
+    int64_t instances;
+    status = napi_get_value_int64(env, argv[1], &instances);
+    if (status != napi_ok || instances < 0) {
+      napi_throw_error(env, "EINVAL", "Expected a non-negative number of instances");
+      return NULL;
+    }
+    int64_t threads;
+    status = napi_get_value_int64(env, argv[2], &threads);
+    if (status != napi_ok || threads < 0) {
+      napi_throw_error(env, "EINVAL", "Expected a non-negative number of threads");
+      return NULL;
+    }
+
+    // Every task touches the stack of its thread, and the first ones load the
+    // instances. There is at least one, which settles the promise.
+    size_t task_count = (size_t) (instances > threads ? instances : threads);
+    if (task_count == 0) {
+      task_count = 1;
+    }
+    struct js_prewarm* prewarm = (struct js_prewarm*) malloc(
+        sizeof(struct js_prewarm) + task_count * sizeof(struct js_prewarm_task));
+    prewarm->path = get_string_from_value(env, argv[0]);
+    prewarm->instances = (size_t) instances;
+    prewarm->task_count = task_count;
+    prewarm->started = 0;
+    prewarm->completed = 0;
+    prewarm->error = EVMC_LOADER_SUCCESS;
+    prewarm->start = uv_hrtime();
+
+    napi_value promise;
+    status = napi_create_promise(env, &prewarm->deferred, &promise);
+    assert(status == napi_ok);
+
+    napi_value name;
+    status = napi_create_string_utf8(env, "evmc_prewarm", NAPI_AUTO_LENGTH, &name);
+    assert(status == napi_ok);
+    size_t i;
+    for (i = 0; i < task_count; i++) {
+      struct js_prewarm_task* task = &prewarm->tasks[i];
+      task->prewarm = prewarm;
+      task->index = i;
+      status = napi_create_async_work(env, NULL, name, prewarm_execute, prewarm_complete, task, &task->work);
+      assert(status == napi_ok);
+      status = napi_queue_async_work(env, task->work);
+      assert(status == napi_ok);
+    }
+
+    return promise;
+}
+
+napi_value evmc_set_tiers(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 2;
+    napi_value argv[2];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 2) {
+      napi_throw_error(env, "EINVAL", "Expected 2 arguments");
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
+
+    uint32_t length;
+    status = napi_get_array_length(env, argv[1], &length);
+    if (status != napi_ok) {
+      napi_throw_error(env, "EINVAL", "Expected an array of tiers");
+      return NULL;
+    }
+    if (length >= EVMC_TIERING_MAX_TIERS) {
+      napi_throw_error(env, "EINVAL", "Too many tiers");
+      return NULL;
+    }
+
+    struct evmc_tiering* tiering = evmc_tiering_create(context->instance);
+    uint32_t i;
+    for (i = 0; i < length; i++) {
+      napi_value tier;
+      status = napi_get_element(env, argv[1], i, &tier);
+      assert(status == napi_ok);
+
+      napi_value node_threshold;
+      status = napi_get_named_property(env, tier, "threshold", &node_threshold);
+      assert(status == napi_ok);
+      int64_t threshold;
+      status = napi_get_value_int64(env, node_threshold, &threshold);
+      if (status != napi_ok || threshold < 1) {
+        evmc_tiering_release(tiering);
+        napi_throw_error(env, "EINVAL", "Expected a threshold of at least 1 execution");
+        return NULL;
+      }
+
+      napi_value node_path;
+      status = napi_get_named_property(env, tier, "path", &node_path);
+      assert(status == napi_ok);
+      char* path = get_string_from_value(env, node_path);
+      enum evmc_loader_error_code error_code;
+      struct evmc_instance* instance = evmc_prewarm_take(path, &error_code);
+      free(path);
+      if (error_code != EVMC_LOADER_SUCCESS) {
+        evmc_tiering_release(tiering);
+        napi_throw_error(env, "EINVAL", "Unable to load VM");
+        return NULL;
+      }
+
+      if (!evmc_tiering_add(tiering, instance, (uint64_t) threshold)) {
+        instance->destroy(instance);
+        evmc_tiering_release(tiering);
+        napi_throw_error(env, "EINVAL", "Tier thresholds must increase");
+        return NULL;
+      }
+    }
+
+    // Executions already running finish on the tiers they started with.
+    if (context->tiering != NULL) {
+      evmc_tiering_release(context->tiering);
+    }
+    context->tiering = tiering;
+
+    return NULL;
+}
+
+napi_value evmc_get_vm_stats(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 1;
+    napi_value argv[1];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 1) {
+      napi_throw_error(env, "EINVAL", "Expected 1 argument");
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
+
+    napi_value out;
+    status = napi_create_array(env, &out);
+    assert(status == napi_ok);
+    if (context->tiering == NULL) {
+      return out;
+    }
+
+    size_t i;
+    for (i = 0; i < evmc_tiering_count(context->tiering); i++) {
+      struct evmc_tier_stats stats;
+      evmc_tiering_get_stats(context->tiering, i, &stats);
+
+      napi_value tier;
+      status = napi_create_object(env, &tier);
+      assert(status == napi_ok);
+
+      napi_value value;
+      status = napi_create_int64(env, stats.threshold, &value);
+      assert(status == napi_ok);
+      status = napi_set_named_property(env, tier, "threshold", value);
+      assert(status == napi_ok);
+
+      status = napi_create_int64(env, stats.executions, &value);
+      assert(status == napi_ok);
+      status = napi_set_named_property(env, tier, "executions", value);
+      assert(status == napi_ok);
+
+      status = napi_create_int64(env, stats.rejections, &value);
+      assert(status == napi_ok);
+      status = napi_set_named_property(env, tier, "rejections", value);
+      assert(status == napi_ok);
+
+      status = napi_create_int64(env, stats.promotions, &value);
+      assert(status == napi_ok);
+      status = napi_set_named_property(env, tier, "promotions", value);
+      assert(status == napi_ok);
+
+      status = napi_create_bigint_uint64(env, stats.elapsed_ns, &value);
+      assert(status == napi_ok);
+      status = napi_set_named_property(env, tier, "elapsedNs", value);
+      assert(status == napi_ok);
+
+      status = napi_set_element(env, out, (uint32_t) i, tier);
+      assert(status == napi_ok);
+    }
+
+    return out;
+}
+
+/** Reads a limit which is 0 or more, where 0 means no limit. */
+bool get_limit(napi_env env, napi_value object, const char* name, size_t* limit) {
+    napi_status status;
+    napi_value node_limit;
+    status = napi_get_named_property(env, object, name, &node_limit);
+    assert(status == napi_ok);
+    int64_t value;
+    status = napi_get_value_int64(env, node_limit, &value);
+    if (status != napi_ok || value < 0) {
+      return false;
+    }
+    *limit = (size_t) value;
+    return true;
+}
+
+napi_value evmc_set_scheduler_limits(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 2;
+    napi_value argv[2];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 2) {
+      napi_throw_error(env, "EINVAL", "Expected 2 arguments");
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
+
+    size_t max_running;
+    if (!get_limit(env, argv[1], "maxRunning", &max_running)) {
+      napi_throw_error(env, "EINVAL", "Expected a limit of running executions");
+      return NULL;
+    }
+
+    napi_value node_priorities;
+    status = napi_get_named_property(env, argv[1], "priorities", &node_priorities);
+    assert(status == napi_ok);
+    uint32_t length;
+    status = napi_get_array_length(env, node_priorities, &length);
+    if (status != napi_ok || length != EVMC_PRIORITY_COUNT) {
+      napi_throw_error(env, "EINVAL", "Expected limits for each priority");
+      return NULL;
+    }
+
+    size_t class_limits[EVMC_PRIORITY_COUNT][2];
+    uint32_t i;
+    for (i = 0; i < EVMC_PRIORITY_COUNT; i++) {
+      napi_value limits;
+      status = napi_get_element(env, node_priorities, i, &limits);
+      assert(status == napi_ok);
+      if (!get_limit(env, limits, "maxRunning", &class_limits[i][0]) ||
+          !get_limit(env, limits, "maxQueued", &class_limits[i][1])) {
+        napi_throw_error(env, "EINVAL", "Expected limits of running and queued executions");
+        return NULL;
+      }
+    }
+
+    // Loosened limits let queued executions start right away.
+    evmc_scheduler_set_max_running(context->scheduler, max_running);
+    for (i = 0; i < EVMC_PRIORITY_COUNT; i++) {
+      evmc_scheduler_set_class_limits(context->scheduler, (enum evmc_priority) i,
+                                      class_limits[i][0], class_limits[i][1]);
+    }
+
+    return NULL;
+}
+
+napi_value evmc_get_scheduler_stats(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 1;
+    napi_value argv[1];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 1) {
+      napi_throw_error(env, "EINVAL", "Expected 1 argument");
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
+
+    napi_value out;
+    status = napi_create_array_with_length(env, EVMC_PRIORITY_COUNT, &out);
+    assert(status == napi_ok);
+
+    uint32_t i;
+    for (i = 0; i < EVMC_PRIORITY_COUNT; i++) {
+      struct evmc_scheduler_stats stats;
+      evmc_scheduler_get_stats(context->scheduler, (enum evmc_priority) i, &stats);
+
+      napi_value priority;
+      status = napi_create_object(env, &priority);
+      assert(status == napi_ok);
+
+      napi_value value;
+      status = napi_create_int64(env, stats.queued, &value);
+      assert(status == napi_ok);
+      status = napi_set_named_property(env, priority, "queued", value);
+      assert(status == napi_ok);
+
+      status = napi_create_int64(env, stats.running, &value);
+      assert(status == napi_ok);
+      status = napi_set_named_property(env, priority, "running", value);
+      assert(status == napi_ok);
+
+      status = napi_create_int64(env, stats.started, &value);
+      assert(status == napi_ok);
+      status = napi_set_named_property(env, priority, "started", value);
+      assert(status == napi_ok);
+
+      status = napi_create_int64(env, stats.expired, &value);
+      assert(status == napi_ok);
+      status = napi_set_named_property(env, priority, "expired", value);
+      assert(status == napi_ok);
+
+      status = napi_create_int64(env, stats.rejected, &value);
+      assert(status == napi_ok);
+      status = napi_set_named_property(env, priority, "rejected", value);
+      assert(status == napi_ok);
+
+      status = napi_create_int64(env, stats.aborted, &value);
+      assert(status == napi_ok);
+      status = napi_set_named_property(env, priority, "aborted", value);
+      assert(status == napi_ok);
+
+      status = napi_create_bigint_uint64(env, stats.wait_ns, &value);
+      assert(status == napi_ok);
+      status = napi_set_named_property(env, priority, "waitNs", value);
+      assert(status == napi_ok);
+
+      status = napi_create_bigint_uint64(env, stats.max_wait_ns, &value);
+      assert(status == napi_ok);
+      status = napi_set_named_property(env, priority, "maxWaitNs", value);
+      assert(status == napi_ok);
+
+      status = napi_set_element(env, out, i, priority);
+      assert(status == napi_ok);
+    }
+
+    return out;
+}
+
+napi_value evmc_set_handoff_spin(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 2;
+    napi_value argv[2];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 2) {
+      napi_throw_error(env, "EINVAL", "Expected 2 arguments");
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
+
+    int64_t spin_ns;
+    status = napi_get_value_int64(env, argv[1], &spin_ns);
+    if (status != napi_ok || spin_ns < 0) {
+      napi_throw_error(env, "EINVAL", "Expected a non-negative spin time");
+      return NULL;
+    }
+    context->handoff_spin_ns = (uint64_t) spin_ns;
+
+    return NULL;
+}
+
+napi_value evmc_set_intern_capacity(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 2;
+    napi_value argv[2];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 2) {
+      napi_throw_error(env, "EINVAL", "Expected 2 arguments");
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
+
+    int64_t capacity;
+    status = napi_get_value_int64(env, argv[1], &capacity);
+    if (status != napi_ok || capacity < 0) {
+      napi_throw_error(env, "EINVAL", "Expected a non-negative number of slots");
+      return NULL;
+    }
+    if (!set_intern_capacity(env, context, (size_t) capacity)) {
+      napi_throw_error(env, "EINVAL", "Too many slots for the interning table");
+      return NULL;
+    }
+
+    return NULL;
+}
+
+napi_value evmc_get_intern_stats(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 1;
+    napi_value argv[1];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 1) {
+      napi_throw_error(env, "EINVAL", "Expected 1 argument");
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
+
+    napi_value out;
+    status = napi_create_object(env, &out);
+    assert(status == napi_ok);
+
+    napi_value value;
+    status = napi_create_int64(env, context->intern_hits, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "hits", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, context->intern_misses, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "misses", value);
+    assert(status == napi_ok);
+
+    size_t capacity = context->intern_table == NULL ? 0 : evmc_intern_table_capacity(context->intern_table);
+    status = napi_create_int64(env, capacity, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "capacity", value);
+    assert(status == napi_ok);
+
+    return out;
+}
+
+napi_value evmc_get_handoff_stats(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    struct evmc_handoff_stats stats;
+    evmc_handoff_get_stats(&stats);
+
+    napi_value out;
+    status = napi_create_object(env, &out);
+    assert(status == napi_ok);
+
+    napi_value value;
+    status = napi_create_int64(env, stats.waits, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "waits", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.spun, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "spun", value);
+    assert(status == napi_ok);
+
+    status = napi_create_bigint_uint64(env, stats.spin_ns, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "spinNs", value);
+    assert(status == napi_ok);
+
+    return out;
+}
+
+napi_value evmc_set_profiler(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 2;
+    napi_value argv[2];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 2) {
+      napi_throw_error(env, "EINVAL", "Expected 2 arguments");
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
+
+    int64_t capacity;
+    status = napi_get_value_int64(env, argv[1], &capacity);
+    if (status != napi_ok || capacity < 0) {
+      napi_throw_error(env, "EINVAL", "Expected a number of contracts");
+      return NULL;
+    }
+
+    struct evmc_profiler* profiler = NULL;
+    if (capacity > 0) {
+      profiler = evmc_profiler_create((size_t) capacity);
+      if (profiler == NULL) {
+        napi_throw_error(env, "EINVAL", "Too many contracts for the profiler");
+        return NULL;
+      }
+    }
+
+    // Executions already running are counted in the profiler they started with.
+    if (context->profiler != NULL) {
+      evmc_profiler_release(context->profiler);
+    }
+    context->profiler = profiler;
+
+    return NULL;
+}
+
+/** The names host calls are reported under, in the order of enum evmc_host_call. */
+static const char* const host_call_names[EVMC_HOST_CALL_COUNT] = {
+    "accountExists", "getStorage", "setStorage", "getBalance", "getCodeSize", "getCodeHash",
+    "copyCode", "selfDestruct", "call", "getTxContext", "getBlockHash", "emitLog",
+    "transfer"};
+
+napi_value evmc_get_profile(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 3;
+    napi_value argv[3];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 3) {
+      napi_throw_error(env, "EINVAL", "Expected 3 arguments");
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
+
+    if (context->profiler == NULL) {
+      napi_throw_error(env, "EINVAL", "The profiler is not enabled");
+      return NULL;
+    }
+
+    uint32_t order;
+    status = napi_get_value_uint32(env, argv[1], &order);
+    if (status != napi_ok || order > EVMC_PROFILE_BY_EXECUTIONS) {
+      napi_throw_error(env, "EINVAL", "Expected an order to rank contracts by");
+      return NULL;
+    }
+
+    int64_t limit;
+    status = napi_get_value_int64(env, argv[2], &limit);
+    if (status != napi_ok || limit < 0) {
+      napi_throw_error(env, "EINVAL", "Expected a number of contracts");
+      return NULL;
+    }
+
+    struct evmc_profile_entry* entries = NULL;
+    size_t count = 0;
+    if (limit > 0) {
+      entries = (struct evmc_profile_entry*) malloc((size_t) limit * sizeof(struct evmc_profile_entry));
+      if (entries == NULL) {
+        napi_throw_error(env, "ENOMEM", "Out of memory");
+        return NULL;
+      }
+      count = evmc_profiler_top(context->profiler, (enum evmc_profile_order) order, entries, (size_t) limit);
+    }
+
+    napi_value out;
+    status = napi_create_object(env, &out);
+    assert(status == napi_ok);
+
+    napi_value list;
+    status = napi_create_array_with_length(env, count, &list);
+    assert(status == napi_ok);
+
+    size_t i, j;
+    for (i = 0; i < count; i++) {
+      struct evmc_profile_entry* entry = &entries[i];
+
+      napi_value node_entry;
+      status = napi_create_object(env, &node_entry);
+      assert(status == napi_ok);
+
+      napi_value value;
+      create_bigint_from_evmc_bytes32(env, (const evmc_bytes32*) entry->code_hash, &value);
+      status = napi_set_named_property(env, node_entry, "codeHash", value);
+      assert(status == napi_ok);
+
+      status = napi_create_int64(env, entry->code_size, &value);
+      assert(status == napi_ok);
+      status = napi_set_named_property(env, node_entry, "codeSize", value);
+      assert(status == napi_ok);
+
+      status = napi_create_int64(env, entry->executions, &value);
+      assert(status == napi_ok);
+      status = napi_set_named_property(env, node_entry, "executions", value);
+      assert(status == napi_ok);
+
+      status = napi_create_bigint_uint64(env, entry->gas_used, &value);
+      assert(status == napi_ok);
+      status = napi_set_named_property(env, node_entry, "gasUsed", value);
+      assert(status == napi_ok);
+
+      status = napi_create_bigint_uint64(env, entry->vm_ns, &value);
+      assert(status == napi_ok);
+      status = napi_set_named_property(env, node_entry, "vmNs", value);
+      assert(status == napi_ok);
+
+      status = napi_create_bigint_uint64(env, entry->host_ns, &value);
+      assert(status == napi_ok);
+      status = napi_set_named_property(env, node_entry, "hostNs", value);
+      assert(status == napi_ok);
+
+      napi_value host_calls;
+      status = napi_create_object(env, &host_calls);
+      assert(status == napi_ok);
+      for (j = 0; j < EVMC_HOST_CALL_COUNT; j++) {
+        status = napi_create_int64(env, entry->host_calls[j], &value);
+        assert(status == napi_ok);
+        status = napi_set_named_property(env, host_calls, host_call_names[j], value);
+        assert(status == napi_ok);
+      }
+      status = napi_set_named_property(env, node_entry, "hostCalls", host_calls);
+      assert(status == napi_ok);
+
+      status = napi_set_element(env, list, (uint32_t) i, node_entry);
+      assert(status == napi_ok);
+    }
+    free(entries);
+
+    status = napi_set_named_property(env, out, "contracts", list);
+    assert(status == napi_ok);
+
+    napi_value untracked;
+    status = napi_create_int64(env, evmc_profiler_untracked(context->profiler), &untracked);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "untracked", untracked);
+    assert(status == napi_ok);
+
+    return out;
+}
+
+void evmc_cleanup_witness(napi_env env, void* finalize_data, void* finalize_hint) {
+    struct js_witness_handle* handle = (struct js_witness_handle*) finalize_data;
+
+    if (handle->witness != NULL) {
+      evmc_witness_release(handle->witness);
+    }
+
+    free(handle);
+}
+
+/** Adds each buffer of an array to the witness, as nodes or as code. */
+bool add_witness_buffers(napi_env env, struct evmc_witness* witness, napi_value array, bool nodes) {
+    napi_status status;
+
+    uint32_t length;
+    status = napi_get_array_length(env, array, &length);
+    if (status != napi_ok) {
+      napi_throw_error(env, "EINVAL", nodes ? "Expected an array of nodes" : "Expected an array of codes");
+      return false;
+    }
+
+    uint32_t i;
+    for (i = 0; i < length; i++) {
+      napi_value node_buffer;
+      status = napi_get_element(env, array, i, &node_buffer);
+      assert(status == napi_ok);
+
+      uint8_t* data;
+      size_t size;
+      status = napi_get_buffer_info(env, node_buffer, (void**) &data, &size);
+      if (status != napi_ok) {
+        napi_throw_error(env, "EINVAL", "Expected a buffer");
+        return false;
+      }
+
+      if (!nodes) {
+        evmc_witness_add_code(witness, data, size);
+      } else if (!evmc_witness_add_node(witness, data, size)) {
+        char message[64];
+        snprintf(message, sizeof(message), "Witness node %u is not an RLP list", i);
+        napi_throw_error(env, "EINVAL", message);
+        return false;
+      }
+    }
+    return true;
+}
+
+napi_value evmc_create_witness(napi_env env, napi_callback_info info) {
+    napi_status status;
+    napi_value out;
+
+    size_t argc = 3;
+    napi_value argv[3];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 3) {
+      napi_throw_error(env, "EINVAL", "Expected 3 arguments");
+      return NULL;
+    }
+
+    evmc_bytes32 state_root;
+    get_evmc_bytes32_from_bigint(env, argv[0], &state_root);
+
+    struct evmc_witness* witness = evmc_witness_create(&state_root);
+    assert(witness != NULL);
+    if (!add_witness_buffers(env, witness, argv[1], true) ||
+        !add_witness_buffers(env, witness, argv[2], false)) {
+      evmc_witness_release(witness);
+      return NULL;
+    }
+
+    struct js_witness_handle* handle = (struct js_witness_handle*) malloc(sizeof(struct js_witness_handle));
+    handle->witness = witness;
+
+    status = napi_create_external(env, handle, evmc_cleanup_witness, NULL, &out);
+    assert(status == napi_ok);
+    return out;
+}
+
+napi_value evmc_release_witness(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 1;
+    napi_value argv[1];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 1) {
+      napi_throw_error(env, "EINVAL", "Expected 1 argument");
+      return NULL;
+    }
+
+    struct js_witness_handle* handle;
+    status = napi_get_value_external(env, argv[0], (void**) &handle);
+    assert(status == napi_ok);
+
+    // Executions still running on the witness keep it.
+    if (handle->witness != NULL) {
+      evmc_witness_release(handle->witness);
+      handle->witness = NULL;
+    }
+
+    return NULL;
+}
+
+napi_value evmc_get_witness_info(napi_env env, napi_callback_info info) {
+    napi_status status;
+    napi_value out;
+
+    size_t argc = 1;
+    napi_value argv[1];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 1) {
+      napi_throw_error(env, "EINVAL", "Expected 1 argument");
+      return NULL;
+    }
+
+    struct js_witness_handle* handle;
+    status = napi_get_value_external(env, argv[0], (void**) &handle);
+    assert(status == napi_ok);
+
+    if (handle->witness == NULL) {
+      napi_throw_error(env, "EINVAL", "Witness has been released");
+      return NULL;
+    }
+
+    status = napi_create_object(env, &out);
+    assert(status == napi_ok);
+
+    napi_value value;
+    status = napi_create_int64(env, evmc_witness_node_count(handle->witness), &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "nodeCount", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, evmc_witness_code_count(handle->witness), &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "codeCount", value);
+    assert(status == napi_ok);
+
+    return out;
+}
+
+void evmc_cleanup_abort(napi_env env, void* finalize_data, void* finalize_hint) {
+    free(finalize_data);
+}
+
+napi_value evmc_create_abort(napi_env env, napi_callback_info info) {
+    napi_status status;
+    napi_value out;
+
+    struct js_abort_handle* handle = (struct js_abort_handle*) malloc(sizeof(struct js_abort_handle));
+    handle->aborted = 0;
+    handle->execution = NULL;
+
+    status = napi_create_external(env, handle, evmc_cleanup_abort, NULL, &out);
+    assert(status == napi_ok);
+    return out;
+}
+
+/**
+ * Aborts the execution given the handle. Its host calls are answered with
+ * zero from then on, and a call waiting on a promise is answered at once, as
+ * the promise may never settle. The VM runs on until it returns, which with
+ * every call failing is soon for code which calls out, and the execution is
+ * then rejected.
+ */
+napi_value evmc_abort(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 1;
+    napi_value argv[1];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 1) {
+      napi_throw_error(env, "EINVAL", "Expected 1 argument");
+      return NULL;
+    }
+
+    struct js_abort_handle* handle;
+    status = napi_get_value_external(env, argv[0], (void**) &handle);
+    assert(status == napi_ok);
+
+    __atomic_store_n(&handle->aborted, 1, __ATOMIC_RELEASE);
+
+    struct js_execution_context* execution = handle->execution;
+    if (execution != NULL && execution->awaiting != NULL) {
+      // The continuation stays attached to the promise, and is only reused
+      // once that settles.
+      struct js_call* call = execution->awaiting->call;
+      execution->awaiting->call = NULL;
+      execution->awaiting = NULL;
+      evmc_handoff_signal(call->handoff);
+    }
+
+    return NULL;
+}
+
+void evmc_cleanup_write_set(napi_env env, void* finalize_data, void* finalize_hint) {
+    struct js_write_set_handle* handle = (struct js_write_set_handle*) finalize_data;
+
+    if (handle->write_set != NULL) {
+      evmc_write_set_release(handle->write_set);
+    }
+
+    free(handle);
+}
+
+napi_value evmc_create_write_set(napi_env env, napi_callback_info info) {
+    napi_status status;
+    napi_value out;
+
+    struct js_write_set_handle* handle = (struct js_write_set_handle*) malloc(sizeof(struct js_write_set_handle));
+    handle->write_set = evmc_write_set_create();
+    assert(handle->write_set != NULL);
+
+    status = napi_create_external(env, handle, evmc_cleanup_write_set, NULL, &out);
+    assert(status == napi_ok);
+    return out;
+}
+
+/** Returns the write set of a handle, or throws and returns NULL if it was released. */
+struct evmc_write_set* get_write_set(napi_env env, napi_value value) {
+    struct js_write_set_handle* handle;
+    napi_status status = napi_get_value_external(env, value, (void**) &handle);
+    assert(status == napi_ok);
+
+    if (handle->write_set == NULL) {
+      napi_throw_error(env, "EINVAL", "Write set has been released");
+    }
+    return handle->write_set;
+}
+
+napi_value evmc_release_write_set(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 1;
+    napi_value argv[1];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
 
-  napi_value node_message_sender;
-  status = napi_get_named_property(env, node_message, "sender", &node_message_sender);
-  assert(status == napi_ok);
-  get_evmc_address_from_bigint(env, node_message_sender, &js_ctx->message.sender);
+    if (argc != 1) {
+      napi_throw_error(env, "EINVAL", "Expected 1 argument");
+      return NULL;
+    }
 
-  napi_value node_message_input_data;
-  status = napi_get_named_property(env, node_message, "inputData", &node_message_input_data);
-  assert(status == napi_ok);
-  uint8_t* input_buffer;
-  status = napi_get_buffer_info(env, node_message_input_data, (void**) &input_buffer, &js_ctx->message.input_size);
-  assert(status == napi_ok);
-  if (js_ctx->message.input_size != 0 ){
-    js_ctx->message.input_data = (uint8_t*) malloc(js_ctx->message.input_size);
+    struct js_write_set_handle* handle;
+    status = napi_get_value_external(env, argv[0], (void**) &handle);
+    assert(status == napi_ok);
+
+    // Executions still journaling into the write set keep it.
+    if (handle->write_set != NULL) {
+      evmc_write_set_release(handle->write_set);
+      handle->write_set = NULL;
+    }
+
+    return NULL;
+}
+
+napi_value evmc_get_write_set_size(napi_env env, napi_callback_info info) {
+    napi_status status;
+    napi_value out;
+
+    size_t argc = 1;
+    napi_value argv[1];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 1) {
+      napi_throw_error(env, "EINVAL", "Expected 1 argument");
+      return NULL;
+    }
+
+    struct evmc_write_set* write_set = get_write_set(env, argv[0]);
+    if (write_set == NULL) {
+      return NULL;
+    }
+
+    status = napi_create_int64(env, evmc_write_set_size(write_set), &out);
+    assert(status == napi_ok);
+    return out;
+}
+
+/**
+ * Journals an update of the fields of an account which are not undefined. The
+ * nonce and balance are not visible to the host, so only JS can write them.
+ */
+napi_value evmc_update_account(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 5;
+    napi_value argv[5];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 5) {
+      napi_throw_error(env, "EINVAL", "Expected 5 arguments");
+      return NULL;
+    }
+
+    struct evmc_write_set* write_set = get_write_set(env, argv[0]);
+    if (write_set == NULL) {
+      return NULL;
+    }
+
+    struct evmc_write write;
+    memset(&write, 0, sizeof(write));
+    write.type = EVMC_WRITE_ACCOUNT;
+    get_evmc_address_from_bigint(env, argv[1], &write.address);
+
+    napi_valuetype type;
+    status = napi_typeof(env, argv[2], &type);
+    assert(status == napi_ok);
+    if (type != napi_undefined) {
+      bool lossless;
+      status = napi_get_value_bigint_uint64(env, argv[2], &write.nonce, &lossless);
+      if (status != napi_ok || !lossless) {
+        napi_throw_error(env, "EINVAL", "Expected a 64-bit nonce");
+        return NULL;
+      }
+      write.fields |= EVMC_WRITE_NONCE;
+    }
+
+    status = napi_typeof(env, argv[3], &type);
+    assert(status == napi_ok);
+    if (type != napi_undefined) {
+      get_evmc_bytes32_from_bigint(env, argv[3], &write.balance);
+      write.fields |= EVMC_WRITE_BALANCE;
+    }
+
+    status = napi_typeof(env, argv[4], &type);
+    assert(status == napi_ok);
+    if (type != napi_undefined) {
+      get_evmc_bytes32_from_bigint(env, argv[4], &write.code_hash);
+      write.fields |= EVMC_WRITE_CODE_HASH;
+    }
+
+    evmc_write_set_append(write_set, &write);
+    return NULL;
+}
+
+napi_value evmc_delete_account(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 2;
+    napi_value argv[2];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 2) {
+      napi_throw_error(env, "EINVAL", "Expected 2 arguments");
+      return NULL;
+    }
+
+    struct evmc_write_set* write_set = get_write_set(env, argv[0]);
+    if (write_set == NULL) {
+      return NULL;
+    }
+
+    struct evmc_write write;
+    memset(&write, 0, sizeof(write));
+    write.type = EVMC_WRITE_DELETE;
+    get_evmc_address_from_bigint(env, argv[1], &write.address);
+    evmc_write_set_append(write_set, &write);
+    return NULL;
+}
+
+napi_value evmc_set_write_set_storage(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 4;
+    napi_value argv[4];
+
+    status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    assert(status == napi_ok);
+
+    if (argc != 4) {
+      napi_throw_error(env, "EINVAL", "Expected 4 arguments");
+      return NULL;
+    }
+
+    struct evmc_write_set* write_set = get_write_set(env, argv[0]);
+    if (write_set == NULL) {
+      return NULL;
+    }
+
+    struct evmc_write write;
+    memset(&write, 0, sizeof(write));
+    write.type = EVMC_WRITE_STORAGE;
+    get_evmc_address_from_bigint(env, argv[1], &write.address);
+    get_evmc_bytes32_from_bigint(env, argv[2], &write.key);
+    get_evmc_bytes32_from_bigint(env, argv[3], &write.value);
+    evmc_write_set_append(write_set, &write);
+    return NULL;
+}
+
+/** Most scheduler tasks a commitment is spread over */
+#define EVMC_COMMIT_MAX_TASKS 8
+
+/**
+ * A commitment being computed by several tasks of the scheduler. Each task
+ * commits accounts until none are left, and the last one to finish commits the
+ * state trie and hands the commitment back to JS.
+ */
+struct js_commit {
+  struct evmc_commitment* commitment;
+  /** The next account to commit */
+  size_t next;
+  /** The tasks not yet finished */
+  size_t pending;
+  /** If a task's deadline passed before it started */
+  bool expired;
+  napi_deferred deferred;
+  napi_threadsafe_function done;
+  /** Keeps the EVM, and with it the scheduler, until the commitment is done */
+  napi_ref evm;
+};
+
+void commit_accounts(struct js_commit* commit, bool expired) {
+  if (expired) {
+    __atomic_store_n(&commit->expired, true, __ATOMIC_RELAXED);
   } else {
-    js_ctx->message.input_data = NULL;
+    size_t count = evmc_commitment_account_count(commit->commitment);
+    size_t index;
+    while ((index = __atomic_fetch_add(&commit->next, 1, __ATOMIC_RELAXED)) < count) {
+      evmc_commitment_commit_account(commit->commitment, index);
+    }
   }
 
-  napi_value node_message_value;
-  status = napi_get_named_property(env, node_message, "value", &node_message_value);
+  if (__atomic_sub_fetch(&commit->pending, 1, __ATOMIC_ACQ_REL) == 0) {
+    if (!commit->expired) {
+      evmc_commitment_commit_state(commit->commitment);
+    }
+    napi_call_threadsafe_function(commit->done, NULL, napi_tsfn_blocking);
+  }
+}
+
+/** Builds {stateRoot, accounts, nodes} from a commitment which succeeded. */
+napi_value create_commitment_object(napi_env env, struct evmc_commitment* commitment) {
+  napi_status status;
+  napi_value out;
+  napi_value value;
+
+  status = napi_create_object(env, &out);
   assert(status == napi_ok);
-  get_evmc_bytes32_from_bigint(env, node_message_value, &js_ctx->message.value);
 
-  napi_value node_message_kind;
-  status = napi_get_named_property(env, node_message, "kind", &node_message_kind);
+  create_bigint_from_evmc_bytes32(env, evmc_commitment_state_root(commitment), &value);
+  status = napi_set_named_property(env, out, "stateRoot", value);
   assert(status == napi_ok);
-  int64_t message_kind;
-  status = napi_get_value_int64(env, node_message_kind, &message_kind);
+
+  napi_value accounts;
+  size_t count = evmc_commitment_account_count(commitment);
+  status = napi_create_array_with_length(env, count, &accounts);
   assert(status == napi_ok);
-  js_ctx->message.kind = (enum evmc_call_kind) message_kind;
+  size_t i;
+  for (i = 0; i < count; i++) {
+    const struct evmc_committed_account* account = evmc_commitment_get_account(commitment, i);
+    napi_value node_account;
+    status = napi_create_object(env, &node_account);
+    assert(status == napi_ok);
 
-  size_t code_size;
-  uint8_t* code;
-  napi_value node_code;
+    create_bigint_from_evmc_address(env, &account->address, &value);
+    status = napi_set_named_property(env, node_account, "address", value);
+    assert(status == napi_ok);
 
-  status = napi_get_named_property(env, argv[1], "code", &node_code);
-  assert(status == napi_ok);
+    status = napi_get_boolean(env, account->exists, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, node_account, "exists", value);
+    assert(status == napi_ok);
 
-  status = napi_get_buffer_info(env, node_code, (void**) &code, &code_size);
-  assert(status == napi_ok);
+    create_bigint_from_evmc_bytes32(env, &account->storage_root, &value);
+    status = napi_set_named_property(env, node_account, "storageRoot", value);
+    assert(status == napi_ok);
 
-  js_ctx->code_size = code_size;
-  if (code_size > 0) {
-    js_ctx->code = (uint8_t*) malloc(code_size);
-    memcpy(js_ctx->code, code, code_size);
+    status = napi_set_element(env, accounts, (uint32_t) i, node_account);
+    assert(status == napi_ok);
   }
+  status = napi_set_named_property(env, out, "accounts", accounts);
+  assert(status == napi_ok);
 
-  status = napi_create_promise(env, &js_ctx->deferred, &js_ctx->promise);
+  // The nodes are encoded one after the other, so each is as long as its RLP.
+  napi_value nodes;
+  status = napi_create_array(env, &nodes);
+  assert(status == napi_ok);
+  size_t size;
+  const uint8_t* data = evmc_commitment_nodes(commitment, &size);
+  uint32_t index = 0;
+  struct rlp_item node;
+  while (size > 0 && rlp_decode(data, size, &node)) {
+    status = napi_create_buffer_copy(env, node.raw_size, node.raw, NULL, &value);
+    assert(status == napi_ok);
+    status = napi_set_element(env, nodes, index++, value);
+    assert(status == napi_ok);
+    data += node.raw_size;
+    size -= node.raw_size;
+  }
+  status = napi_set_named_property(env, out, "nodes", nodes);
   assert(status == napi_ok);
 
-  uv_work_t* work = (uv_work_t*) malloc((sizeof(uv_work_t)));
-  work->data = (void*) js_ctx;
-  uv_queue_work(uv_default_loop(), work, execute, execute_done);
-  
-  return js_ctx->promise;
+  return out;
 }
 
+void commit_done_js(napi_env env, napi_value js_callback, struct js_commit* commit, void* data) {
+  napi_status status;
 
-void evmc_cleanup_evm(napi_env env, void* finalize_data, void* finalize_hint) {
-    struct evmc_js_context* context = (struct evmc_js_context*) finalize_data;
+  if (env != NULL) {
+    const char* code = NULL;
+    char message[160];
+    const evmc_bytes32* key;
+    const evmc_address* address = evmc_commitment_missing(commit->commitment, &key);
+    if (commit->expired) {
+      code = "ETIMEDOUT";
+      snprintf(message, sizeof(message), "Commitment deadline passed before it started");
+    } else if (address != NULL) {
+      code = "EWITNESS";
+      char account[2 * sizeof(address->bytes) + 3];
+      format_hex(account, address->bytes, sizeof(address->bytes));
+      if (key != NULL) {
+        char slot[2 * sizeof(key->bytes) + 3];
+        format_hex(slot, key->bytes, sizeof(key->bytes));
+        snprintf(message, sizeof(message), "No proof of storage slot %s of account %s", slot, account);
+      } else {
+        snprintf(message, sizeof(message), "No proof of account %s", account);
+      }
+    }
 
-    if (!context->released) {
-      context->instance->destroy(context->instance);
-      release_callbacks_from_context(env, context);
+    if (code != NULL) {
+      napi_value node_code;
+      status = napi_create_string_utf8(env, code, NAPI_AUTO_LENGTH, &node_code);
+      assert(status == napi_ok);
+      napi_value node_message;
+      status = napi_create_string_utf8(env, message, NAPI_AUTO_LENGTH, &node_message);
+      assert(status == napi_ok);
+      napi_value error;
+      status = napi_create_error(env, node_code, node_message, &error);
+      assert(status == napi_ok);
+      status = napi_reject_deferred(env, commit->deferred, error);
+      assert(status == napi_ok);
+    } else {
+      status = napi_resolve_deferred(env, commit->deferred, create_commitment_object(env, commit->commitment));
+      assert(status == napi_ok);
     }
 
-    free(context);
+    status = napi_delete_reference(env, commit->evm);
+    assert(status == napi_ok);
+  }
+
+  evmc_commitment_destroy(commit->commitment);
+  status = napi_release_threadsafe_function(commit->done, napi_tsfn_release);
+  assert(status == napi_ok);
+  free(commit);
 }
 
-napi_value evmc_create_evm(napi_env env, napi_callback_info info) {
+napi_value evmc_commit_write_set(napi_env env, napi_callback_info info) {
     napi_status status;
-    napi_value out;
-    
-    size_t argc = 3;
-    napi_value argv[3];
+
+    size_t argc = 4;
+    napi_value argv[4];
 
     status = napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
     assert(status == napi_ok);
 
-    if (argc != 3) {
-      status = napi_throw_error(env, "EINVAL", "Expected 3 arguments");
+    if (argc != 4) {
+      napi_throw_error(env, "EINVAL", "Expected 4 arguments");
+      return NULL;
     }
 
-    char* path;
-    size_t path_size;
+    struct evmc_write_set* write_set = get_write_set(env, argv[1]);
+    if (write_set == NULL) {
+      return NULL;
+    }
 
-    status = napi_get_value_string_utf8(env, argv[0], NULL, 0, &path_size);
+    struct js_witness_handle* witness_handle;
+    status = napi_get_value_external(env, argv[2], (void**) &witness_handle);
     assert(status == napi_ok);
-    // path_size excludes NULL terminator
-    path = (char*) malloc(path_size + 1);
-    status = napi_get_value_string_utf8(env, argv[0], path, path_size + 1, &path_size);
+    if (witness_handle->witness == NULL) {
+      napi_throw_error(env, "EINVAL", "Witness has been released");
+      return NULL;
+    }
+
+    enum evmc_priority priority;
+    uint64_t deadline;
+    if (!get_schedule(env, argv[0], argv[3], &priority, &deadline)) {
+      return NULL;
+    }
+
+    struct evmc_js_context* context;
+    status = napi_get_value_external(env, argv[0], (void**) &context);
     assert(status == napi_ok);
-    
-    enum evmc_loader_error_code error_code;
-    struct evmc_instance* instance = evmc_load_and_create(path, &error_code);
-    assert(error_code == EVMC_LOADER_SUCCESS);
-    free((void*) path);
 
-    struct evmc_js_context* context = (struct evmc_js_context*) malloc(sizeof(struct evmc_js_context));
-    context->instance = instance;
-    context->host = &host_interface;
-    context->released = false;
+    struct js_commit* commit = (struct js_commit*) malloc(sizeof(struct js_commit));
+    commit->commitment = evmc_commitment_create(write_set, witness_handle->witness);
+    commit->next = 0;
+    commit->expired = false;
 
-    // This creates a WEAK reference, which is OK because we only use the refrence from execute() which requires
-    // an instance of the EVM object itself.
-    napi_create_reference(env, argv[2], 0, &context->object);
+    size_t tasks = evmc_commitment_account_count(commit->commitment);
+    if (tasks > EVMC_COMMIT_MAX_TASKS) {
+      tasks = EVMC_COMMIT_MAX_TASKS;
+    } else if (tasks == 0) {
+      tasks = 1;
+    }
+    commit->pending = tasks;
 
-    create_callbacks_from_context(env, context, argv[1]);
+    status = napi_create_reference(env, argv[0], 1, &commit->evm);
+    assert(status == napi_ok);
 
-    status = napi_create_external(env, context, evmc_cleanup_evm, NULL, &out);
+    napi_value name;
+    status = napi_create_string_utf8(env, "evmc_commit", NAPI_AUTO_LENGTH, &name);
     assert(status == napi_ok);
-    return out;
+    status = napi_create_threadsafe_function(env, NULL, NULL, name, 0, 1, NULL, NULL, commit,
+                                             (napi_threadsafe_function_call_js) commit_done_js, &commit->done);
+    assert(status == napi_ok);
+
+    napi_value promise;
+    status = napi_create_promise(env, &commit->deferred, &promise);
+    assert(status == napi_ok);
+
+    size_t i;
+    for (i = 0; i < tasks; i++) {
+      evmc_scheduler_submit(context->scheduler, priority, deadline,
+                            (evmc_scheduler_run_fn) commit_accounts, commit);
+    }
+
+    return promise;
 }
 
+napi_value evmc_get_arena_stats(napi_env env, napi_callback_info info) {
+    napi_status status;
 
-napi_value evmc_release_evm(napi_env env, napi_callback_info info) {
+    struct evmc_arena_stats stats;
+    evmc_arena_get_stats(&stats);
+
+    napi_value out;
+    status = napi_create_object(env, &out);
+    assert(status == napi_ok);
+
+    napi_value value;
+    status = napi_create_int64(env, stats.arenas, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "arenas", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.reuses, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "reuses", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.allocations, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "allocations", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.chunks, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "chunks", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.reserved, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "reserved", value);
+    assert(status == napi_ok);
+
+    return out;
+}
+
+napi_value evmc_get_completion_stats(napi_env env, napi_callback_info info) {
     napi_status status;
-    
+
     size_t argc = 1;
     napi_value argv[1];
 
@@ -1245,25 +5820,61 @@ napi_value evmc_release_evm(napi_env env, napi_callback_info info) {
     assert(status == napi_ok);
 
     if (argc != 1) {
-      status = napi_throw_error(env, "EINVAL", "Expected 1 argument");
+      napi_throw_error(env, "EINVAL", "Expected 1 argument");
+      return NULL;
     }
 
     struct evmc_js_context* context;
     status = napi_get_value_external(env, argv[0], (void**) &context);
+    assert(status == napi_ok);
 
-    if (!context->released) {
-      context->instance->destroy(context->instance);
-      release_callbacks_from_context(env, context);
-      context->released = true;
+    struct evmc_completion_stats stats;
+    evmc_completion_queue_get_stats(context->completions, &stats);
+
+    napi_value out;
+    status = napi_create_object(env, &out);
+    assert(status == napi_ok);
+
+    napi_value value;
+    status = napi_create_int64(env, stats.completions, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "completions", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.batches, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "batches", value);
+    assert(status == napi_ok);
+
+    status = napi_create_int64(env, stats.largest_batch, &value);
+    assert(status == napi_ok);
+    status = napi_set_named_property(env, out, "largestBatch", value);
+    assert(status == napi_ok);
+
+    napi_value histogram;
+    status = napi_create_array_with_length(env, EVMC_COMPLETION_HISTOGRAM_SIZE, &histogram);
+    assert(status == napi_ok);
+    uint32_t i;
+    for (i = 0; i < EVMC_COMPLETION_HISTOGRAM_SIZE; i++) {
+      status = napi_create_int64(env, stats.histogram[i], &value);
+      assert(status == napi_ok);
+      status = napi_set_element(env, histogram, i, value);
+      assert(status == napi_ok);
     }
+    status = napi_set_named_property(env, out, "histogram", histogram);
+    assert(status == napi_ok);
 
-    return NULL;
+    return out;
 }
 
-napi_value init_all (napi_env env, napi_value exports) {
-  napi_value evmc_create_evm_fn;
-  napi_value evmc_execute_evm_fn;
-  napi_value evmc_release_evm_fn;
+uv_once_t init_once = UV_ONCE_INIT;
+
+/**
+ * Sets up state shared by every thread the binding is loaded on, which may be
+ * the main thread and any number of workers.
+ */
+void init_process(void) {
+  precompiles_init();
 
   host_interface.account_exists = (evmc_account_exists_fn) account_exists;
   host_interface.get_storage = (evmc_get_storage_fn) get_storage;
@@ -1278,13 +5889,212 @@ napi_value init_all (napi_env env, napi_value exports) {
   host_interface.get_block_hash = (evmc_get_block_hash_fn) get_block_hash;
   host_interface.emit_log = (evmc_emit_log_fn) emit_log;
 
+  recording_host_interface.account_exists = (evmc_account_exists_fn) record_account_exists;
+  recording_host_interface.get_storage = (evmc_get_storage_fn) record_get_storage;
+  recording_host_interface.set_storage = (evmc_set_storage_fn) record_set_storage;
+  recording_host_interface.get_balance = (evmc_get_balance_fn) record_get_balance;
+  recording_host_interface.get_code_size = (evmc_get_code_size_fn) record_get_code_size;
+  recording_host_interface.get_code_hash = (evmc_get_code_hash_fn) record_get_code_hash;
+  recording_host_interface.copy_code = (evmc_copy_code_fn) record_copy_code;
+  recording_host_interface.selfdestruct = (evmc_selfdestruct_fn) record_selfdestruct;
+  recording_host_interface.call = (evmc_call_fn) record_call;
+  recording_host_interface.get_tx_context = (evmc_get_tx_context_fn) record_get_tx_context;
+  recording_host_interface.get_block_hash = (evmc_get_block_hash_fn) record_get_block_hash;
+  recording_host_interface.emit_log = (evmc_emit_log_fn) record_emit_log;
+
+  state_host_interface.account_exists = (evmc_account_exists_fn) state_account_exists;
+  state_host_interface.get_storage = (evmc_get_storage_fn) state_get_storage;
+  state_host_interface.set_storage = (evmc_set_storage_fn) state_set_storage;
+  state_host_interface.get_balance = (evmc_get_balance_fn) state_get_balance;
+  state_host_interface.get_code_size = (evmc_get_code_size_fn) state_get_code_size;
+  state_host_interface.get_code_hash = (evmc_get_code_hash_fn) state_get_code_hash;
+  state_host_interface.copy_code = (evmc_copy_code_fn) state_copy_code;
+  state_host_interface.selfdestruct = (evmc_selfdestruct_fn) selfdestruct;
+  state_host_interface.call = (evmc_call_fn) call;
+  state_host_interface.get_tx_context = (evmc_get_tx_context_fn) state_get_tx_context;
+  state_host_interface.get_block_hash = (evmc_get_block_hash_fn) state_get_block_hash;
+  state_host_interface.emit_log = (evmc_emit_log_fn) emit_log;
+
+  memo_host_interface.account_exists = (evmc_account_exists_fn) memo_account_exists;
+  memo_host_interface.get_storage = (evmc_get_storage_fn) memo_get_storage;
+  memo_host_interface.set_storage = (evmc_set_storage_fn) memo_set_storage;
+  memo_host_interface.get_balance = (evmc_get_balance_fn) memo_get_balance;
+  memo_host_interface.get_code_size = (evmc_get_code_size_fn) memo_get_code_size;
+  memo_host_interface.get_code_hash = (evmc_get_code_hash_fn) memo_get_code_hash;
+  memo_host_interface.copy_code = (evmc_copy_code_fn) memo_copy_code;
+  memo_host_interface.selfdestruct = (evmc_selfdestruct_fn) memo_selfdestruct;
+  memo_host_interface.call = (evmc_call_fn) memo_call;
+  memo_host_interface.get_tx_context = (evmc_get_tx_context_fn) memo_get_tx_context;
+  memo_host_interface.get_block_hash = (evmc_get_block_hash_fn) memo_get_block_hash;
+  memo_host_interface.emit_log = (evmc_emit_log_fn) memo_emit_log;
+
+  estimate_host_interface.account_exists = (evmc_account_exists_fn) state_account_exists;
+  estimate_host_interface.get_storage = (evmc_get_storage_fn) state_get_storage;
+  estimate_host_interface.set_storage = (evmc_set_storage_fn) state_set_storage;
+  estimate_host_interface.get_balance = (evmc_get_balance_fn) state_get_balance;
+  estimate_host_interface.get_code_size = (evmc_get_code_size_fn) state_get_code_size;
+  estimate_host_interface.get_code_hash = (evmc_get_code_hash_fn) state_get_code_hash;
+  estimate_host_interface.copy_code = (evmc_copy_code_fn) state_copy_code;
+  estimate_host_interface.selfdestruct = (evmc_selfdestruct_fn) estimate_selfdestruct;
+  estimate_host_interface.call = (evmc_call_fn) call;
+  estimate_host_interface.get_tx_context = (evmc_get_tx_context_fn) state_get_tx_context;
+  estimate_host_interface.get_block_hash = (evmc_get_block_hash_fn) state_get_block_hash;
+  estimate_host_interface.emit_log = (evmc_emit_log_fn) estimate_emit_log;
+}
+
+napi_value init_all (napi_env env, napi_value exports) {
+  napi_value evmc_create_evm_fn;
+  napi_value evmc_execute_evm_fn;
+  napi_value evmc_estimate_gas_fn;
+  napi_value evmc_create_state_view_fn;
+  napi_value evmc_fork_state_view_fn;
+  napi_value evmc_get_state_view_memory_usage_fn;
+  napi_value evmc_release_state_view_fn;
+  napi_value evmc_release_evm_fn;
+  napi_value evmc_open_snapshot_fn;
+  napi_value evmc_close_snapshot_fn;
+  napi_value evmc_get_snapshot_info_fn;
+  napi_value evmc_set_snapshot_fn;
+  napi_value evmc_write_snapshot_fn;
+  napi_value evmc_set_native_precompiles_fn;
+  napi_value evmc_set_account_cache_fn;
+  napi_value evmc_invalidate_accounts_fn;
+  napi_value evmc_invalidate_all_accounts_fn;
+  napi_value evmc_get_account_cache_stats_fn;
+  napi_value evmc_set_result_cache_fn;
+  napi_value evmc_get_result_cache_stats_fn;
+  napi_value evmc_start_recording_fn;
+  napi_value evmc_stop_recording_fn;
+  napi_value evmc_replay_fn;
+  napi_value evmc_set_tiers_fn;
+  napi_value evmc_get_vm_stats_fn;
+  napi_value evmc_get_completion_stats_fn;
+  napi_value evmc_get_arena_stats_fn;
+  napi_value evmc_set_handoff_spin_fn;
+  napi_value evmc_prewarm_fn;
+  napi_value evmc_set_intern_capacity_fn;
+  napi_value evmc_get_intern_stats_fn;
+  napi_value evmc_get_handoff_stats_fn;
+  napi_value evmc_set_profiler_fn;
+  napi_value evmc_execute_transaction_fn;
+  napi_value evmc_get_profile_fn;
+  napi_value evmc_set_scheduler_limits_fn;
+  napi_value evmc_get_scheduler_stats_fn;
+  napi_value evmc_create_witness_fn;
+  napi_value evmc_release_witness_fn;
+  napi_value evmc_get_witness_info_fn;
+  napi_value evmc_create_write_set_fn;
+  napi_value evmc_release_write_set_fn;
+  napi_value evmc_get_write_set_size_fn;
+  napi_value evmc_update_account_fn;
+  napi_value evmc_delete_account_fn;
+  napi_value evmc_set_write_set_storage_fn;
+  napi_value evmc_commit_write_set_fn;
+  napi_value evmc_create_abort_fn;
+  napi_value evmc_abort_fn;
+
+  uv_once(&init_once, init_process);
+  define_classes(env);
+
   napi_create_function(env, NULL, 0, evmc_create_evm, NULL, &evmc_create_evm_fn);
   napi_create_function(env, NULL, 0, evmc_execute_evm, NULL, &evmc_execute_evm_fn);
+  napi_create_function(env, NULL, 0, evmc_estimate_gas, NULL, &evmc_estimate_gas_fn);
+  napi_create_function(env, NULL, 0, evmc_create_state_view, NULL, &evmc_create_state_view_fn);
+  napi_create_function(env, NULL, 0, evmc_fork_state_view, NULL, &evmc_fork_state_view_fn);
+  napi_create_function(env, NULL, 0, evmc_get_state_view_memory_usage, NULL, &evmc_get_state_view_memory_usage_fn);
+  napi_create_function(env, NULL, 0, evmc_release_state_view, NULL, &evmc_release_state_view_fn);
   napi_create_function(env, NULL, 0, evmc_release_evm, NULL, &evmc_release_evm_fn);
+  napi_create_function(env, NULL, 0, evmc_open_snapshot, NULL, &evmc_open_snapshot_fn);
+  napi_create_function(env, NULL, 0, evmc_close_snapshot, NULL, &evmc_close_snapshot_fn);
+  napi_create_function(env, NULL, 0, evmc_get_snapshot_info, NULL, &evmc_get_snapshot_info_fn);
+  napi_create_function(env, NULL, 0, evmc_set_snapshot, NULL, &evmc_set_snapshot_fn);
+  napi_create_function(env, NULL, 0, evmc_write_snapshot, NULL, &evmc_write_snapshot_fn);
+  napi_create_function(env, NULL, 0, evmc_set_native_precompiles, NULL, &evmc_set_native_precompiles_fn);
+  napi_create_function(env, NULL, 0, evmc_set_account_cache, NULL, &evmc_set_account_cache_fn);
+  napi_create_function(env, NULL, 0, evmc_invalidate_accounts, NULL, &evmc_invalidate_accounts_fn);
+  napi_create_function(env, NULL, 0, evmc_invalidate_all_accounts, NULL, &evmc_invalidate_all_accounts_fn);
+  napi_create_function(env, NULL, 0, evmc_get_account_cache_stats, NULL, &evmc_get_account_cache_stats_fn);
+  napi_create_function(env, NULL, 0, evmc_set_result_cache, NULL, &evmc_set_result_cache_fn);
+  napi_create_function(env, NULL, 0, evmc_get_result_cache_stats, NULL, &evmc_get_result_cache_stats_fn);
+  napi_create_function(env, NULL, 0, evmc_start_recording, NULL, &evmc_start_recording_fn);
+  napi_create_function(env, NULL, 0, evmc_stop_recording, NULL, &evmc_stop_recording_fn);
+  napi_create_function(env, NULL, 0, evmc_replay, NULL, &evmc_replay_fn);
+  napi_create_function(env, NULL, 0, evmc_set_tiers, NULL, &evmc_set_tiers_fn);
+  napi_create_function(env, NULL, 0, evmc_get_vm_stats, NULL, &evmc_get_vm_stats_fn);
+  napi_create_function(env, NULL, 0, evmc_get_completion_stats, NULL, &evmc_get_completion_stats_fn);
+  napi_create_function(env, NULL, 0, evmc_get_arena_stats, NULL, &evmc_get_arena_stats_fn);
+  napi_create_function(env, NULL, 0, evmc_set_handoff_spin, NULL, &evmc_set_handoff_spin_fn);
+  napi_create_function(env, NULL, 0, evmc_prewarm, NULL, &evmc_prewarm_fn);
+  napi_create_function(env, NULL, 0, evmc_set_intern_capacity, NULL, &evmc_set_intern_capacity_fn);
+  napi_create_function(env, NULL, 0, evmc_get_intern_stats, NULL, &evmc_get_intern_stats_fn);
+  napi_create_function(env, NULL, 0, evmc_get_handoff_stats, NULL, &evmc_get_handoff_stats_fn);
+  napi_create_function(env, NULL, 0, evmc_set_profiler, NULL, &evmc_set_profiler_fn);
+  napi_create_function(env, NULL, 0, evmc_execute_transaction, NULL, &evmc_execute_transaction_fn);
+  napi_create_function(env, NULL, 0, evmc_get_profile, NULL, &evmc_get_profile_fn);
+  napi_create_function(env, NULL, 0, evmc_set_scheduler_limits, NULL, &evmc_set_scheduler_limits_fn);
+  napi_create_function(env, NULL, 0, evmc_get_scheduler_stats, NULL, &evmc_get_scheduler_stats_fn);
+  napi_create_function(env, NULL, 0, evmc_create_witness, NULL, &evmc_create_witness_fn);
+  napi_create_function(env, NULL, 0, evmc_release_witness, NULL, &evmc_release_witness_fn);
+  napi_create_function(env, NULL, 0, evmc_get_witness_info, NULL, &evmc_get_witness_info_fn);
+  napi_create_function(env, NULL, 0, evmc_create_write_set, NULL, &evmc_create_write_set_fn);
+  napi_create_function(env, NULL, 0, evmc_release_write_set, NULL, &evmc_release_write_set_fn);
+  napi_create_function(env, NULL, 0, evmc_get_write_set_size, NULL, &evmc_get_write_set_size_fn);
+  napi_create_function(env, NULL, 0, evmc_update_account, NULL, &evmc_update_account_fn);
+  napi_create_function(env, NULL, 0, evmc_delete_account, NULL, &evmc_delete_account_fn);
+  napi_create_function(env, NULL, 0, evmc_set_write_set_storage, NULL, &evmc_set_write_set_storage_fn);
+  napi_create_function(env, NULL, 0, evmc_commit_write_set, NULL, &evmc_commit_write_set_fn);
+  napi_create_function(env, NULL, 0, evmc_create_abort, NULL, &evmc_create_abort_fn);
+  napi_create_function(env, NULL, 0, evmc_abort, NULL, &evmc_abort_fn);
 
   napi_set_named_property(env, exports, "createEvmcEvm", evmc_create_evm_fn);
   napi_set_named_property(env, exports, "executeEvmcEvm", evmc_execute_evm_fn);
+  napi_set_named_property(env, exports, "estimateEvmcGas", evmc_estimate_gas_fn);
+  napi_set_named_property(env, exports, "createEvmcStateView", evmc_create_state_view_fn);
+  napi_set_named_property(env, exports, "forkEvmcStateView", evmc_fork_state_view_fn);
+  napi_set_named_property(env, exports, "getEvmcStateViewMemoryUsage", evmc_get_state_view_memory_usage_fn);
+  napi_set_named_property(env, exports, "releaseEvmcStateView", evmc_release_state_view_fn);
   napi_set_named_property(env, exports, "releaseEvmcEvm", evmc_release_evm_fn);
+  napi_set_named_property(env, exports, "openEvmcSnapshot", evmc_open_snapshot_fn);
+  napi_set_named_property(env, exports, "closeEvmcSnapshot", evmc_close_snapshot_fn);
+  napi_set_named_property(env, exports, "getEvmcSnapshotInfo", evmc_get_snapshot_info_fn);
+  napi_set_named_property(env, exports, "setEvmcSnapshot", evmc_set_snapshot_fn);
+  napi_set_named_property(env, exports, "writeEvmcSnapshot", evmc_write_snapshot_fn);
+  napi_set_named_property(env, exports, "setEvmcNativePrecompiles", evmc_set_native_precompiles_fn);
+  napi_set_named_property(env, exports, "setEvmcAccountCache", evmc_set_account_cache_fn);
+  napi_set_named_property(env, exports, "invalidateEvmcAccounts", evmc_invalidate_accounts_fn);
+  napi_set_named_property(env, exports, "invalidateAllEvmcAccounts", evmc_invalidate_all_accounts_fn);
+  napi_set_named_property(env, exports, "getEvmcAccountCacheStats", evmc_get_account_cache_stats_fn);
+  napi_set_named_property(env, exports, "setEvmcResultCache", evmc_set_result_cache_fn);
+  napi_set_named_property(env, exports, "getEvmcResultCacheStats", evmc_get_result_cache_stats_fn);
+  napi_set_named_property(env, exports, "startEvmcRecording", evmc_start_recording_fn);
+  napi_set_named_property(env, exports, "stopEvmcRecording", evmc_stop_recording_fn);
+  napi_set_named_property(env, exports, "replayEvmcTrace", evmc_replay_fn);
+  napi_set_named_property(env, exports, "setEvmcTiers", evmc_set_tiers_fn);
+  napi_set_named_property(env, exports, "getEvmcVmStats", evmc_get_vm_stats_fn);
+  napi_set_named_property(env, exports, "getEvmcCompletionStats", evmc_get_completion_stats_fn);
+  napi_set_named_property(env, exports, "getEvmcArenaStats", evmc_get_arena_stats_fn);
+  napi_set_named_property(env, exports, "setEvmcHandoffSpin", evmc_set_handoff_spin_fn);
+  napi_set_named_property(env, exports, "prewarmEvmc", evmc_prewarm_fn);
+  napi_set_named_property(env, exports, "setEvmcInternCapacity", evmc_set_intern_capacity_fn);
+  napi_set_named_property(env, exports, "getEvmcInternStats", evmc_get_intern_stats_fn);
+  napi_set_named_property(env, exports, "getEvmcHandoffStats", evmc_get_handoff_stats_fn);
+  napi_set_named_property(env, exports, "setEvmcProfiler", evmc_set_profiler_fn);
+  napi_set_named_property(env, exports, "executeEvmcTransaction", evmc_execute_transaction_fn);
+  napi_set_named_property(env, exports, "getEvmcProfile", evmc_get_profile_fn);
+  napi_set_named_property(env, exports, "setEvmcSchedulerLimits", evmc_set_scheduler_limits_fn);
+  napi_set_named_property(env, exports, "getEvmcSchedulerStats", evmc_get_scheduler_stats_fn);
+  napi_set_named_property(env, exports, "createEvmcWitness", evmc_create_witness_fn);
+  napi_set_named_property(env, exports, "releaseEvmcWitness", evmc_release_witness_fn);
+  napi_set_named_property(env, exports, "getEvmcWitnessInfo", evmc_get_witness_info_fn);
+  napi_set_named_property(env, exports, "createEvmcWriteSet", evmc_create_write_set_fn);
+  napi_set_named_property(env, exports, "releaseEvmcWriteSet", evmc_release_write_set_fn);
+  napi_set_named_property(env, exports, "getEvmcWriteSetSize", evmc_get_write_set_size_fn);
+  napi_set_named_property(env, exports, "updateEvmcAccount", evmc_update_account_fn);
+  napi_set_named_property(env, exports, "deleteEvmcAccount", evmc_delete_account_fn);
+  napi_set_named_property(env, exports, "setEvmcWriteSetStorage", evmc_set_write_set_storage_fn);
+  napi_set_named_property(env, exports, "commitEvmcWriteSet", evmc_commit_write_set_fn);
+  napi_set_named_property(env, exports, "createEvmcAbort", evmc_create_abort_fn);
+  napi_set_named_property(env, exports, "abortEvmc", evmc_abort_fn);
 
   return exports;
 }
@@ -0,0 +1,318 @@
+import * as path from 'path';
+import {PerformanceObserver} from 'perf_hooks';
+import * as process from 'process';
+
+import {Evmc, EvmcCallKind, EvmcMessage, EvmcStatusCode, EvmcStorageStatus} from './evmc';
+
+// This file contains the soak benchmark, which runs millions of mixed
+// executions against a synchronous and an asynchronous host, and samples
+// memory, garbage collection and event loop delay as it goes. It fails if
+// memory keeps growing once warmed up. To run it, execute `npm run soak` from
+// the package directory. The environment may override:
+//   SOAK_EXECUTIONS       executions to run in total (2000000)
+//   SOAK_SAMPLES          samples to take over the run (20)
+//   SOAK_CONCURRENCY      executions in flight at once (16)
+//   SOAK_MAX_GROWTH_MB    growth of RSS or external memory per million
+//                         executions which fails the run (8)
+
+const numberFromEnv = (name: string, fallback: number) => {
+  const value = process.env[name];
+  return value === undefined ? fallback : Number(value);
+};
+
+const EXECUTIONS = numberFromEnv('SOAK_EXECUTIONS', 2000000);
+const SAMPLES = numberFromEnv('SOAK_SAMPLES', 20);
+const CONCURRENCY = numberFromEnv('SOAK_CONCURRENCY', 16);
+const MAX_GROWTH_MB = numberFromEnv('SOAK_MAX_GROWTH_MB', 8);
+// The interval of the event loop delay timer, which the delays it records
+// include.
+const LOOP_DELAY_RESOLUTION_MS = 10;
+// Samples taken before this many are the warm up, while arenas, caches and
+// the heap settle, and do not count towards growth.
+const WARMUP_SAMPLES = Math.max(1, Math.floor(SAMPLES / 4));
+
+const STORAGE_ADDRESS = 0x42n;
+const STORAGE_VALUE = 0x05n;
+const TX_ORIGIN = 0xEA674fdDe714fd979de3EdF0F56AA9716B898ec8n;
+const TX_DESTINATION = 0x174201554d57715a2382555c6dd9028166ab20ean;
+const CALL_ACCOUNT = 0x44fD3AB8381cC3d14AFa7c4aF7Fd13CdC65026E1n;
+const CALL_OUTPUT = Buffer.alloc(32, 0xb7);
+
+const MESSAGE = {
+  kind: EvmcCallKind.EVMC_CALL,
+  sender: TX_ORIGIN,
+  depth: 0,
+  destination: TX_DESTINATION,
+  gas: 100000n,
+  inputData: Buffer.from([]),
+  value: 0n
+};
+
+/** The contracts executions cycle through, each exercising another path. */
+const CONTRACTS = [
+  // STOP
+  Buffer.from('00', 'hex'),
+  // PUSH1 0x42 SLOAD POP, 8 times, then STOP
+  Buffer.from('60425450'.repeat(8) + '00', 'hex'),
+  // PUSH1 0x05 PUSH1 0x42 SSTORE STOP
+  Buffer.from('600560425500', 'hex'),
+  // CALL(10000, CALL_ACCOUNT, 0, 0, 0, 0, 32), then RETURN(0, 32)
+  Buffer.from(
+      '60206000600060006000' +
+          `73${CALL_ACCOUNT.toString(16).padStart(40, '0')}612710f1` +
+          '60206000f3',
+      'hex'),
+  // LOG1(0, 32, 0x01) STOP
+  Buffer.from('600160206000a100', 'hex'),
+  // REVERT(0, 32)
+  Buffer.from('60206000fd', 'hex'),
+];
+
+class SoakEVM extends Evmc {
+  constructor(path: string, private readonly sync: boolean) {
+    super(path);
+  }
+
+  private answer<T>(value: T): Promise<T>|T {
+    return this.sync ? value : Promise.resolve(value);
+  }
+
+  getAccountExists(account: bigint) {
+    return this.answer(true);
+  }
+
+  getStorage(account: bigint, key: bigint) {
+    return this.answer(key === STORAGE_ADDRESS ? STORAGE_VALUE : 0n);
+  }
+
+  setStorage(account: bigint, key: bigint, value: bigint) {
+    return this.answer(EvmcStorageStatus.EVMC_STORAGE_MODIFIED);
+  }
+
+  getBalance(account: bigint) {
+    return this.answer(0n);
+  }
+
+  getCodeSize(account: bigint) {
+    return this.answer(0n);
+  }
+
+  copyCode(account: bigint, offset: number, length: number) {
+    return this.answer(Buffer.alloc(0));
+  }
+
+  selfDestruct(account: bigint, beneficiary: bigint) {
+    return this.answer(undefined);
+  }
+
+  getCodeHash(account: bigint) {
+    return this.answer(0n);
+  }
+
+  call(message: EvmcMessage) {
+    return this.answer({
+      statusCode: EvmcStatusCode.EVMC_SUCCESS,
+      gasLeft: message.gas / 2n,
+      outputData: CALL_OUTPUT,
+      createAddress: 0n
+    });
+  }
+
+  getTxContext() {
+    return this.answer({
+      txGasPrice: 100n,
+      txOrigin: TX_ORIGIN,
+      blockCoinbase: 0n,
+      blockNumber: 1n,
+      blockTimestamp: 1551402771n,
+      blockGasLimit: 8000000n,
+      blockDifficulty: 1n
+    });
+  }
+
+  getBlockHash(num: bigint) {
+    return this.answer(0n);
+  }
+
+  emitLog(account: bigint, data: Buffer, topics: Array<bigint>) {
+    return this.answer(undefined);
+  }
+}
+
+/** The subset of perf_hooks.monitorEventLoopDelay the soak uses. */
+interface EventLoopDelay {
+  min: number;
+  max: number;
+  mean: number;
+  enable(): void;
+  disable(): void;
+  reset(): void;
+  percentile(percentile: number): number;
+}
+
+// Not in the node typings this package builds with, nor in node 10.
+const monitorEventLoopDelay:
+    ((options: {resolution: number}) => EventLoopDelay)|undefined =
+        require('perf_hooks').monitorEventLoopDelay;
+const gc: (() => void)|undefined = (global as {gc?: () => void}).gc;
+
+interface Sample {
+  executions: number;
+  rss: number;
+  external: number;
+  heapUsed: number;
+}
+
+// Garbage collections and the time they paused for, since the last sample.
+let gcPauses = 0;
+let gcPauseMs = 0;
+let gcMaxPauseMs = 0;
+new PerformanceObserver(list => {
+  for (const entry of list.getEntries()) {
+    gcPauses++;
+    gcPauseMs += entry.duration;
+    gcMaxPauseMs = Math.max(gcMaxPauseMs, entry.duration);
+  }
+}).observe({entryTypes: ['gc']});
+
+const megabytes = (bytes: number) => (bytes / (1024 * 1024)).toFixed(1);
+
+/** Formats a recorded loop delay as the delay beyond the timer interval. */
+const loopDelay = (nanos: number) =>
+    Math.max(0, nanos / 1e6 - LOOP_DELAY_RESOLUTION_MS).toFixed(2);
+
+/** Takes a sample, after a full collection if node runs with --expose-gc. */
+const sample = (executions: number): Sample => {
+  if (gc !== undefined) {
+    gc();
+  }
+  const memory = process.memoryUsage();
+  return {
+    executions,
+    rss: memory.rss,
+    external: memory.external,
+    heapUsed: memory.heapUsed
+  };
+};
+
+/** The least squares slope of a field over the samples, per execution. */
+const slope = (samples: Sample[], field: (sample: Sample) => number) => {
+  const n = samples.length;
+  const meanX = samples.reduce((sum, s) => sum + s.executions, 0) / n;
+  const meanY = samples.reduce((sum, s) => sum + field(s), 0) / n;
+  let covariance = 0;
+  let variance = 0;
+  for (const s of samples) {
+    covariance += (s.executions - meanX) * (field(s) - meanY);
+    variance += (s.executions - meanX) * (s.executions - meanX);
+  }
+  return variance === 0 ? 0 : covariance / variance;
+};
+
+const getDynamicLibraryExtension = () => {
+  return process.platform === 'win32' ?
+      'dll' :
+      process.platform === 'darwin' ? 'dylib' : 'so';
+};
+
+const soak = async () => {
+  const alethPath = path.join(
+      __dirname,
+      `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+          getDynamicLibraryExtension()}`);
+  const evms = [new SoakEVM(alethPath, true), new SoakEVM(alethPath, false)];
+  const delay = monitorEventLoopDelay === undefined ?
+      undefined :
+      monitorEventLoopDelay({resolution: LOOP_DELAY_RESOLUTION_MS});
+  if (delay !== undefined) {
+    delay.enable();
+  }
+  if (gc === undefined) {
+    console.log('Run node with --expose-gc for steadier memory samples.');
+  }
+  console.log(`Soaking ${EXECUTIONS} executions, ${CONCURRENCY} at once...`);
+
+  const interval = Math.max(1, Math.floor(EXECUTIONS / SAMPLES));
+  const samples: Sample[] = [];
+  let started = 0;
+  let completed = 0;
+  let failures = 0;
+  let lastSample = process.hrtime.bigint();
+
+  const report = () => {
+    const current = sample(completed);
+    samples.push(current);
+    const now = process.hrtime.bigint();
+    const rate = interval / (Number(now - lastSample) / 1e9);
+    lastSample = now;
+    const lag = delay === undefined ?
+        '' :
+        ` loop delay p50 ${loopDelay(delay.percentile(50))}ms p99 ${
+            loopDelay(delay.percentile(99))}ms max ${loopDelay(delay.max)}ms`;
+    console.log(`${completed}: ${rate.toFixed(0)} executions/s rss ${
+        megabytes(current.rss)}MB external ${
+        megabytes(current.external)}MB heap ${
+        megabytes(current.heapUsed)}MB gc ${gcPauses} pauses ${
+        gcPauseMs.toFixed(1)}ms (max ${gcMaxPauseMs.toFixed(2)}ms)${lag}`);
+    gcPauses = 0;
+    gcPauseMs = 0;
+    gcMaxPauseMs = 0;
+    if (delay !== undefined) {
+      delay.reset();
+    }
+  };
+
+  // Each lane runs executions one after the other, alternating hosts and
+  // cycling through the contracts.
+  const lane = async () => {
+    while (started < EXECUTIONS) {
+      const i = started++;
+      const evm = evms[i % evms.length];
+      const contract = CONTRACTS[Math.floor(i / evms.length) % CONTRACTS.length];
+      const result = await evm.execute(MESSAGE, contract);
+      if (result.statusCode !== EvmcStatusCode.EVMC_SUCCESS &&
+          result.statusCode !== EvmcStatusCode.EVMC_REVERT) {
+        failures++;
+      }
+      if (++completed % interval === 0) {
+        report();
+      }
+    }
+  };
+  const lanes: Array<Promise<void>> = [];
+  for (let i = 0; i < CONCURRENCY; i++) {
+    lanes.push(lane());
+  }
+  await Promise.all(lanes);
+  if (delay !== undefined) {
+    delay.disable();
+  }
+  for (const evm of evms) {
+    evm.release();
+  }
+
+  const settled = samples.slice(WARMUP_SAMPLES);
+  const rssGrowth = slope(settled, s => s.rss) * 1e6;
+  const externalGrowth = slope(settled, s => s.external) * 1e6;
+  const heapGrowth = slope(settled, s => s.heapUsed) * 1e6;
+  console.log(`Growth per million executions after warm up: rss ${
+      megabytes(rssGrowth)}MB external ${megabytes(externalGrowth)}MB heap ${
+      megabytes(heapGrowth)}MB`);
+
+  const limit = MAX_GROWTH_MB * 1024 * 1024;
+  if (failures > 0) {
+    console.log(`FAIL: ${failures} executions failed`);
+    process.exitCode = 1;
+  } else if (settled.length < 2) {
+    console.log('FAIL: too few samples to measure growth');
+    process.exitCode = 1;
+  } else if (rssGrowth > limit || externalGrowth > limit) {
+    console.log(`FAIL: memory grows by more than ${
+        MAX_GROWTH_MB}MB per million executions`);
+    process.exitCode = 1;
+  } else {
+    console.log('PASS');
+  }
+};
+
+soak();
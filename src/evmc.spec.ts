@@ -1,11 +1,17 @@
 import 'mocha';
 
 import * as chai from 'chai';
+import * as crypto from 'crypto';
+import * as fs from 'fs';
+import * as os from 'os';
 import * as path from 'path';
 import * as process from 'process';
 import * as util from 'util';
+import * as v8 from 'v8';
+import * as vm from 'vm';
+import {threadId} from 'worker_threads';
 
-import {Evmc, EvmcCallKind, EvmcMessage, EvmcStatusCode, EvmcStorageStatus} from './evmc';
+import {Evmc, evmc_flags, EvmcAbortSignal, EvmcCallKind, EvmcExecution, EvmcMessage, EvmcPriority, EvmcProfileOrder, EvmcRevision, EvmcSnapshot, EvmcStateView, EvmcStatusCode, EvmcStorageStatus, EvmcWitness, EvmcWorker, EvmcWriteSet} from './evmc';
 
 const evmasm = require('evmasm');
 
@@ -430,4 +436,1656 @@ describe('Try EVM creation', () => {
     evm.release();
     evm.released.should.be.true;
   });
-});
\ No newline at end of file
+});
+
+describe('Try EVM snapshots', () => {
+  const snapshotPath = path.join(os.tmpdir(), `evmc-${process.pid}.snapshot`);
+  let evm: TestEVM;
+  let snapshot: EvmcSnapshot;
+
+  it('should write and map a snapshot', () => {
+    EvmcSnapshot.write(snapshotPath, [
+      {
+        address: TX_DESTINATION,
+        balance: BALANCE_BALANCE + 1n,
+        codeHash: BALANCE_CODEHASH,
+        code: CODE_CODE,
+        storage: new Map([[STORAGE_ADDRESS, STORAGE_VALUE + 1n]])
+      },
+      {
+        address: CODE_ACCOUNT,
+        balance: 0n,
+        codeHash: BALANCE_CODEHASH,
+        code: CODE_CODE,
+        storage: new Map()
+      }
+    ]);
+    snapshot = new EvmcSnapshot(snapshotPath);
+    snapshot.info.accountCount.should.equal(2);
+    snapshot.info.slotCount.should.equal(1);
+    // Both accounts share the same code.
+    snapshot.info.codeSize.should.equal(CODE_CODE.length);
+
+    evm = new TestEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+    evm.useSnapshot(snapshot);
+  });
+
+  it('should read storage from the snapshot', async () => {
+    const result = await evm.execute(
+        EVM_MESSAGE,
+        Buffer.from(
+            evmasm.compile(`
+          jumpi(success, eq(sload(${STORAGE_ADDRESS}), ${STORAGE_VALUE + 1n}))
+          data(0xFE) // Invalid Opcode
+          success:
+          stop
+          `),
+            'hex'));
+    result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+  });
+
+  it('should read balances from the snapshot', async () => {
+    const result = await evm.execute(
+        EVM_MESSAGE,
+        Buffer.from(
+            evmasm.compile(`
+          jumpi(success, eq(balance(0x${BALANCE_ACCOUNT.toString(16)}), ${
+                BALANCE_BALANCE + 1n}))
+          data(0xFE) // Invalid Opcode
+          success:
+          stop
+          `),
+            'hex'));
+    result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+  });
+
+  it('should copy code from the snapshot', async () => {
+    const result = await evm.execute(
+        EVM_MESSAGE,
+        Buffer.from(
+            evmasm.compile(`
+            extcodecopy(0x${CODE_ACCOUNT.toString(16)}, 0, 0, 
+            0x${CODE_CODE.length.toString(16)})
+            jumpi(success, eq(mload(0), 0x${CODE_CODE.toString('hex')}))
+            data(0xFE) // Invalid Opcode
+            success:
+            stop
+          `),
+            'hex'));
+    result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+  });
+
+  it('should release the snapshot', async () => {
+    snapshot.close();
+    evm.release();
+    snapshot.closed.should.be.true;
+  });
+
+  it('should not share different code with the same hash', () => {
+    const otherCode = Buffer.from('600160005260206000f3', 'hex');
+    EvmcSnapshot.write(snapshotPath, [
+      {
+        address: TX_DESTINATION,
+        balance: 0n,
+        codeHash: BALANCE_CODEHASH,
+        code: CODE_CODE,
+        storage: new Map()
+      },
+      {
+        address: CODE_ACCOUNT,
+        balance: 0n,
+        codeHash: BALANCE_CODEHASH,
+        code: otherCode,
+        storage: new Map()
+      }
+    ]);
+    const other = new EvmcSnapshot(snapshotPath);
+    other.info.codeSize.should.equal(CODE_CODE.length + otherCode.length);
+    other.close();
+  });
+
+  after(() => {
+    if (fs.existsSync(snapshotPath)) {
+      fs.unlinkSync(snapshotPath);
+    }
+  });
+});
+
+describe('Try native precompiles', () => {
+  let evm: TestEVM;
+
+  const word = (value: number|bigint, bytes = 32) =>
+      value.toString(16).padStart(bytes * 2, '0');
+
+  // Stores the input in memory, calls the precompile with the given gas, and
+  // returns whether the call succeeded along with its output.
+  const callPrecompile = async (
+      address: number, input: string, outputSize: number, gas: number,
+      revision: EvmcRevision) => {
+    let code = '';
+    const padded = input.padEnd(Math.ceil(input.length / 64) * 64, '0');
+    for (let i = 0; i < padded.length; i += 64) {
+      // MSTORE(offset, word)
+      code += `7f${padded.slice(i, i + 64)}61${word(i / 2, 2)}52`;
+    }
+    // CALL(gas, address, 0, 0, input size, 0x1000, output size)
+    code += `61${word(outputSize, 2)}61100061${word(input.length / 2, 2)}` +
+        `6000600060${word(address, 1)}63${word(gas, 4)}f1`;
+    // MSTORE(0x0fe0, success) RETURN(0x0fe0, 32 + output size)
+    code += `610fe05261${word(outputSize + 32, 2)}610fe0f3`;
+    const result = await evm.execute(
+        {...EVM_MESSAGE, gas: 10000000n}, Buffer.from(code, 'hex'), revision);
+    result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+    return {
+      success: result.outputData[31] === 1,
+      output: result.outputData.slice(32).toString('hex')
+    };
+  };
+
+  // Checks the output of a precompile given exactly its cost, and that it runs
+  // out of gas with one less.
+  const shouldAnswer = async (
+      address: number, input: string, cost: number, output: string,
+      revision = EvmcRevision.EVMC_ISTANBUL) => {
+    const paid =
+        await callPrecompile(address, input, output.length / 2, cost, revision);
+    paid.success.should.be.true;
+    paid.output.should.equal(output);
+    const short = await callPrecompile(
+        address, input, output.length / 2, cost - 1, revision);
+    short.success.should.be.false;
+  };
+
+  const shouldFail = async (
+      address: number, input: string, outputSize: number, gas: number) => {
+    const result = await callPrecompile(
+        address, input, outputSize, gas, EvmcRevision.EVMC_ISTANBUL);
+    result.success.should.be.false;
+  };
+
+  it('should be created', () => {
+    evm = new TestEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+  });
+
+  it('should hash with sha256 without calling JS', async () => {
+    const hash = crypto.createHash('sha256').update(CODE_INPUT_DATA).digest();
+    const result = await evm.execute(
+        EVM_MESSAGE,
+        Buffer.from(
+            evmasm.compile(`
+            mstore(0, 0x${CODE_INPUT_DATA.toString('hex')})
+            pop(call(10000, 0x02, 0, 0, 32, 32, 32))
+            jumpi(success, eq(mload(32), 0x${hash.toString('hex')}))
+            data(0xFE) // Invalid Opcode
+            success:
+            stop
+          `),
+            'hex'));
+    result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+  });
+
+  it('should copy with identity without calling JS', async () => {
+    const result = await evm.execute(
+        EVM_MESSAGE,
+        Buffer.from(
+            evmasm.compile(`
+            mstore(0, 0x${CODE_INPUT_DATA.toString('hex')})
+            pop(call(10000, 0x04, 0, 0, 32, 32, 32))
+            jumpi(success, eq(mload(32), 0x${CODE_INPUT_DATA.toString('hex')}))
+            data(0xFE) // Invalid Opcode
+            success:
+            stop
+          `),
+            'hex'));
+    result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+  });
+
+  it('should recover signers with ecrecover', async () => {
+    const hash =
+        '456e9aea5e197a1f1af7a3e85a3212fa4049a3ba34c2289b4c860fc0b0c64ef3';
+    const signature =
+        '9242685bf161793cc25603c231bc2f568eb630ea16aa137d2664ac8038825608' +
+        '4f8ae3bd7535248d0bd448298cc2e2071e56992d0774dc340c368ae950852ada';
+    await shouldAnswer(
+        0x01, hash + word(28) + signature, 3000,
+        word(0x7156526fbd7a3c72969b54f64e42c10fbb768c8an));
+    // An invalid recovery id recovers nothing.
+    await shouldAnswer(0x01, hash + word(29) + signature, 3000, word(0));
+  });
+
+  it('should hash with ripemd160', async () => {
+    await shouldAnswer(
+        0x03, '', 600, word(0x9c1185a5c5e9fc54612808977ee8f548b2258d31n));
+    await shouldAnswer(
+        0x03, Buffer.from('abc').toString('hex'), 720,
+        word(0x8eb208f7e05d987a9b044a8e98c6b087f15a0bfcn));
+  });
+
+  it('should exponentiate with modexp', async () => {
+    const modexp = (base: string, exponent: string, modulus: string) =>
+        word(base.length / 2) + word(exponent.length / 2) +
+        word(modulus.length / 2) + base + exponent + modulus;
+    const prime =
+        'fffffffffffffffffffffffffffffffffffffffffffffffffffffffefffffc2f';
+    const primeLessOne =
+        'fffffffffffffffffffffffffffffffffffffffffffffffffffffffefffffc2e';
+    // The examples of EIP-198.
+    await shouldAnswer(0x05, modexp('03', primeLessOne, prime), 13056, word(1));
+    await shouldAnswer(0x05, modexp('', primeLessOne, prime), 13056, word(0));
+    // A division which has to add the divisor back.
+    await shouldAnswer(
+        0x05,
+        modexp(
+            '7fffffff800000000000000000000000', '01',
+            '800000000000000000000001'),
+        12, '7fffffffffffffff00000002');
+    // A modulus which has to be normalized, and a longer base.
+    await shouldAnswer(
+        0x05,
+        modexp('f1'.repeat(64), '010001', '00ff' + 'a5'.repeat(61) + 'c3'),
+        3276,
+        '00296f0797e2c736c4efa5e1aca1a711fa2d2818173fdbef3deb58bdd57a7517' +
+            '1d737b99cb882890d99b6791d68999edf2ea4cbdbc765adac127dfc082731cd0');
+    // An exponent longer than 32 bytes.
+    await shouldAnswer(
+        0x05,
+        modexp(
+            '0123456789abcdef'.repeat(6), 'ff'.repeat(40),
+            '8000000000000001' + '7f'.repeat(31) + 'ed'),
+        36748,
+        '261d6ce10b28dd98684e6ee022d10444b4f5e739e58d9fa152f588e46df85516' +
+            '3afe463222c988b9');
+    await shouldAnswer(0x05, modexp('02', '02', '00'.repeat(32)), 51, word(0));
+  });
+
+  const G1 = word(1) + word(2);
+  const G1_DOUBLE =
+      '030644e72e131a029b85045b68181585d97816a916871ca8d3c208c16d87cfd3' +
+      '15ed738c0e0a7c92e7845f96b2ae9c0a68a6a449e3538fc7ff3ebf7a5a18a2c4';
+
+  it('should add points with bn256', async () => {
+    await shouldAnswer(0x06, G1 + G1, 150, G1_DOUBLE);
+    await shouldAnswer(
+        0x06, G1 + G1, 500, G1_DOUBLE, EvmcRevision.EVMC_BYZANTIUM);
+    await shouldAnswer(0x06, '', 150, word(0) + word(0));
+    await shouldFail(0x06, word(1) + word(3) + G1, 64, 150);
+  });
+
+  it('should multiply points with bn256', async () => {
+    await shouldAnswer(0x07, G1 + word(2), 6000, G1_DOUBLE);
+    await shouldAnswer(
+        0x07, G1 + word(2), 40000, G1_DOUBLE, EvmcRevision.EVMC_BYZANTIUM);
+    await shouldFail(0x07, word(1) + word(3) + word(2), 64, 6000);
+  });
+
+  it('should check pairings with bn256', async () => {
+    const G2 =
+        '198e9393920d483a7260bfb731fb5d25f1aa493335a9e71297e485b7aef312c2' +
+        '1800deef121f1e76426a00665e5c4479674322d4f75edadd46debd5cd992f6ed' +
+        '090689d0585ff075ec9e99ad690c3395bc4b313370b38ef355acdadcd122975b' +
+        '12c85ea5db8c6deb4aab71808dcb408fe3d1e7690c43d37b4ce6cc0166fa7daa';
+    const negatedG1 = word(1) +
+        '30644e72e131a029b85045b68181585d97816a916871ca8d3c208c16d87cfd45';
+    await shouldAnswer(0x08, G1 + G2 + negatedG1 + G2, 113000, word(1));
+    await shouldAnswer(
+        0x08, G1 + G2 + negatedG1 + G2, 260000, word(1),
+        EvmcRevision.EVMC_BYZANTIUM);
+    await shouldAnswer(0x08, G1 + G2, 79000, word(0));
+    await shouldAnswer(0x08, '', 45000, word(1));
+    await shouldFail(0x08, G1 + G2 + '00', 32, 200000);
+  });
+
+  it('should compress with blake2f', async () => {
+    // The vectors of EIP-152, compressing 'abc'.
+    const state =
+        '48c9bdf267e6096a3ba7ca8485ae67bb2bf894fe72f36e3cf1361d5f3af54fa5' +
+        'd182e6ad7f520e511f6c3e2b8c68059b6bbd41fbabd9831f79217e1319cde05b';
+    const block = Buffer.from('abc').toString('hex') + '00'.repeat(125);
+    const offset = '0300000000000000' + '0000000000000000';
+    const input = (rounds: number, final: string) =>
+        word(rounds, 4) + state + block + offset + final;
+    await shouldAnswer(
+        0x09, input(12, '01'), 12,
+        'ba80a53f981c4d0d6a2797b69f12f6e94c212f14685ac4b74b12bb6fdbffa2d1' +
+            '7d87c5392aab792dc252d5de4533cc9518d38aa8dbf1925ab92386edd4009923');
+    await shouldAnswer(
+        0x09, input(12, '00'), 12,
+        '75ab69d3190a562c51aef8d88f1c2775876944407270c42c9844252c26d28752' +
+            '98743e7f6d5ea2f2d3e8d226039cd31b4e426ac4f2d3d666a610c2116fde4735');
+    await shouldAnswer(
+        0x09, input(1, '01'), 1,
+        'b63a380cb2897d521994a85234ee2c181b5f844d2c624c002677e9703449d2fb' +
+            'a551b3a8333bcdf5f2f7e08993d53923de3d64fcc68c034e717b9293fed7a421');
+    // Inputs must be exactly 213 bytes, ending with a flag of 0 or 1.
+    await shouldFail(0x09, input(12, ''), 64, 1000);
+    await shouldFail(0x09, input(12, '0100'), 64, 1000);
+    await shouldFail(0x09, input(12, '02'), 64, 1000);
+  });
+
+  it('should call JS for precompiles of later revisions', async () => {
+    const result = await evm.execute(
+        EVM_MESSAGE,
+        Buffer.from(
+            evmasm.compile(`
+            mstore(0, 0x${CODE_INPUT_DATA.toString('hex')})
+            pop(call(10000, 0x09, 0, 0, 32, 32, 32))
+            jumpi(success, eq(mload(32), 0x${CODE_OUTPUT_DATA.toString('hex')}))
+            data(0xFE) // Invalid Opcode
+            success:
+            stop
+          `),
+            'hex'),
+        EvmcRevision.EVMC_HOMESTEAD);
+    result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+  });
+
+  it('should call JS when native precompiles are disabled', async () => {
+    evm.useNativePrecompiles(false);
+    const result = await evm.execute(
+        EVM_MESSAGE,
+        Buffer.from(
+            evmasm.compile(`
+            mstore(0, 0x${CODE_INPUT_DATA.toString('hex')})
+            pop(call(10000, 0x04, 0, 0, 32, 32, 32))
+            jumpi(success, eq(mload(32), 0x${CODE_OUTPUT_DATA.toString('hex')}))
+            data(0xFE) // Invalid Opcode
+            success:
+            stop
+          `),
+            'hex'));
+    result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+  });
+
+  it('should destroy the EVM', async () => {
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
+
+describe('Try EVM account cache', () => {
+  class CountingEVM extends TestEVM {
+    balanceCalls = 0;
+
+    async getBalance(account: bigint) {
+      this.balanceCalls++;
+      return super.getBalance(account);
+    }
+  }
+
+  const balanceCode = Buffer.from(
+      evmasm.compile(`
+      jumpi(success, eq(balance(0x${BALANCE_ACCOUNT.toString(16)}), ${
+          BALANCE_BALANCE}))
+      data(0xFE) // Invalid Opcode
+      success:
+      stop
+    `),
+      'hex');
+  let evm: CountingEVM;
+
+  it('should be created with a cache', () => {
+    evm = new CountingEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+    evm.useAccountCache(1024 * 1024);
+    evm.accountCacheStats.capacity.should.be.greaterThan(0);
+  });
+
+  it('should answer repeated balance queries from the cache', async () => {
+    for (let i = 0; i < 3; i++) {
+      const result = await evm.execute(EVM_MESSAGE, balanceCode);
+      result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+    }
+    evm.balanceCalls.should.equal(1);
+    evm.accountCacheStats.hits.should.equal(2);
+    evm.accountCacheStats.misses.should.equal(1);
+  });
+
+  it('should ask again after invalidation', async () => {
+    evm.invalidateAccounts([BALANCE_ACCOUNT]);
+    await evm.execute(EVM_MESSAGE, balanceCode);
+    evm.balanceCalls.should.equal(2);
+
+    evm.invalidateAll();
+    await evm.execute(EVM_MESSAGE, balanceCode);
+    evm.balanceCalls.should.equal(3);
+    evm.accountCacheStats.invalidations.should.equal(2);
+  });
+
+  it('should destroy the EVM', async () => {
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
+
+describe('Try EVM record and replay', () => {
+  const tracePath = path.join(os.tmpdir(), `evmc-${process.pid}.trace`);
+  let evm: TestEVM;
+
+  it('should record executions', async () => {
+    evm = new TestEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+    evm.startRecording(tracePath);
+    const balanceResult = await evm.execute(
+        EVM_MESSAGE,
+        Buffer.from(
+            evmasm.compile(`
+            jumpi(success, eq(balance(0x${BALANCE_ACCOUNT.toString(16)}), ${
+                BALANCE_BALANCE}))
+            data(0xFE) // Invalid Opcode
+            success:
+            stop
+          `),
+            'hex'));
+    balanceResult.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+    const storageResult = await evm.execute(
+        EVM_MESSAGE,
+        Buffer.from(
+            evmasm.compile(`
+            jumpi(success, eq(sload(${STORAGE_ADDRESS}), ${STORAGE_VALUE}))
+            data(0xFE) // Invalid Opcode
+            success:
+            stop
+          `),
+            'hex'));
+    storageResult.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+    evm.stopRecording();
+  });
+
+  it('should replay the trace without diverging', async () => {
+    const stats = await evm.replay(tracePath);
+    stats.executions.should.equal(2);
+    stats.hostCalls.should.equal(2);
+    stats.divergences.should.equal(0);
+    stats.mismatches.should.equal(0);
+  });
+
+  it('should reject a missing trace', async () => {
+    let error: Error|undefined;
+    try {
+      await evm.replay(`${tracePath}.missing`);
+    } catch (e) {
+      error = e;
+    }
+    should.exist(error);
+  });
+
+  it('should finish a replay after the EVM is released', async () => {
+    const replay = evm.replay(tracePath);
+    evm.release();
+    evm.released.should.be.true;
+    const stats = await replay;
+    stats.executions.should.equal(2);
+    stats.divergences.should.equal(0);
+  });
+
+  after(() => {
+    if (fs.existsSync(tracePath)) {
+      fs.unlinkSync(tracePath);
+    }
+  });
+});
+
+describe('Try EVM tiering', () => {
+  const vmPath = path.join(
+      __dirname,
+      `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+          getDynamicLibraryExtension()}`);
+  const code = Buffer.from(evmasm.compile(`stop`), 'hex');
+  let evm: TestEVM;
+
+  it('should be created with a tier', () => {
+    evm = new TestEVM(vmPath);
+    evm.useTiers([{path: vmPath, threshold: 3}]);
+    evm.vmStats.length.should.equal(2);
+  });
+
+  it('should promote code once it is hot', async () => {
+    for (let i = 0; i < 4; i++) {
+      const result = await evm.execute(EVM_MESSAGE, code);
+      result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+    }
+    const stats = evm.vmStats;
+    stats[0].executions.should.equal(2);
+    stats[1].executions.should.equal(2);
+    stats[1].promotions.should.equal(1);
+  });
+
+  it('should reject thresholds which do not increase', () => {
+    (() => evm.useTiers([
+      {path: vmPath, threshold: 3}, {path: vmPath, threshold: 3}
+    ])).should.throw();
+  });
+
+  it('should destroy the EVM', async () => {
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
+
+describe('Try EVM gas estimation', () => {
+  class CountingEVM extends TestEVM {
+    storageCalls = 0;
+
+    async getStorage(account: bigint, key: bigint) {
+      this.storageCalls++;
+      return super.getStorage(account, key);
+    }
+  }
+
+  const code = Buffer.from(
+      evmasm.compile(`
+      jumpi(check, eq(sload(${STORAGE_ADDRESS}), ${STORAGE_VALUE}))
+      data(0xFE) // Invalid Opcode
+      check:
+      jumpi(success, gt(gas(), 20000))
+      data(0xFE) // Invalid Opcode
+      success:
+      stop
+    `),
+      'hex');
+  let evm: CountingEVM;
+
+  it('should be created', () => {
+    evm = new CountingEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+  });
+
+  it('should find the lowest gas limit', async () => {
+    const estimate = await evm.estimateGas(EVM_MESSAGE, code);
+    estimate.result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+    estimate.gas.should.be.greaterThan(20000n);
+    estimate.gas.should.be.lessThan(TX_GAS);
+    evm.storageCalls.should.equal(1);
+
+    const below = await evm.execute(
+        {...EVM_MESSAGE, gas: estimate.gas - 1n}, code);
+    below.statusCode.should.not.equal(EvmcStatusCode.EVMC_SUCCESS);
+  });
+
+  it('should return the upper bound if the execution fails', async () => {
+    const estimate = await evm.estimateGas(EVM_MESSAGE, code, {hi: 10000n});
+    estimate.gas.should.equal(10000n);
+    estimate.result.statusCode.should.not.equal(EvmcStatusCode.EVMC_SUCCESS);
+  });
+
+  it('should destroy the EVM', async () => {
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
+
+describe('Try EVM state views', () => {
+  const incrementCode = Buffer.from(
+      evmasm.compile(`
+      sstore(${STORAGE_ADDRESS}, add(sload(${STORAGE_ADDRESS}), 1))
+      stop
+    `),
+      'hex');
+  const checkCode = (value: bigint) => Buffer.from(
+      evmasm.compile(`
+      jumpi(success, eq(sload(${STORAGE_ADDRESS}), ${value}))
+      data(0xFE) // Invalid Opcode
+      success:
+      stop
+    `),
+      'hex');
+  let evm: TestEVM;
+  let base: EvmcStateView;
+
+  it('should write to a view', async () => {
+    evm = new TestEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+    base = evm.createStateView();
+    const result = await evm.execute(
+        EVM_MESSAGE, incrementCode, EvmcRevision.EVMC_CONSTANTINOPLE2, base);
+    result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+    base.memoryUsage.should.be.greaterThan(0);
+  });
+
+  it('should keep writes of forks apart', async () => {
+    const forks = [base.fork(), base.fork()];
+    await Promise.all(forks.map(
+        fork => evm.execute(
+            EVM_MESSAGE, incrementCode, EvmcRevision.EVMC_CONSTANTINOPLE2, fork)));
+    for (const fork of forks) {
+      const result = await evm.execute(
+          EVM_MESSAGE, checkCode(STORAGE_VALUE + 2n),
+          EvmcRevision.EVMC_CONSTANTINOPLE2, fork);
+      result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+      fork.release();
+    }
+  });
+
+  it('should drop the writes of a reverting execution', async () => {
+    // PUSH1 0x77 PUSH1 0x42 SSTORE PUSH1 0 DUP1 REVERT
+    const revertCode = Buffer.from('6077604255600080fd', 'hex');
+    const fork = base.fork();
+    const reverted = await evm.execute(
+        EVM_MESSAGE, revertCode, EvmcRevision.EVMC_CONSTANTINOPLE2, fork);
+    reverted.statusCode.should.equal(EvmcStatusCode.EVMC_REVERT);
+    const result = await evm.execute(
+        EVM_MESSAGE, checkCode(STORAGE_VALUE + 1n),
+        EvmcRevision.EVMC_CONSTANTINOPLE2, fork);
+    result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+    fork.release();
+  });
+
+  it('should not execute on a forked view', () => {
+    (() => evm.execute(
+         EVM_MESSAGE, incrementCode, EvmcRevision.EVMC_CONSTANTINOPLE2, base))
+        .should.throw();
+  });
+
+  it('should destroy the EVM', async () => {
+    base.release();
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
+
+describe('Try EVM transaction streams', () => {
+  class PrefetchingEVM extends TestEVM {
+    prefetched: bigint[] = [];
+
+    async getBalance(account: bigint) {
+      this.prefetched.push(account);
+      return BALANCE_BALANCE;
+    }
+
+    async getCodeSize(account: bigint) {
+      if (account === CODE_ACCOUNT) {
+        return BigInt(CODE_CODE.length);
+      }
+      return super.getCodeSize(account);
+    }
+  }
+
+  const returnCode = (value: number) => Buffer.from(
+      evmasm.compile(`
+      mstore(0, ${value})
+      return(0, 32)
+    `),
+      'hex');
+  let evm: PrefetchingEVM;
+
+  it('should execute a stream in order', async () => {
+    evm = new PrefetchingEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+    async function* transactions() {
+      for (let i = 0; i < 4; i++) {
+        yield {message: EVM_MESSAGE, code: returnCode(i)};
+      }
+    }
+    const outputs: number[] = [];
+    for await (const result of evm.executeStream(
+        transactions(), {lookahead: 2})) {
+      result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+      outputs.push(result.outputData[31]);
+    }
+    outputs.should.deep.equal([0, 1, 2, 3]);
+    evm.prefetched.length.should.equal(8);
+  });
+
+  it('should fetch missing code of the destination', async () => {
+    const results = [];
+    for await (const result of evm.executeStream([{
+      message: {...EVM_MESSAGE, destination: CODE_ACCOUNT},
+      accessList: [{address: BALANCE_ACCOUNT, storageKeys: [STORAGE_ADDRESS]}]
+    }])) {
+      results.push(result);
+    }
+    results.length.should.equal(1);
+    // The fetched code starts with an undefined instruction.
+    results[0].statusCode.should.equal(
+        EvmcStatusCode.EVMC_UNDEFINED_INSTRUCTION);
+  });
+
+  it('should run code changed earlier in the stream', async () => {
+    // The first transaction deploys new code to the destination of the
+    // second, whose code is prefetched while the first runs.
+    class DeployingEVM extends TestEVM {
+      deployed = returnCode(1);
+
+      async getCodeSize(account: bigint) {
+        return BigInt(this.deployed.length);
+      }
+
+      async copyCode(account: bigint, offset: number, length: number) {
+        return this.deployed.slice(offset, offset + length);
+      }
+
+      async setStorage(account: bigint, key: bigint, val: bigint) {
+        this.deployed = returnCode(2);
+        return EvmcStorageStatus.EVMC_STORAGE_ADDED;
+      }
+    }
+    const deployingEvm = new DeployingEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+    const deploy = Buffer.from(evmasm.compile(`sstore(1, 1) stop`), 'hex');
+    const outputs: number[] = [];
+    for await (const result of deployingEvm.executeStream(
+        [{message: EVM_MESSAGE, code: deploy}, {message: EVM_MESSAGE}],
+        {lookahead: 2})) {
+      result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+      outputs.push(result.outputData.length === 0 ? 0 : result.outputData[31]);
+    }
+    outputs.should.deep.equal([0, 2]);
+    deployingEvm.release();
+  });
+
+  it('should stop taking transactions when the consumer stops', async () => {
+    let taken = 0;
+    function* transactions() {
+      for (;;) {
+        taken++;
+        yield {message: EVM_MESSAGE, code: returnCode(1)};
+      }
+    }
+    for await (const result of evm.executeStream(
+        transactions(), {lookahead: 1})) {
+      result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+      break;
+    }
+    taken.should.be.lessThan(4);
+  });
+
+  it('should destroy the EVM', async () => {
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
+
+describe('Try EVM completion batching', () => {
+  let evm: TestEVM;
+
+  it('should resolve concurrent executions in batches', async () => {
+    evm = new TestEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+    const results = await Promise.all(Array.from(
+        {length: 256}, () => evm.execute(EVM_MESSAGE, Buffer.from([0x00]))));
+    for (const result of results) {
+      result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+    }
+    const stats = evm.completionStats;
+    stats.completions.should.equal(256);
+    stats.batches.should.be.at.most(256);
+    stats.largestBatch.should.be.at.most(64);
+    stats.histogram.reduce((sum, batches) => sum + batches, 0)
+        .should.equal(stats.batches);
+  });
+
+  it('should destroy the EVM', async () => {
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
+
+describe('Try EVM scheduling', () => {
+  const LOW = {priority: EvmcPriority.EVMC_PRIORITY_LOW};
+  let evm: TestEVM;
+
+  it('should run executions by priority', async () => {
+    evm = new TestEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+    const result = await evm.execute(
+        EVM_MESSAGE, Buffer.from([0x00]), undefined, undefined,
+        {priority: EvmcPriority.EVMC_PRIORITY_HIGH});
+    result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+    evm.schedulerStats[EvmcPriority.EVMC_PRIORITY_HIGH].started.should.equal(
+        1);
+  });
+
+  it('should refuse executions beyond a full queue', async () => {
+    evm.useSchedulerLimits(
+        {maxRunning: 1, priorities: [{}, {}, {maxQueued: 1}]});
+    const running = [
+      evm.execute(EVM_MESSAGE, Buffer.from([0x00]), undefined, undefined, LOW),
+      evm.execute(EVM_MESSAGE, Buffer.from([0x00]), undefined, undefined, LOW)
+    ];
+    (() => evm.execute(
+         EVM_MESSAGE, Buffer.from([0x00]), undefined, undefined, LOW))
+        .should.throw();
+    await Promise.all(running);
+    evm.schedulerStats[EvmcPriority.EVMC_PRIORITY_LOW].rejected.should.equal(
+        1);
+  });
+
+  it('should drop executions whose deadline has passed', async () => {
+    const running =
+        evm.execute(EVM_MESSAGE, Buffer.from([0x00]), undefined, undefined);
+    let error: NodeJS.ErrnoException|undefined;
+    try {
+      await evm.execute(
+          EVM_MESSAGE, Buffer.from([0x00]), undefined, undefined,
+          {deadline: 0});
+    } catch (e) {
+      error = e;
+    }
+    await running;
+    error!.code!.should.equal('ETIMEDOUT');
+    evm.schedulerStats[EvmcPriority.EVMC_PRIORITY_NORMAL].expired.should.equal(
+        1);
+  });
+
+  it('should destroy the EVM', async () => {
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
+
+describe('Try EVM execution arenas', () => {
+  let evm: TestEVM;
+
+  it('should recycle execution memory', async () => {
+    evm = new TestEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+    const before = Evmc.arenaStats;
+    for (let i = 0; i < 10; i++) {
+      const result = await evm.execute(EVM_MESSAGE, Buffer.from([0x00]));
+      result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+    }
+    const after = Evmc.arenaStats;
+    (after.arenas - before.arenas).should.be.at.most(1);
+    (after.reuses - before.reuses).should.be.at.least(9);
+    after.reserved.should.be.greaterThan(0);
+  });
+
+  it('should destroy the EVM', async () => {
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
+
+describe('Try EVM result objects', () => {
+  let evm: TestEVM;
+
+  it('should materialize result fields on access', async () => {
+    evm = new TestEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+    // PUSH1 0x2a PUSH1 0 MSTORE PUSH1 0x20 PUSH1 0 RETURN
+    const result = await evm.execute(
+        EVM_MESSAGE, Buffer.from('602a60005260206000f3', 'hex'));
+    result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+    result.outputData.length.should.equal(32);
+    result.outputData[31].should.equal(0x2a);
+    result.outputData.should.equal(result.outputData);
+    Object.keys(result).should.be.empty;
+  });
+
+  it('should destroy the EVM', async () => {
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
+
+class ContextEVM extends TestEVM {
+  ids = new Set<number>();
+
+  async getStorage(account: bigint, key: bigint, execution?: EvmcExecution) {
+    this.ids.add(execution!.id);
+    return execution!.context as bigint;
+  }
+}
+
+describe('Try EVM execution contexts', () => {
+  let evm: ContextEVM;
+
+  it('should pass each execution its own context', async () => {
+    evm = new ContextEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+    // PUSH1 0 SLOAD PUSH1 0 MSTORE PUSH1 0x20 PUSH1 0 RETURN
+    const code = Buffer.from('60005460005260206000f3', 'hex');
+    const results = await Promise.all([1n, 2n, 3n].map(
+        context => evm.execute(
+            EVM_MESSAGE, code, EvmcRevision.EVMC_PETERSBURG, undefined, {},
+            {context})));
+    results.map(result => result.outputData[31])
+        .should.deep.equal([1, 2, 3]);
+    evm.ids.size.should.equal(3);
+  });
+
+  it('should run with the transaction context of the execution', async () => {
+    // NUMBER PUSH1 0 MSTORE PUSH1 0x20 PUSH1 0 RETURN
+    const result = await evm.execute(
+        EVM_MESSAGE, Buffer.from('4360005260206000f3', 'hex'),
+        EvmcRevision.EVMC_PETERSBURG, undefined, {}, {
+          txContext: {
+            txGasPrice: TX_GASPRICE,
+            txOrigin: TX_ORIGIN,
+            blockCoinbase: BLOCK_COINBASE,
+            blockNumber: 42n,
+            blockTimestamp: BLOCK_TIMESTAMP,
+            blockGasLimit: BLOCK_GASLIMIT,
+            blockDifficulty: BLOCK_DIFFICULTY
+          }
+        });
+    result.outputData[31].should.equal(42);
+  });
+
+  it('should destroy the EVM', async () => {
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
+
+describe('Try EVM on a worker', () => {
+  let evm: EvmcWorker;
+  const hostModule = path.join(os.tmpdir(), `evmc-host-${process.pid}.js`);
+
+  it('should run callbacks on the worker', async () => {
+    // The host answers storage reads with the id of the thread it runs on.
+    fs.writeFileSync(hostModule, `
+      const {threadId} = require('worker_threads');
+      const {Evmc} = require(${JSON.stringify(path.join(__dirname, 'evmc'))});
+      module.exports = class extends Evmc {
+        getAccountExists() { return true; }
+        getStorage() { return BigInt(threadId); }
+        setStorage() { return 0; }
+        getBalance() { return 0n; }
+        getCodeSize() { return 0n; }
+        getCodeHash() { return 0n; }
+        copyCode() { return Buffer.alloc(0); }
+        selfDestruct() {}
+        call() { throw new Error('Unexpected call'); }
+        getTxContext() { throw new Error('Unexpected getTxContext'); }
+        getBlockHash() { return 0n; }
+        emitLog() {}
+      };`);
+    evm = new EvmcWorker(
+        hostModule,
+        path.join(
+            __dirname,
+            `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+                getDynamicLibraryExtension()}`));
+    // PUSH1 0 SLOAD PUSH1 0 MSTORE PUSH1 0x20 PUSH1 0 RETURN
+    const result = await evm.execute(
+        EVM_MESSAGE, Buffer.from('60005460005260206000f3', 'hex'),
+        EvmcRevision.EVMC_PETERSBURG);
+    result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+    result.outputData.readUInt32BE(28).should.not.equal(threadId);
+  });
+
+  it('should destroy the EVM', async () => {
+    evm.release();
+    evm.released.should.be.true;
+    fs.unlinkSync(hostModule);
+  });
+});
+
+describe('Try EVM host call handoff', () => {
+  let evm: TestEVM;
+
+  it('should answer host calls while spinning', async () => {
+    evm = new TestEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+    evm.useHandoffSpin(20000);
+    const before = Evmc.handoffStats;
+    // PUSH1 0x42 SLOAD PUSH1 0 MSTORE PUSH1 0x20 PUSH1 0 RETURN
+    const result = await evm.execute(
+        EVM_MESSAGE, Buffer.from('60425460005260206000f3', 'hex'),
+        EvmcRevision.EVMC_PETERSBURG);
+    result.outputData.readUInt32BE(28).should.equal(Number(STORAGE_VALUE));
+    (Evmc.handoffStats.waits - before.waits).should.equal(1);
+  });
+
+  it('should destroy the EVM', async () => {
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
+
+describe('Try EVM profiler', () => {
+  let evm: TestEVM;
+  // PUSH1 0x42 SLOAD PUSH1 0 MSTORE PUSH1 0x20 PUSH1 0 RETURN
+  const code = Buffer.from('60425460005260206000f3', 'hex');
+
+  it('should count executions per contract', async () => {
+    evm = new TestEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+    evm.useProfiler(16);
+    let gasUsed = 0n;
+    for (let i = 0; i < 3; i++) {
+      const result =
+          await evm.execute(EVM_MESSAGE, code, EvmcRevision.EVMC_PETERSBURG);
+      gasUsed += EVM_MESSAGE.gas - result.gasLeft;
+    }
+    const profile = evm.profile(10, EvmcProfileOrder.EVMC_PROFILE_BY_GAS);
+    profile.untracked.should.equal(0);
+    profile.contracts.length.should.equal(1);
+    const contract = profile.contracts[0];
+    contract.codeSize.should.equal(code.length);
+    contract.executions.should.equal(3);
+    contract.gasUsed.should.equal(gasUsed);
+    contract.hostCalls.getStorage.should.equal(3);
+    contract.hostCalls.setStorage.should.equal(0);
+  });
+
+  it('should fail to report when disabled', async () => {
+    evm.useProfiler(0);
+    (() => evm.profile()).should.throw();
+  });
+
+  it('should destroy the EVM', async () => {
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
+
+describe('Try EVM transactions', () => {
+  // PUSH1 0x42 SLOAD PUSH1 0 MSTORE PUSH1 0x20 PUSH1 0 RETURN
+  const code = Buffer.from('60425460005260206000f3', 'hex');
+
+  class TransactionEVM extends TestEVM {
+    balances = new Map<bigint, bigint>([[TX_ORIGIN, 10n ** 18n]]);
+
+    balanceOf(account: bigint) {
+      return this.balances.get(account) || 0n;
+    }
+
+    async getBalance(account: bigint) {
+      return this.balanceOf(account);
+    }
+
+    async getCodeSize(account: bigint) {
+      return account === TX_DESTINATION ? BigInt(code.length) : 0n;
+    }
+
+    async copyCode(account: bigint, offset: number, length: number) {
+      return code.slice(offset, offset + length);
+    }
+
+    transfer(from: bigint|undefined, to: bigint|undefined, value: bigint) {
+      if (from !== undefined) {
+        this.balances.set(from, this.balanceOf(from) - value);
+      }
+      if (to !== undefined) {
+        this.balances.set(to, this.balanceOf(to) + value);
+      }
+    }
+  }
+
+  let evm: TransactionEVM;
+  const transaction = {
+    sender: TX_ORIGIN,
+    to: TX_DESTINATION,
+    nonce: 0n,
+    value: 5n,
+    gasLimit: TX_GAS,
+    gasPrice: TX_GASPRICE,
+    data: Buffer.from([])
+  };
+
+  it('should execute a transaction and pay for it', async () => {
+    evm = new TransactionEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+    const receipt = await evm.executeTransaction(
+        transaction, EvmcRevision.EVMC_PETERSBURG);
+    receipt.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+    receipt.outputData.readUInt32BE(28).should.equal(Number(STORAGE_VALUE));
+    receipt.logs.length.should.equal(0);
+    (receipt.gasUsed > 21000n).should.be.true;
+    receipt.fee.should.equal(receipt.gasUsed * TX_GASPRICE);
+    evm.balanceOf(BLOCK_COINBASE).should.equal(receipt.fee);
+    evm.balanceOf(TX_DESTINATION).should.equal(5n);
+    evm.balanceOf(TX_ORIGIN).should.equal(10n ** 18n - 5n - receipt.fee);
+  });
+
+  it('should buy the gas before the message runs', async () => {
+    // PUSH20 TX_ORIGIN BALANCE PUSH1 0 MSTORE PUSH1 0x20 PUSH1 0 RETURN
+    const balanceCode = Buffer.from(
+        `73${TX_ORIGIN.toString(16).padStart(40, '0')}3160005260206000f3`,
+        'hex');
+    class BalanceEVM extends TransactionEVM {
+      async getCodeSize(account: bigint) {
+        return account === TX_DESTINATION ? BigInt(balanceCode.length) : 0n;
+      }
+
+      async copyCode(account: bigint, offset: number, length: number) {
+        return balanceCode.slice(offset, offset + length);
+      }
+    }
+    const balanceEvm = new BalanceEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+    const receipt = await balanceEvm.executeTransaction(
+        transaction, EvmcRevision.EVMC_PETERSBURG);
+    receipt.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+    BigInt(`0x${receipt.outputData.toString('hex')}`)
+        .should.equal(10n ** 18n - 5n - TX_GAS * TX_GASPRICE);
+    balanceEvm.balanceOf(TX_ORIGIN).should.equal(10n ** 18n - 5n - receipt.fee);
+    balanceEvm.balanceOf(BLOCK_COINBASE).should.equal(receipt.fee);
+    balanceEvm.release();
+  });
+
+  it('should drop the writes of a create which cannot deposit', async () => {
+    // Returns more code than a contract may have.
+    const init = Buffer.from(
+        evmasm.compile(`
+        sstore(${STORAGE_ADDRESS}, ${STORAGE_VALUE})
+        return(0, 24577)
+      `),
+        'hex');
+    const writeSet = new EvmcWriteSet();
+    const receipt = await evm.executeTransaction(
+        {
+          sender: TX_ORIGIN,
+          nonce: 1n,
+          value: 0n,
+          gasLimit: 1000000n,
+          gasPrice: TX_GASPRICE,
+          data: init
+        },
+        EvmcRevision.EVMC_PETERSBURG, {}, {writeSet});
+    receipt.statusCode.should.equal(EvmcStatusCode.EVMC_OUT_OF_GAS);
+    should.not.exist(receipt.createAddress);
+    writeSet.size.should.equal(0);
+    writeSet.release();
+  });
+
+  it('should reject a transaction the sender cannot pay for', async () => {
+    let error: NodeJS.ErrnoException|undefined;
+    try {
+      await evm.executeTransaction(
+          {...transaction, value: 10n ** 18n}, EvmcRevision.EVMC_PETERSBURG);
+    } catch (e) {
+      error = e;
+    }
+    should.exist(error);
+    error!.code!.should.equal('EINVALIDTX');
+  });
+
+  it('should destroy the EVM', async () => {
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
+
+describe('Try EVM stateless witness', () => {
+  // PUSH1 0x42 SLOAD PUSH1 0 MSTORE PUSH1 0x20 PUSH1 0 RETURN
+  const code = Buffer.from('60425460005260206000f3', 'hex');
+  // The state trie of TX_DESTINATION, running code with slot 0x42 set to
+  // 0x99, and TX_ORIGIN, followed by the storage trie of TX_DESTINATION.
+  const stateRoot =
+      0x79619783f1268b793cc5d28278d02cbd0e6246b56221d39bb02a055643c90dffn;
+  const stateNodes = [
+    'e215a0ad30c53248d50699ccebb025a8e150959de121fcb3c62ced40a01a1aacc1d98c',
+    'f851808080a06f49f97aafeb30117974a8de882cca764f193781ee0fc4c49070b93d64' +
+        '0213578080808080a0ea615d6e8249056508f94b48985bb9a1d4e30ac31b5822d1d1' +
+        '504d332600b5ee80808080808080',
+    'f86fa020111b87fc297a83b7dc55fe4a7988125ca9282cb30b7bd3e8ed56ca810d9dd9' +
+        'b84cf84a0186abcdef123455a0320a1a58d7d2e523f434035713aaa0088c4b7180b1' +
+        'aedbd05e32b431c56a2679a062647045d7f53f8c51ae4c0d68d1a005301afc7e9354' +
+        '1f710cc50ccd0e72ca3f',
+    'f871a020e7449aaced683b3ca8826910182e66444f16da575d9751b28a59f44e70d0b1' +
+        'b84ef84c80880de0b6b3a7640000a056e81f171bcc55a6ff8345e692c0f86e5b48e0' +
+        '1b996cadc001622fb5e363b421a0c5d2460186f7233c927e7db2dcc703c0e500b653' +
+        'ca82273b7bfad8045d85a470'
+  ].map(node => Buffer.from(node, 'hex'));
+  const storageNodes = [Buffer.from(
+      'e5a12038dfe4635b27babeca8be38d3b448cb5161a639b899a14825ba9c8d7892eb8c3' +
+          '828199',
+      'hex')];
+
+  let evm: TestEVM;
+  let witness: EvmcWitness;
+
+  it('should index a witness', async () => {
+    evm = new TestEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+    witness =
+        new EvmcWitness(stateRoot, [...stateNodes, ...storageNodes], [code]);
+    witness.info.nodeCount.should.equal(5);
+    witness.info.codeCount.should.equal(1);
+  });
+
+  it('should read storage from the witness', async () => {
+    const result = await evm.execute(
+        EVM_MESSAGE, code, EvmcRevision.EVMC_PETERSBURG, undefined, {},
+        {witness});
+    result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+    result.outputData.readUInt32BE(28).should.equal(0x99);
+  });
+
+  it('should fail on a missing proof', async () => {
+    const partial = new EvmcWitness(stateRoot, stateNodes, [code]);
+    let error: NodeJS.ErrnoException|undefined;
+    try {
+      await evm.execute(
+          EVM_MESSAGE, code, EvmcRevision.EVMC_PETERSBURG, undefined, {},
+          {witness: partial});
+    } catch (e) {
+      error = e;
+    }
+    partial.release();
+    should.exist(error);
+    error!.code!.should.equal('EWITNESS');
+    error!.message.should.match(/^No proof of storage slot 0x0+42 of account/);
+  });
+
+  it('should reject a node which is not an RLP list', async () => {
+    (() => new EvmcWitness(stateRoot, [Buffer.from([0x80])])).should.throw();
+  });
+
+  it('should destroy the EVM', async () => {
+    witness.release();
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
+
+describe('Try EVM write set commitment', () => {
+  // PUSH1 7 PUSH1 0x42 SSTORE STOP
+  const code = Buffer.from('600760425500', 'hex');
+  // PUSH1 9 PUSH1 0x42 SSTORE PUSH1 0 PUSH1 0 REVERT
+  const revertCode = Buffer.from('600960425560006000fd', 'hex');
+  // The witness of the stateless witness test, with slot 0x42 of
+  // TX_DESTINATION set to 0x99.
+  const stateRoot =
+      0x79619783f1268b793cc5d28278d02cbd0e6246b56221d39bb02a055643c90dffn;
+  const nodes = [
+    'e215a0ad30c53248d50699ccebb025a8e150959de121fcb3c62ced40a01a1aacc1d98c',
+    'f851808080a06f49f97aafeb30117974a8de882cca764f193781ee0fc4c49070b93d64' +
+        '0213578080808080a0ea615d6e8249056508f94b48985bb9a1d4e30ac31b5822d1d1' +
+        '504d332600b5ee80808080808080',
+    'f86fa020111b87fc297a83b7dc55fe4a7988125ca9282cb30b7bd3e8ed56ca810d9dd9' +
+        'b84cf84a0186abcdef123455a0320a1a58d7d2e523f434035713aaa0088c4b7180b1' +
+        'aedbd05e32b431c56a2679a062647045d7f53f8c51ae4c0d68d1a005301afc7e9354' +
+        '1f710cc50ccd0e72ca3f',
+    'f871a020e7449aaced683b3ca8826910182e66444f16da575d9751b28a59f44e70d0b1' +
+        'b84ef84c80880de0b6b3a7640000a056e81f171bcc55a6ff8345e692c0f86e5b48e0' +
+        '1b996cadc001622fb5e363b421a0c5d2460186f7233c927e7db2dcc703c0e500b653' +
+        'ca82273b7bfad8045d85a470',
+    'e5a12038dfe4635b27babeca8be38d3b448cb5161a639b899a14825ba9c8d7892eb8c3' +
+        '828199'
+  ].map(node => Buffer.from(node, 'hex'));
+  // After slot 0x42 is set to 7, and TX_ORIGIN pays 1 wei with nonce 1.
+  const newStateRoot =
+      0xad43d1b9384b076383dc25256fae7df78804ad47f228d4a0c502c790b753c694n;
+  const newStorageRoot =
+      0x8e34a72913f2172ebc19a5f4f29d76e8cda9d93c502d5a09b275e43884373cbbn;
+
+  let evm: TestEVM;
+  let witness: EvmcWitness;
+  let writeSet: EvmcWriteSet;
+
+  it('should journal the writes of an execution', async () => {
+    evm = new TestEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+    witness = new EvmcWitness(stateRoot, nodes);
+    writeSet = new EvmcWriteSet();
+    const result = await evm.execute(
+        EVM_MESSAGE, code, EvmcRevision.EVMC_PETERSBURG, undefined, {},
+        {writeSet});
+    result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+    writeSet.size.should.equal(1);
+  });
+
+  it('should drop the writes of a failed execution', async () => {
+    const result = await evm.execute(
+        EVM_MESSAGE, revertCode, EvmcRevision.EVMC_PETERSBURG, undefined, {},
+        {writeSet});
+    result.statusCode.should.equal(EvmcStatusCode.EVMC_REVERT);
+    writeSet.size.should.equal(1);
+  });
+
+  it('should commit the writes to the witness', async () => {
+    writeSet.updateAccount(TX_ORIGIN, {nonce: 1n, balance: 10n ** 18n - 1n});
+    const commitment = await evm.commit(writeSet, witness);
+    commitment.stateRoot.should.equal(newStateRoot);
+    commitment.accounts.length.should.equal(2);
+    commitment.accounts[0].address.should.equal(TX_DESTINATION);
+    commitment.accounts[0].storageRoot.should.equal(newStorageRoot);
+    commitment.accounts[1].exists.should.be.true;
+    // The new storage root, both account leaves, and the branch and the
+    // extension above them.
+    commitment.nodes.length.should.equal(5);
+  });
+
+  it('should fail on a missing proof', async () => {
+    const partial = new EvmcWitness(stateRoot, nodes.slice(0, 4));
+    let error: NodeJS.ErrnoException|undefined;
+    try {
+      await evm.commit(writeSet, partial);
+    } catch (e) {
+      error = e;
+    }
+    partial.release();
+    should.exist(error);
+    error!.code!.should.equal('EWITNESS');
+    error!.message.should.match(/^No proof of storage slot 0x0+42 of account/);
+  });
+
+  it('should destroy the EVM', async () => {
+    writeSet.release();
+    witness.release();
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
+
+describe('Try EVM abort', () => {
+  // PUSH1 0x42 SLOAD PUSH1 0 MSTORE PUSH1 0x20 PUSH1 0 RETURN
+  const code = Buffer.from('60425460005260206000f3', 'hex');
+
+  class StuckEVM extends TestEVM {
+    async getStorage(account: bigint, key: bigint) {
+      return new Promise<bigint>(() => {});
+    }
+  }
+
+  class TestAbortSignal implements EvmcAbortSignal {
+    aborted = false;
+    listeners: Array<() => void> = [];
+
+    addEventListener(type: 'abort', listener: () => void) {
+      this.listeners.push(listener);
+    }
+
+    removeEventListener(type: 'abort', listener: () => void) {
+      this.listeners = this.listeners.filter(l => l !== listener);
+    }
+
+    abort() {
+      this.aborted = true;
+      this.listeners.forEach(listener => listener());
+    }
+  }
+
+  let evm: StuckEVM;
+
+  const rejection = async (execution: Promise<unknown>) => {
+    let error: NodeJS.ErrnoException|undefined;
+    try {
+      await execution;
+    } catch (e) {
+      error = e;
+    }
+    should.exist(error);
+    return error!;
+  };
+
+  it('should abort an execution waiting on a callback', async () => {
+    evm = new StuckEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+    const signal = new TestAbortSignal();
+    const execution = evm.execute(
+        EVM_MESSAGE, code, EvmcRevision.EVMC_PETERSBURG, undefined, {},
+        {signal});
+    setTimeout(() => signal.abort(), 10);
+    const error = await rejection(execution);
+    error.code!.should.equal('ECANCELED');
+    signal.listeners.length.should.equal(0);
+    evm.schedulerStats[EvmcPriority.EVMC_PRIORITY_NORMAL].aborted.should.equal(
+        1);
+  });
+
+  it('should abort an execution which times out', async () => {
+    const error = await rejection(evm.execute(
+        EVM_MESSAGE, code, EvmcRevision.EVMC_PETERSBURG, undefined, {},
+        {timeout: 10}));
+    error.code!.should.equal('ECANCELED');
+  });
+
+  it('should not run an execution aborted before it starts', async () => {
+    const signal = new TestAbortSignal();
+    signal.abort();
+    const error = await rejection(evm.execute(
+        EVM_MESSAGE, code, EvmcRevision.EVMC_PETERSBURG, undefined, {},
+        {signal}));
+    error.code!.should.equal('ECANCELED');
+  });
+
+  it('should destroy the EVM', async () => {
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
+
+describe('Try EVM continuations', () => {
+  // mocha runs without --expose-gc, so collecting an EVM needs gc exposed here.
+  v8.setFlagsFromString('--expose-gc');
+  const gc: () => void = vm.runInNewContext('gc');
+
+  // PUSH1 0x42 SLOAD PUSH1 0 MSTORE PUSH1 0x20 PUSH1 0 RETURN
+  const code = Buffer.from('60425460005260206000f3', 'hex');
+
+  class PendingEVM extends TestEVM {
+    pending = false;
+    settle: Array<() => void> = [];
+
+    async getStorage(account: bigint, key: bigint) {
+      if (!this.pending) {
+        return super.getStorage(account, key);
+      }
+      return new Promise<bigint>(
+          resolve => this.settle.push(() => resolve(STORAGE_VALUE)));
+    }
+  }
+
+  const createEvm = () => new PendingEVM(path.join(
+      __dirname,
+      `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+          getDynamicLibraryExtension()}`));
+
+  let evm: PendingEVM;
+
+  it('should reuse continuations across executions', async () => {
+    evm = createEvm();
+    for (let i = 0; i < 8; i++) {
+      const result = await evm.execute(EVM_MESSAGE, code);
+      result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+      BigInt(`0x${result.outputData.toString('hex')}`)
+          .should.equal(STORAGE_VALUE);
+    }
+  });
+
+  it('should settle a promise after its aborted EVM is collected', async () => {
+    const abandon = async () => {
+      const pendingEvm = createEvm();
+      pendingEvm.pending = true;
+      let error: NodeJS.ErrnoException|undefined;
+      try {
+        await pendingEvm.execute(
+            EVM_MESSAGE, code, EvmcRevision.EVMC_PETERSBURG, undefined, {},
+            {timeout: 10});
+      } catch (e) {
+        error = e;
+      }
+      error!.code!.should.equal('ECANCELED');
+      pendingEvm.release();
+      return pendingEvm.settle;
+    };
+    const settle = await abandon();
+    settle.length.should.equal(1);
+    for (let i = 0; i < 4; i++) {
+      gc();
+      await new Promise(resolve => setImmediate(resolve));
+    }
+    settle.forEach(s => s());
+    await new Promise(resolve => setTimeout(resolve, 10));
+  });
+
+  it('should destroy the EVM', async () => {
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
+
+describe('Try EVM result cache', () => {
+  class CountingEVM extends TestEVM {
+    storageCalls = 0;
+
+    async getStorage(account: bigint, key: bigint) {
+      this.storageCalls++;
+      return super.getStorage(account, key);
+    }
+  }
+
+  // PUSH1 0x42 SLOAD PUSH1 0 MSTORE PUSH1 0x20 PUSH1 0 RETURN
+  const code = Buffer.from('60425460005260206000f3', 'hex');
+  const staticMessage = {...EVM_MESSAGE, flags: evmc_flags.EVMC_STATIC};
+  let evm: CountingEVM;
+
+  it('should be created with a cache', () => {
+    evm = new CountingEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+    evm.useResultCache(1024 * 1024);
+    evm.resultCacheStats.budget.should.equal(1024 * 1024);
+  });
+
+  it('should answer repeated static executions from the cache', async () => {
+    for (let i = 0; i < 3; i++) {
+      const result = await evm.execute(staticMessage, code);
+      result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+      BigInt(`0x${result.outputData.toString('hex')}`)
+          .should.equal(STORAGE_VALUE);
+    }
+    evm.storageCalls.should.equal(1);
+    evm.resultCacheStats.hits.should.equal(2);
+    evm.resultCacheStats.misses.should.equal(1);
+  });
+
+  it('should not cache executions which are not static', async () => {
+    await evm.execute(EVM_MESSAGE, code);
+    evm.storageCalls.should.equal(2);
+  });
+
+  it('should run again after invalidation', async () => {
+    evm.invalidateAccounts([TX_DESTINATION]);
+    await evm.execute(staticMessage, code);
+    evm.storageCalls.should.equal(3);
+
+    evm.invalidateAll();
+    await evm.execute(staticMessage, code);
+    evm.storageCalls.should.equal(4);
+    evm.resultCacheStats.stale.should.equal(1);
+  });
+
+  it('should destroy the EVM', async () => {
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
+
+describe('Try EVM BigInt interning', () => {
+  class KeyEVM extends TestEVM {
+    keys: bigint[] = [];
+
+    async getStorage(account: bigint, key: bigint) {
+      this.keys.push(key);
+      return super.getStorage(account, key);
+    }
+  }
+
+  // PUSH1 0x42 SLOAD PUSH1 0 MSTORE PUSH1 0x20 PUSH1 0 RETURN
+  const code = Buffer.from('60425460005260206000f3', 'hex');
+  let evm: KeyEVM;
+
+  it('should reuse BigInts of repeated arguments', async () => {
+    evm = new KeyEVM(path.join(
+        __dirname,
+        `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+            getDynamicLibraryExtension()}`));
+    evm.internStats.capacity.should.be.greaterThan(0);
+    for (let i = 0; i < 3; i++) {
+      const result = await evm.execute(EVM_MESSAGE, code);
+      result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+    }
+    evm.keys.should.deep.equal([STORAGE_ADDRESS, STORAGE_ADDRESS, STORAGE_ADDRESS]);
+    // The address and key of the first read are created, the others reused.
+    evm.internStats.misses.should.equal(2);
+    evm.internStats.hits.should.equal(4);
+  });
+
+  it('should create every BigInt without interning', async () => {
+    evm.useInterning(0);
+    evm.internStats.capacity.should.equal(0);
+    await evm.execute(EVM_MESSAGE, code);
+    evm.internStats.misses.should.equal(4);
+    evm.internStats.hits.should.equal(4);
+  });
+
+  it('should destroy the EVM', async () => {
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
+
+describe('Try EVM prewarm', () => {
+  const alethPath = path.join(
+      __dirname,
+      `../libbuild/aleth/libaleth-interpreter/libaleth-interpreter.${
+          getDynamicLibraryExtension()}`);
+  let evm: TestEVM;
+
+  it('should load instances and start threads ahead of time', async () => {
+    const stats = await Evmc.prewarm(alethPath, {instances: 2, threads: 2});
+    stats.pooled.should.be.at.least(2);
+    stats.threads.should.be.at.least(1);
+  });
+
+  it('should execute on a prewarmed instance', async () => {
+    evm = new TestEVM(alethPath);
+    const result = await evm.execute(
+        EVM_MESSAGE, Buffer.from('60425460005260206000f3', 'hex'));
+    result.statusCode.should.equal(EvmcStatusCode.EVMC_SUCCESS);
+  });
+
+  it('should reject if the VM cannot be loaded', async () => {
+    let error: Error|undefined;
+    try {
+      await Evmc.prewarm(path.join(__dirname, 'missing-vm'), {instances: 1});
+    } catch (e) {
+      error = e;
+    }
+    should.exist(error);
+  });
+
+  it('should destroy the EVM', async () => {
+    evm.release();
+    evm.released.should.be.true;
+  });
+});
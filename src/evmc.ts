@@ -1,4 +1,12 @@
+import {extname, join} from 'path';
+import {Worker} from 'worker_threads';
+
 type EvmcHandle = void;
+type EvmcSnapshotHandle = void;
+type EvmcStateViewHandle = void;
+type EvmcWitnessHandle = void;
+type EvmcWriteSetHandle = void;
+type EvmcAbortHandle = void;
 const evmc: EvmcBinding = require('bindings')('evmc');
 
 /**
@@ -212,7 +220,23 @@ export enum EvmcStorageStatus {
   EVMC_STORAGE_DELETED = 4
 }
 
+/**
+ * The class an execution is scheduled in. Executions of a higher class start
+ * before any queued execution of a lower one.
+ */
+export enum EvmcPriority {
+  /** Work which must not wait, such as building a block. */
+  EVMC_PRIORITY_HIGH = 0,
+  EVMC_PRIORITY_NORMAL = 1,
+  /** Best-effort work, such as serving eth_call. */
+  EVMC_PRIORITY_LOW = 2
+}
 
+/**
+ * Messages passed to the call callback share one native class, whose fields
+ * are converted on first access. They are accessors, so spreading a message
+ * copies nothing; read the fields needed instead.
+ */
 export interface EvmcMessage {
   gas: bigint;
   flags?: evmc_flags;
@@ -228,12 +252,29 @@ export interface EvmcExecutionParameters {
   revision: EvmcRevision;
   message: EvmcMessage;
   code: Buffer;
+  /** The state view to run on, if any. */
+  state?: EvmcStateViewHandle;
+  priority?: EvmcPriority;
+  /** Milliseconds from now after which the execution must not start. */
+  deadline?: number;
+  /** Passed to every callback of the execution. */
+  execution?: EvmcExecution;
+  txContext?: EvmcTxContext;
+  witness?: EvmcWitnessHandle;
+  writeSet?: EvmcWriteSetHandle;
+  abort?: EvmcAbortHandle;
 }
 
+/**
+ * Results of executions share one native class, like messages passed to the
+ * call callback, so their fields are accessors as well.
+ */
 export interface EvmcResult {
   statusCode: EvmcStatusCode;
   gasLeft: bigint;
+  /** Created on first access, and the same Buffer after that. */
   outputData: Buffer;
+  /** Only set if the execution succeeded. */
   createAddress: bigint;
 }
 
@@ -248,15 +289,560 @@ export interface EvmcTxContext {
   blockDifficulty: bigint; /** The block difficulty. */
 }
 
+/** An account to be written into an [[EvmcSnapshot]]. */
+export interface EvmcSnapshotAccount {
+  address: bigint;
+  balance: bigint;
+  /**
+   * The keccak256 hash of the code. Accounts with the same code hash share a
+   * single copy of the code in the snapshot.
+   */
+  codeHash: bigint;
+  code: Buffer;
+  storage: Map<bigint, bigint>;
+}
+
+/** Sizes of an [[EvmcWitness]]. */
+export interface EvmcWitnessInfo {
+  /** Distinct trie nodes. */
+  nodeCount: number;
+  /** Distinct codes. */
+  codeCount: number;
+}
+
+/** Fields of an account to write, see [[EvmcWriteSet.updateAccount]]. */
+export interface EvmcAccountUpdate {
+  nonce?: bigint;
+  balance?: bigint;
+  codeHash?: bigint;
+}
+
+/** An account after the writes of an [[EvmcCommitment]]. */
+export interface EvmcCommittedAccount {
+  address: bigint;
+  /**
+   * False if the account was deleted, or if the writes to an account which did
+   * not exist left it empty.
+   */
+  exists: boolean;
+  storageRoot: bigint;
+}
+
+/** The tries after the writes of an [[EvmcWriteSet]], see [[Evmc.commit]]. */
+export interface EvmcCommitment {
+  stateRoot: bigint;
+  /** The accounts written, ordered by address. */
+  accounts: EvmcCommittedAccount[];
+  /**
+   * The RLP of every new node referred to by hash, of the storage tries and
+   * then of the state trie, whose root node is last unless nothing changed.
+   */
+  nodes: Buffer[];
+}
+
+/** Sizes of a mapped [[EvmcSnapshot]]. */
+export interface EvmcSnapshotInfo {
+  accountCount: number;
+  slotCount: number;
+  /** Size of the deduplicated code section, in bytes. */
+  codeSize: number;
+  /** Size of the mapped file, in bytes. */
+  mappedSize: number;
+}
+
+/** Counters of the account metadata cache of an [[Evmc]]. */
+export interface EvmcAccountCacheStats {
+  /** Queries answered from the cache. */
+  hits: number;
+  /** Queries which were passed on to the callbacks. */
+  misses: number;
+  /** Fraction of queries answered from the cache. */
+  hitRate: number;
+  /** Accounts dropped to make room for others. */
+  evictions: number;
+  invalidations: number;
+  /** Accounts currently cached. */
+  entries: number;
+  /** Accounts which fit in the memory budget. */
+  capacity: number;
+  /** Bytes allocated by the cache. */
+  memoryUsage: number;
+}
+
+/** Counters of the static result cache of an [[Evmc]]. */
+export interface EvmcResultCacheStats {
+  /** Executions answered from the cache. */
+  hits: number;
+  /** Cacheable executions which ran, including those whose entry was stale. */
+  misses: number;
+  /** Fraction of cacheable executions answered from the cache. */
+  hitRate: number;
+  /** Entries dropped because something they read had changed. */
+  stale: number;
+  /** Executions not stored, as they called out or would not fit. */
+  uncacheable: number;
+  /** Entries dropped to make room for others. */
+  evictions: number;
+  invalidations: number;
+  /** Results currently cached. */
+  entries: number;
+  /** The memory budget, in bytes. */
+  budget: number;
+  /** Bytes held by the cache. */
+  memoryUsage: number;
+}
+
+/** Outcome of replaying a trace with [[Evmc.replay]]. */
+export interface EvmcReplayStats {
+  /** Executions in the trace. */
+  executions: number;
+  /** Host calls answered from the trace. */
+  hostCalls: number;
+  /** Executions which made different host calls than were recorded. */
+  divergences: number;
+  /** Executions whose result differed from the recorded one. */
+  mismatches: number;
+  /** Time spent executing, in nanoseconds. */
+  elapsedNs: bigint;
+}
+
+/** Outcome of [[Evmc.estimateGas]]. */
+export interface EvmcGasEstimate {
+  /** The lowest gas limit the execution succeeds with. */
+  gas: bigint;
+  /** The result of the execution with that gas limit. */
+  result: EvmcResult;
+}
+
+/** A VM which hot code is promoted to, see [[Evmc.useTiers]]. */
+export interface EvmcTier {
+  /** Path to the VM library. */
+  path: string;
+  /** Executions of the same code after which it runs on this VM. */
+  threshold: number;
+}
+
+/** Counters of one VM of an [[Evmc]]. */
+export interface EvmcVmStats {
+  path: string;
+  /** The threshold of the tier, or 0 for the base VM. */
+  threshold: number;
+  executions: number;
+  /** Executions the VM rejected, which ran on the tier below instead. */
+  rejections: number;
+  /** Contracts which have reached this tier. */
+  promotions: number;
+  /** Time spent executing, including host calls, in nanoseconds. */
+  elapsedNs: bigint;
+  /** Average time per execution, in nanoseconds. */
+  meanNs: number;
+}
+
+/** When to run an execution. */
+export interface EvmcSchedule {
+  /** The class to queue the execution in, EVMC_PRIORITY_NORMAL by default. */
+  priority?: EvmcPriority;
+  /**
+   * Milliseconds from now after which the execution is dropped if it has not
+   * started yet, failing with code ETIMEDOUT. No deadline by default.
+   */
+  deadline?: number;
+}
+
+/** Limits of one priority class, where 0 or leaving a limit out means none. */
+export interface EvmcPriorityLimits {
+  /** Executions of the class running at once. */
+  maxRunning?: number;
+  /** Executions of the class waiting to start, beyond which they fail. */
+  maxQueued?: number;
+}
+
+/** Limits of the scheduler, see [[Evmc.useSchedulerLimits]]. */
+export interface EvmcSchedulerLimits {
+  /** Executions running at once across all classes, 0 for no limit. */
+  maxRunning?: number;
+  /** Limits of each class, indexed by [[EvmcPriority]]. */
+  priorities?: EvmcPriorityLimits[];
+}
+
+/** Counters of one priority class. */
+export interface EvmcSchedulerStats {
+  priority: EvmcPriority;
+  /** Executions waiting to start. */
+  queued: number;
+  running: number;
+  started: number;
+  /** Executions dropped because their deadline passed before they started. */
+  expired: number;
+  /** Executions refused because the queue was full. */
+  rejected: number;
+  /** Executions aborted, before they started or while they ran. */
+  aborted: number;
+  /** Time executions waited to start or expire, in nanoseconds. */
+  waitNs: bigint;
+  maxWaitNs: bigint;
+  meanWaitNs: number;
+}
+
+/** How finished executions have been handed back to JS. */
+export interface EvmcCompletionStats {
+  completions: number;
+  /** Main thread wakeups which resolved at least one execution. */
+  batches: number;
+  largestBatch: number;
+  meanBatch: number;
+  /**
+   * Batches by size: the first entry counts batches of 1, the second of 2-3,
+   * then 4-7 and so on.
+   */
+  histogram: number[];
+}
+
+/**
+ * Native memory of executions, which is held in arenas shared by all
+ * [[Evmc]] instances and recycled between executions.
+ */
+export interface EvmcArenaStats {
+  /** Arenas created. */
+  arenas: number;
+  /** Executions which recycled an arena instead of creating one. */
+  reuses: number;
+  allocations: number;
+  /** Chunks of memory allocated from the system for arenas. */
+  chunks: number;
+  /**
+   * Bytes held by arenas, in use or kept for reuse, which are reported to the
+   * garbage collector as external memory.
+   */
+  reserved: number;
+}
+
+/** Options of [[Evmc.prewarm]]. */
+export interface EvmcPrewarmOptions {
+  /** VM instances to load ahead of time, by default 1. */
+  instances?: number;
+  /**
+   * Thread pool threads to start and touch the stacks of, by default the size
+   * of the pool.
+   */
+  threads?: number;
+}
+
+/** Outcome of [[Evmc.prewarm]]. */
+export interface EvmcPrewarmStats {
+  /** VM instances waiting in the pool, of any path. */
+  pooled: number;
+  /** Distinct threads the prewarm ran on. */
+  threads: number;
+  elapsedNs: bigint;
+}
+
+/**
+ * How the addresses, keys and topics passed to the callbacks of an [[Evmc]]
+ * were converted to BigInts, see [[Evmc.useInterning]].
+ */
+export interface EvmcInternStats {
+  /** Arguments which reused the BigInt of an earlier callback. */
+  hits: number;
+  /** Arguments for which a new BigInt was created. */
+  misses: number;
+  /** Fraction of arguments which reused a BigInt. */
+  hitRate: number;
+  /** Values the interning table holds, 0 if not interning. */
+  capacity: number;
+}
+
+/**
+ * How host calls have waited for their answers, across all [[Evmc]]
+ * instances, see [[Evmc.useHandoffSpin]].
+ */
+export interface EvmcHandoffStats {
+  /** Host calls answered by a callback. */
+  waits: number;
+  /** Host calls answered while spinning, which never slept. */
+  spun: number;
+  /** Time spent spinning, in nanoseconds. */
+  spinNs: bigint;
+}
+
+/** How [[Evmc.profile]] ranks contracts, highest first. */
+export enum EvmcProfileOrder {
+  /** By time in the VM and waiting on the host together. */
+  EVMC_PROFILE_BY_TIME = 0,
+  EVMC_PROFILE_BY_VM_TIME = 1,
+  EVMC_PROFILE_BY_HOST_TIME = 2,
+  EVMC_PROFILE_BY_GAS = 3,
+  EVMC_PROFILE_BY_EXECUTIONS = 4
+}
+
+/** Host callbacks a contract made, by callback. */
+export interface EvmcHostCallCounts {
+  accountExists: number;
+  getStorage: number;
+  setStorage: number;
+  getBalance: number;
+  getCodeSize: number;
+  getCodeHash: number;
+  copyCode: number;
+  selfDestruct: number;
+  call: number;
+  getTxContext: number;
+  getBlockHash: number;
+  emitLog: number;
+  transfer: number;
+}
+
+/** The totals of all executions of one contract code. */
+export interface EvmcContractProfile {
+  /** The Keccak-256 hash of the code. */
+  codeHash: bigint;
+  codeSize: number;
+  executions: number;
+  gasUsed: bigint;
+  /** Time spent in the VM, not counting host callbacks, in nanoseconds. */
+  vmNs: bigint;
+  /**
+   * Time spent waiting for host callbacks, in nanoseconds. This includes
+   * nested executions a call callback runs, which are also counted on their
+   * own.
+   */
+  hostNs: bigint;
+  /**
+   * Callbacks made to the host. Answers found natively, such as by the
+   * account cache or a snapshot, are not callbacks.
+   */
+  hostCalls: EvmcHostCallCounts;
+}
+
+/** The report of [[Evmc.profile]]. */
+export interface EvmcProfile {
+  /** The contracts ranking highest, highest first. */
+  contracts: EvmcContractProfile[];
+  /** Executions of code which did not fit in the profiler, so were not counted. */
+  untracked: number;
+}
+
+/** A transaction to run with [[Evmc.executeTransaction]]. */
+export interface EvmcTransaction {
+  sender: bigint;
+  /** The account called, or undefined to create a contract from the data. */
+  to?: bigint;
+  /**
+   * The nonce of the sender, which the address of a created contract is
+   * derived from. Checking and incrementing it is up to the host.
+   */
+  nonce: bigint;
+  value: bigint;
+  gasLimit: bigint;
+  gasPrice: bigint;
+  /** The input of a call, or the init code of a create. */
+  data: Buffer;
+}
+
+/** A log emitted by a transaction. */
+export interface EvmcLog {
+  address: bigint;
+  data: Buffer;
+  topics: bigint[];
+}
+
+/** The outcome of [[Evmc.executeTransaction]]. */
+export interface EvmcReceipt {
+  statusCode: EvmcStatusCode;
+  /** Gas the sender paid for, after the refund. */
+  gasUsed: bigint;
+  /** Gas given back for clearing storage and self-destructing. */
+  gasRefund: bigint;
+  /** gasUsed times the gas price, paid to the coinbase of the block. */
+  fee: bigint;
+  /** The output of a call, or the code deployed by a create. */
+  outputData: Buffer;
+  /** The address of the created contract, if a create succeeded. */
+  createAddress?: bigint;
+  /**
+   * Logs of the transaction's own message, empty if it failed. Logs of nested
+   * calls are emitted by the executions the call callback runs.
+   */
+  logs: EvmcLog[];
+}
+
+/** A transaction to run with [[Evmc.executeStream]]. */
+export interface EvmcStreamTransaction {
+  message: EvmcMessage;
+  /**
+   * The bytecode to execute. Calls may leave it out to run the destination's
+   * code, which is then fetched once the transactions before it have run;
+   * creates must provide it.
+   */
+  code?: Buffer;
+  /** The revision, [[EvmcStreamOptions.revision]] by default. */
+  revision?: EvmcRevision;
+  /** Accounts and storage slots the transaction is known to read. */
+  accessList?: Array<{address: bigint, storageKeys: bigint[]}>;
+}
+
+/** Options of [[Evmc.executeStream]]. */
+export interface EvmcStreamOptions {
+  /**
+   * How many transactions to take from the source and prefetch ahead of the
+   * one executing, 2 by default.
+   */
+  lookahead?: number;
+  /** The revision of transactions which do not have their own. */
+  revision?: EvmcRevision;
+}
+
+/**
+ * Identifies the execution a callback is made for. It is passed to every
+ * callback after its own arguments, so a host can run many executions on one
+ * [[Evmc]] at once and still tell which one is asking.
+ */
+export interface EvmcExecution {
+  /** Unique among the executions of the [[Evmc]]. */
+  id: number;
+  /** The context given in the [[EvmcExecutionOptions]], if any. */
+  context?: unknown;
+}
+
+/**
+ * What executions need of an AbortSignal, which any signal with the same
+ * methods can stand in for.
+ */
+export interface EvmcAbortSignal {
+  readonly aborted: boolean;
+  addEventListener(
+      type: 'abort', listener: () => void, options?: {once?: boolean}): void;
+  removeEventListener(type: 'abort', listener: () => void): void;
+}
+
+/** Per-execution settings, see [[Evmc.execute]]. */
+export interface EvmcExecutionOptions {
+  /** Any value the host wants the callbacks of this execution to have. */
+  context?: unknown;
+  /**
+   * The transaction context of this execution, which is then never asked of
+   * getTxContext, so executions in different blocks can share an [[Evmc]].
+   */
+  txContext?: EvmcTxContext;
+  /**
+   * Runs the execution statelessly on a witness, see [[EvmcWitness]]. Not
+   * supported by [[EvmcWorker]].
+   */
+  witness?: EvmcWitness;
+  /**
+   * Journals the storage writes and self-destructs of the execution in a
+   * write set, see [[EvmcWriteSet]]. Not supported by [[EvmcWorker]].
+   */
+  writeSet?: EvmcWriteSet;
+  /**
+   * Aborts the execution once signaled, whether it is still queued or
+   * already running, rejecting it with code ECANCELED. A running execution
+   * has its pending host call answered at once and every later one with
+   * zero, and nested calls fail, so the VM returns as soon as its code calls
+   * out; code which never calls out runs until it returns or runs out of
+   * gas. Writes it journaled in a write set are dropped. Not supported by
+   * [[EvmcWorker]].
+   */
+  signal?: EvmcAbortSignal;
+  /**
+   * Milliseconds from now after which the execution is aborted as by a
+   * signal, whether it has started or not.
+   */
+  timeout?: number;
+}
+
 /** Private interface to interact with the EVM binding. */
 interface EvmcBinding {
   createEvmcEvm(path: string, context: EvmJsContext, obj: {}): EvmcHandle;
   executeEvmcEvm(handle: EvmcHandle, parameters: EvmcExecutionParameters):
       EvmcResult;
+  executeEvmcTransaction(
+      handle: EvmcHandle,
+      parameters: EvmcExecutionParameters&
+      {nonce: bigint, gasPrice: bigint}): Promise<EvmcReceipt>;
+  estimateEvmcGas(
+      handle: EvmcHandle, parameters: EvmcExecutionParameters, lo: bigint,
+      hi: bigint): Promise<EvmcGasEstimate>;
   releaseEvmcEvm(handle: EvmcHandle): void;
+  createEvmcStateView(): EvmcStateViewHandle;
+  forkEvmcStateView(handle: EvmcStateViewHandle): EvmcStateViewHandle;
+  getEvmcStateViewMemoryUsage(handle: EvmcStateViewHandle): number;
+  releaseEvmcStateView(handle: EvmcStateViewHandle): void;
+  openEvmcSnapshot(path: string): EvmcSnapshotHandle;
+  closeEvmcSnapshot(handle: EvmcSnapshotHandle): void;
+  getEvmcSnapshotInfo(handle: EvmcSnapshotHandle): EvmcSnapshotInfo;
+  setEvmcSnapshot(handle: EvmcHandle, snapshot: EvmcSnapshotHandle|null):
+      void;
+  writeEvmcSnapshot(path: string, accounts: Array<{
+    address: bigint,
+    balance: bigint,
+    codeHash: bigint,
+    code: Buffer,
+    storage: Array<[bigint, bigint]>
+  }>): void;
+  setEvmcNativePrecompiles(handle: EvmcHandle, enabled: boolean): void;
+  setEvmcAccountCache(handle: EvmcHandle, budget: number): void;
+  invalidateEvmcAccounts(handle: EvmcHandle, addresses: bigint[]): void;
+  invalidateAllEvmcAccounts(handle: EvmcHandle): void;
+  getEvmcAccountCacheStats(handle: EvmcHandle):
+      Pick<EvmcAccountCacheStats, Exclude<keyof EvmcAccountCacheStats, 'hitRate'>>;
+  setEvmcResultCache(handle: EvmcHandle, budget: number): void;
+  getEvmcResultCacheStats(handle: EvmcHandle):
+      Pick<EvmcResultCacheStats, Exclude<keyof EvmcResultCacheStats, 'hitRate'>>;
+  startEvmcRecording(handle: EvmcHandle, path: string): void;
+  stopEvmcRecording(handle: EvmcHandle): void;
+  replayEvmcTrace(handle: EvmcHandle, path: string): Promise<EvmcReplayStats>;
+  setEvmcTiers(handle: EvmcHandle, tiers: EvmcTier[]): void;
+  setEvmcSchedulerLimits(
+      handle: EvmcHandle,
+      limits: {
+        maxRunning: number,
+        priorities: Array<Required<EvmcPriorityLimits>>
+      }): void;
+  getEvmcSchedulerStats(handle: EvmcHandle): Array<Pick<
+      EvmcSchedulerStats,
+      Exclude<keyof EvmcSchedulerStats, 'priority'|'meanWaitNs'>>>;
+  getEvmcArenaStats(): EvmcArenaStats;
+  setEvmcHandoffSpin(handle: EvmcHandle, spinNs: number): void;
+  getEvmcHandoffStats(): EvmcHandoffStats;
+  prewarmEvmc(path: string, instances: number, threads: number):
+      Promise<EvmcPrewarmStats>;
+  setEvmcInternCapacity(handle: EvmcHandle, capacity: number): void;
+  getEvmcInternStats(handle: EvmcHandle):
+      Pick<EvmcInternStats, Exclude<keyof EvmcInternStats, 'hitRate'>>;
+  setEvmcProfiler(handle: EvmcHandle, capacity: number): void;
+  getEvmcProfile(handle: EvmcHandle, order: EvmcProfileOrder, limit: number):
+      EvmcProfile;
+  getEvmcCompletionStats(handle: EvmcHandle): Pick<
+      EvmcCompletionStats, Exclude<keyof EvmcCompletionStats, 'meanBatch'>>;
+  getEvmcVmStats(handle: EvmcHandle):
+      Array<Pick<EvmcVmStats, Exclude<keyof EvmcVmStats, 'path'|'meanNs'>>>;
+  createEvmcWitness(stateRoot: bigint, nodes: Buffer[], codes: Buffer[]):
+      EvmcWitnessHandle;
+  releaseEvmcWitness(handle: EvmcWitnessHandle): void;
+  getEvmcWitnessInfo(handle: EvmcWitnessHandle): EvmcWitnessInfo;
+  createEvmcWriteSet(): EvmcWriteSetHandle;
+  releaseEvmcWriteSet(handle: EvmcWriteSetHandle): void;
+  getEvmcWriteSetSize(handle: EvmcWriteSetHandle): number;
+  updateEvmcAccount(
+      handle: EvmcWriteSetHandle, address: bigint, nonce: bigint|undefined,
+      balance: bigint|undefined, codeHash: bigint|undefined): void;
+  deleteEvmcAccount(handle: EvmcWriteSetHandle, address: bigint): void;
+  setEvmcWriteSetStorage(
+      handle: EvmcWriteSetHandle, address: bigint, key: bigint,
+      value: bigint): void;
+  createEvmcAbort(): EvmcAbortHandle;
+  abortEvmc(handle: EvmcAbortHandle): void;
+  commitEvmcWriteSet(
+      handle: EvmcHandle, writeSet: EvmcWriteSetHandle,
+      witness: EvmcWitnessHandle, schedule: EvmcSchedule):
+      Promise<EvmcCommitment>;
 }
 
-/** Private interface to pass as callback to the EVM binding. */
+/**
+ * Private interface to pass as callback to the EVM binding, which binds each
+ * callback the first time an execution calls it.
+ */
 interface EvmJsContext {
   getAccountExists(account: bigint): Promise<boolean>|boolean;
   getStorage(account: bigint, key: bigint): Promise<bigint>|bigint;
@@ -273,13 +859,248 @@ interface EvmJsContext {
   getBlockHash(num: bigint): Promise<bigint>|bigint;
   emitLog(account: bigint, data: Buffer, topics: Array<bigint>): Promise<void>|
       void;
-  executeComplete(): void;
+  transfer?(from: bigint|undefined, to: bigint|undefined, value: bigint):
+      Promise<void>|void;
+}
+/**
+ * A frozen, read-only state which is memory mapped from a file.
+ *
+ * An [[Evmc]] using a snapshot answers account existence, balance, code and
+ * storage queries directly from the mapping, without calling into JS. A single
+ * snapshot may be shared by any number of EVMs and concurrent executions, and
+ * all of them share the same page cache.
+ */
+export class EvmcSnapshot {
+  _snapshot: EvmcSnapshotHandle;
+  closed = false;
+
+  /**
+   * Maps the snapshot at the given path.
+   * @param path  The path of a file written by [[EvmcSnapshot.write]].
+   */
+  constructor(path: string) {
+    this._snapshot = evmc.openEvmcSnapshot(path);
+  }
+
+  /**
+   * Writes a snapshot of the given accounts to a file.
+   * @param path      The path of the file to write.
+   * @param accounts  The accounts in the snapshot, in any order.
+   */
+  static write(path: string, accounts: EvmcSnapshotAccount[]) {
+    evmc.writeEvmcSnapshot(path, accounts.map(account => {
+      return {
+        address: account.address,
+        balance: account.balance,
+        codeHash: account.codeHash,
+        code: account.code,
+        storage: Array.from(account.storage)
+      };
+    }));
+  }
+
+  /** The sizes of the snapshot. */
+  get info(): EvmcSnapshotInfo {
+    if (this.closed) {
+      throw new Error('Snapshot has been closed!');
+    }
+    return evmc.getEvmcSnapshotInfo(this._snapshot);
+  }
+
+  /**
+   * Closes the snapshot. The file stays mapped until every EVM and execution
+   * using it is done.
+   */
+  close() {
+    evmc.closeEvmcSnapshot(this._snapshot);
+    this.closed = true;
+  }
+}
+
+/**
+ * The Merkle proofs of the state a block or transaction touches, for running
+ * it without the state itself.
+ *
+ * The nodes are indexed natively by their keccak256 hash, and every lookup
+ * walks the state trie, and then the storage trie of the account, from the
+ * state root through the index. Answers are therefore proven against the
+ * root, and nodes which are not on the path of a lookup are never used.
+ *
+ * Executions given a witness answer account existence, balance, code and
+ * storage queries from it on their own thread, and never call getAccountExists,
+ * getBalance, getCodeSize, getCodeHash, copyCode or getStorage. Writes still
+ * go to the callbacks, or stay in a state view, which then reads through to
+ * the witness. If a lookup needs a node or code the witness does not have, the
+ * execution stops calling out and is rejected with code EWITNESS once the VM
+ * returns, naming the account or slot which had no proof.
+ */
+export class EvmcWitness {
+  _witness: EvmcWitnessHandle;
+  released = false;
+
+  /**
+   * Indexes a witness. Throws with code EINVAL if a node is not an RLP list.
+   * @param stateRoot  The state root the proofs are against.
+   * @param nodes      The RLP encoded trie nodes, of the state trie and of
+   *                   the storage tries, in any order.
+   * @param codes      The code of the accounts which are run or whose code
+   *                   is read.
+   */
+  constructor(stateRoot: bigint, nodes: Buffer[], codes: Buffer[] = []) {
+    this._witness = evmc.createEvmcWitness(stateRoot, nodes, codes);
+  }
+
+  /** The sizes of the witness. */
+  get info(): EvmcWitnessInfo {
+    if (this.released) {
+      throw new Error('Witness has been released!');
+    }
+    return evmc.getEvmcWitnessInfo(this._witness);
+  }
+
+  /**
+   * Releases the witness. Its memory is freed once the executions running on
+   * it are done.
+   */
+  release() {
+    evmc.releaseEvmcWitness(this._witness);
+    this.released = true;
+  }
 }
+
+/**
+ * The state writes of a block, journaled natively as its executions run, to
+ * compute the state root after them with [[Evmc.commit]].
+ *
+ * Executions given a write set append their storage writes and self-destructs
+ * to it, whether they go to setStorage or stay in a state view. When an
+ * execution fails, the writes it made are dropped again, along with those of
+ * executions the host ran for its calls while it ran. Executions sharing a
+ * write set must therefore run one at a time, apart from such nested ones.
+ *
+ * Nonces and balances are not written through EVMC, so the host journals them
+ * with [[updateAccount]], as it does the code hash of created contracts.
+ */
+export class EvmcWriteSet {
+  _writeSet: EvmcWriteSetHandle;
+  released = false;
+
+  /** Creates an empty write set. */
+  constructor() {
+    this._writeSet = evmc.createEvmcWriteSet();
+  }
+
+  /** The number of writes journaled. */
+  get size(): number {
+    if (this.released) {
+      throw new Error('Write set has been released!');
+    }
+    return evmc.getEvmcWriteSetSize(this._writeSet);
+  }
+
+  /**
+   * Journals new values for some fields of an account, creating it if it does
+   * not exist.
+   */
+  updateAccount(address: bigint, update: EvmcAccountUpdate) {
+    if (this.released) {
+      throw new Error('Write set has been released!');
+    }
+    evmc.updateEvmcAccount(
+        this._writeSet, address, update.nonce, update.balance,
+        update.codeHash);
+  }
+
+  /** Journals the removal of an account and all of its storage. */
+  deleteAccount(address: bigint) {
+    if (this.released) {
+      throw new Error('Write set has been released!');
+    }
+    evmc.deleteEvmcAccount(this._writeSet, address);
+  }
+
+  /** Journals a storage write made outside of an execution. */
+  setStorage(address: bigint, key: bigint, value: bigint) {
+    if (this.released) {
+      throw new Error('Write set has been released!');
+    }
+    evmc.setEvmcWriteSetStorage(this._writeSet, address, key, value);
+  }
+
+  /**
+   * Releases the write set. Its memory is freed once the executions and
+   * commitments using it are done.
+   */
+  release() {
+    evmc.releaseEvmcWriteSet(this._writeSet);
+    this.released = true;
+  }
+}
+
+/**
+ * A native copy of state read through the callbacks, plus the storage writes
+ * of the executions run on it.
+ *
+ * Executions on a view ask the callbacks for each piece of state once, and then
+ * read it natively. Storage writes stay in the view, and later executions on
+ * the view run on top of them; setStorage is never called. Forks of a view read
+ * through to it and keep their own writes, so many what-if executions can run
+ * concurrently on forks of the same pending state, each allocating only for
+ * what it writes. The writes of an execution which fails are dropped.
+ *
+ * Only storage is kept in a view: self destructs, logs and nested calls of
+ * executions on it still go to the callbacks.
+ */
+export class EvmcStateView {
+  _state: EvmcStateViewHandle;
+  released = false;
+
+  /** Creates an empty view. */
+  constructor(handle?: EvmcStateViewHandle) {
+    this._state = handle === undefined ? evmc.createEvmcStateView() : handle;
+  }
+
+  /**
+   * Creates a copy-on-write child of this view. Once forked, a view can no
+   * longer be executed on, so that its children see it as it was.
+   */
+  fork(): EvmcStateView {
+    if (this.released) {
+      throw new Error('State view has been released!');
+    }
+    return new EvmcStateView(evmc.forkEvmcStateView(this._state));
+  }
+
+  /**
+   * Bytes allocated by this view, not counting the views it was forked from.
+   * State filled in from the callbacks is held by the view all its family was
+   * forked from.
+   */
+  get memoryUsage(): number {
+    if (this.released) {
+      throw new Error('State view has been released!');
+    }
+    return evmc.getEvmcStateViewMemoryUsage(this._state);
+  }
+
+  /**
+   * Releases the view. Its memory is freed once its forks and the executions
+   * running on it are done.
+   */
+  release() {
+    evmc.releaseEvmcStateView(this._state);
+    this.released = true;
+  }
+}
+
 export abstract class Evmc {
   _evm: EvmcHandle;
   released = false;
+  private vmPaths: string[];
+  private executions = 0;
 
   constructor(path: string) {
+    this.vmPaths = [path];
     this._evm = evmc.createEvmcEvm(
         path, {
           getAccountExists: this.getAccountExists,
@@ -294,7 +1115,7 @@ export abstract class Evmc {
           call: this.call,
           getBlockHash: this.getBlockHash,
           emitLog: this.emitLog,
-          executeComplete: () => {}
+          transfer: this.transfer
         },
         this);
   }
@@ -308,7 +1129,8 @@ export abstract class Evmc {
    * @param address  The address of the account the query is about.
    * @return         true if exists, false otherwise.
    */
-  abstract getAccountExists(address: bigint): Promise<boolean>|boolean;
+  abstract getAccountExists(address: bigint, execution?: EvmcExecution):
+      Promise<boolean>|boolean;
 
   /**
    * Get storage callback function.
@@ -321,7 +1143,8 @@ export abstract class Evmc {
    * @return         The storage value at the given storage key or null bytes
    *                 if the account does not exist.
    */
-  abstract getStorage(account: bigint, key: bigint): Promise<bigint>|bigint;
+  abstract getStorage(account: bigint, key: bigint, execution?: EvmcExecution):
+      Promise<bigint>|bigint;
 
   /**
    * Set storage callback function.
@@ -337,8 +1160,9 @@ export abstract class Evmc {
    * @param value    The value to be stored.
    * @return         The effect on the storage item.
    */
-  abstract setStorage(account: bigint, key: bigint, value: bigint):
-      Promise<EvmcStorageStatus>|EvmcStorageStatus;
+  abstract setStorage(
+      account: bigint, key: bigint, value: bigint,
+      execution?: EvmcExecution): Promise<EvmcStorageStatus>|EvmcStorageStatus;
 
   /**
    * Get balance callback function.
@@ -350,7 +1174,8 @@ export abstract class Evmc {
    * @return         The balance of the given account or 0 if the account does
    * not exist.
    */
-  abstract getBalance(account: bigint): Promise<bigint>|bigint;
+  abstract getBalance(account: bigint, execution?: EvmcExecution):
+      Promise<bigint>|bigint;
 
   /**
    * Get code size callback function.
@@ -362,7 +1187,8 @@ export abstract class Evmc {
    * @return         The size of the code in the account or 0 if the account
    * does not exist.
    */
-  abstract getCodeSize(address: bigint): Promise<bigint>|bigint;
+  abstract getCodeSize(address: bigint, execution?: EvmcExecution):
+      Promise<bigint>|bigint;
 
   /**
    * Get code hash callback function.
@@ -375,7 +1201,8 @@ export abstract class Evmc {
    * @return         The hash of the code in the account or null bytes if the
    * account does not exist.
    */
-  abstract getCodeHash(address: bigint): Promise<bigint>|bigint;
+  abstract getCodeHash(address: bigint, execution?: EvmcExecution):
+      Promise<bigint>|bigint;
 
   /**
    * Copy code callback function.
@@ -393,8 +1220,9 @@ export abstract class Evmc {
    *  @param buffer       A buffer containing the code, up to size length.
    * Client.
    */
-  abstract copyCode(account: bigint, offset: number, length: number):
-      Promise<Buffer>|Buffer;
+  abstract copyCode(
+      account: bigint, offset: number, length: number,
+      execution?: EvmcExecution): Promise<Buffer>|Buffer;
 
 
   /**
@@ -407,8 +1235,9 @@ export abstract class Evmc {
    *  @param beneficiary  The address where the remaining ETH is going to be
    *                      transferred.
    */
-  abstract selfDestruct(address: bigint, beneficiary: bigint): Promise<void>|
-      void;
+  abstract selfDestruct(
+      address: bigint, beneficiary: bigint,
+      execution?: EvmcExecution): Promise<void>|void;
 
   /**
    * Pointer to the callback function supporting EVM calls.
@@ -416,7 +1245,8 @@ export abstract class Evmc {
    * @param  msg     The call parameters.
    * @return         The result of the call.
    */
-  abstract call(message: EvmcMessage): Promise<EvmcResult>|EvmcResult;
+  abstract call(message: EvmcMessage, execution?: EvmcExecution):
+      Promise<EvmcResult>|EvmcResult;
 
 
   /**
@@ -427,7 +1257,8 @@ export abstract class Evmc {
    *
    *  @return              The transaction context.
    */
-  abstract getTxContext(): Promise<EvmcTxContext>|EvmcTxContext;
+  abstract getTxContext(execution?: EvmcExecution):
+      Promise<EvmcTxContext>|EvmcTxContext;
 
   /**
    * Get block hash callback function.
@@ -440,7 +1271,8 @@ export abstract class Evmc {
    * @return         The block hash or null bytes
    *                 if the information about the block is not available.
    */
-  abstract getBlockHash(num: bigint): Promise<bigint>|bigint;
+  abstract getBlockHash(num: bigint, execution?: EvmcExecution):
+      Promise<bigint>|bigint;
 
   /**
    * Log callback function.
@@ -451,8 +1283,25 @@ export abstract class Evmc {
    *  @param data          The buffer to unindexed data attached to the log.
    *  @param topics        An array of topics attached to the log.
    */
-  abstract emitLog(address: bigint, data: Buffer, topics: Array<bigint>):
-      Promise<void>|void;
+  abstract emitLog(
+      address: bigint, data: Buffer, topics: Array<bigint>,
+      execution?: EvmcExecution): Promise<void>|void;
+
+  /**
+   * Transfer callback function, which moves value from one account to
+   * another. EVMC leaves moving the value of a transaction and paying for its
+   * gas to the host, so only hosts using [[executeTransaction]] need it. The
+   * gas of a transaction is bought from the sender before its message runs,
+   * and what is left of it given back to the sender and paid to the coinbase
+   * afterwards, so one of the accounts is undefined for those.
+   *
+   *  @param from    The account the value is taken from, if any.
+   *  @param to      The account the value is given to, if any.
+   *  @param value   The value to move.
+   */
+  transfer?(
+      from: bigint|undefined, to: bigint|undefined, value: bigint,
+      execution?: EvmcExecution): Promise<void>|void;
 
 
   /**
@@ -460,14 +1309,714 @@ export abstract class Evmc {
    * @param msg        Call parameters.
    * @param code       Reference to the bytecode to be executed.
    * @param rev        Requested EVM specification revision.
+   * @param state      The state view to run on. A view runs one execution
+   *                   at a time, and keeps its storage writes, but not its
+   *                   self destructs, logs and nested calls.
+   * @param schedule   The priority and deadline of the execution. Throws
+   *                   with code EBUSY if the queue of its priority is full.
+   * @param options    The context the callbacks of the execution receive,
+   *                   and its transaction context if it has its own.
    */
   execute(
       message: EvmcMessage, code: Buffer,
-      revision = EvmcRevision.EVMC_MAX_REVISION): EvmcResult {
+      revision = EvmcRevision.EVMC_MAX_REVISION, state?: EvmcStateView,
+      schedule: EvmcSchedule = {},
+      options: EvmcExecutionOptions = {}): EvmcResult {
+    if (this.released) {
+      throw new Error('EVM has been released!');
+    }
+    if (state !== undefined && state.released) {
+      throw new Error('State view has been released!');
+    }
+    return this.abortable(options, abort => evmc.executeEvmcEvm(this._evm, {
+      revision,
+      message,
+      code,
+      state: state && state._state,
+      priority: schedule.priority,
+      deadline: schedule.deadline,
+      execution: this.createExecution(options),
+      txContext: options.txContext,
+      witness: this.getWitness(options),
+      writeSet: this.getWriteSet(options),
+      abort
+    }));
+  }
+
+  /**
+   * Executes a whole transaction natively, from checking it can be paid for
+   * to paying its fee, and resolves with its receipt.
+   *
+   * Before the message runs, the intrinsic gas is charged, the sender's
+   * balance is checked against the gas limit times the gas price plus the
+   * value, the gas limit is paid for by the sender, the code of the
+   * destination is fetched, and the value is moved with [[transfer]].
+   * Afterwards, created code is charged for, the refund is applied, the value
+   * is moved back if the message failed, the unused and refunded gas is given
+   * back to the sender, and the fee goes to the coinbase of the transaction
+   * context. All of this asks the same
+   * callbacks as the execution, on its thread, so the account cache and
+   * snapshots answer it too. Rejects with code EINVALIDTX if the transaction
+   * cannot be paid for, in which case nothing was moved.
+   *
+   * As with [[execute]], undoing the other writes of a failed message is up to
+   * the host, as are nonces, which EVMC hosts do not expose.
+   * @param transaction   The transaction.
+   * @param revision      Requested EVM specification revision.
+   * @param schedule      The priority and deadline of the execution.
+   * @param options       The context the callbacks of the execution receive,
+   *                      and its transaction context if it has its own.
+   */
+  executeTransaction(
+      transaction: EvmcTransaction, revision = EvmcRevision.EVMC_MAX_REVISION,
+      schedule: EvmcSchedule = {},
+      options: EvmcExecutionOptions = {}): Promise<EvmcReceipt> {
+    if (this.released) {
+      throw new Error('EVM has been released!');
+    }
+    const create = transaction.to === undefined;
+    return this.abortable(options, abort => evmc.executeEvmcTransaction(this._evm, {
+      revision,
+      message: {
+        kind: create ? EvmcCallKind.EVMC_CREATE : EvmcCallKind.EVMC_CALL,
+        sender: transaction.sender,
+        destination: create ? 0n : transaction.to!,
+        depth: 0,
+        gas: transaction.gasLimit,
+        inputData: transaction.data,
+        value: transaction.value
+      },
+      code: Buffer.alloc(0),
+      priority: schedule.priority,
+      deadline: schedule.deadline,
+      execution: this.createExecution(options),
+      txContext: options.txContext,
+      witness: this.getWitness(options),
+      writeSet: this.getWriteSet(options),
+      abort,
+      nonce: transaction.nonce,
+      gasPrice: transaction.gasPrice
+    }));
+  }
+
+  private createExecution(options: EvmcExecutionOptions): EvmcExecution {
+    return {id: ++this.executions, context: options.context};
+  }
+
+  private getWitness(options: EvmcExecutionOptions): EvmcWitnessHandle|
+      undefined {
+    if (options.witness === undefined) {
+      return undefined;
+    }
+    if (options.witness.released) {
+      throw new Error('Witness has been released!');
+    }
+    return options.witness._witness;
+  }
+
+  /**
+   * Starts an execution with an abort flag if the options have a signal or a
+   * timeout, and stops listening for them once the execution is done.
+   */
+  private abortable<T>(
+      options: EvmcExecutionOptions,
+      start: (abort: EvmcAbortHandle|undefined) => T): T {
+    const signal = options.signal;
+    if (signal === undefined && options.timeout === undefined) {
+      return start(undefined);
+    }
+    const abort = evmc.createEvmcAbort();
+    const onAbort = () => evmc.abortEvmc(abort);
+    // An execution aborted from the start never runs.
+    if (signal !== undefined && signal.aborted) {
+      onAbort();
+    }
+    const execution = start(abort) as unknown as Promise<unknown>;
+    if (signal !== undefined && !signal.aborted) {
+      signal.addEventListener('abort', onAbort, {once: true});
+    }
+    const timer = options.timeout === undefined ?
+        undefined :
+        setTimeout(onAbort, options.timeout);
+    const done = () => {
+      if (signal !== undefined) {
+        signal.removeEventListener('abort', onAbort);
+      }
+      if (timer !== undefined) {
+        clearTimeout(timer);
+      }
+    };
+    return execution.then(
+               result => {
+                 done();
+                 return result;
+               },
+               error => {
+                 done();
+                 throw error;
+               }) as unknown as T;
+  }
+
+  private getWriteSet(options: EvmcExecutionOptions): EvmcWriteSetHandle|
+      undefined {
+    if (options.writeSet === undefined) {
+      return undefined;
+    }
+    if (options.writeSet.released) {
+      throw new Error('Write set has been released!');
+    }
+    return options.writeSet._writeSet;
+  }
+
+  /**
+   * Executes a stream of transactions one after the other, each on the state
+   * left by the previous one, and yields their results in order.
+   *
+   * While a transaction executes, the following ones are taken from the
+   * source and their state is prefetched: the balances of the sender and the
+   * destination, the destination's code when the transaction has none, and
+   * the balances and storage slots of the access list. Prefetching calls the
+   * callbacks like an execution would, without using their answers, so a host
+   * backed by a slow store can bring the state into memory before it is
+   * needed. The answers prefetched for a transaction must therefore still be
+   * loaded by the host once the transactions before it have run.
+   *
+   * No more than the lookahead is taken from the source ahead of the
+   * executing transaction, and no transaction is executed before the previous
+   * result has been consumed, so a slow consumer holds back both.
+   * @param transactions   The transactions to execute.
+   * @param options        How far to look ahead, and the default revision.
+   */
+  async * executeStream(
+      transactions: AsyncIterable<EvmcStreamTransaction>|
+      Iterable<EvmcStreamTransaction>,
+      options: EvmcStreamOptions = {}): AsyncIterableIterator<EvmcResult> {
+    if (this.released) {
+      throw new Error('EVM has been released!');
+    }
+    const lookahead = options.lookahead === undefined ? 2 : options.lookahead;
+    if (!Number.isInteger(lookahead) || lookahead < 0) {
+      throw new Error('Lookahead must be a non-negative integer!');
+    }
+    const revision = options.revision === undefined ?
+        EvmcRevision.EVMC_MAX_REVISION :
+        options.revision;
+    const iterator: AsyncIterator<EvmcStreamTransaction>|
+        Iterator<EvmcStreamTransaction> = Symbol.asyncIterator in transactions ?
+        (transactions as AsyncIterable<EvmcStreamTransaction>)
+            [Symbol.asyncIterator]() :
+        (transactions as Iterable<EvmcStreamTransaction>)[Symbol.iterator]();
+
+    // Transactions are taken from the source one at a time, but prefetched
+    // as soon as they are taken. Each pending entry resolves to a transaction
+    // ready to execute, or undefined at the end of the source.
+    let taken: Promise<unknown> = Promise.resolve();
+    let exhausted = false;
+    const pending: Array<Promise<EvmcStreamTransaction|undefined>> = [];
+    const take = () => {
+      const next = taken
+                       .then(
+                           () => exhausted ? {done: true, value: undefined} :
+                                             iterator.next())
+                       .then((item: IteratorResult<EvmcStreamTransaction>) => {
+                         exhausted = exhausted || !!item.done;
+                         return item;
+                       });
+      taken = next.catch(() => undefined);
+      const ready = next.then(
+          item => item.done ? undefined : this.prefetch(item.value));
+      // Errors surface when the entry is awaited, which may be never if the
+      // consumer stops early.
+      ready.catch(() => undefined);
+      pending.push(ready);
+    };
+
+    try {
+      for (let i = 0; i <= lookahead; i++) {
+        take();
+      }
+      for (;;) {
+        const transaction = await pending.shift()!;
+        if (transaction === undefined) {
+          return;
+        }
+        take();
+        // The code prefetched may have changed since, as by a deploy or a
+        // self destruct earlier in the stream.
+        const code = transaction.code !== undefined ?
+            transaction.code :
+            await this.fetchCode(transaction.message.destination);
+        yield await this.execute(
+            transaction.message, code,
+            transaction.revision === undefined ? revision :
+                                                 transaction.revision);
+      }
+    } finally {
+      if (!exhausted && iterator.return !== undefined) {
+        await taken;
+        await iterator.return();
+      }
+    }
+  }
+
+  /** Calls the callbacks a transaction will start with, without using their answers. */
+  private async prefetch(transaction: EvmcStreamTransaction):
+      Promise<EvmcStreamTransaction> {
+    const {message} = transaction;
+    if (transaction.code === undefined &&
+        (message.kind === EvmcCallKind.EVMC_CREATE ||
+         message.kind === EvmcCallKind.EVMC_CREATE2)) {
+      throw new Error('Creates must provide their code!');
+    }
+    const reads: Array<Promise<unknown>|unknown> = [
+      this.getBalance(message.sender),
+      this.getBalance(message.destination),
+    ];
+    for (const entry of transaction.accessList || []) {
+      reads.push(this.getBalance(entry.address));
+      for (const key of entry.storageKeys) {
+        reads.push(this.getStorage(entry.address, key));
+      }
+    }
+    if (transaction.code === undefined) {
+      reads.push(this.fetchCode(message.destination));
+    }
+    await Promise.all(reads);
+    return transaction;
+  }
+
+  /** Fetches the code of an account through the callbacks. */
+  private async fetchCode(account: bigint): Promise<Buffer> {
+    const size = await this.getCodeSize(account);
+    return this.copyCode(account, 0, Number(size));
+  }
+
+  /** Creates an empty [[EvmcStateView]] to execute on. */
+  createStateView(): EvmcStateView {
+    return new EvmcStateView();
+  }
+
+  /**
+   * Finds the lowest gas limit the given bytecode succeeds with, by binary
+   * search on a worker thread.
+   *
+   * State read by the first run is kept natively and reused by the following
+   * runs, which only call back into JS for nested calls. setStorage, emitLog
+   * and selfDestruct are never called: writes are kept natively and dropped
+   * after each run, so the call callback sees state as it was before the
+   * estimate.
+   * @param message    Call parameters. The gas is replaced by each run.
+   * @param code       Reference to the bytecode to be executed.
+   * @param bounds     The lowest gas limit to return, 0 by default, and the
+   *                   highest to try, the message's gas by default.
+   * @param revision   Requested EVM specification revision.
+   * @param schedule   The priority and deadline of the estimate.
+   * @param options    The context the callbacks of the estimate receive,
+   *                   and its transaction context if it has its own.
+   * @returns          The estimate, along with the result of running with it.
+   *                   If the execution fails even with the highest limit,
+   *                   the gas is that limit and the result tells why.
+   */
+  estimateGas(
+      message: EvmcMessage, code: Buffer,
+      bounds: {lo?: bigint, hi?: bigint} = {},
+      revision = EvmcRevision.EVMC_MAX_REVISION, schedule: EvmcSchedule = {},
+      options: EvmcExecutionOptions = {}): Promise<EvmcGasEstimate> {
+    if (this.released) {
+      throw new Error('EVM has been released!');
+    }
+    const lo = bounds.lo === undefined ? 0n : bounds.lo;
+    const hi = bounds.hi === undefined ? message.gas : bounds.hi;
+    return this.abortable(
+        options,
+        abort => evmc.estimateEvmcGas(
+            this._evm, {
+              revision,
+              message,
+              code,
+              ...schedule,
+              execution: this.createExecution(options),
+              txContext: options.txContext,
+              witness: this.getWitness(options),
+              abort
+            },
+            lo, hi));
+  }
+
+  /**
+   * Serves state reads of subsequent executions from a snapshot.
+   *
+   * While a snapshot is in use, getAccountExists, getBalance, getCodeSize,
+   * getCodeHash, copyCode and getStorage are answered from the snapshot and
+   * never called. All other callbacks, including setStorage, are still
+   * called, but writes are not visible to later reads: snapshots are meant for
+   * read-only execution such as eth_call. Executions already running keep the
+   * snapshot they started with.
+   * @param snapshot   The snapshot to use, or undefined to read state through
+   *                   the callbacks again.
+   */
+  useSnapshot(snapshot?: EvmcSnapshot) {
+    if (this.released) {
+      throw new Error('EVM has been released!');
+    }
+    if (snapshot !== undefined && snapshot.closed) {
+      throw new Error('Snapshot has been closed!');
+    }
+    evmc.setEvmcSnapshot(
+        this._evm, snapshot === undefined ? null : snapshot._snapshot);
+  }
+
+  /**
+   * Chooses whether calls to precompiled contracts are run natively.
+   *
+   * By default, calls to the precompiled contracts of the execution's
+   * revision (ecrecover, sha256, ripemd160 and identity, plus modexp and the
+   * alt_bn128 contracts since Byzantium and blake2f since Istanbul) are run
+   * by the binding and never reach the call callback, unless they transfer
+   * value. Disable this if the call callback implements its own precompiles.
+   * @param enabled   If precompiles should be run natively.
+   */
+  useNativePrecompiles(enabled: boolean) {
+    if (this.released) {
+      throw new Error('EVM has been released!');
+    }
+    evmc.setEvmcNativePrecompiles(this._evm, enabled);
+  }
+
+  /**
+   * Caches the answers of getAccountExists, getBalance, getCodeSize and
+   * getCodeHash across executions, so popular accounts are only asked for
+   * once.
+   *
+   * The cache assumes these answers only change when told. Balances moved and
+   * code deployed through the call and selfDestruct callbacks are invalidated
+   * automatically; anything else, such as gas fees and rewards applied at the
+   * end of a transaction or block, must be reported with
+   * [[invalidateAccounts]] or [[invalidateAll]].
+   * @param budget   The memory budget in bytes, or 0 to disable the cache.
+   *                 Replacing the cache starts over with an empty one.
+   */
+  useAccountCache(budget: number) {
+    if (this.released) {
+      throw new Error('EVM has been released!');
+    }
+    evmc.setEvmcAccountCache(this._evm, budget);
+  }
+
+  /**
+   * Drops cached metadata of the given accounts, and cached results which
+   * read their state.
+   * @param addresses   The accounts which have changed.
+   */
+  invalidateAccounts(addresses: bigint[]) {
+    evmc.invalidateEvmcAccounts(this._evm, addresses);
+  }
+
+  /**
+   * Drops all cached account metadata and results, such as at a block
+   * boundary.
+   */
+  invalidateAll() {
+    evmc.invalidateAllEvmcAccounts(this._evm);
+  }
+
+  /** The counters of the account cache, all zero if it is not in use. */
+  get accountCacheStats(): EvmcAccountCacheStats {
+    const stats = evmc.getEvmcAccountCacheStats(this._evm);
+    const queries = stats.hits + stats.misses;
+    return {...stats, hitRate: queries === 0 ? 0 : stats.hits / queries};
+  }
+
+  /**
+   * Caches the results of static executions, keyed by their code, message
+   * and revision, so repeated read-only calls such as balanceOf or quotes
+   * skip the VM.
+   *
+   * Each result is stored with what its execution read: the accounts whose
+   * state it queried, the transaction context and the block hashes. A result
+   * is only served while none of those have changed. Storage written and
+   * balances moved through this EVM mark their accounts changed
+   * automatically; anything else must be reported with [[invalidateAccounts]]
+   * or [[invalidateAll]]. The transaction context and block hashes are asked
+   * for again and compared before a result is served.
+   *
+   * Only executions with the EVMC_STATIC flag, without a snapshot, witness,
+   * state view or recording, are cached. Those which call other accounts
+   * through the call callback are not, as their callees are not tracked.
+   * @param budget   The memory budget in bytes, or 0 to disable the cache.
+   *                 Replacing the cache starts over with an empty one.
+   */
+  useResultCache(budget: number) {
     if (this.released) {
       throw new Error('EVM has been released!');
     }
-    return evmc.executeEvmcEvm(this._evm, {revision, message, code});
+    evmc.setEvmcResultCache(this._evm, budget);
+  }
+
+  /** The counters of the result cache, all zero if it is not in use. */
+  get resultCacheStats(): EvmcResultCacheStats {
+    const stats = evmc.getEvmcResultCacheStats(this._evm);
+    const lookups = stats.hits + stats.misses;
+    return {...stats, hitRate: lookups === 0 ? 0 : stats.hits / lookups};
+  }
+
+  /**
+   * Promotes hot contracts to faster VMs.
+   *
+   * Executions are counted per code, and code which has run at least a tier's
+   * threshold times runs on the VM of the highest tier it has reached instead
+   * of the one this EVM was created with. A VM returning EVMC_REJECTED hands
+   * the execution down to the tier below it, down to the base VM.
+   * @param tiers   The VMs to promote to, with increasing thresholds, or an
+   *                empty array to run everything on the base VM. Replacing the
+   *                tiers resets the execution counts and [[vmStats]].
+   */
+  useTiers(tiers: EvmcTier[]) {
+    if (this.released) {
+      throw new Error('EVM has been released!');
+    }
+    evmc.setEvmcTiers(this._evm, tiers);
+    this.vmPaths = [this.vmPaths[0], ...tiers.map(tier => tier.path)];
+  }
+
+  /** The counters of each VM, starting with the base VM. */
+  get vmStats(): EvmcVmStats[] {
+    return evmc.getEvmcVmStats(this._evm).map((stats, i) => {
+      const meanNs = stats.executions === 0 ?
+          0 :
+          Number(stats.elapsedNs) / stats.executions;
+      return {...stats, path: this.vmPaths[i], meanNs};
+    });
+  }
+
+  /**
+   * Limits how many executions run at once, overall and per priority class.
+   *
+   * Executions start in order of priority while under the limits, and wait
+   * in the queue of their class otherwise. Without limits, every execution is
+   * handed to the libuv thread pool right away and they start in the order
+   * they were made; keeping the overall limit at most the size of the pool
+   * (UV_THREADPOOL_SIZE, 4 by default) lets priorities decide instead.
+   * Replacing the limits removes any which are left out.
+   * @param limits   The limits, which are all unlimited by default.
+   */
+  useSchedulerLimits(limits: EvmcSchedulerLimits) {
+    if (this.released) {
+      throw new Error('EVM has been released!');
+    }
+    const priorities = [
+      EvmcPriority.EVMC_PRIORITY_HIGH, EvmcPriority.EVMC_PRIORITY_NORMAL,
+      EvmcPriority.EVMC_PRIORITY_LOW
+    ].map(priority => {
+      const limit = (limits.priorities && limits.priorities[priority]) || {};
+      return {
+        maxRunning: limit.maxRunning || 0,
+        maxQueued: limit.maxQueued || 0
+      };
+    });
+    evmc.setEvmcSchedulerLimits(
+        this._evm, {maxRunning: limits.maxRunning || 0, priorities});
+  }
+
+  /** The counters of each priority class, indexed by [[EvmcPriority]]. */
+  get schedulerStats(): EvmcSchedulerStats[] {
+    return evmc.getEvmcSchedulerStats(this._evm).map((stats, priority) => {
+      const waited = stats.started + stats.expired;
+      const meanWaitNs = waited === 0 ? 0 : Number(stats.waitNs) / waited;
+      return {...stats, priority, meanWaitNs};
+    });
+  }
+
+  /**
+   * Does the work of starting up ahead of traffic, such as while a service
+   * starts or scales out, so that the first executions do not pay for it.
+   *
+   * Loads VM instances into a pool, which EVMs created with the same path
+   * take instead of loading their own, and starts the threads of the pool
+   * executions run on and touches their stacks. EVMs themselves set up the
+   * callbacks and threadsafe functions they need with their first execution
+   * and first use of each callback.
+   * @param path      The path to the VM, as passed to the constructor.
+   * @param options   How many instances and threads to prewarm.
+   */
+  static prewarm(path: string, options: EvmcPrewarmOptions = {}):
+      Promise<EvmcPrewarmStats> {
+    const instances = options.instances === undefined ? 1 : options.instances;
+    const threads = options.threads === undefined ?
+        Number(process.env.UV_THREADPOOL_SIZE || 4) :
+        options.threads;
+    return evmc.prewarmEvmc(path, instances, threads);
+  }
+
+  /**
+   * The counters of execution memory. Each execution allocates from an arena
+   * which is freed in one step once it completes.
+   */
+  static get arenaStats(): EvmcArenaStats {
+    return evmc.getEvmcArenaStats();
+  }
+
+  /**
+   * Makes host calls spin for their answer before going to sleep.
+   *
+   * A VM thread waiting on a callback sleeps until the main thread wakes it,
+   * which costs a kernel round trip on both sides. Synchronous callbacks
+   * answer within microseconds, so spinning for about as long picks their
+   * answers up without sleeping, at the cost of a busy thread pool thread
+   * while a call waits. Spinning does not help callbacks returning promises,
+   * or a main loop too busy to run callbacks promptly.
+   * @param nanoseconds   How long to spin, 0 to sleep at once, as by default.
+   */
+  useHandoffSpin(nanoseconds: number) {
+    if (this.released) {
+      throw new Error('EVM has been released!');
+    }
+    evmc.setEvmcHandoffSpin(this._evm, nanoseconds);
+  }
+
+  /**
+   * Sizes the table of BigInts reused across callbacks.
+   *
+   * Executions pass the same few addresses, storage keys and log topics to
+   * the callbacks again and again. The BigInt last created for each value is
+   * kept in a table of this many slots, by a hash of the value, and passed
+   * again instead of creating another, which saves the garbage collector
+   * work. Storage values and transferred amounts are always created anew.
+   * Interning is on by default, with 256 slots.
+   * @param capacity   Slots in the table, rounded up to a power of two, or 0
+   *                   to create every BigInt anew.
+   */
+  useInterning(capacity: number) {
+    if (this.released) {
+      throw new Error('EVM has been released!');
+    }
+    evmc.setEvmcInternCapacity(this._evm, capacity);
+  }
+
+  /** The counters of BigInts created and reused for callback arguments. */
+  get internStats(): EvmcInternStats {
+    const stats = evmc.getEvmcInternStats(this._evm);
+    const total = stats.hits + stats.misses;
+    return {...stats, hitRate: total === 0 ? 0 : stats.hits / total};
+  }
+
+  /** The counters of host calls waiting for their answers. */
+  static get handoffStats(): EvmcHandoffStats {
+    return evmc.getEvmcHandoffStats();
+  }
+
+  /**
+   * Profiles executions per contract code: how often each runs, the gas it
+   * uses, the time it spends in the VM and waiting on host callbacks, and
+   * the callbacks it makes, see [[profile]].
+   *
+   * Every run of a gas estimate counts as an execution. Counting is done with
+   * atomic adds in a fixed table, and only times host calls when enabled, so
+   * it is cheap enough to leave on.
+   * @param capacity   How many distinct contracts to count, or 0 to disable
+   *                   profiling, as by default. Replacing the profiler starts
+   *                   over with empty totals.
+   */
+  useProfiler(capacity: number) {
+    if (this.released) {
+      throw new Error('EVM has been released!');
+    }
+    evmc.setEvmcProfiler(this._evm, capacity);
+  }
+
+  /**
+   * Reports the contracts which have taken up the most of the EVM so far.
+   * @param limit   How many contracts to report.
+   * @param order   What to rank contracts by.
+   */
+  profile(limit = 20, order = EvmcProfileOrder.EVMC_PROFILE_BY_TIME):
+      EvmcProfile {
+    if (this.released) {
+      throw new Error('EVM has been released!');
+    }
+    return evmc.getEvmcProfile(this._evm, order, limit);
+  }
+
+  /**
+   * The counters of completion batching. Executions finishing together are
+   * resolved in batches of up to 64 on a single wakeup of the main thread.
+   */
+  get completionStats(): EvmcCompletionStats {
+    const stats = evmc.getEvmcCompletionStats(this._evm);
+    const meanBatch =
+        stats.batches === 0 ? 0 : stats.completions / stats.batches;
+    return {...stats, meanBatch};
+  }
+
+  /**
+   * Records every following execution, along with each host call it makes and
+   * the answer it got, to a binary trace file. Recording an execution costs a
+   * copy of everything crossing the host interface, but no extra callbacks.
+   * Executions which finish while recording are written whole, in the order
+   * they finish.
+   * @param path   The trace file to create, replacing any existing one.
+   *               Starting a new recording stops the current one.
+   */
+  startRecording(path: string) {
+    if (this.released) {
+      throw new Error('EVM has been released!');
+    }
+    evmc.startEvmcRecording(this._evm, path);
+  }
+
+  /**
+   * Stops recording. Executions already running are still written once they
+   * finish.
+   */
+  stopRecording() {
+    evmc.stopEvmcRecording(this._evm);
+  }
+
+  /**
+   * Runs every execution of a recorded trace on this EVM, answering host
+   * calls from the trace without calling back into JavaScript. Useful to
+   * benchmark a VM or to check that a different VM or revision behaves the
+   * same; an execution diverges once it makes a host call that was not
+   * recorded, and is answered with empty values from then on.
+   * @param path   A trace file written by [[startRecording]].
+   * @returns      A promise resolving to the outcome of the replay.
+   */
+  replay(path: string): Promise<EvmcReplayStats> {
+    if (this.released) {
+      throw new Error('EVM has been released!');
+    }
+    return evmc.replayEvmcTrace(this._evm, path);
+  }
+
+  /**
+   * Applies the writes journaled so far to the tries of a witness, and
+   * resolves with the new state root and the nodes which changed.
+   *
+   * The storage tries of the accounts written are updated in parallel on the
+   * thread pool, as scheduled work of this EVM, and the state trie after
+   * them. The witness must prove every account and slot written, as well as
+   * the siblings of removed slots whose branches collapse; otherwise the
+   * commitment is rejected with code EWITNESS, naming what had no proof.
+   * Writes journaled after the call are not included.
+   * @param writeSet   The writes to apply.
+   * @param witness    The state before the writes.
+   * @param schedule   The priority and deadline of the work. Throws with code
+   *                   EBUSY if the queue of its priority is full.
+   */
+  commit(
+      writeSet: EvmcWriteSet, witness: EvmcWitness,
+      schedule: EvmcSchedule = {}): Promise<EvmcCommitment> {
+    if (this.released) {
+      throw new Error('EVM has been released!');
+    }
+    if (writeSet.released) {
+      throw new Error('Write set has been released!');
+    }
+    if (witness.released) {
+      throw new Error('Witness has been released!');
+    }
+    return evmc.commitEvmcWriteSet(
+        this._evm, writeSet._writeSet, witness._witness, schedule);
   }
 
   /**
@@ -478,4 +2027,132 @@ export abstract class Evmc {
     evmc.releaseEvmcEvm(this._evm);
     this.released = true;
   }
-}
\ No newline at end of file
+}
+/**
+ * An [[Evmc]] running on a worker thread with its own event loop, so that its
+ * callbacks never delay the main loop.
+ *
+ * The host is loaded on the worker from a module whose default export (or
+ * the module itself) is a subclass of [[Evmc]]. It is constructed with the VM
+ * path and the host data, which must be cloneable, as must the contexts of
+ * executions. Only requests and their final results cross between threads;
+ * every callback runs on the worker. State views are bound to the thread they
+ * were created on and cannot be used.
+ */
+export class EvmcWorker {
+  released = false;
+  private worker: Worker;
+  private requests = 0;
+  private pending = new Map<
+      number,
+      {resolve: (reply: unknown) => void, reject: (error: Error) => void}>();
+
+  /**
+   * Starts the worker.
+   * @param hostModule  The path of the module to load the host from.
+   * @param vmPath      The path of the VM library.
+   * @param hostData    Passed to the constructor of the host.
+   */
+  constructor(hostModule: string, vmPath: string, hostData?: unknown) {
+    // The worker script is a sibling of this one, whether compiled or not.
+    const script = join(__dirname, `evmc.worker${extname(__filename)}`);
+    const workerData = {hostModule, vmPath, hostData};
+    // Under ts-node, the worker has to register it as well.
+    this.worker = extname(script) === '.ts' ?
+        new Worker(
+            `require('ts-node/register'); require(${JSON.stringify(script)});`,
+            {eval: true, workerData}) :
+        new Worker(script, {workerData});
+    this.worker.on('message', response => {
+      const request = this.pending.get(response.id)!;
+      this.settle(response.id);
+      if (response.error !== undefined) {
+        request.reject(
+            Object.assign(new Error(response.error.message), {
+              code: response.error.code
+            }));
+      } else {
+        request.resolve(response.reply);
+      }
+    });
+    const fail = (error: Error) => {
+      for (const [id, request] of this.pending) {
+        this.settle(id);
+        request.reject(error);
+      }
+      this.released = true;
+    };
+    this.worker.on('error', fail);
+    this.worker.on('exit', () => fail(new Error('EVM worker has exited!')));
+    // An idle worker does not keep the process alive.
+    this.worker.unref();
+  }
+
+  /** Executes on the worker, like [[Evmc.execute]] without a state view. */
+  async execute(
+      message: EvmcMessage, code: Buffer,
+      revision = EvmcRevision.EVMC_MAX_REVISION, schedule: EvmcSchedule = {},
+      options: EvmcExecutionOptions = {}): Promise<EvmcResult> {
+    const result = await this.request(
+        {method: 'execute', message, code, revision, schedule, options});
+    return EvmcWorker.toResult(result as EvmcResult);
+  }
+
+  /** Estimates gas on the worker, like [[Evmc.estimateGas]]. */
+  async estimateGas(
+      message: EvmcMessage, code: Buffer,
+      bounds: {lo?: bigint, hi?: bigint} = {},
+      revision = EvmcRevision.EVMC_MAX_REVISION, schedule: EvmcSchedule = {},
+      options: EvmcExecutionOptions = {}): Promise<EvmcGasEstimate> {
+    const estimate = await this.request({
+      method: 'estimateGas',
+      message,
+      code,
+      bounds,
+      revision,
+      schedule,
+      options
+    }) as EvmcGasEstimate;
+    return {gas: estimate.gas, result: EvmcWorker.toResult(estimate.result)};
+  }
+
+  /**
+   * Releases the EVM and stops the worker once the executions already sent
+   * to it are done.
+   */
+  release() {
+    this.worker.postMessage({method: 'release'});
+    this.released = true;
+  }
+
+  private request(request: {}): Promise<unknown> {
+    if (this.released) {
+      throw new Error('EVM has been released!');
+    }
+    const id = ++this.requests;
+    if (this.pending.size === 0) {
+      this.worker.ref();
+    }
+    return new Promise((resolve, reject) => {
+      this.pending.set(id, {resolve, reject});
+      this.worker.postMessage({...request, id});
+    });
+  }
+
+  private settle(id: number) {
+    this.pending.delete(id);
+    if (this.pending.size === 0) {
+      this.worker.unref();
+    }
+  }
+
+  /** Output arrives as a Uint8Array. */
+  private static toResult(result: EvmcResult): EvmcResult {
+    const output = result.outputData as Uint8Array;
+    return {
+      ...result,
+      outputData:
+          Buffer.from(output.buffer, output.byteOffset, output.byteLength)
+    };
+  }
+}
@@ -0,0 +1,75 @@
+import {parentPort, workerData} from 'worker_threads';
+
+import {Evmc, EvmcMessage, EvmcResult} from './evmc';
+
+/**
+ * The worker side of [[EvmcWorker]]: runs an [[Evmc]] loaded from the host
+ * module on this thread's loop, so its callbacks never run on the main one.
+ */
+
+type EvmcHostClass = new (path: string, data?: unknown) => Evmc;
+
+// tslint:disable-next-line:no-any
+const hostModule: any = require(workerData.hostModule);
+const Host: EvmcHostClass =
+    hostModule.default !== undefined ? hostModule.default : hostModule;
+const evm = new Host(workerData.vmPath, workerData.hostData);
+
+/** Buffers arrive as Uint8Arrays, which the binding does not take. */
+function toBuffer(data: Uint8Array): Buffer {
+  return Buffer.from(data.buffer, data.byteOffset, data.byteLength);
+}
+
+/** Copies the fields of a result, which are accessors that do not clone. */
+function toPlain(result: EvmcResult): EvmcResult {
+  return {
+    statusCode: result.statusCode,
+    gasLeft: result.gasLeft,
+    outputData: result.outputData,
+    createAddress: result.createAddress
+  };
+}
+
+let running = 0;
+let releasing = false;
+
+/** Releases the EVM once releasing and no execution is left. */
+function releaseIfIdle() {
+  if (releasing && running === 0) {
+    evm.release();
+    parentPort!.close();
+  }
+}
+
+parentPort!.on('message', async request => {
+  if (request.method === 'release') {
+    releasing = true;
+    releaseIfIdle();
+    return;
+  }
+  const message: EvmcMessage = {
+    ...request.message,
+    inputData: toBuffer(request.message.inputData)
+  };
+  const code = toBuffer(request.code);
+  running++;
+  try {
+    let reply;
+    if (request.method === 'execute') {
+      reply = toPlain(await evm.execute(
+          message, code, request.revision, undefined, request.schedule,
+          request.options));
+    } else {
+      const estimate = await evm.estimateGas(
+          message, code, request.bounds, request.revision, request.schedule,
+          request.options);
+      reply = {gas: estimate.gas, result: toPlain(estimate.result)};
+    }
+    parentPort!.postMessage({id: request.id, reply});
+  } catch (e) {
+    parentPort!.postMessage(
+        {id: request.id, error: {message: e.message, code: e.code}});
+  }
+  running--;
+  releaseIfIdle();
+});
@@ -0,0 +1,360 @@
+#include "field.h"
+
+#include <string.h>
+
+typedef unsigned __int128 uint128_t;
+
+/** out = a - b, returning the borrow. */
+static uint64_t sub4(uint64_t out[4], const uint64_t a[4], const uint64_t b[4]) {
+  uint64_t borrow = 0;
+  int i;
+  for (i = 0; i < 4; i++) {
+    uint128_t d = (uint128_t) a[i] - b[i] - borrow;
+    out[i] = (uint64_t) d;
+    borrow = (uint64_t) (d >> 64) & 1;
+  }
+  return borrow;
+}
+
+/** out = a + b, returning the carry. */
+static uint64_t add4(uint64_t out[4], const uint64_t a[4], const uint64_t b[4]) {
+  uint64_t carry = 0;
+  int i;
+  for (i = 0; i < 4; i++) {
+    uint128_t s = (uint128_t) a[i] + b[i] + carry;
+    out[i] = (uint64_t) s;
+    carry = (uint64_t) (s >> 64);
+  }
+  return carry;
+}
+
+static bool less_than_p(const struct field* f, const uint64_t a[4]) {
+  uint64_t tmp[4];
+  return sub4(tmp, a, f->p) != 0;
+}
+
+void fe_add(const struct field* f, fe* out, const fe* a, const fe* b) {
+  uint64_t sum[4];
+  uint64_t carry = add4(sum, a->w, b->w);
+  uint64_t reduced[4];
+  uint64_t borrow = sub4(reduced, sum, f->p);
+  // Keep the sum only if it did not overflow and was already below p.
+  if (carry == 0 && borrow != 0) {
+    memcpy(out->w, sum, sizeof(sum));
+  } else {
+    memcpy(out->w, reduced, sizeof(reduced));
+  }
+}
+
+void fe_sub(const struct field* f, fe* out, const fe* a, const fe* b) {
+  uint64_t diff[4];
+  if (sub4(diff, a->w, b->w) != 0) {
+    add4(diff, diff, f->p);
+  }
+  memcpy(out->w, diff, sizeof(diff));
+}
+
+void fe_neg(const struct field* f, fe* out, const fe* a) {
+  fe zero;
+  memset(&zero, 0, sizeof(zero));
+  fe_sub(f, out, &zero, a);
+}
+
+void fe_mul(const struct field* f, fe* out, const fe* a, const fe* b) {
+  // Coarsely integrated operand scanning Montgomery multiplication.
+  uint64_t t[6] = {0, 0, 0, 0, 0, 0};
+  int i, j;
+  for (i = 0; i < 4; i++) {
+    uint64_t c = 0;
+    for (j = 0; j < 4; j++) {
+      uint128_t s = (uint128_t) a->w[j] * b->w[i] + t[j] + c;
+      t[j] = (uint64_t) s;
+      c = (uint64_t) (s >> 64);
+    }
+    uint128_t s = (uint128_t) t[4] + c;
+    t[4] = (uint64_t) s;
+    t[5] = (uint64_t) (s >> 64);
+
+    uint64_t m = t[0] * f->n0;
+    s = (uint128_t) m * f->p[0] + t[0];
+    c = (uint64_t) (s >> 64);
+    for (j = 1; j < 4; j++) {
+      s = (uint128_t) m * f->p[j] + t[j] + c;
+      t[j - 1] = (uint64_t) s;
+      c = (uint64_t) (s >> 64);
+    }
+    s = (uint128_t) t[4] + c;
+    t[3] = (uint64_t) s;
+    t[4] = t[5] + (uint64_t) (s >> 64);
+  }
+
+  uint64_t reduced[4];
+  uint64_t borrow = sub4(reduced, t, f->p);
+  if (t[4] == 0 && borrow != 0) {
+    memcpy(out->w, t, sizeof(out->w));
+  } else {
+    memcpy(out->w, reduced, sizeof(reduced));
+  }
+}
+
+void fe_sqr(const struct field* f, fe* out, const fe* a) {
+  fe_mul(f, out, a, a);
+}
+
+void field_init(struct field* f, const uint64_t p[4]) {
+  memcpy(f->p, p, sizeof(f->p));
+
+  // Newton iteration for p^-1 mod 2^64, doubling the correct bits each step.
+  uint64_t inv = 1;
+  int i;
+  for (i = 0; i < 6; i++) {
+    inv *= 2 - p[0] * inv;
+  }
+  f->n0 = (uint64_t) 0 - inv;
+
+  // R mod p and R^2 mod p by repeated doubling of 1.
+  fe x;
+  memset(&x, 0, sizeof(x));
+  x.w[0] = 1;
+  for (i = 0; i < 512; i++) {
+    fe_add(f, &x, &x, &x);
+    if (i == 255) {
+      f->one = x;
+    }
+  }
+  f->r2 = x;
+}
+
+static void load_be(uint64_t out[4], const uint8_t in[32]) {
+  int i, j;
+  for (i = 0; i < 4; i++) {
+    uint64_t v = 0;
+    for (j = 0; j < 8; j++) {
+      v = (v << 8) | in[(3 - i) * 8 + j];
+    }
+    out[i] = v;
+  }
+}
+
+bool fe_from_bytes(const struct field* f, fe* out, const uint8_t in[32]) {
+  fe plain;
+  load_be(plain.w, in);
+  if (!less_than_p(f, plain.w)) {
+    return false;
+  }
+  fe_mul(f, out, &plain, &f->r2);
+  return true;
+}
+
+bool fe_from_bytes_reduce(const struct field* f, fe* out, const uint8_t in[32]) {
+  fe plain;
+  load_be(plain.w, in);
+  if (!less_than_p(f, plain.w)) {
+    sub4(plain.w, plain.w, f->p);
+    if (!less_than_p(f, plain.w)) {
+      return false;
+    }
+  }
+  fe_mul(f, out, &plain, &f->r2);
+  return true;
+}
+
+void fe_from_u64(const struct field* f, fe* out, uint64_t in) {
+  fe plain;
+  memset(&plain, 0, sizeof(plain));
+  plain.w[0] = in;
+  fe_mul(f, out, &plain, &f->r2);
+}
+
+static void fe_to_plain(const struct field* f, fe* out, const fe* in) {
+  fe one;
+  memset(&one, 0, sizeof(one));
+  one.w[0] = 1;
+  fe_mul(f, out, in, &one);
+}
+
+void fe_to_bytes(const struct field* f, uint8_t out[32], const fe* in) {
+  fe plain;
+  fe_to_plain(f, &plain, in);
+  int i, j;
+  for (i = 0; i < 4; i++) {
+    for (j = 0; j < 8; j++) {
+      out[(3 - i) * 8 + j] = (uint8_t) (plain.w[i] >> (56 - 8 * j));
+    }
+  }
+}
+
+bool fe_is_zero(const fe* a) {
+  return (a->w[0] | a->w[1] | a->w[2] | a->w[3]) == 0;
+}
+
+bool fe_eq(const fe* a, const fe* b) {
+  return memcmp(a->w, b->w, sizeof(a->w)) == 0;
+}
+
+bool fe_is_odd(const struct field* f, const fe* a) {
+  fe plain;
+  fe_to_plain(f, &plain, a);
+  return (plain.w[0] & 1) != 0;
+}
+
+void fe_pow(const struct field* f, fe* out, const fe* a, const uint64_t e[4]) {
+  fe result = f->one;
+  fe base = *a;
+  int i;
+  for (i = 255; i >= 0; i--) {
+    fe_sqr(f, &result, &result);
+    if ((e[i / 64] >> (i % 64)) & 1) {
+      fe_mul(f, &result, &result, &base);
+    }
+  }
+  *out = result;
+}
+
+void fe_inv(const struct field* f, fe* out, const fe* a) {
+  uint64_t e[4];
+  uint64_t two[4] = {2, 0, 0, 0};
+  sub4(e, f->p, two);
+  fe_pow(f, out, a, e);
+}
+
+void ec_set_infinity(const struct field* f, struct ec_point* out) {
+  out->x = f->one;
+  out->y = f->one;
+  memset(&out->z, 0, sizeof(out->z));
+}
+
+bool ec_is_infinity(const struct ec_point* p) {
+  return fe_is_zero(&p->z);
+}
+
+void ec_set_affine(const struct field* f, struct ec_point* out, const fe* x, const fe* y) {
+  out->x = *x;
+  out->y = *y;
+  out->z = f->one;
+}
+
+bool ec_is_on_curve(const struct field* f, const fe* b, const fe* x, const fe* y) {
+  fe lhs, rhs;
+  fe_sqr(f, &lhs, y);
+  fe_sqr(f, &rhs, x);
+  fe_mul(f, &rhs, &rhs, x);
+  fe_add(f, &rhs, &rhs, b);
+  return fe_eq(&lhs, &rhs);
+}
+
+void ec_double(const struct field* f, struct ec_point* out, const struct ec_point* p) {
+  if (ec_is_infinity(p) || fe_is_zero(&p->y)) {
+    ec_set_infinity(f, out);
+    return;
+  }
+
+  // dbl-2009-l, for curves with a = 0.
+  fe a, b, c, d, e, ff, t;
+  fe_sqr(f, &a, &p->x);
+  fe_sqr(f, &b, &p->y);
+  fe_sqr(f, &c, &b);
+  fe_add(f, &d, &p->x, &b);
+  fe_sqr(f, &d, &d);
+  fe_sub(f, &d, &d, &a);
+  fe_sub(f, &d, &d, &c);
+  fe_add(f, &d, &d, &d);
+  fe_add(f, &e, &a, &a);
+  fe_add(f, &e, &e, &a);
+  fe_sqr(f, &ff, &e);
+
+  struct ec_point r;
+  fe_add(f, &t, &d, &d);
+  fe_sub(f, &r.x, &ff, &t);
+
+  fe_add(f, &c, &c, &c);
+  fe_add(f, &c, &c, &c);
+  fe_add(f, &c, &c, &c);
+  fe_sub(f, &t, &d, &r.x);
+  fe_mul(f, &r.y, &e, &t);
+  fe_sub(f, &r.y, &r.y, &c);
+
+  fe_mul(f, &r.z, &p->y, &p->z);
+  fe_add(f, &r.z, &r.z, &r.z);
+  *out = r;
+}
+
+void ec_add(const struct field* f, struct ec_point* out, const struct ec_point* p, const struct ec_point* q) {
+  if (ec_is_infinity(p)) {
+    *out = *q;
+    return;
+  }
+  if (ec_is_infinity(q)) {
+    *out = *p;
+    return;
+  }
+
+  // add-2007-bl
+  fe z1z1, z2z2, u1, u2, s1, s2, h, i, j, r, v, t;
+  fe_sqr(f, &z1z1, &p->z);
+  fe_sqr(f, &z2z2, &q->z);
+  fe_mul(f, &u1, &p->x, &z2z2);
+  fe_mul(f, &u2, &q->x, &z1z1);
+  fe_mul(f, &s1, &p->y, &q->z);
+  fe_mul(f, &s1, &s1, &z2z2);
+  fe_mul(f, &s2, &q->y, &p->z);
+  fe_mul(f, &s2, &s2, &z1z1);
+  fe_sub(f, &h, &u2, &u1);
+  fe_sub(f, &r, &s2, &s1);
+
+  if (fe_is_zero(&h)) {
+    if (fe_is_zero(&r)) {
+      ec_double(f, out, p);
+    } else {
+      ec_set_infinity(f, out);
+    }
+    return;
+  }
+
+  fe_add(f, &i, &h, &h);
+  fe_sqr(f, &i, &i);
+  fe_mul(f, &j, &h, &i);
+  fe_add(f, &r, &r, &r);
+  fe_mul(f, &v, &u1, &i);
+
+  struct ec_point o;
+  fe_sqr(f, &o.x, &r);
+  fe_sub(f, &o.x, &o.x, &j);
+  fe_sub(f, &o.x, &o.x, &v);
+  fe_sub(f, &o.x, &o.x, &v);
+
+  fe_sub(f, &t, &v, &o.x);
+  fe_mul(f, &o.y, &r, &t);
+  fe_mul(f, &t, &s1, &j);
+  fe_add(f, &t, &t, &t);
+  fe_sub(f, &o.y, &o.y, &t);
+
+  fe_add(f, &o.z, &p->z, &q->z);
+  fe_sqr(f, &o.z, &o.z);
+  fe_sub(f, &o.z, &o.z, &z1z1);
+  fe_sub(f, &o.z, &o.z, &z2z2);
+  fe_mul(f, &o.z, &o.z, &h);
+  *out = o;
+}
+
+void ec_mul(const struct field* f, struct ec_point* out, const struct ec_point* p, const uint8_t scalar[32]) {
+  struct ec_point r;
+  ec_set_infinity(f, &r);
+  int i;
+  for (i = 0; i < 256; i++) {
+    ec_double(f, &r, &r);
+    if ((scalar[i / 8] >> (7 - i % 8)) & 1) {
+      ec_add(f, &r, &r, p);
+    }
+  }
+  *out = r;
+}
+
+void ec_to_affine(const struct field* f, fe* x, fe* y, const struct ec_point* p) {
+  fe zinv, zinv2, zinv3;
+  fe_inv(f, &zinv, &p->z);
+  fe_sqr(f, &zinv2, &zinv);
+  fe_mul(f, &zinv3, &zinv2, &zinv);
+  fe_mul(f, x, &p->x, &zinv2);
+  fe_mul(f, y, &p->y, &zinv3);
+}
@@ -0,0 +1,86 @@
+#ifndef EVMC_JS_FIELD_H
+#define EVMC_JS_FIELD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Arithmetic modulo a prime below 2^256, in Montgomery form.
+ *
+ * Elements are four little-endian 64-bit limbs. Every fe_* function expects
+ * its inputs in Montgomery form and fully reduced, and produces the same.
+ */
+
+typedef struct {
+  uint64_t w[4];
+} fe;
+
+struct field {
+  /** The modulus. */
+  uint64_t p[4];
+  /** -p^-1 mod 2^64. */
+  uint64_t n0;
+  /** R^2 mod p, where R = 2^256. */
+  fe r2;
+  /** 1 in Montgomery form. */
+  fe one;
+};
+
+void field_init(struct field* f, const uint64_t p[4]);
+
+/** Reads a big-endian number. Returns false if it is not below p. */
+bool fe_from_bytes(const struct field* f, fe* out, const uint8_t in[32]);
+
+/** Reads a big-endian number below 2p, reducing it modulo p. */
+bool fe_from_bytes_reduce(const struct field* f, fe* out, const uint8_t in[32]);
+
+void fe_from_u64(const struct field* f, fe* out, uint64_t in);
+void fe_to_bytes(const struct field* f, uint8_t out[32], const fe* in);
+
+bool fe_is_zero(const fe* a);
+bool fe_eq(const fe* a, const fe* b);
+
+void fe_add(const struct field* f, fe* out, const fe* a, const fe* b);
+void fe_sub(const struct field* f, fe* out, const fe* a, const fe* b);
+void fe_neg(const struct field* f, fe* out, const fe* a);
+void fe_mul(const struct field* f, fe* out, const fe* a, const fe* b);
+void fe_sqr(const struct field* f, fe* out, const fe* a);
+
+/** Raises a to a plain (not Montgomery) 256-bit exponent. */
+void fe_pow(const struct field* f, fe* out, const fe* a, const uint64_t e[4]);
+
+/** Inverts a through Fermat's little theorem. The inverse of zero is zero. */
+void fe_inv(const struct field* f, fe* out, const fe* a);
+
+/** Returns true if the plain value of a is odd. */
+bool fe_is_odd(const struct field* f, const fe* a);
+
+/**
+ * A point on a short Weierstrass curve y^2 = x^3 + b, in Jacobian coordinates.
+ * The point at infinity has z = 0.
+ */
+struct ec_point {
+  fe x;
+  fe y;
+  fe z;
+};
+
+void ec_set_infinity(const struct field* f, struct ec_point* out);
+bool ec_is_infinity(const struct ec_point* p);
+
+/** Sets out to the affine point (x, y). */
+void ec_set_affine(const struct field* f, struct ec_point* out, const fe* x, const fe* y);
+
+/** Returns true if the affine point (x, y) satisfies y^2 = x^3 + b. */
+bool ec_is_on_curve(const struct field* f, const fe* b, const fe* x, const fe* y);
+
+void ec_double(const struct field* f, struct ec_point* out, const struct ec_point* p);
+void ec_add(const struct field* f, struct ec_point* out, const struct ec_point* p, const struct ec_point* q);
+
+/** Multiplies p by a big-endian 256-bit scalar. */
+void ec_mul(const struct field* f, struct ec_point* out, const struct ec_point* p, const uint8_t scalar[32]);
+
+/** Converts p to affine coordinates. p must not be the point at infinity. */
+void ec_to_affine(const struct field* f, fe* x, fe* y, const struct ec_point* p);
+
+#endif
@@ -0,0 +1,119 @@
+#include "handoff.h"
+
+#include <stdbool.h>
+
+#include <uv.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/** Iterations between checks of the clock while spinning */
+#define SPINS_PER_CHECK 64
+
+enum handoff_state {
+  HANDOFF_PENDING,
+  HANDOFF_SIGNALED,
+  /** The waiter is asleep and must be woken */
+  HANDOFF_SLEEPING
+};
+
+struct evmc_handoff {
+  /** On a line of its own, as the waiter polls it while the signaler writes it */
+  _Alignas(64) uint32_t state;
+#ifndef __linux__
+  bool initialized;
+  uv_sem_t sem;
+#endif
+};
+
+static __thread struct evmc_handoff thread_handoff;
+
+/** CPUs the process may run on, or 0 before first use */
+static unsigned parallelism;
+
+static struct evmc_handoff_stats stats;
+
+static void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  __asm__ volatile("yield" ::: "memory");
+#endif
+}
+
+static void sleep_until_signaled(struct evmc_handoff* handoff) {
+#ifdef __linux__
+  while (__atomic_load_n(&handoff->state, __ATOMIC_ACQUIRE) == HANDOFF_SLEEPING) {
+    syscall(SYS_futex, &handoff->state, FUTEX_WAIT_PRIVATE, HANDOFF_SLEEPING, NULL, NULL, 0);
+  }
+#else
+  uv_sem_wait(&handoff->sem);
+#endif
+}
+
+static void wake(struct evmc_handoff* handoff) {
+#ifdef __linux__
+  syscall(SYS_futex, &handoff->state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#else
+  uv_sem_post(&handoff->sem);
+#endif
+}
+
+struct evmc_handoff* evmc_handoff_arm(void) {
+  struct evmc_handoff* handoff = &thread_handoff;
+#ifndef __linux__
+  if (!handoff->initialized) {
+    uv_sem_init(&handoff->sem, 0);
+    handoff->initialized = true;
+  }
+#endif
+  __atomic_store_n(&handoff->state, HANDOFF_PENDING, __ATOMIC_RELAXED);
+  return handoff;
+}
+
+void evmc_handoff_wait(struct evmc_handoff* handoff, uint64_t spin_ns) {
+  __atomic_add_fetch(&stats.waits, 1, __ATOMIC_RELAXED);
+
+  // With a single CPU, the answer cannot come while spinning.
+  if (parallelism == 0) {
+    parallelism = uv_available_parallelism();
+  }
+  if (spin_ns > 0 && parallelism > 1) {
+    uint64_t start = uv_hrtime();
+    uint64_t elapsed = 0;
+    unsigned spins = 0;
+    while (elapsed < spin_ns) {
+      if (__atomic_load_n(&handoff->state, __ATOMIC_ACQUIRE) == HANDOFF_SIGNALED) {
+        __atomic_add_fetch(&stats.spun, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&stats.spin_ns, uv_hrtime() - start, __ATOMIC_RELAXED);
+        return;
+      }
+      cpu_relax();
+      if (++spins % SPINS_PER_CHECK == 0) {
+        elapsed = uv_hrtime() - start;
+      }
+    }
+    __atomic_add_fetch(&stats.spin_ns, elapsed, __ATOMIC_RELAXED);
+  }
+
+  uint32_t expected = HANDOFF_PENDING;
+  if (__atomic_compare_exchange_n(&handoff->state, &expected, HANDOFF_SLEEPING, false,
+                                  __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+    sleep_until_signaled(handoff);
+  }
+}
+
+void evmc_handoff_signal(struct evmc_handoff* handoff) {
+  if (__atomic_exchange_n(&handoff->state, HANDOFF_SIGNALED, __ATOMIC_ACQ_REL) == HANDOFF_SLEEPING) {
+    wake(handoff);
+  }
+}
+
+void evmc_handoff_get_stats(struct evmc_handoff_stats* out) {
+  out->waits = __atomic_load_n(&stats.waits, __ATOMIC_RELAXED);
+  out->spun = __atomic_load_n(&stats.spun, __ATOMIC_RELAXED);
+  out->spin_ns = __atomic_load_n(&stats.spin_ns, __ATOMIC_RELAXED);
+}
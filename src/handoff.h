@@ -0,0 +1,42 @@
+#ifndef EVMC_JS_HANDOFF_H
+#define EVMC_JS_HANDOFF_H
+
+#include <stdint.h>
+
+/**
+ * Hands the answer of a host call from the main thread back to the worker
+ * thread waiting for it.
+ *
+ * Each thread has one handoff, reused by every call it makes, as a thread
+ * waits on one call at a time. The waiting thread may spin for a while before
+ * going to sleep, so that answers which are ready within microseconds, as
+ * from synchronous callbacks, are picked up without a kernel round trip. Only
+ * a thread which has gone to sleep costs the signaling thread a wakeup.
+ */
+
+struct evmc_handoff;
+
+struct evmc_handoff_stats {
+  /** Waits which were answered. */
+  uint64_t waits;
+  /** Waits answered while spinning, without sleeping. */
+  uint64_t spun;
+  /** Time spent spinning, in nanoseconds. */
+  uint64_t spin_ns;
+};
+
+/** Returns the handoff of the calling thread, armed for one wait. */
+struct evmc_handoff* evmc_handoff_arm(void);
+
+/**
+ * Waits until the handoff is signaled, spinning for up to spin_ns nanoseconds
+ * before sleeping. Writes made before the signal are visible once this returns.
+ */
+void evmc_handoff_wait(struct evmc_handoff* handoff, uint64_t spin_ns);
+
+/** Signals a handoff, which may then be reused by its thread at once. */
+void evmc_handoff_signal(struct evmc_handoff* handoff);
+
+void evmc_handoff_get_stats(struct evmc_handoff_stats* stats);
+
+#endif
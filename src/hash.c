@@ -0,0 +1,401 @@
+#include "hash.h"
+
+#include <string.h>
+
+#define ROTL64(x, n) (((x) << (n)) | ((x) >> (64 - (n))))
+#define ROTR64(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+#define ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static const uint64_t keccakf_rc[24] = {
+    0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL,
+    0x8000000080008000ULL, 0x000000000000808bULL, 0x0000000080000001ULL,
+    0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008aULL,
+    0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+    0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL,
+    0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
+    0x000000000000800aULL, 0x800000008000000aULL, 0x8000000080008081ULL,
+    0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL};
+
+static const int keccakf_rotc[24] = {1,  3,  6,  10, 15, 21, 28, 36,
+                                     45, 55, 2,  14, 27, 41, 56, 8,
+                                     25, 43, 62, 18, 39, 61, 20, 44};
+
+static const int keccakf_piln[24] = {10, 7,  11, 17, 18, 3,  5,  16,
+                                     8,  21, 24, 4,  15, 23, 19, 13,
+                                     12, 2,  20, 14, 22, 9,  6,  1};
+
+static void keccakf(uint64_t st[25]) {
+  int round, i, j;
+  uint64_t t, bc[5];
+
+  for (round = 0; round < 24; round++) {
+    // Theta
+    for (i = 0; i < 5; i++) {
+      bc[i] = st[i] ^ st[i + 5] ^ st[i + 10] ^ st[i + 15] ^ st[i + 20];
+    }
+    for (i = 0; i < 5; i++) {
+      t = bc[(i + 4) % 5] ^ ROTL64(bc[(i + 1) % 5], 1);
+      for (j = 0; j < 25; j += 5) {
+        st[j + i] ^= t;
+      }
+    }
+
+    // Rho and Pi
+    t = st[1];
+    for (i = 0; i < 24; i++) {
+      j = keccakf_piln[i];
+      bc[0] = st[j];
+      st[j] = ROTL64(t, keccakf_rotc[i]);
+      t = bc[0];
+    }
+
+    // Chi
+    for (j = 0; j < 25; j += 5) {
+      for (i = 0; i < 5; i++) {
+        bc[i] = st[j + i];
+      }
+      for (i = 0; i < 5; i++) {
+        st[j + i] ^= (~bc[(i + 1) % 5]) & bc[(i + 2) % 5];
+      }
+    }
+
+    // Iota
+    st[0] ^= keccakf_rc[round];
+  }
+}
+
+static uint64_t load64_le(const uint8_t* p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static void store64_le(uint8_t* p, uint64_t v) {
+  memcpy(p, &v, sizeof(v));
+}
+
+/** Keccak sponge with a 256-bit output. The suffix selects Keccak or SHA3. */
+static void keccak_sponge256(const uint8_t* data, size_t size, uint8_t suffix, uint8_t out[32]) {
+  const size_t rate = 136;
+  uint64_t st[25];
+  memset(st, 0, sizeof(st));
+
+  while (size >= rate) {
+    size_t i;
+    for (i = 0; i < rate / 8; i++) {
+      st[i] ^= load64_le(data + i * 8);
+    }
+    keccakf(st);
+    data += rate;
+    size -= rate;
+  }
+
+  uint8_t block[136];
+  memset(block, 0, sizeof(block));
+  memcpy(block, data, size);
+  block[size] ^= suffix;
+  block[rate - 1] ^= 0x80;
+
+  size_t i;
+  for (i = 0; i < rate / 8; i++) {
+    st[i] ^= load64_le(block + i * 8);
+  }
+  keccakf(st);
+
+  for (i = 0; i < 4; i++) {
+    store64_le(out + i * 8, st[i]);
+  }
+}
+
+void keccak256(const uint8_t* data, size_t size, uint8_t out[32]) {
+  keccak_sponge256(data, size, 0x01, out);
+}
+
+void sha3_256(const uint8_t* data, size_t size, uint8_t out[32]) {
+  keccak_sponge256(data, size, 0x06, out);
+}
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static void sha256_block(uint32_t h[8], const uint8_t block[64]) {
+  uint32_t w[64];
+  int i;
+  for (i = 0; i < 16; i++) {
+    w[i] = ((uint32_t) block[i * 4] << 24) | ((uint32_t) block[i * 4 + 1] << 16) |
+           ((uint32_t) block[i * 4 + 2] << 8) | block[i * 4 + 3];
+  }
+  for (i = 16; i < 64; i++) {
+    uint32_t s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+
+  uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+  uint32_t e = h[4], f = h[5], g = h[6], k = h[7];
+  for (i = 0; i < 64; i++) {
+    uint32_t s1 = ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25);
+    uint32_t ch = (e & f) ^ (~e & g);
+    uint32_t t1 = k + s1 + ch + sha256_k[i] + w[i];
+    uint32_t s0 = ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22);
+    uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+    uint32_t t2 = s0 + maj;
+    k = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+
+  h[0] += a;
+  h[1] += b;
+  h[2] += c;
+  h[3] += d;
+  h[4] += e;
+  h[5] += f;
+  h[6] += g;
+  h[7] += k;
+}
+
+void sha256(const uint8_t* data, size_t size, uint8_t out[32]) {
+  uint32_t h[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                   0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+  uint64_t bits = (uint64_t) size * 8;
+
+  while (size >= 64) {
+    sha256_block(h, data);
+    data += 64;
+    size -= 64;
+  }
+
+  uint8_t block[128];
+  memset(block, 0, sizeof(block));
+  memcpy(block, data, size);
+  block[size] = 0x80;
+  size_t padded = size + 9 > 64 ? 128 : 64;
+  int i;
+  for (i = 0; i < 8; i++) {
+    block[padded - 1 - i] = (uint8_t) (bits >> (8 * i));
+  }
+  sha256_block(h, block);
+  if (padded == 128) {
+    sha256_block(h, block + 64);
+  }
+
+  for (i = 0; i < 8; i++) {
+    out[i * 4] = (uint8_t) (h[i] >> 24);
+    out[i * 4 + 1] = (uint8_t) (h[i] >> 16);
+    out[i * 4 + 2] = (uint8_t) (h[i] >> 8);
+    out[i * 4 + 3] = (uint8_t) h[i];
+  }
+}
+
+uint64_t hash_code64(const uint8_t* code, size_t size) {
+  uint64_t h = 0x9e3779b97f4a7c15ULL ^ size;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    memcpy(&word, code + i, sizeof(word));
+    h = (h ^ word) * 0xff51afd7ed558ccdULL;
+    h ^= h >> 32;
+  }
+  uint64_t tail = 0;
+  for (; i < size; i++) {
+    tail = (tail << 8) | code[i];
+  }
+  h = (h ^ tail) * 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 29;
+  return h == 0 ? 1 : h;
+}
+
+static const uint8_t ripemd160_r[80] = {
+    0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15,
+    7,  4,  13, 1,  10, 6,  15, 3,  12, 0,  9,  5,  2,  14, 11, 8,
+    3,  10, 14, 4,  9,  15, 8,  1,  2,  7,  0,  6,  13, 11, 5,  12,
+    1,  9,  11, 10, 0,  8,  12, 4,  13, 3,  7,  15, 14, 5,  6,  2,
+    4,  0,  5,  9,  7,  12, 2,  10, 14, 1,  3,  8,  11, 6,  15, 13};
+
+static const uint8_t ripemd160_rp[80] = {
+    5,  14, 7,  0,  9,  2,  11, 4,  13, 6,  15, 8,  1,  10, 3,  12,
+    6,  11, 3,  7,  0,  13, 5,  10, 14, 15, 8,  12, 4,  9,  1,  2,
+    15, 5,  1,  3,  7,  14, 6,  9,  11, 8,  12, 2,  10, 0,  4,  13,
+    8,  6,  4,  1,  3,  11, 15, 0,  5,  12, 2,  13, 9,  7,  10, 14,
+    12, 15, 10, 4,  1,  5,  8,  7,  6,  2,  13, 14, 0,  3,  9,  11};
+
+static const uint8_t ripemd160_s[80] = {
+    11, 14, 15, 12, 5,  8,  7,  9,  11, 13, 14, 15, 6,  7,  9,  8,
+    7,  6,  8,  13, 11, 9,  7,  15, 7,  12, 15, 9,  11, 7,  13, 12,
+    11, 13, 6,  7,  14, 9,  13, 15, 14, 8,  13, 6,  5,  12, 7,  5,
+    11, 12, 14, 15, 14, 15, 9,  8,  9,  14, 5,  6,  8,  6,  5,  12,
+    9,  15, 5,  11, 6,  8,  13, 12, 5,  12, 13, 14, 11, 8,  5,  6};
+
+static const uint8_t ripemd160_sp[80] = {
+    8,  9,  9,  11, 13, 15, 15, 5,  7,  7,  8,  11, 14, 14, 12, 6,
+    9,  13, 15, 7,  12, 8,  9,  11, 7,  7,  12, 7,  6,  15, 13, 11,
+    9,  7,  15, 11, 8,  6,  6,  14, 12, 13, 5,  14, 13, 13, 7,  5,
+    15, 5,  8,  11, 14, 14, 6,  14, 6,  9,  12, 9,  12, 5,  15, 8,
+    8,  5,  12, 9,  12, 5,  14, 6,  8,  13, 6,  5,  15, 13, 11, 11};
+
+static const uint32_t ripemd160_k[5] = {0x00000000, 0x5a827999, 0x6ed9eba1,
+                                        0x8f1bbcdc, 0xa953fd4e};
+static const uint32_t ripemd160_kp[5] = {0x50a28be6, 0x5c4dd124, 0x6d703ef3,
+                                         0x7a6d76e9, 0x00000000};
+
+static uint32_t ripemd160_f(int j, uint32_t x, uint32_t y, uint32_t z) {
+  switch (j / 16) {
+    case 0:
+      return x ^ y ^ z;
+    case 1:
+      return (x & y) | (~x & z);
+    case 2:
+      return (x | ~y) ^ z;
+    case 3:
+      return (x & z) | (y & ~z);
+    default:
+      return x ^ (y | ~z);
+  }
+}
+
+static void ripemd160_block(uint32_t h[5], const uint8_t block[64]) {
+  uint32_t x[16];
+  int j;
+  for (j = 0; j < 16; j++) {
+    x[j] = (uint32_t) block[j * 4] | ((uint32_t) block[j * 4 + 1] << 8) |
+           ((uint32_t) block[j * 4 + 2] << 16) | ((uint32_t) block[j * 4 + 3] << 24);
+  }
+
+  uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+  uint32_t ap = h[0], bp = h[1], cp = h[2], dp = h[3], ep = h[4];
+  uint32_t t;
+  for (j = 0; j < 80; j++) {
+    t = a + ripemd160_f(j, b, c, d) + x[ripemd160_r[j]] + ripemd160_k[j / 16];
+    t = ROTL32(t, ripemd160_s[j]) + e;
+    a = e;
+    e = d;
+    d = ROTL32(c, 10);
+    c = b;
+    b = t;
+
+    t = ap + ripemd160_f(79 - j, bp, cp, dp) + x[ripemd160_rp[j]] + ripemd160_kp[j / 16];
+    t = ROTL32(t, ripemd160_sp[j]) + ep;
+    ap = ep;
+    ep = dp;
+    dp = ROTL32(cp, 10);
+    cp = bp;
+    bp = t;
+  }
+
+  t = h[1] + c + dp;
+  h[1] = h[2] + d + ep;
+  h[2] = h[3] + e + ap;
+  h[3] = h[4] + a + bp;
+  h[4] = h[0] + b + cp;
+  h[0] = t;
+}
+
+void ripemd160(const uint8_t* data, size_t size, uint8_t out[20]) {
+  uint32_t h[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+  uint64_t bits = (uint64_t) size * 8;
+
+  while (size >= 64) {
+    ripemd160_block(h, data);
+    data += 64;
+    size -= 64;
+  }
+
+  uint8_t block[128];
+  memset(block, 0, sizeof(block));
+  memcpy(block, data, size);
+  block[size] = 0x80;
+  size_t padded = size + 9 > 64 ? 128 : 64;
+  int i;
+  for (i = 0; i < 8; i++) {
+    block[padded - 8 + i] = (uint8_t) (bits >> (8 * i));
+  }
+  ripemd160_block(h, block);
+  if (padded == 128) {
+    ripemd160_block(h, block + 64);
+  }
+
+  for (i = 0; i < 5; i++) {
+    out[i * 4] = (uint8_t) h[i];
+    out[i * 4 + 1] = (uint8_t) (h[i] >> 8);
+    out[i * 4 + 2] = (uint8_t) (h[i] >> 16);
+    out[i * 4 + 3] = (uint8_t) (h[i] >> 24);
+  }
+}
+
+static const uint64_t blake2b_iv[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL,
+    0xa54ff53a5f1d36f1ULL, 0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+    0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL};
+
+static const uint8_t blake2b_sigma[10][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+    {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+    {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+    {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+    {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0}};
+
+#define BLAKE2B_G(a, b, c, d, x, y) \
+  do {                              \
+    v[a] = v[a] + v[b] + (x);       \
+    v[d] = ROTR64(v[d] ^ v[a], 32); \
+    v[c] = v[c] + v[d];             \
+    v[b] = ROTR64(v[b] ^ v[c], 24); \
+    v[a] = v[a] + v[b] + (y);       \
+    v[d] = ROTR64(v[d] ^ v[a], 16); \
+    v[c] = v[c] + v[d];             \
+    v[b] = ROTR64(v[b] ^ v[c], 63); \
+  } while (0)
+
+void blake2b_compress(uint32_t rounds, uint64_t h[8], const uint64_t m[16],
+                      const uint64_t t[2], int last) {
+  uint64_t v[16];
+  int i;
+  for (i = 0; i < 8; i++) {
+    v[i] = h[i];
+    v[i + 8] = blake2b_iv[i];
+  }
+  v[12] ^= t[0];
+  v[13] ^= t[1];
+  if (last) {
+    v[14] = ~v[14];
+  }
+
+  uint32_t round;
+  for (round = 0; round < rounds; round++) {
+    const uint8_t* s = blake2b_sigma[round % 10];
+    BLAKE2B_G(0, 4, 8, 12, m[s[0]], m[s[1]]);
+    BLAKE2B_G(1, 5, 9, 13, m[s[2]], m[s[3]]);
+    BLAKE2B_G(2, 6, 10, 14, m[s[4]], m[s[5]]);
+    BLAKE2B_G(3, 7, 11, 15, m[s[6]], m[s[7]]);
+    BLAKE2B_G(0, 5, 10, 15, m[s[8]], m[s[9]]);
+    BLAKE2B_G(1, 6, 11, 12, m[s[10]], m[s[11]]);
+    BLAKE2B_G(2, 7, 8, 13, m[s[12]], m[s[13]]);
+    BLAKE2B_G(3, 4, 9, 14, m[s[14]], m[s[15]]);
+  }
+
+  for (i = 0; i < 8; i++) {
+    h[i] ^= v[i] ^ v[i + 8];
+  }
+}
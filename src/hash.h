@@ -0,0 +1,34 @@
+#ifndef EVMC_JS_HASH_H
+#define EVMC_JS_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Keccak-256, as used by Ethereum (not the padded NIST SHA3-256). */
+void keccak256(const uint8_t* data, size_t size, uint8_t out[32]);
+
+/** NIST SHA3-256. Shares the Keccak permutation with keccak256. */
+void sha3_256(const uint8_t* data, size_t size, uint8_t out[32]);
+
+void sha256(const uint8_t* data, size_t size, uint8_t out[32]);
+
+/**
+ * A fast 64-bit hash of code, for keying tables by it. Never returns zero, so
+ * zero can mark an unused slot. Not collision resistant.
+ */
+uint64_t hash_code64(const uint8_t* code, size_t size);
+
+void ripemd160(const uint8_t* data, size_t size, uint8_t out[20]);
+
+/**
+ * The BLAKE2b compression function F, as exposed by EIP-152.
+ * @param rounds  The number of rounds.
+ * @param h       The state vector, updated in place.
+ * @param m       The message block.
+ * @param t       The offset counters.
+ * @param last    Whether this is the final block.
+ */
+void blake2b_compress(uint32_t rounds, uint64_t h[8], const uint64_t m[16],
+                      const uint64_t t[2], int last);
+
+#endif
@@ -0,0 +1,77 @@
+#include "intern.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/** Large enough for any working set, small enough to index with a uint32_t */
+#define MAX_CAPACITY (1u << 20)
+
+struct evmc_intern_table {
+  uint32_t shift;
+  uint32_t capacity;
+  /** Which slots hold a value, as zero is a value too */
+  uint8_t* used;
+  evmc_bytes32* values;
+};
+
+struct evmc_intern_table* evmc_intern_table_create(size_t capacity) {
+  if (capacity == 0 || capacity > MAX_CAPACITY) {
+    return NULL;
+  }
+  uint32_t bits = 0;
+  while (((size_t) 1 << bits) < capacity) {
+    bits++;
+  }
+
+  struct evmc_intern_table* table = (struct evmc_intern_table*) malloc(sizeof(struct evmc_intern_table));
+  if (table == NULL) {
+    return NULL;
+  }
+  table->capacity = 1u << bits;
+  table->shift = 64 - bits;
+  table->used = (uint8_t*) calloc(table->capacity, sizeof(uint8_t));
+  table->values = (evmc_bytes32*) malloc(table->capacity * sizeof(evmc_bytes32));
+  if (table->used == NULL || table->values == NULL) {
+    evmc_intern_table_free(table);
+    return NULL;
+  }
+  return table;
+}
+
+void evmc_intern_table_free(struct evmc_intern_table* table) {
+  free(table->used);
+  free(table->values);
+  free(table);
+}
+
+size_t evmc_intern_table_capacity(const struct evmc_intern_table* table) {
+  return table->capacity;
+}
+
+static uint64_t load64(const uint8_t* bytes) {
+  uint64_t word;
+  memcpy(&word, bytes, sizeof(word));
+  return word;
+}
+
+static uint64_t rotate(uint64_t word, unsigned bits) {
+  return (word << bits) | (word >> (64 - bits));
+}
+
+bool evmc_intern_table_find(struct evmc_intern_table* table, const evmc_bytes32* value,
+                            uint32_t* slot) {
+  // Padded addresses and small keys are mostly zero, so every word counts.
+  uint64_t hash = load64(value->bytes) ^ rotate(load64(value->bytes + 8), 17) ^
+                  rotate(load64(value->bytes + 16), 31) ^ rotate(load64(value->bytes + 24), 47);
+  hash *= 0x9e3779b97f4a7c15ull;
+  // A shift by 64 is undefined, and a table of one slot needs no hash.
+  uint32_t index = table->shift == 64 ? 0 : (uint32_t) (hash >> table->shift);
+
+  *slot = index;
+  if (table->used[index] && memcmp(&table->values[index], value, sizeof(evmc_bytes32)) == 0) {
+    return true;
+  }
+  table->used[index] = 1;
+  table->values[index] = *value;
+  return false;
+}
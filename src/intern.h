@@ -0,0 +1,39 @@
+#ifndef EVMC_JS_INTERN_H
+#define EVMC_JS_INTERN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "evmc/evmc.h"
+
+/**
+ * Direct mapped table of recently seen 32 byte values, such as addresses and
+ * storage keys, by slot. The caller keeps the converted value of each slot
+ * alongside, and only converts a value again when it is not in its slot.
+ *
+ * Addresses are interned as their 32 byte left padded form, so they share
+ * slots with keys of the same numeric value. A table is used by one thread.
+ */
+
+struct evmc_intern_table;
+
+/**
+ * Creates a table with capacity slots, rounded up to a power of two. Returns
+ * NULL if capacity is 0 or too large.
+ */
+struct evmc_intern_table* evmc_intern_table_create(size_t capacity);
+
+void evmc_intern_table_free(struct evmc_intern_table* table);
+
+size_t evmc_intern_table_capacity(const struct evmc_intern_table* table);
+
+/**
+ * Finds the slot of value. Returns true if it already holds value, or claims
+ * the slot for value, dropping what it held, and returns false; the caller
+ * then replaces its converted value of the slot.
+ */
+bool evmc_intern_table_find(struct evmc_intern_table* table, const evmc_bytes32* value,
+                            uint32_t* slot);
+
+#endif
@@ -0,0 +1,529 @@
+#include "precompiles.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bn256.h"
+#include "hash.h"
+#include "secp256k1.h"
+
+struct precompile {
+  /** The first revision the contract exists in. */
+  enum evmc_revision since;
+
+  /** Returns the gas cost of running the contract on input, saturating at INT64_MAX. */
+  int64_t (*cost)(const uint8_t* input, size_t size, enum evmc_revision revision);
+
+  /**
+   * Runs the contract, setting *output to a malloc'd buffer of *output_size
+   * bytes. Returns false if the input is invalid.
+   */
+  bool (*run)(const uint8_t* input, size_t size, uint8_t** output, size_t* output_size);
+};
+
+static int64_t saturate(unsigned __int128 value) {
+  return value > INT64_MAX ? INT64_MAX : (int64_t) value;
+}
+
+static int64_t linear_cost(size_t size, uint64_t base, uint64_t per_word) {
+  return saturate(base + (unsigned __int128) per_word * ((size / 32) + (size % 32 != 0)));
+}
+
+/** Copies input[offset, offset + length) into out, zero-filling past the end of input. */
+static void read_padded(uint8_t* out, size_t length, const uint8_t* input, size_t size,
+                        size_t offset) {
+  size_t available = offset < size ? size - offset : 0;
+  if (available > length) {
+    available = length;
+  }
+  if (available > 0) {
+    memcpy(out, input + offset, available);
+  }
+  memset(out + available, 0, length - available);
+}
+
+static bool allocate_output(uint8_t** output, size_t* output_size, size_t size) {
+  *output_size = size;
+  *output = size > 0 ? (uint8_t*) malloc(size) : NULL;
+  return true;
+}
+
+static int64_t ecrecover_cost(const uint8_t* input, size_t size, enum evmc_revision revision) {
+  return 3000;
+}
+
+static bool ecrecover_run(const uint8_t* input, size_t size, uint8_t** output,
+                          size_t* output_size) {
+  uint8_t padded[128];
+  read_padded(padded, sizeof(padded), input, size, 0);
+
+  // An invalid signature is not an error: the output is simply empty.
+  allocate_output(output, output_size, 0);
+
+  // v is a full word, which must be exactly 27 or 28.
+  size_t i;
+  for (i = 32; i < 63; i++) {
+    if (padded[i] != 0) {
+      return true;
+    }
+  }
+  if (padded[63] != 27 && padded[63] != 28) {
+    return true;
+  }
+
+  uint8_t pubkey[64];
+  if (!secp256k1_recover(padded, padded[63] - 27, padded + 64, padded + 96, pubkey)) {
+    return true;
+  }
+
+  uint8_t hash[32];
+  keccak256(pubkey, sizeof(pubkey), hash);
+  allocate_output(output, output_size, 32);
+  memset(*output, 0, 12);
+  memcpy(*output + 12, hash + 12, 20);
+  return true;
+}
+
+static int64_t sha256_cost(const uint8_t* input, size_t size, enum evmc_revision revision) {
+  return linear_cost(size, 60, 12);
+}
+
+static bool sha256_run(const uint8_t* input, size_t size, uint8_t** output,
+                       size_t* output_size) {
+  allocate_output(output, output_size, 32);
+  sha256(input, size, *output);
+  return true;
+}
+
+static int64_t ripemd160_cost(const uint8_t* input, size_t size, enum evmc_revision revision) {
+  return linear_cost(size, 600, 120);
+}
+
+static bool ripemd160_run(const uint8_t* input, size_t size, uint8_t** output,
+                          size_t* output_size) {
+  allocate_output(output, output_size, 32);
+  memset(*output, 0, 12);
+  ripemd160(input, size, *output + 12);
+  return true;
+}
+
+static int64_t identity_cost(const uint8_t* input, size_t size, enum evmc_revision revision) {
+  return linear_cost(size, 15, 3);
+}
+
+static bool identity_run(const uint8_t* input, size_t size, uint8_t** output,
+                         size_t* output_size) {
+  allocate_output(output, output_size, size);
+  if (size > 0) {
+    memcpy(*output, input, size);
+  }
+  return true;
+}
+
+/** Reads a 32-byte big-endian length, saturating at UINT64_MAX. */
+static uint64_t read_length(const uint8_t* input, size_t size, size_t offset) {
+  uint8_t word[32];
+  read_padded(word, sizeof(word), input, size, offset);
+  uint64_t value = 0;
+  int i;
+  for (i = 0; i < 24; i++) {
+    if (word[i] != 0) {
+      return UINT64_MAX;
+    }
+  }
+  for (i = 24; i < 32; i++) {
+    value = (value << 8) | word[i];
+  }
+  return value;
+}
+
+static int bit_length(const uint8_t* bytes, size_t length) {
+  size_t i;
+  for (i = 0; i < length; i++) {
+    if (bytes[i] != 0) {
+      return (int) ((length - i - 1) * 8) + 32 - __builtin_clz(bytes[i]);
+    }
+  }
+  return 0;
+}
+
+/** The EIP-198 multiplication complexity. */
+static unsigned __int128 modexp_complexity(uint64_t x) {
+  unsigned __int128 x2 = (unsigned __int128) x * x;
+  if (x <= 64) {
+    return x2;
+  }
+  if (x <= 1024) {
+    return x2 / 4 + 96 * (unsigned __int128) x - 3072;
+  }
+  return x2 / 16 + 480 * (unsigned __int128) x - 199680;
+}
+
+static int64_t modexp_cost(const uint8_t* input, size_t size, enum evmc_revision revision) {
+  uint64_t base_length = read_length(input, size, 0);
+  uint64_t exponent_length = read_length(input, size, 32);
+  uint64_t modulus_length = read_length(input, size, 64);
+
+  // Anything this large costs more gas than can ever be supplied.
+  const uint64_t limit = (uint64_t) 1 << 32;
+  if (base_length > limit || exponent_length > limit || modulus_length > limit) {
+    return INT64_MAX;
+  }
+
+  uint8_t head[32];
+  size_t head_length = exponent_length < 32 ? exponent_length : 32;
+  size_t head_offset = 96 + base_length;
+  read_padded(head, head_length, input, size, head_offset);
+  int head_bits = bit_length(head, head_length);
+
+  uint64_t adjusted = head_bits > 0 ? head_bits - 1 : 0;
+  if (exponent_length > 32) {
+    adjusted += 8 * (exponent_length - 32);
+  }
+  if (adjusted < 1) {
+    adjusted = 1;
+  }
+
+  uint64_t longest = base_length > modulus_length ? base_length : modulus_length;
+  unsigned __int128 complexity = modexp_complexity(longest);
+  if (complexity > ((unsigned __int128) 1 << 80)) {
+    return INT64_MAX;
+  }
+  return saturate(complexity * adjusted / 20);
+}
+
+/** Converts big-endian bytes to little-endian 32-bit limbs. */
+static void limbs_from_bytes(uint32_t* out, size_t limbs, const uint8_t* bytes, size_t length) {
+  memset(out, 0, limbs * sizeof(uint32_t));
+  size_t i;
+  for (i = 0; i < length; i++) {
+    size_t position = length - 1 - i;
+    out[position / 4] |= (uint32_t) bytes[i] << (8 * (position % 4));
+  }
+}
+
+static void limbs_to_bytes(uint8_t* out, size_t length, const uint32_t* limbs, size_t count) {
+  size_t i;
+  for (i = 0; i < length; i++) {
+    size_t position = length - 1 - i;
+    out[i] = position / 4 < count ? (uint8_t) (limbs[position / 4] >> (8 * (position % 4))) : 0;
+  }
+}
+
+/**
+ * Sets r to u mod v, where u has m limbs and v has n limbs with a nonzero top
+ * limb and m >= n (Knuth's algorithm D). scratch must hold m + n + 1 limbs.
+ */
+static void limbs_mod(uint32_t* r, const uint32_t* u, size_t m, const uint32_t* v, size_t n,
+                      uint32_t* scratch) {
+  const uint64_t b = (uint64_t) 1 << 32;
+  size_t i;
+
+  if (n == 1) {
+    uint64_t k = 0;
+    for (i = m; i-- > 0;) {
+      k = ((k << 32) | u[i]) % v[0];
+    }
+    r[0] = (uint32_t) k;
+    return;
+  }
+
+  // Normalize so that the top limb of v has its high bit set.
+  int s = __builtin_clz(v[n - 1]);
+  uint32_t* vn = scratch;
+  uint32_t* un = scratch + n;
+  for (i = n - 1; i > 0; i--) {
+    vn[i] = (v[i] << s) | (uint32_t) ((uint64_t) v[i - 1] >> (32 - s));
+  }
+  vn[0] = v[0] << s;
+  un[m] = (uint32_t) ((uint64_t) u[m - 1] >> (32 - s));
+  for (i = m - 1; i > 0; i--) {
+    un[i] = (u[i] << s) | (uint32_t) ((uint64_t) u[i - 1] >> (32 - s));
+  }
+  un[0] = u[0] << s;
+
+  size_t j;
+  for (j = m - n + 1; j-- > 0;) {
+    uint64_t numerator = ((uint64_t) un[j + n] << 32) | un[j + n - 1];
+    uint64_t qhat = numerator / vn[n - 1];
+    uint64_t rhat = numerator % vn[n - 1];
+    while (qhat >= b || qhat * vn[n - 2] > ((rhat << 32) | un[j + n - 2])) {
+      qhat--;
+      rhat += vn[n - 1];
+      if (rhat >= b) {
+        break;
+      }
+    }
+
+    // Multiply and subtract.
+    int64_t k = 0, t;
+    for (i = 0; i < n; i++) {
+      uint64_t p = qhat * vn[i];
+      t = (int64_t) un[i + j] - k - (int64_t) (p & 0xffffffff);
+      un[i + j] = (uint32_t) t;
+      k = (int64_t) (p >> 32) - (t >> 32);
+    }
+    t = (int64_t) un[j + n] - k;
+    un[j + n] = (uint32_t) t;
+
+    // The estimate was one too large: add v back.
+    if (t < 0) {
+      uint64_t carry = 0;
+      for (i = 0; i < n; i++) {
+        uint64_t sum = (uint64_t) un[i + j] + vn[i] + carry;
+        un[i + j] = (uint32_t) sum;
+        carry = sum >> 32;
+      }
+      un[j + n] += (uint32_t) carry;
+    }
+  }
+
+  for (i = 0; i < n - 1; i++) {
+    r[i] = (un[i] >> s) | (uint32_t) ((uint64_t) un[i + 1] << (32 - s));
+  }
+  r[n - 1] = un[n - 1] >> s;
+}
+
+/** Sets out to a * b mod m, all of n limbs. product must hold 2n limbs. */
+static void limbs_mulmod(uint32_t* out, const uint32_t* a, const uint32_t* b, const uint32_t* m,
+                         size_t n, uint32_t* product, uint32_t* scratch) {
+  memset(product, 0, 2 * n * sizeof(uint32_t));
+  size_t i, j;
+  for (i = 0; i < n; i++) {
+    uint64_t carry = 0;
+    if (a[i] == 0) {
+      continue;
+    }
+    for (j = 0; j < n; j++) {
+      uint64_t t = (uint64_t) a[i] * b[j] + product[i + j] + carry;
+      product[i + j] = (uint32_t) t;
+      carry = t >> 32;
+    }
+    product[i + n] = (uint32_t) carry;
+  }
+  limbs_mod(out, product, 2 * n, m, n, scratch);
+}
+
+static bool modexp_run(const uint8_t* input, size_t size, uint8_t** output,
+                       size_t* output_size) {
+  // The cost has already bounded these lengths.
+  size_t base_length = read_length(input, size, 0);
+  size_t exponent_length = read_length(input, size, 32);
+  size_t modulus_length = read_length(input, size, 64);
+
+  allocate_output(output, output_size, modulus_length);
+  if (modulus_length == 0) {
+    return true;
+  }
+
+  uint8_t* bytes = (uint8_t*) malloc(base_length + exponent_length + modulus_length);
+  uint8_t* base_bytes = bytes;
+  uint8_t* exponent_bytes = bytes + base_length;
+  uint8_t* modulus_bytes = exponent_bytes + exponent_length;
+  read_padded(base_bytes, base_length, input, size, 96);
+  read_padded(exponent_bytes, exponent_length, input, size, 96 + base_length);
+  read_padded(modulus_bytes, modulus_length, input, size, 96 + base_length + exponent_length);
+
+  size_t n = (modulus_length + 3) / 4;
+  size_t base_limbs = (base_length + 3) / 4;
+  size_t wide = base_limbs > 2 * n ? base_limbs : 2 * n;
+
+  uint32_t* modulus = (uint32_t*) malloc(n * sizeof(uint32_t));
+  uint32_t* result = (uint32_t*) calloc(n, sizeof(uint32_t));
+  uint32_t* power = (uint32_t*) calloc(n, sizeof(uint32_t));
+  uint32_t* product = (uint32_t*) calloc(wide, sizeof(uint32_t));
+  uint32_t* scratch = (uint32_t*) malloc((wide + n + 1) * sizeof(uint32_t));
+
+  limbs_from_bytes(modulus, n, modulus_bytes, modulus_length);
+  while (n > 0 && modulus[n - 1] == 0) {
+    n--;
+  }
+
+  // A zero modulus gives zero; the output is already sized for the full length.
+  if (n > 0) {
+    size_t m = base_limbs > n ? base_limbs : n;
+    limbs_from_bytes(product, m, base_bytes, base_length);
+    limbs_mod(power, product, m, modulus, n, scratch);
+
+    // result = 1 mod modulus
+    memset(product, 0, n * sizeof(uint32_t));
+    product[0] = 1;
+    limbs_mod(result, product, n, modulus, n, scratch);
+
+    int bits = bit_length(exponent_bytes, exponent_length);
+    int i;
+    for (i = bits - 1; i >= 0; i--) {
+      limbs_mulmod(result, result, result, modulus, n, product, scratch);
+      if ((exponent_bytes[exponent_length - 1 - i / 8] >> (i % 8)) & 1) {
+        limbs_mulmod(result, result, power, modulus, n, product, scratch);
+      }
+    }
+  }
+  limbs_to_bytes(*output, modulus_length, result, n);
+
+  free(scratch);
+  free(product);
+  free(power);
+  free(result);
+  free(modulus);
+  free(bytes);
+  return true;
+}
+
+static int64_t bn256_add_cost(const uint8_t* input, size_t size, enum evmc_revision revision) {
+  return revision >= EVMC_ISTANBUL ? 150 : 500;
+}
+
+static bool bn256_add_run(const uint8_t* input, size_t size, uint8_t** output,
+                          size_t* output_size) {
+  uint8_t padded[128];
+  read_padded(padded, sizeof(padded), input, size, 0);
+  allocate_output(output, output_size, 64);
+  return bn256_add(padded, *output);
+}
+
+static int64_t bn256_mul_cost(const uint8_t* input, size_t size, enum evmc_revision revision) {
+  return revision >= EVMC_ISTANBUL ? 6000 : 40000;
+}
+
+static bool bn256_mul_run(const uint8_t* input, size_t size, uint8_t** output,
+                          size_t* output_size) {
+  uint8_t padded[96];
+  read_padded(padded, sizeof(padded), input, size, 0);
+  allocate_output(output, output_size, 64);
+  return bn256_scalar_mul(padded, *output);
+}
+
+static int64_t bn256_pairing_cost(const uint8_t* input, size_t size,
+                                  enum evmc_revision revision) {
+  uint64_t pairs = size / 192;
+  if (revision >= EVMC_ISTANBUL) {
+    return saturate(45000 + (unsigned __int128) 34000 * pairs);
+  }
+  return saturate(100000 + (unsigned __int128) 80000 * pairs);
+}
+
+static bool bn256_pairing_run(const uint8_t* input, size_t size, uint8_t** output,
+                              size_t* output_size) {
+  if (size % 192 != 0) {
+    return false;
+  }
+  bool success;
+  if (!bn256_pairing_check(input, size / 192, &success)) {
+    return false;
+  }
+  allocate_output(output, output_size, 32);
+  memset(*output, 0, 32);
+  (*output)[31] = success ? 1 : 0;
+  return true;
+}
+
+static uint64_t load_le64(const uint8_t* bytes) {
+  uint64_t value = 0;
+  int i;
+  for (i = 7; i >= 0; i--) {
+    value = (value << 8) | bytes[i];
+  }
+  return value;
+}
+
+static int64_t blake2f_cost(const uint8_t* input, size_t size, enum evmc_revision revision) {
+  if (size != 213) {
+    return 0;
+  }
+  return ((uint32_t) input[0] << 24) | ((uint32_t) input[1] << 16) |
+         ((uint32_t) input[2] << 8) | input[3];
+}
+
+static bool blake2f_run(const uint8_t* input, size_t size, uint8_t** output,
+                        size_t* output_size) {
+  if (size != 213 || input[212] > 1) {
+    return false;
+  }
+
+  uint32_t rounds = (uint32_t) blake2f_cost(input, size, EVMC_ISTANBUL);
+  uint64_t h[8], m[16], t[2];
+  int i;
+  for (i = 0; i < 8; i++) {
+    h[i] = load_le64(input + 4 + 8 * i);
+  }
+  for (i = 0; i < 16; i++) {
+    m[i] = load_le64(input + 68 + 8 * i);
+  }
+  t[0] = load_le64(input + 196);
+  t[1] = load_le64(input + 204);
+
+  blake2b_compress(rounds, h, m, t, input[212]);
+
+  allocate_output(output, output_size, 64);
+  for (i = 0; i < 64; i++) {
+    (*output)[i] = (uint8_t) (h[i / 8] >> (8 * (i % 8)));
+  }
+  return true;
+}
+
+static const struct precompile precompiles[] = {
+    {EVMC_FRONTIER, ecrecover_cost, ecrecover_run},
+    {EVMC_FRONTIER, sha256_cost, sha256_run},
+    {EVMC_FRONTIER, ripemd160_cost, ripemd160_run},
+    {EVMC_FRONTIER, identity_cost, identity_run},
+    {EVMC_BYZANTIUM, modexp_cost, modexp_run},
+    {EVMC_BYZANTIUM, bn256_add_cost, bn256_add_run},
+    {EVMC_BYZANTIUM, bn256_mul_cost, bn256_mul_run},
+    {EVMC_BYZANTIUM, bn256_pairing_cost, bn256_pairing_run},
+    {EVMC_ISTANBUL, blake2f_cost, blake2f_run},
+};
+
+void precompiles_init(void) {
+  secp256k1_init();
+  bn256_init();
+}
+
+bool precompile_is_active(const evmc_address* address, enum evmc_revision revision) {
+  size_t i;
+  for (i = 0; i < sizeof(address->bytes) - 1; i++) {
+    if (address->bytes[i] != 0) {
+      return false;
+    }
+  }
+  uint8_t index = address->bytes[sizeof(address->bytes) - 1];
+  if (index == 0 || index > sizeof(precompiles) / sizeof(precompiles[0])) {
+    return false;
+  }
+  return revision >= precompiles[index - 1].since;
+}
+
+static void precompile_free_result(const struct evmc_result* result) {
+  free((void*) result->output_data);
+}
+
+struct evmc_result precompile_execute(const struct evmc_message* msg,
+                                      enum evmc_revision revision) {
+  const struct precompile* contract =
+      &precompiles[msg->destination.bytes[sizeof(msg->destination.bytes) - 1] - 1];
+
+  struct evmc_result result;
+  memset(&result, 0, sizeof(result));
+
+  int64_t cost = contract->cost(msg->input_data, msg->input_size, revision);
+  if (cost > msg->gas) {
+    result.status_code = EVMC_OUT_OF_GAS;
+    return result;
+  }
+
+  uint8_t* output = NULL;
+  size_t output_size = 0;
+  if (!contract->run(msg->input_data, msg->input_size, &output, &output_size)) {
+    free(output);
+    result.status_code = EVMC_PRECOMPILE_FAILURE;
+    return result;
+  }
+
+  result.status_code = EVMC_SUCCESS;
+  result.gas_left = msg->gas - cost;
+  result.output_data = output;
+  result.output_size = output_size;
+  result.release = output != NULL ? precompile_free_result : NULL;
+  return result;
+}
@@ -0,0 +1,27 @@
+#ifndef EVMC_JS_PRECOMPILES_H
+#define EVMC_JS_PRECOMPILES_H
+
+#include <stdbool.h>
+
+#include "evmc/evmc.h"
+
+/**
+ * The precompiled contracts at addresses 0x01 to 0x09: ecrecover, sha256,
+ * ripemd160 and identity since Frontier, modexp and the alt_bn128 operations
+ * since Byzantium, and blake2f since Istanbul, with the gas schedule of the
+ * revision being executed.
+ */
+
+/** Sets up the curve constants. Must be called once before any execution. */
+void precompiles_init(void);
+
+/** Returns true if address is a precompiled contract in the given revision. */
+bool precompile_is_active(const evmc_address* address, enum evmc_revision revision);
+
+/**
+ * Runs the precompiled contract msg is addressed to, which must be active.
+ * The output, if any, is freed by the result's release function.
+ */
+struct evmc_result precompile_execute(const struct evmc_message* msg, enum evmc_revision revision);
+
+#endif
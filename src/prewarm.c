@@ -0,0 +1,88 @@
+#include "prewarm.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <uv.h>
+
+/** A pooled instance; the path is allocated after it */
+struct evmc_prewarm_instance {
+  struct evmc_prewarm_instance* next;
+  struct evmc_instance* instance;
+  char path[];
+};
+
+static uv_once_t pool_once = UV_ONCE_INIT;
+static uv_mutex_t pool_lock;
+static struct evmc_prewarm_instance* pool;
+static size_t pooled;
+
+static void init_pool(void) {
+  uv_mutex_init(&pool_lock);
+}
+
+enum evmc_loader_error_code evmc_prewarm_load(const char* path) {
+  enum evmc_loader_error_code error_code;
+  struct evmc_instance* instance = evmc_load_and_create(path, &error_code);
+  if (instance == NULL) {
+    return error_code;
+  }
+
+  size_t length = strlen(path) + 1;
+  struct evmc_prewarm_instance* entry =
+      (struct evmc_prewarm_instance*) malloc(sizeof(struct evmc_prewarm_instance) + length);
+  entry->instance = instance;
+  memcpy(entry->path, path, length);
+
+  uv_once(&pool_once, init_pool);
+  uv_mutex_lock(&pool_lock);
+  entry->next = pool;
+  pool = entry;
+  pooled++;
+  uv_mutex_unlock(&pool_lock);
+  return EVMC_LOADER_SUCCESS;
+}
+
+struct evmc_instance* evmc_prewarm_take(const char* path, enum evmc_loader_error_code* error_code) {
+  struct evmc_prewarm_instance* entry = NULL;
+
+  uv_once(&pool_once, init_pool);
+  uv_mutex_lock(&pool_lock);
+  struct evmc_prewarm_instance** link;
+  for (link = &pool; *link != NULL; link = &(*link)->next) {
+    if (strcmp((*link)->path, path) == 0) {
+      entry = *link;
+      *link = entry->next;
+      pooled--;
+      break;
+    }
+  }
+  uv_mutex_unlock(&pool_lock);
+
+  if (entry == NULL) {
+    return evmc_load_and_create(path, error_code);
+  }
+  struct evmc_instance* instance = entry->instance;
+  free(entry);
+  *error_code = EVMC_LOADER_SUCCESS;
+  return instance;
+}
+
+size_t evmc_prewarm_pooled(void) {
+  uv_once(&pool_once, init_pool);
+  uv_mutex_lock(&pool_lock);
+  size_t count = pooled;
+  uv_mutex_unlock(&pool_lock);
+  return count;
+}
+
+void evmc_prewarm_stack(void) {
+  // Volatile, so that the writes are not optimized away. One per page is
+  // enough to fault it in.
+  volatile uint8_t stack[EVMC_PREWARM_STACK_SIZE];
+  size_t i;
+  for (i = 0; i < sizeof(stack); i += 4096) {
+    stack[i] = 0;
+  }
+}
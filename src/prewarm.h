@@ -0,0 +1,34 @@
+#ifndef EVMC_JS_PREWARM_H
+#define EVMC_JS_PREWARM_H
+
+#include <stddef.h>
+
+#include "evmc/evmc.h"
+#include "evmc/loader.h"
+
+/**
+ * Work done ahead of traffic, so that the first executions of a service do
+ * not pay for it: VM instances loaded into a process wide pool, by the path
+ * of their library, for EVMs created later to take, and thread stacks touched
+ * so their pages are mapped. The pool may be used from any thread.
+ */
+
+/** Bytes of stack touched by evmc_prewarm_stack */
+#define EVMC_PREWARM_STACK_SIZE (256 * 1024)
+
+/** Loads and creates an instance of the VM at path into the pool. */
+enum evmc_loader_error_code evmc_prewarm_load(const char* path);
+
+/**
+ * Takes an instance of the VM at path from the pool, or loads and creates a
+ * new one if none is pooled.
+ */
+struct evmc_instance* evmc_prewarm_take(const char* path, enum evmc_loader_error_code* error_code);
+
+/** Instances of any VM in the pool. */
+size_t evmc_prewarm_pooled(void);
+
+/** Touches EVMC_PREWARM_STACK_SIZE bytes of the stack of the calling thread. */
+void evmc_prewarm_stack(void);
+
+#endif
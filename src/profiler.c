@@ -0,0 +1,180 @@
+#include "profiler.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+
+/** How far a code is looked for past its home slot before it is untracked. */
+#define MAX_PROBES 32
+#define MAX_CAPACITY ((size_t) 1 << 20)
+
+struct evmc_profile_slot {
+  /** The fast hash of the code, or zero while the slot is unused. */
+  uint64_t key;
+  /** Set once code_hash and code_size are filled in by the thread claiming the slot. */
+  uint32_t ready;
+  struct evmc_profile_entry entry;
+};
+
+struct evmc_profiler {
+  size_t mask;
+  uint64_t untracked;
+  int refs;
+  struct evmc_profile_slot slots[];
+};
+
+struct evmc_profiler* evmc_profiler_create(size_t capacity) {
+  if (capacity == 0 || capacity > MAX_CAPACITY) {
+    return NULL;
+  }
+  size_t size = 1;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  struct evmc_profiler* profiler = (struct evmc_profiler*) calloc(
+      1, sizeof(struct evmc_profiler) + size * sizeof(struct evmc_profile_slot));
+  if (profiler == NULL) {
+    return NULL;
+  }
+  profiler->mask = size - 1;
+  profiler->refs = 1;
+  return profiler;
+}
+
+void evmc_profiler_retain(struct evmc_profiler* profiler) {
+  __atomic_add_fetch(&profiler->refs, 1, __ATOMIC_RELAXED);
+}
+
+void evmc_profiler_release(struct evmc_profiler* profiler) {
+  if (__atomic_sub_fetch(&profiler->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    free(profiler);
+  }
+}
+
+/** Finds the slot of code, claiming an unused one if it has none. */
+static struct evmc_profile_slot* find_slot(struct evmc_profiler* profiler, const uint8_t* code,
+                                           size_t code_size) {
+  uint64_t key = hash_code64(code, code_size);
+  size_t i;
+  for (i = 0; i < MAX_PROBES && i <= profiler->mask; i++) {
+    struct evmc_profile_slot* slot = &profiler->slots[(key + i) & profiler->mask];
+    uint64_t found = __atomic_load_n(&slot->key, __ATOMIC_RELAXED);
+    if (found == key) {
+      return slot;
+    }
+    if (found == 0) {
+      uint64_t expected = 0;
+      if (__atomic_compare_exchange_n(&slot->key, &expected, key, false, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED)) {
+        // Only the first execution of each code pays for the real hash.
+        keccak256(code, code_size, slot->entry.code_hash);
+        slot->entry.code_size = code_size;
+        __atomic_store_n(&slot->ready, 1, __ATOMIC_RELEASE);
+        return slot;
+      }
+      if (expected == key) {
+        return slot;
+      }
+    }
+  }
+  return NULL;
+}
+
+void evmc_profiler_record(struct evmc_profiler* profiler, const uint8_t* code, size_t code_size,
+                          uint64_t gas_used, uint64_t elapsed_ns,
+                          const struct evmc_profile_sample* sample) {
+  struct evmc_profile_slot* slot = find_slot(profiler, code, code_size);
+  if (slot == NULL) {
+    __atomic_add_fetch(&profiler->untracked, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  struct evmc_profile_entry* entry = &slot->entry;
+  uint64_t host_ns = sample->host_ns < elapsed_ns ? sample->host_ns : elapsed_ns;
+  __atomic_add_fetch(&entry->executions, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&entry->gas_used, gas_used, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&entry->vm_ns, elapsed_ns - host_ns, __ATOMIC_RELAXED);
+  if (host_ns != 0) {
+    __atomic_add_fetch(&entry->host_ns, host_ns, __ATOMIC_RELAXED);
+  }
+  size_t i;
+  for (i = 0; i < EVMC_HOST_CALL_COUNT; i++) {
+    if (sample->host_calls[i] != 0) {
+      __atomic_add_fetch(&entry->host_calls[i], sample->host_calls[i], __ATOMIC_RELAXED);
+    }
+  }
+}
+
+struct ranked_entry {
+  uint64_t rank;
+  struct evmc_profile_entry entry;
+};
+
+static int compare_ranked(const void* a, const void* b) {
+  uint64_t x = ((const struct ranked_entry*) a)->rank;
+  uint64_t y = ((const struct ranked_entry*) b)->rank;
+  return x < y ? 1 : x > y ? -1 : 0;
+}
+
+static uint64_t rank_of(const struct evmc_profile_entry* entry, enum evmc_profile_order order) {
+  switch (order) {
+    case EVMC_PROFILE_BY_VM_TIME:
+      return entry->vm_ns;
+    case EVMC_PROFILE_BY_HOST_TIME:
+      return entry->host_ns;
+    case EVMC_PROFILE_BY_GAS:
+      return entry->gas_used;
+    case EVMC_PROFILE_BY_EXECUTIONS:
+      return entry->executions;
+    case EVMC_PROFILE_BY_TIME:
+    default:
+      return entry->vm_ns + entry->host_ns;
+  }
+}
+
+size_t evmc_profiler_top(struct evmc_profiler* profiler, enum evmc_profile_order order,
+                         struct evmc_profile_entry* entries, size_t limit) {
+  size_t capacity = profiler->mask + 1;
+  struct ranked_entry* ranked =
+      (struct ranked_entry*) malloc(capacity * sizeof(struct ranked_entry));
+  if (ranked == NULL) {
+    return 0;
+  }
+
+  size_t count = 0;
+  size_t i, j;
+  for (i = 0; i < capacity; i++) {
+    struct evmc_profile_slot* slot = &profiler->slots[i];
+    if (!__atomic_load_n(&slot->ready, __ATOMIC_ACQUIRE)) {
+      continue;
+    }
+    struct evmc_profile_entry* entry = &ranked[count].entry;
+    memcpy(entry->code_hash, slot->entry.code_hash, sizeof(entry->code_hash));
+    entry->code_size = slot->entry.code_size;
+    entry->executions = __atomic_load_n(&slot->entry.executions, __ATOMIC_RELAXED);
+    entry->gas_used = __atomic_load_n(&slot->entry.gas_used, __ATOMIC_RELAXED);
+    entry->vm_ns = __atomic_load_n(&slot->entry.vm_ns, __ATOMIC_RELAXED);
+    entry->host_ns = __atomic_load_n(&slot->entry.host_ns, __ATOMIC_RELAXED);
+    for (j = 0; j < EVMC_HOST_CALL_COUNT; j++) {
+      entry->host_calls[j] = __atomic_load_n(&slot->entry.host_calls[j], __ATOMIC_RELAXED);
+    }
+    ranked[count].rank = rank_of(entry, order);
+    count++;
+  }
+
+  qsort(ranked, count, sizeof(struct ranked_entry), compare_ranked);
+
+  if (count > limit) {
+    count = limit;
+  }
+  for (i = 0; i < count; i++) {
+    entries[i] = ranked[i].entry;
+  }
+  free(ranked);
+  return count;
+}
+
+uint64_t evmc_profiler_untracked(struct evmc_profiler* profiler) {
+  return __atomic_load_n(&profiler->untracked, __ATOMIC_RELAXED);
+}
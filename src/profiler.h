@@ -0,0 +1,94 @@
+#ifndef EVMC_JS_PROFILER_H
+#define EVMC_JS_PROFILER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Totals of executions per contract code, to see which contracts take up the
+ * EVM's time.
+ *
+ * Code is counted by its hash in a fixed table which never evicts: once the
+ * table is full, executions of code not already in it are only counted as
+ * untracked. Counters are updated with atomic adds, so a profiler may be
+ * recorded to from any number of threads at once, and read while it is.
+ */
+
+/** The host callbacks, in the order they are reported in. */
+enum evmc_host_call {
+  EVMC_HOST_ACCOUNT_EXISTS,
+  EVMC_HOST_GET_STORAGE,
+  EVMC_HOST_SET_STORAGE,
+  EVMC_HOST_GET_BALANCE,
+  EVMC_HOST_GET_CODE_SIZE,
+  EVMC_HOST_GET_CODE_HASH,
+  EVMC_HOST_COPY_CODE,
+  EVMC_HOST_SELFDESTRUCT,
+  EVMC_HOST_CALL,
+  EVMC_HOST_GET_TX_CONTEXT,
+  EVMC_HOST_GET_BLOCK_HASH,
+  EVMC_HOST_EMIT_LOG,
+  EVMC_HOST_TRANSFER,
+  EVMC_HOST_CALL_COUNT
+};
+
+/** What one execution spent on the host, gathered while it runs. */
+struct evmc_profile_sample {
+  uint64_t host_ns;
+  uint64_t host_calls[EVMC_HOST_CALL_COUNT];
+};
+
+struct evmc_profile_entry {
+  /** The Keccak-256 hash of the code. */
+  uint8_t code_hash[32];
+  uint64_t code_size;
+  uint64_t executions;
+  uint64_t gas_used;
+  /** Time spent in the VM, not counting host callbacks. */
+  uint64_t vm_ns;
+  /** Time spent waiting for host callbacks to answer. */
+  uint64_t host_ns;
+  uint64_t host_calls[EVMC_HOST_CALL_COUNT];
+};
+
+enum evmc_profile_order {
+  /** By VM and host time together. */
+  EVMC_PROFILE_BY_TIME,
+  EVMC_PROFILE_BY_VM_TIME,
+  EVMC_PROFILE_BY_HOST_TIME,
+  EVMC_PROFILE_BY_GAS,
+  EVMC_PROFILE_BY_EXECUTIONS
+};
+
+struct evmc_profiler;
+
+/**
+ * Creates a profiler with room for capacity distinct codes, rounded up to a
+ * power of two. Returns NULL if capacity is zero or over a million. The
+ * returned profiler holds one reference.
+ */
+struct evmc_profiler* evmc_profiler_create(size_t capacity);
+
+void evmc_profiler_retain(struct evmc_profiler* profiler);
+
+void evmc_profiler_release(struct evmc_profiler* profiler);
+
+/**
+ * Adds an execution of code which used gas_used and took elapsed_ns in all,
+ * of which sample->host_ns was spent waiting on the host.
+ */
+void evmc_profiler_record(struct evmc_profiler* profiler, const uint8_t* code, size_t code_size,
+                          uint64_t gas_used, uint64_t elapsed_ns,
+                          const struct evmc_profile_sample* sample);
+
+/**
+ * Copies the limit codes ranking highest by order into entries, highest
+ * first, and returns how many were copied.
+ */
+size_t evmc_profiler_top(struct evmc_profiler* profiler, enum evmc_profile_order order,
+                         struct evmc_profile_entry* entries, size_t limit);
+
+/** Executions which were not counted because the table was full. */
+uint64_t evmc_profiler_untracked(struct evmc_profiler* profiler);
+
+#endif
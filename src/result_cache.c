@@ -0,0 +1,392 @@
+#include "result_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <uv.h>
+
+#include "hash.h"
+
+/** Account versions are kept per stripe of addresses, so their table is fixed. */
+#define STRIPES 4096
+
+struct result_entry {
+  /** Must come first, as entries are handed out as their result. */
+  struct evmc_cached_result result;
+  evmc_bytes32 key;
+  /** The stripes read and their versions, as in evmc_read_set */
+  const uint32_t* stripes;
+  const uint64_t* versions;
+  size_t count;
+  /** Bytes of the allocation, counted against the budget */
+  size_t size;
+  /** If the entry is still in the cache, which then holds a reference */
+  bool cached;
+  /** Next entry in the same bucket */
+  struct result_entry* chain;
+  /** Neighbours in recency order, most recent first */
+  struct result_entry* prev;
+  struct result_entry* next;
+  int refs;
+};
+
+struct evmc_result_cache {
+  uv_mutex_t lock;
+  struct result_entry** buckets;
+  size_t bucket_mask;
+  struct result_entry* head;
+  struct result_entry* tail;
+  size_t count;
+  /** Bytes of the entries, which with fixed_size stays within the budget */
+  size_t size;
+  size_t fixed_size;
+  size_t budget;
+  /** Bumped by invalidate_all, which keeps results begun before out */
+  uint64_t epoch;
+  uint64_t versions[STRIPES];
+  struct evmc_result_cache_stats stats;
+  int refs;
+};
+
+static uint32_t stripe_of(const evmc_address* address) {
+  uint64_t a, b;
+  memcpy(&a, address->bytes, sizeof(a));
+  memcpy(&b, address->bytes + 12, sizeof(b));
+  uint64_t h = (a ^ b) * 0x9e3779b97f4a7c15ULL;
+  return (uint32_t) (h >> 32) & (STRIPES - 1);
+}
+
+static size_t bucket_of(struct evmc_result_cache* cache, const evmc_bytes32* key) {
+  // Keys are hashes already.
+  uint64_t h;
+  memcpy(&h, key->bytes, sizeof(h));
+  return (size_t) h & cache->bucket_mask;
+}
+
+struct evmc_result_cache* evmc_result_cache_create(size_t budget) {
+  // About one bucket per kilobyte of results.
+  size_t bucket_count = 16;
+  while (bucket_count < budget / 1024 && bucket_count < (1u << 20)) {
+    bucket_count <<= 1;
+  }
+  size_t fixed_size = sizeof(struct evmc_result_cache) + bucket_count * sizeof(struct result_entry*);
+  if (budget <= fixed_size) {
+    return NULL;
+  }
+
+  struct evmc_result_cache* cache = (struct evmc_result_cache*) calloc(1, sizeof(struct evmc_result_cache));
+  if (cache == NULL) {
+    return NULL;
+  }
+  cache->buckets = (struct result_entry**) calloc(bucket_count, sizeof(struct result_entry*));
+  if (cache->buckets == NULL) {
+    free(cache);
+    return NULL;
+  }
+  cache->bucket_mask = bucket_count - 1;
+  cache->fixed_size = fixed_size;
+  cache->budget = budget;
+  cache->stats.budget = budget;
+  cache->refs = 1;
+  uv_mutex_init(&cache->lock);
+  return cache;
+}
+
+void evmc_result_cache_retain(struct evmc_result_cache* cache) {
+  __atomic_add_fetch(&cache->refs, 1, __ATOMIC_RELAXED);
+}
+
+void evmc_cached_result_release(const struct evmc_cached_result* result) {
+  struct result_entry* entry = (struct result_entry*) result;
+  if (__atomic_sub_fetch(&entry->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    free(entry);
+  }
+}
+
+static void unlink_recent(struct evmc_result_cache* cache, struct result_entry* entry) {
+  if (entry->prev != NULL) {
+    entry->prev->next = entry->next;
+  } else {
+    cache->head = entry->next;
+  }
+  if (entry->next != NULL) {
+    entry->next->prev = entry->prev;
+  } else {
+    cache->tail = entry->prev;
+  }
+}
+
+static void push_recent(struct evmc_result_cache* cache, struct result_entry* entry) {
+  entry->prev = NULL;
+  entry->next = cache->head;
+  if (cache->head != NULL) {
+    cache->head->prev = entry;
+  } else {
+    cache->tail = entry;
+  }
+  cache->head = entry;
+}
+
+static void remove_entry(struct evmc_result_cache* cache, struct result_entry* entry) {
+  struct result_entry** link = &cache->buckets[bucket_of(cache, &entry->key)];
+  while (*link != entry) {
+    link = &(*link)->chain;
+  }
+  *link = entry->chain;
+  unlink_recent(cache, entry);
+  entry->cached = false;
+  cache->count--;
+  cache->size -= entry->size;
+  evmc_cached_result_release(&entry->result);
+}
+
+void evmc_result_cache_release(struct evmc_result_cache* cache) {
+  if (__atomic_sub_fetch(&cache->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    while (cache->head != NULL) {
+      remove_entry(cache, cache->head);
+    }
+    uv_mutex_destroy(&cache->lock);
+    free(cache->buckets);
+    free(cache);
+  }
+}
+
+void evmc_result_cache_key(const struct evmc_message* message, enum evmc_revision revision,
+                           const uint8_t* code, size_t code_size, evmc_bytes32* key) {
+  // Everything the execution sees of its message, apart from the state.
+  struct {
+    uint8_t code_hash[32];
+    evmc_address destination;
+    evmc_address sender;
+    evmc_uint256be value;
+    int64_t gas;
+    int32_t depth;
+    uint32_t flags;
+    int32_t kind;
+    int32_t revision;
+  } header;
+  memset(&header, 0, sizeof(header));
+  keccak256(code, code_size, header.code_hash);
+  header.destination = message->destination;
+  header.sender = message->sender;
+  header.value = message->value;
+  header.gas = message->gas;
+  header.depth = message->depth;
+  header.flags = message->flags;
+  header.kind = (int32_t) message->kind;
+  header.revision = (int32_t) revision;
+
+  uint8_t* buffer = (uint8_t*) malloc(sizeof(header) + message->input_size);
+  memcpy(buffer, &header, sizeof(header));
+  if (message->input_size > 0) {
+    memcpy(buffer + sizeof(header), message->input_data, message->input_size);
+  }
+  keccak256(buffer, sizeof(header) + message->input_size, key->bytes);
+  free(buffer);
+}
+
+void evmc_read_set_begin(struct evmc_result_cache* cache, struct evmc_read_set* set) {
+  memset(set, 0, sizeof(*set));
+  set->epoch = __atomic_load_n(&cache->epoch, __ATOMIC_ACQUIRE);
+}
+
+void evmc_read_set_account(struct evmc_result_cache* cache, struct evmc_read_set* set,
+                           const evmc_address* address) {
+  uint32_t stripe = stripe_of(address);
+  // The same account is usually read several times in a row.
+  size_t i = set->count;
+  while (i > 0) {
+    if (set->stripes[--i] == stripe) {
+      return;
+    }
+  }
+  if (set->count == set->capacity) {
+    set->capacity = set->capacity == 0 ? 8 : set->capacity * 2;
+    set->stripes = (uint32_t*) realloc(set->stripes, set->capacity * sizeof(uint32_t));
+    set->versions = (uint64_t*) realloc(set->versions, set->capacity * sizeof(uint64_t));
+  }
+  set->stripes[set->count] = stripe;
+  set->versions[set->count] = __atomic_load_n(&cache->versions[stripe], __ATOMIC_ACQUIRE);
+  set->count++;
+}
+
+void evmc_read_set_tx_context(struct evmc_read_set* set, const struct evmc_tx_context* tx_context) {
+  set->reads_tx_context = true;
+  set->tx_context = *tx_context;
+}
+
+void evmc_read_set_block_hash(struct evmc_read_set* set, uint64_t number, const evmc_bytes32* hash) {
+  if (set->block_hash_count == set->block_hash_capacity) {
+    set->block_hash_capacity = set->block_hash_capacity == 0 ? 4 : set->block_hash_capacity * 2;
+    set->block_hashes = (struct evmc_block_hash_read*) realloc(
+        set->block_hashes, set->block_hash_capacity * sizeof(struct evmc_block_hash_read));
+  }
+  set->block_hashes[set->block_hash_count].number = number;
+  set->block_hashes[set->block_hash_count].hash = *hash;
+  set->block_hash_count++;
+}
+
+void evmc_read_set_free(struct evmc_read_set* set) {
+  free(set->stripes);
+  free(set->versions);
+  free(set->block_hashes);
+  memset(set, 0, sizeof(*set));
+}
+
+static struct result_entry* find(struct evmc_result_cache* cache, const evmc_bytes32* key) {
+  struct result_entry* entry = cache->buckets[bucket_of(cache, key)];
+  while (entry != NULL && memcmp(&entry->key, key, sizeof(*key)) != 0) {
+    entry = entry->chain;
+  }
+  return entry;
+}
+
+static bool versions_hold(struct evmc_result_cache* cache, const uint32_t* stripes,
+                          const uint64_t* versions, size_t count) {
+  size_t i;
+  for (i = 0; i < count; i++) {
+    if (__atomic_load_n(&cache->versions[stripes[i]], __ATOMIC_ACQUIRE) != versions[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const struct evmc_cached_result* evmc_result_cache_lookup(struct evmc_result_cache* cache,
+                                                          const evmc_bytes32* key) {
+  uv_mutex_lock(&cache->lock);
+  struct result_entry* entry = find(cache, key);
+  if (entry == NULL) {
+    cache->stats.misses++;
+    uv_mutex_unlock(&cache->lock);
+    return NULL;
+  }
+  if (!versions_hold(cache, entry->stripes, entry->versions, entry->count)) {
+    cache->stats.misses++;
+    cache->stats.stale++;
+    remove_entry(cache, entry);
+    uv_mutex_unlock(&cache->lock);
+    return NULL;
+  }
+  if (cache->head != entry) {
+    unlink_recent(cache, entry);
+    push_recent(cache, entry);
+  }
+  __atomic_add_fetch(&entry->refs, 1, __ATOMIC_RELAXED);
+  uv_mutex_unlock(&cache->lock);
+  return &entry->result;
+}
+
+void evmc_result_cache_settle(struct evmc_result_cache* cache, const struct evmc_cached_result* result,
+                              bool valid) {
+  struct result_entry* entry = (struct result_entry*) result;
+  uv_mutex_lock(&cache->lock);
+  if (valid) {
+    cache->stats.hits++;
+  } else {
+    cache->stats.misses++;
+    cache->stats.stale++;
+    if (entry->cached) {
+      remove_entry(cache, entry);
+    }
+  }
+  uv_mutex_unlock(&cache->lock);
+}
+
+void evmc_result_cache_store(struct evmc_result_cache* cache, const evmc_bytes32* key,
+                             const struct evmc_read_set* set, const struct evmc_result* result) {
+  // One allocation holds the entry, then its versions, block hashes, stripes
+  // and output, in decreasing order of alignment.
+  size_t versions_offset = sizeof(struct result_entry);
+  size_t block_hashes_offset = versions_offset + set->count * sizeof(uint64_t);
+  size_t stripes_offset = block_hashes_offset + set->block_hash_count * sizeof(struct evmc_block_hash_read);
+  size_t output_offset = stripes_offset + set->count * sizeof(uint32_t);
+  size_t size = output_offset + result->output_size;
+
+  if (set->uncacheable || size > cache->budget - cache->fixed_size) {
+    uv_mutex_lock(&cache->lock);
+    cache->stats.uncacheable++;
+    uv_mutex_unlock(&cache->lock);
+    return;
+  }
+  // Something the execution read has already changed.
+  if (!versions_hold(cache, set->stripes, set->versions, set->count)) {
+    return;
+  }
+
+  uint8_t* block = (uint8_t*) malloc(size);
+  if (block == NULL) {
+    return;
+  }
+  struct result_entry* entry = (struct result_entry*) block;
+  memset(entry, 0, sizeof(*entry));
+  entry->result.status_code = result->status_code;
+  entry->result.gas_left = result->gas_left;
+  entry->result.output_size = result->output_size;
+  entry->result.output_data = result->output_size > 0 ? block + output_offset : NULL;
+  if (result->output_size > 0) {
+    memcpy(block + output_offset, result->output_data, result->output_size);
+  }
+  entry->result.reads_tx_context = set->reads_tx_context;
+  entry->result.tx_context = set->tx_context;
+  entry->result.block_hash_count = set->block_hash_count;
+  entry->result.block_hashes = (struct evmc_block_hash_read*) (block + block_hashes_offset);
+  memcpy(block + block_hashes_offset, set->block_hashes,
+         set->block_hash_count * sizeof(struct evmc_block_hash_read));
+  entry->versions = (uint64_t*) (block + versions_offset);
+  memcpy(block + versions_offset, set->versions, set->count * sizeof(uint64_t));
+  entry->stripes = (uint32_t*) (block + stripes_offset);
+  memcpy(block + stripes_offset, set->stripes, set->count * sizeof(uint32_t));
+  entry->count = set->count;
+  entry->key = *key;
+  entry->size = size;
+  entry->cached = true;
+  entry->refs = 1;
+
+  uv_mutex_lock(&cache->lock);
+  if (set->epoch != cache->epoch) {
+    uv_mutex_unlock(&cache->lock);
+    free(block);
+    return;
+  }
+  struct result_entry* previous = find(cache, key);
+  if (previous != NULL) {
+    remove_entry(cache, previous);
+  }
+  while (cache->size + size > cache->budget - cache->fixed_size) {
+    remove_entry(cache, cache->tail);
+    cache->stats.evictions++;
+  }
+  struct result_entry** bucket = &cache->buckets[bucket_of(cache, key)];
+  entry->chain = *bucket;
+  *bucket = entry;
+  push_recent(cache, entry);
+  cache->count++;
+  cache->size += size;
+  uv_mutex_unlock(&cache->lock);
+}
+
+void evmc_result_cache_invalidate(struct evmc_result_cache* cache, const evmc_address* address) {
+  __atomic_add_fetch(&cache->versions[stripe_of(address)], 1, __ATOMIC_ACQ_REL);
+  __atomic_add_fetch(&cache->stats.invalidations, 1, __ATOMIC_RELAXED);
+}
+
+void evmc_result_cache_invalidate_all(struct evmc_result_cache* cache) {
+  uv_mutex_lock(&cache->lock);
+  __atomic_add_fetch(&cache->epoch, 1, __ATOMIC_ACQ_REL);
+  __atomic_add_fetch(&cache->stats.invalidations, 1, __ATOMIC_RELAXED);
+  while (cache->head != NULL) {
+    remove_entry(cache, cache->head);
+  }
+  uv_mutex_unlock(&cache->lock);
+}
+
+void evmc_result_cache_get_stats(struct evmc_result_cache* cache,
+                                 struct evmc_result_cache_stats* stats) {
+  uv_mutex_lock(&cache->lock);
+  *stats = cache->stats;
+  stats->invalidations = __atomic_load_n(&cache->stats.invalidations, __ATOMIC_RELAXED);
+  stats->entries = cache->count;
+  stats->memory_usage = cache->fixed_size + cache->size;
+  uv_mutex_unlock(&cache->lock);
+}
@@ -0,0 +1,143 @@
+#ifndef EVMC_JS_RESULT_CACHE_H
+#define EVMC_JS_RESULT_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "evmc/evmc.h"
+
+/**
+ * Least recently used cache of the results of static executions, keyed by a
+ * hash of their code, message and revision.
+ *
+ * Each entry keeps the read set of the execution it came from: the accounts it
+ * read state of, and the transaction context and block hashes it asked for.
+ * Accounts are versioned in stripes, by a hash of their address, and writing
+ * or invalidating an account bumps its stripe, so an entry is stale once any
+ * account it read may have changed since. The transaction context and block
+ * hashes are not versioned, and are asked for again and compared by the
+ * caller before an entry is used.
+ *
+ * Entries are immutable once stored, and a cache may be used from any number
+ * of threads at once.
+ */
+
+struct evmc_block_hash_read {
+  uint64_t number;
+  evmc_bytes32 hash;
+};
+
+/** What an execution has read so far, gathered on the thread running it. */
+struct evmc_read_set {
+  /** The invalidate_all count when the execution began */
+  uint64_t epoch;
+  /** The stripes of the accounts read, and their versions when first read */
+  uint32_t* stripes;
+  uint64_t* versions;
+  size_t count;
+  size_t capacity;
+  bool reads_tx_context;
+  struct evmc_tx_context tx_context;
+  struct evmc_block_hash_read* block_hashes;
+  size_t block_hash_count;
+  size_t block_hash_capacity;
+  /** If the execution depended on something which cannot be revalidated */
+  bool uncacheable;
+};
+
+struct evmc_cached_result {
+  enum evmc_status_code status_code;
+  int64_t gas_left;
+  const uint8_t* output_data;
+  size_t output_size;
+  /** The transaction context the execution read, if it did */
+  bool reads_tx_context;
+  struct evmc_tx_context tx_context;
+  /** The block hashes the execution read */
+  const struct evmc_block_hash_read* block_hashes;
+  size_t block_hash_count;
+};
+
+struct evmc_result_cache_stats {
+  /** Lookups answered from the cache */
+  uint64_t hits;
+  /** Lookups which ran the execution, including those of stale entries */
+  uint64_t misses;
+  /** Entries dropped because something they read had changed */
+  uint64_t stale;
+  /** Executions not stored, as they called out or their entry would not fit */
+  uint64_t uncacheable;
+  uint64_t evictions;
+  uint64_t invalidations;
+  size_t entries;
+  size_t budget;
+  /** Bytes held by entries, buckets and versions */
+  size_t memory_usage;
+};
+
+struct evmc_result_cache;
+
+/**
+ * Creates a cache holding entries up to budget bytes. Returns NULL if the
+ * budget does not cover its fixed tables. The returned cache holds one
+ * reference.
+ */
+struct evmc_result_cache* evmc_result_cache_create(size_t budget);
+
+void evmc_result_cache_retain(struct evmc_result_cache* cache);
+
+/** Drops a reference, freeing the cache once the last one is gone. */
+void evmc_result_cache_release(struct evmc_result_cache* cache);
+
+/** Computes the key of an execution of code with the message at revision. */
+void evmc_result_cache_key(const struct evmc_message* message, enum evmc_revision revision,
+                           const uint8_t* code, size_t code_size, evmc_bytes32* key);
+
+/** Starts an empty read set for an execution which may be stored. */
+void evmc_read_set_begin(struct evmc_result_cache* cache, struct evmc_read_set* set);
+
+/** Notes that the account is about to be read. */
+void evmc_read_set_account(struct evmc_result_cache* cache, struct evmc_read_set* set,
+                           const evmc_address* address);
+
+void evmc_read_set_tx_context(struct evmc_read_set* set, const struct evmc_tx_context* tx_context);
+
+void evmc_read_set_block_hash(struct evmc_read_set* set, uint64_t number, const evmc_bytes32* hash);
+
+void evmc_read_set_free(struct evmc_read_set* set);
+
+/**
+ * Finds the entry stored under key, if no account it read has changed, and
+ * retains it. The caller compares its transaction context and block hashes,
+ * then settles and releases it.
+ */
+const struct evmc_cached_result* evmc_result_cache_lookup(struct evmc_result_cache* cache,
+                                                          const evmc_bytes32* key);
+
+/**
+ * Counts a lookup which returned the entry as a hit if the caller found the
+ * rest of its reads unchanged, or drops the entry as stale otherwise.
+ */
+void evmc_result_cache_settle(struct evmc_result_cache* cache, const struct evmc_cached_result* entry,
+                              bool valid);
+
+void evmc_cached_result_release(const struct evmc_cached_result* entry);
+
+/**
+ * Stores the result of an execution with its read set, unless the set is
+ * uncacheable, the cache has been invalidated entirely since the set began,
+ * or the entry would take up more than the whole budget.
+ */
+void evmc_result_cache_store(struct evmc_result_cache* cache, const evmc_bytes32* key,
+                             const struct evmc_read_set* set, const struct evmc_result* result);
+
+/** Makes stale every entry which read the account. */
+void evmc_result_cache_invalidate(struct evmc_result_cache* cache, const evmc_address* address);
+
+void evmc_result_cache_invalidate_all(struct evmc_result_cache* cache);
+
+void evmc_result_cache_get_stats(struct evmc_result_cache* cache,
+                                 struct evmc_result_cache_stats* stats);
+
+#endif
@@ -0,0 +1,155 @@
+#include "rlp.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/** Reads a big-endian length of size bytes, which must not have leading zeros. */
+static bool read_length(const uint8_t* data, size_t size, size_t* length) {
+  if (size == 0 || size > sizeof(size_t) || data[0] == 0) {
+    return false;
+  }
+  size_t value = 0;
+  size_t i;
+  for (i = 0; i < size; i++) {
+    value = (value << 8) | data[i];
+  }
+  *length = value;
+  return true;
+}
+
+bool rlp_decode(const uint8_t* data, size_t size, struct rlp_item* item) {
+  if (size == 0) {
+    return false;
+  }
+  uint8_t prefix = data[0];
+  size_t header;
+  size_t length;
+  if (prefix < 0x80) {
+    header = 0;
+    length = 1;
+    item->list = false;
+  } else if (prefix < 0xb8) {
+    header = 1;
+    length = prefix - 0x80;
+    item->list = false;
+  } else if (prefix < 0xc0) {
+    header = 1 + (prefix - 0xb7);
+    if (header > size || !read_length(data + 1, header - 1, &length) || length < 56) {
+      return false;
+    }
+    item->list = false;
+  } else if (prefix < 0xf8) {
+    header = 1;
+    length = prefix - 0xc0;
+    item->list = true;
+  } else {
+    header = 1 + (prefix - 0xf7);
+    if (header > size || !read_length(data + 1, header - 1, &length) || length < 56) {
+      return false;
+    }
+    item->list = true;
+  }
+  if (length > size - header) {
+    return false;
+  }
+  item->data = data + header;
+  item->size = length;
+  item->raw = data;
+  item->raw_size = header + length;
+  return true;
+}
+
+int rlp_decode_list(const struct rlp_item* list, struct rlp_item* items, int max) {
+  if (!list->list) {
+    return -1;
+  }
+  const uint8_t* data = list->data;
+  size_t size = list->size;
+  int count = 0;
+  while (size > 0) {
+    if (count == max || !rlp_decode(data, size, &items[count])) {
+      return -1;
+    }
+    data += items[count].raw_size;
+    size -= items[count].raw_size;
+    count++;
+  }
+  return count;
+}
+
+static void reserve(struct rlp_buffer* buffer, size_t size) {
+  if (buffer->size + size <= buffer->capacity) {
+    return;
+  }
+  size_t capacity = buffer->capacity == 0 ? 256 : buffer->capacity;
+  while (capacity < buffer->size + size) {
+    capacity *= 2;
+  }
+  buffer->data = (uint8_t*) realloc(buffer->data, capacity);
+  buffer->capacity = capacity;
+}
+
+/** Encodes the header of an item with a payload of length into header, returning its size. */
+static size_t encode_header(uint8_t header[9], uint8_t offset, size_t length) {
+  if (length < 56) {
+    header[0] = (uint8_t) (offset + length);
+    return 1;
+  }
+  size_t bytes = 0;
+  size_t rest;
+  for (rest = length; rest != 0; rest >>= 8) {
+    bytes++;
+  }
+  header[0] = (uint8_t) (offset + 55 + bytes);
+  size_t i;
+  for (i = 0; i < bytes; i++) {
+    header[1 + i] = (uint8_t) (length >> (8 * (bytes - 1 - i)));
+  }
+  return 1 + bytes;
+}
+
+void rlp_put_raw(struct rlp_buffer* buffer, const uint8_t* data, size_t size) {
+  reserve(buffer, size);
+  if (size > 0) {
+    memcpy(buffer->data + buffer->size, data, size);
+  }
+  buffer->size += size;
+}
+
+void rlp_put_string(struct rlp_buffer* buffer, const uint8_t* data, size_t size) {
+  if (size == 1 && data[0] < 0x80) {
+    rlp_put_raw(buffer, data, 1);
+    return;
+  }
+  uint8_t header[9];
+  rlp_put_raw(buffer, header, encode_header(header, 0x80, size));
+  rlp_put_raw(buffer, data, size);
+}
+
+void rlp_put_uint(struct rlp_buffer* buffer, const uint8_t* data, size_t size) {
+  while (size > 0 && data[0] == 0) {
+    data++;
+    size--;
+  }
+  rlp_put_string(buffer, data, size);
+}
+
+size_t rlp_begin_list(struct rlp_buffer* buffer) {
+  return buffer->size;
+}
+
+void rlp_end_list(struct rlp_buffer* buffer, size_t start) {
+  uint8_t header[9];
+  size_t header_size = encode_header(header, 0xc0, buffer->size - start);
+  reserve(buffer, header_size);
+  memmove(buffer->data + start + header_size, buffer->data + start, buffer->size - start);
+  memcpy(buffer->data + start, header, header_size);
+  buffer->size += header_size;
+}
+
+void rlp_buffer_free(struct rlp_buffer* buffer) {
+  free(buffer->data);
+  buffer->data = NULL;
+  buffer->size = 0;
+  buffer->capacity = 0;
+}
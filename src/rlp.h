@@ -0,0 +1,57 @@
+#ifndef EVMC_JS_RLP_H
+#define EVMC_JS_RLP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** An RLP item, pointing into the buffer it was decoded from. */
+struct rlp_item {
+  /** The payload: the bytes of a string, or the encoded items of a list. */
+  const uint8_t* data;
+  size_t size;
+  bool list;
+  /** The whole encoding, header included. */
+  const uint8_t* raw;
+  size_t raw_size;
+};
+
+/**
+ * Decodes the item at the start of data. Returns false if the item is
+ * malformed or runs past size.
+ */
+bool rlp_decode(const uint8_t* data, size_t size, struct rlp_item* item);
+
+/**
+ * Decodes the items of a list into items. Returns how many there are, or -1 if
+ * the list is malformed or has more than max items.
+ */
+int rlp_decode_list(const struct rlp_item* list, struct rlp_item* items, int max);
+
+/** A growing buffer items are encoded into. Zero-initialize it before use. */
+struct rlp_buffer {
+  uint8_t* data;
+  size_t size;
+  size_t capacity;
+};
+
+/** Appends already encoded bytes. */
+void rlp_put_raw(struct rlp_buffer* buffer, const uint8_t* data, size_t size);
+
+void rlp_put_string(struct rlp_buffer* buffer, const uint8_t* data, size_t size);
+
+/** Appends a big-endian integer without leading zeros, as RLP encodes numbers. */
+void rlp_put_uint(struct rlp_buffer* buffer, const uint8_t* data, size_t size);
+
+/**
+ * Starts a list, whose items are then appended, and returns where it starts
+ * to pass to rlp_end_list.
+ */
+size_t rlp_begin_list(struct rlp_buffer* buffer);
+
+/** Puts the header in front of the items appended since rlp_begin_list. */
+void rlp_end_list(struct rlp_buffer* buffer, size_t start);
+
+void rlp_buffer_free(struct rlp_buffer* buffer);
+
+#endif
@@ -0,0 +1,158 @@
+#include "scheduler.h"
+
+#include <stdlib.h>
+
+struct evmc_scheduled_work {
+  /** Must come first, as work is found from the request. */
+  uv_work_t request;
+  struct evmc_scheduled_work* next;
+  struct evmc_scheduler* scheduler;
+  enum evmc_priority priority;
+  uint64_t submitted;
+  uint64_t deadline;
+  evmc_scheduler_run_fn run;
+  void* data;
+};
+
+struct evmc_scheduler_class {
+  struct evmc_scheduled_work* head;
+  struct evmc_scheduled_work* tail;
+  size_t max_running;
+  size_t max_queued;
+  /** Counters updated by the pool threads are accessed atomically. */
+  struct evmc_scheduler_stats stats;
+};
+
+struct evmc_scheduler {
+  uv_loop_t* loop;
+  size_t max_running;
+  size_t running;
+  struct evmc_scheduler_class classes[EVMC_PRIORITY_COUNT];
+};
+
+struct evmc_scheduler* evmc_scheduler_create(uv_loop_t* loop) {
+  struct evmc_scheduler* scheduler = (struct evmc_scheduler*) calloc(1, sizeof(struct evmc_scheduler));
+  if (scheduler == NULL) {
+    return NULL;
+  }
+  scheduler->loop = loop;
+  return scheduler;
+}
+
+void evmc_scheduler_destroy(struct evmc_scheduler* scheduler) {
+  free(scheduler);
+}
+
+static void run_work(uv_work_t* request) {
+  struct evmc_scheduled_work* work = (struct evmc_scheduled_work*) request;
+  struct evmc_scheduler_stats* stats = &work->scheduler->classes[work->priority].stats;
+  uint64_t now = uv_hrtime();
+  uint64_t wait = now - work->submitted;
+  bool expired = work->deadline != 0 && now > work->deadline;
+
+  __atomic_add_fetch(&stats->wait_ns, wait, __ATOMIC_RELAXED);
+  uint64_t max_wait = __atomic_load_n(&stats->max_wait_ns, __ATOMIC_RELAXED);
+  while (wait > max_wait &&
+         !__atomic_compare_exchange_n(&stats->max_wait_ns, &max_wait, wait, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+  __atomic_add_fetch(expired ? &stats->expired : &stats->started, 1, __ATOMIC_RELAXED);
+
+  work->run(work->data, expired);
+}
+
+static void dispatch(struct evmc_scheduler* scheduler);
+
+static void work_done(uv_work_t* request, int status) {
+  struct evmc_scheduled_work* work = (struct evmc_scheduled_work*) request;
+  struct evmc_scheduler* scheduler = work->scheduler;
+  scheduler->classes[work->priority].stats.running--;
+  scheduler->running--;
+  free(work);
+  dispatch(scheduler);
+}
+
+/** Hands queued work to the thread pool while the limits allow. */
+static void dispatch(struct evmc_scheduler* scheduler) {
+  int priority;
+  for (priority = 0; priority < EVMC_PRIORITY_COUNT; priority++) {
+    struct evmc_scheduler_class* queue = &scheduler->classes[priority];
+    while (queue->head != NULL) {
+      if (scheduler->max_running != 0 && scheduler->running >= scheduler->max_running) {
+        return;
+      }
+      if (queue->max_running != 0 && queue->stats.running >= queue->max_running) {
+        break;
+      }
+      struct evmc_scheduled_work* work = queue->head;
+      queue->head = work->next;
+      if (queue->head == NULL) {
+        queue->tail = NULL;
+      }
+      queue->stats.queued--;
+      queue->stats.running++;
+      scheduler->running++;
+      uv_queue_work(scheduler->loop, &work->request, run_work, work_done);
+    }
+  }
+}
+
+void evmc_scheduler_set_max_running(struct evmc_scheduler* scheduler, size_t max_running) {
+  scheduler->max_running = max_running;
+  dispatch(scheduler);
+}
+
+void evmc_scheduler_set_class_limits(struct evmc_scheduler* scheduler, enum evmc_priority priority,
+                                     size_t max_running, size_t max_queued) {
+  scheduler->classes[priority].max_running = max_running;
+  scheduler->classes[priority].max_queued = max_queued;
+  dispatch(scheduler);
+}
+
+bool evmc_scheduler_admit(struct evmc_scheduler* scheduler, enum evmc_priority priority) {
+  struct evmc_scheduler_class* queue = &scheduler->classes[priority];
+  if (queue->max_queued != 0 && queue->stats.queued >= queue->max_queued) {
+    queue->stats.rejected++;
+    return false;
+  }
+  return true;
+}
+
+void evmc_scheduler_submit(struct evmc_scheduler* scheduler, enum evmc_priority priority,
+                           uint64_t deadline, evmc_scheduler_run_fn run, void* data) {
+  struct evmc_scheduler_class* queue = &scheduler->classes[priority];
+  struct evmc_scheduled_work* work = (struct evmc_scheduled_work*) malloc(sizeof(struct evmc_scheduled_work));
+  work->next = NULL;
+  work->scheduler = scheduler;
+  work->priority = priority;
+  work->submitted = uv_hrtime();
+  work->deadline = deadline;
+  work->run = run;
+  work->data = data;
+
+  if (queue->tail == NULL) {
+    queue->head = work;
+  } else {
+    queue->tail->next = work;
+  }
+  queue->tail = work;
+  queue->stats.queued++;
+  dispatch(scheduler);
+}
+
+void evmc_scheduler_count_aborted(struct evmc_scheduler* scheduler, enum evmc_priority priority) {
+  scheduler->classes[priority].stats.aborted++;
+}
+
+void evmc_scheduler_get_stats(struct evmc_scheduler* scheduler, enum evmc_priority priority,
+                              struct evmc_scheduler_stats* stats) {
+  struct evmc_scheduler_stats* source = &scheduler->classes[priority].stats;
+  stats->queued = source->queued;
+  stats->running = source->running;
+  stats->started = __atomic_load_n(&source->started, __ATOMIC_RELAXED);
+  stats->expired = __atomic_load_n(&source->expired, __ATOMIC_RELAXED);
+  stats->rejected = source->rejected;
+  stats->aborted = source->aborted;
+  stats->wait_ns = __atomic_load_n(&source->wait_ns, __ATOMIC_RELAXED);
+  stats->max_wait_ns = __atomic_load_n(&source->max_wait_ns, __ATOMIC_RELAXED);
+}
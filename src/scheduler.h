@@ -0,0 +1,88 @@
+#ifndef EVMC_JS_SCHEDULER_H
+#define EVMC_JS_SCHEDULER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <uv.h>
+
+/**
+ * Queues work for the libuv thread pool by priority class.
+ *
+ * Each class has its own FIFO queue. Work is handed to the thread pool as long
+ * as neither its class nor the scheduler as a whole has reached its limit of
+ * running work, always taking from the highest priority class first. With the
+ * overall limit at most the size of the thread pool, the pool's own FIFO queue
+ * stays empty and the classes decide what runs next.
+ *
+ * Work may have a deadline, past which it is expired instead of run when it
+ * gets its turn. A class may also bound its queue, refusing work beyond it.
+ * Work must be submitted, and the scheduler configured, from the loop thread.
+ */
+
+enum evmc_priority {
+  EVMC_PRIORITY_HIGH = 0,
+  EVMC_PRIORITY_NORMAL = 1,
+  EVMC_PRIORITY_LOW = 2
+};
+
+#define EVMC_PRIORITY_COUNT 3
+
+/**
+ * Runs work on a thread of the pool. It is still called for expired work, so
+ * that it can be finished without being done.
+ */
+typedef void (*evmc_scheduler_run_fn)(void* data, bool expired);
+
+struct evmc_scheduler_stats {
+  /** Work waiting for its turn. */
+  size_t queued;
+  /** Work handed to the thread pool and not yet finished. */
+  size_t running;
+  uint64_t started;
+  /** Work whose deadline passed before it started. */
+  uint64_t expired;
+  /** Work refused because the queue was full. */
+  uint64_t rejected;
+  /** Work aborted by its owner, whether before or while it ran. */
+  uint64_t aborted;
+  /** Time from submission until started or expired, in total and at most. */
+  uint64_t wait_ns;
+  uint64_t max_wait_ns;
+};
+
+struct evmc_scheduler;
+
+struct evmc_scheduler* evmc_scheduler_create(uv_loop_t* loop);
+
+/** Frees the scheduler, which must have no queued or running work. */
+void evmc_scheduler_destroy(struct evmc_scheduler* scheduler);
+
+/** Limits the work running across all classes, 0 for no limit. */
+void evmc_scheduler_set_max_running(struct evmc_scheduler* scheduler, size_t max_running);
+
+/** Limits the running and queued work of a class, 0 for no limit. */
+void evmc_scheduler_set_class_limits(struct evmc_scheduler* scheduler, enum evmc_priority priority,
+                                     size_t max_running, size_t max_queued);
+
+/**
+ * Returns if the class has room for more work. Work refused this way is
+ * counted as rejected.
+ */
+bool evmc_scheduler_admit(struct evmc_scheduler* scheduler, enum evmc_priority priority);
+
+/**
+ * Queues work which has been admitted, to be run by run with data. A deadline
+ * is a uv_hrtime() value, or 0 for none.
+ */
+void evmc_scheduler_submit(struct evmc_scheduler* scheduler, enum evmc_priority priority,
+                           uint64_t deadline, evmc_scheduler_run_fn run, void* data);
+
+/** Counts work which was aborted, on the loop thread. */
+void evmc_scheduler_count_aborted(struct evmc_scheduler* scheduler, enum evmc_priority priority);
+
+void evmc_scheduler_get_stats(struct evmc_scheduler* scheduler, enum evmc_priority priority,
+                              struct evmc_scheduler_stats* stats);
+
+#endif
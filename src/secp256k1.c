@@ -0,0 +1,114 @@
+#include "secp256k1.h"
+
+#include <string.h>
+
+#include "field.h"
+
+static const uint64_t secp256k1_p[4] = {0xfffffffefffffc2fULL, 0xffffffffffffffffULL,
+                                        0xffffffffffffffffULL, 0xffffffffffffffffULL};
+static const uint64_t secp256k1_n[4] = {0xbfd25e8cd0364141ULL, 0xbaaedce6af48a03bULL,
+                                        0xfffffffffffffffeULL, 0xffffffffffffffffULL};
+/** (p + 1) / 4, the square root exponent as p = 3 mod 4. */
+static const uint64_t secp256k1_sqrt_exp[4] = {0xffffffffbfffff0cULL, 0xffffffffffffffffULL,
+                                               0xffffffffffffffffULL, 0x3fffffffffffffffULL};
+
+static const uint8_t secp256k1_gx[32] = {
+    0x79, 0xbe, 0x66, 0x7e, 0xf9, 0xdc, 0xbb, 0xac, 0x55, 0xa0, 0x62,
+    0x95, 0xce, 0x87, 0x0b, 0x07, 0x02, 0x9b, 0xfc, 0xdb, 0x2d, 0xce,
+    0x28, 0xd9, 0x59, 0xf2, 0x81, 0x5b, 0x16, 0xf8, 0x17, 0x98};
+static const uint8_t secp256k1_gy[32] = {
+    0x48, 0x3a, 0xda, 0x77, 0x26, 0xa3, 0xc4, 0x65, 0x5d, 0xa4, 0xfb,
+    0xfc, 0x0e, 0x11, 0x08, 0xa8, 0xfd, 0x17, 0xb4, 0x48, 0xa6, 0x85,
+    0x54, 0x19, 0x9c, 0x47, 0xd0, 0x8f, 0xfb, 0x10, 0xd4, 0xb8};
+
+/** The base field. */
+static struct field fp;
+/** The scalar field, modulo the group order. */
+static struct field fn;
+static struct ec_point generator;
+static fe curve_b;
+
+void secp256k1_init(void) {
+  field_init(&fp, secp256k1_p);
+  field_init(&fn, secp256k1_n);
+
+  fe x, y;
+  fe_from_bytes(&fp, &x, secp256k1_gx);
+  fe_from_bytes(&fp, &y, secp256k1_gy);
+  ec_set_affine(&fp, &generator, &x, &y);
+  fe_from_u64(&fp, &curve_b, 7);
+}
+
+bool secp256k1_recover(const uint8_t hash[32], int recid, const uint8_t r[32],
+                       const uint8_t s[32], uint8_t pubkey[64]) {
+  fe r_n, s_n, e_n;
+  if (!fe_from_bytes(&fn, &r_n, r) || fe_is_zero(&r_n) ||
+      !fe_from_bytes(&fn, &s_n, s) || fe_is_zero(&s_n) ||
+      !fe_from_bytes_reduce(&fn, &e_n, hash)) {
+    return false;
+  }
+
+  // R = (r, y) with the parity of y given by the recovery id. As r < n < p,
+  // r is always a valid x coordinate candidate.
+  fe x, y, y2;
+  if (!fe_from_bytes(&fp, &x, r)) {
+    return false;
+  }
+  fe_sqr(&fp, &y2, &x);
+  fe_mul(&fp, &y2, &y2, &x);
+  fe_add(&fp, &y2, &y2, &curve_b);
+  fe_pow(&fp, &y, &y2, secp256k1_sqrt_exp);
+
+  fe check;
+  fe_sqr(&fp, &check, &y);
+  if (!fe_eq(&check, &y2)) {
+    return false;
+  }
+  if (fe_is_odd(&fp, &y) != (recid & 1)) {
+    fe_neg(&fp, &y, &y);
+  }
+
+  struct ec_point big_r;
+  ec_set_affine(&fp, &big_r, &x, &y);
+
+  // Q = r^-1 (s R - e G) = u1 G + u2 R
+  fe r_inv, u1, u2;
+  fe_inv(&fn, &r_inv, &r_n);
+  fe_mul(&fn, &u1, &e_n, &r_inv);
+  fe_neg(&fn, &u1, &u1);
+  fe_mul(&fn, &u2, &s_n, &r_inv);
+
+  uint8_t u1_bytes[32], u2_bytes[32];
+  fe_to_bytes(&fn, u1_bytes, &u1);
+  fe_to_bytes(&fn, u2_bytes, &u2);
+
+  // Shamir's trick: walk both scalars at once.
+  struct ec_point both;
+  ec_add(&fp, &both, &generator, &big_r);
+
+  struct ec_point q;
+  ec_set_infinity(&fp, &q);
+  int i;
+  for (i = 0; i < 256; i++) {
+    ec_double(&fp, &q, &q);
+    int b1 = (u1_bytes[i / 8] >> (7 - i % 8)) & 1;
+    int b2 = (u2_bytes[i / 8] >> (7 - i % 8)) & 1;
+    if (b1 && b2) {
+      ec_add(&fp, &q, &q, &both);
+    } else if (b1) {
+      ec_add(&fp, &q, &q, &generator);
+    } else if (b2) {
+      ec_add(&fp, &q, &q, &big_r);
+    }
+  }
+
+  if (ec_is_infinity(&q)) {
+    return false;
+  }
+
+  fe qx, qy;
+  ec_to_affine(&fp, &qx, &qy, &q);
+  fe_to_bytes(&fp, pubkey, &qx);
+  fe_to_bytes(&fp, pubkey + 32, &qy);
+  return true;
+}
@@ -0,0 +1,22 @@
+#ifndef EVMC_JS_SECP256K1_H
+#define EVMC_JS_SECP256K1_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Sets up the curve constants. Must be called once before any recovery. */
+void secp256k1_init(void);
+
+/**
+ * Recovers the public key which produced the signature (r, s) over hash.
+ * @param hash    The signed message hash.
+ * @param recid   The recovery id, 0 or 1 (v - 27).
+ * @param r       The signature r value, big-endian.
+ * @param s       The signature s value, big-endian.
+ * @param pubkey  Receives the uncompressed public key x || y, big-endian.
+ * @return        false if the signature is invalid.
+ */
+bool secp256k1_recover(const uint8_t hash[32], int recid, const uint8_t r[32],
+                       const uint8_t s[32], uint8_t pubkey[64]);
+
+#endif
@@ -0,0 +1,332 @@
+#include "snapshot.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct evmc_snapshot {
+  const uint8_t* base;
+  size_t size;
+  const struct evmc_snapshot_header* header;
+  const uint64_t* buckets;
+  const struct evmc_snapshot_account* accounts;
+  const struct evmc_snapshot_slot* slots;
+  const uint8_t* code;
+  int refs;
+};
+
+static bool section_fits(size_t file_size, uint64_t offset, uint64_t count,
+                         uint64_t element_size) {
+  if (offset > file_size || offset % 8 != 0) {
+    return false;
+  }
+  return count <= (file_size - offset) / element_size;
+}
+
+struct evmc_snapshot* evmc_snapshot_open(const char* path, const char** error) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    *error = "Unable to open snapshot";
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(struct evmc_snapshot_header)) {
+    close(fd);
+    *error = "Snapshot is truncated";
+    return NULL;
+  }
+
+  size_t size = (size_t) st.st_size;
+  void* base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+  if (base == MAP_FAILED) {
+    *error = "Unable to map snapshot";
+    return NULL;
+  }
+
+  const struct evmc_snapshot_header* header = (const struct evmc_snapshot_header*) base;
+  if (memcmp(header->magic, EVMC_SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != EVMC_SNAPSHOT_VERSION ||
+      header->bucket_bits > EVMC_SNAPSHOT_MAX_BUCKET_BITS) {
+    munmap(base, size);
+    *error = "Not a snapshot or unsupported snapshot version";
+    return NULL;
+  }
+
+  if (!section_fits(size, header->buckets_offset, ((uint64_t) 1 << header->bucket_bits) + 1, sizeof(uint64_t)) ||
+      !section_fits(size, header->accounts_offset, header->account_count, sizeof(struct evmc_snapshot_account)) ||
+      !section_fits(size, header->slots_offset, header->slot_count, sizeof(struct evmc_snapshot_slot)) ||
+      !section_fits(size, header->code_offset, header->code_size, 1)) {
+    munmap(base, size);
+    *error = "Snapshot is corrupt";
+    return NULL;
+  }
+
+  // Advise the kernel that lookups are scattered, so it does not read ahead.
+  madvise(base, size, MADV_RANDOM);
+
+  struct evmc_snapshot* snapshot = (struct evmc_snapshot*) malloc(sizeof(struct evmc_snapshot));
+  snapshot->base = (const uint8_t*) base;
+  snapshot->size = size;
+  snapshot->header = header;
+  snapshot->buckets = (const uint64_t*) (snapshot->base + header->buckets_offset);
+  snapshot->accounts = (const struct evmc_snapshot_account*) (snapshot->base + header->accounts_offset);
+  snapshot->slots = (const struct evmc_snapshot_slot*) (snapshot->base + header->slots_offset);
+  snapshot->code = snapshot->base + header->code_offset;
+  snapshot->refs = 1;
+  return snapshot;
+}
+
+void evmc_snapshot_retain(struct evmc_snapshot* snapshot) {
+  __atomic_fetch_add(&snapshot->refs, 1, __ATOMIC_RELAXED);
+}
+
+void evmc_snapshot_release(struct evmc_snapshot* snapshot) {
+  if (__atomic_sub_fetch(&snapshot->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    munmap((void*) snapshot->base, snapshot->size);
+    free(snapshot);
+  }
+}
+
+static uint64_t address_bucket(const evmc_address* address, uint32_t bucket_bits) {
+  uint32_t prefix = ((uint32_t) address->bytes[0] << 8) | address->bytes[1];
+  return prefix >> (EVMC_SNAPSHOT_MAX_BUCKET_BITS - bucket_bits);
+}
+
+const struct evmc_snapshot_account* evmc_snapshot_find_account(
+    const struct evmc_snapshot* snapshot, const evmc_address* address) {
+  uint64_t bucket = address_bucket(address, snapshot->header->bucket_bits);
+  uint64_t lo = snapshot->buckets[bucket];
+  uint64_t hi = snapshot->buckets[bucket + 1];
+  if (hi > snapshot->header->account_count) {
+    return NULL;
+  }
+
+  while (lo < hi) {
+    uint64_t mid = lo + (hi - lo) / 2;
+    int cmp = memcmp(snapshot->accounts[mid].address.bytes, address->bytes, sizeof(address->bytes));
+    if (cmp == 0) {
+      return &snapshot->accounts[mid];
+    } else if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return NULL;
+}
+
+evmc_bytes32 evmc_snapshot_get_storage(const struct evmc_snapshot* snapshot,
+                                       const struct evmc_snapshot_account* account,
+                                       const evmc_bytes32* key) {
+  evmc_bytes32 zero;
+  memset(&zero, 0, sizeof(zero));
+
+  if (account->slot_index > snapshot->header->slot_count ||
+      account->slot_count > snapshot->header->slot_count - account->slot_index) {
+    return zero;
+  }
+
+  const struct evmc_snapshot_slot* slots = snapshot->slots + account->slot_index;
+  uint64_t lo = 0;
+  uint64_t hi = account->slot_count;
+  while (lo < hi) {
+    uint64_t mid = lo + (hi - lo) / 2;
+    int cmp = memcmp(slots[mid].key.bytes, key->bytes, sizeof(key->bytes));
+    if (cmp == 0) {
+      return slots[mid].value;
+    } else if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return zero;
+}
+
+const uint8_t* evmc_snapshot_get_code(const struct evmc_snapshot* snapshot,
+                                      const struct evmc_snapshot_account* account) {
+  if (account->code_size == 0 ||
+      account->code_offset > snapshot->header->code_size ||
+      account->code_size > snapshot->header->code_size - account->code_offset) {
+    return NULL;
+  }
+  return snapshot->code + account->code_offset;
+}
+
+uint64_t evmc_snapshot_account_count(const struct evmc_snapshot* snapshot) {
+  return snapshot->header->account_count;
+}
+
+uint64_t evmc_snapshot_slot_count(const struct evmc_snapshot* snapshot) {
+  return snapshot->header->slot_count;
+}
+
+uint64_t evmc_snapshot_code_size(const struct evmc_snapshot* snapshot) {
+  return snapshot->header->code_size;
+}
+
+size_t evmc_snapshot_mapped_size(const struct evmc_snapshot* snapshot) {
+  return snapshot->size;
+}
+
+static int compare_input_accounts(const void* a, const void* b) {
+  return memcmp(((const struct evmc_snapshot_input_account*) a)->address.bytes,
+                ((const struct evmc_snapshot_input_account*) b)->address.bytes,
+                sizeof(evmc_address));
+}
+
+static int compare_slots(const void* a, const void* b) {
+  return memcmp(((const struct evmc_snapshot_slot*) a)->key.bytes,
+                ((const struct evmc_snapshot_slot*) b)->key.bytes,
+                sizeof(evmc_bytes32));
+}
+
+/**
+ * Orders code by hash, then by size and bytes, so only identical code is
+ * adjacent even if the given hashes are wrong.
+ */
+static int compare_code(const void* a, const void* b) {
+  const struct evmc_snapshot_input_account* x = *(const struct evmc_snapshot_input_account* const*) a;
+  const struct evmc_snapshot_input_account* y = *(const struct evmc_snapshot_input_account* const*) b;
+  int order = memcmp(x->code_hash.bytes, y->code_hash.bytes, sizeof(evmc_bytes32));
+  if (order != 0) {
+    return order;
+  }
+  if (x->code_size != y->code_size) {
+    return x->code_size < y->code_size ? -1 : 1;
+  }
+  return memcmp(x->code, y->code, x->code_size);
+}
+
+static uint32_t choose_bucket_bits(size_t account_count) {
+  // Aim for a handful of accounts per bucket.
+  uint32_t bits = 0;
+  while (bits < EVMC_SNAPSHOT_MAX_BUCKET_BITS && ((size_t) 4 << bits) < account_count) {
+    bits++;
+  }
+  return bits;
+}
+
+static size_t align8(size_t value) {
+  return (value + 7) & ~(size_t) 7;
+}
+
+const char* evmc_snapshot_write(const char* path,
+                                struct evmc_snapshot_input_account* accounts,
+                                size_t account_count) {
+  qsort(accounts, account_count, sizeof(struct evmc_snapshot_input_account), compare_input_accounts);
+
+  size_t i;
+  uint64_t slot_count = 0;
+  for (i = 0; i < account_count; i++) {
+    if (i > 0 && memcmp(accounts[i - 1].address.bytes, accounts[i].address.bytes, sizeof(evmc_address)) == 0) {
+      return "Duplicate account in snapshot";
+    }
+    qsort(accounts[i].slots, accounts[i].slot_count, sizeof(struct evmc_snapshot_slot), compare_slots);
+    size_t j;
+    for (j = 1; j < accounts[i].slot_count; j++) {
+      if (memcmp(accounts[i].slots[j - 1].key.bytes, accounts[i].slots[j].key.bytes, sizeof(evmc_bytes32)) == 0) {
+        return "Duplicate storage key in snapshot";
+      }
+    }
+    slot_count += accounts[i].slot_count;
+  }
+
+  // Deduplicate code: order the accounts with code by code hash, and give
+  // each distinct code a single offset in the code section.
+  struct evmc_snapshot_input_account** by_hash =
+      (struct evmc_snapshot_input_account**) malloc(sizeof(void*) * (account_count + 1));
+  uint64_t* code_offsets = (uint64_t*) calloc(account_count + 1, sizeof(uint64_t));
+  size_t with_code = 0;
+  for (i = 0; i < account_count; i++) {
+    if (accounts[i].code_size > 0) {
+      by_hash[with_code++] = &accounts[i];
+    }
+  }
+  qsort(by_hash, with_code, sizeof(void*), compare_code);
+
+  uint64_t code_size = 0;
+  for (i = 0; i < with_code; i++) {
+    if (i > 0 && compare_code(&by_hash[i - 1], &by_hash[i]) == 0) {
+      code_offsets[by_hash[i] - accounts] = code_offsets[by_hash[i - 1] - accounts];
+      continue;
+    }
+    code_offsets[by_hash[i] - accounts] = code_size;
+    code_size += by_hash[i]->code_size;
+  }
+
+  struct evmc_snapshot_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, EVMC_SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.version = EVMC_SNAPSHOT_VERSION;
+  header.bucket_bits = choose_bucket_bits(account_count);
+  header.account_count = account_count;
+  header.slot_count = slot_count;
+  header.buckets_offset = align8(sizeof(header));
+  header.accounts_offset = header.buckets_offset + sizeof(uint64_t) * (((size_t) 1 << header.bucket_bits) + 1);
+  header.slots_offset = header.accounts_offset + sizeof(struct evmc_snapshot_account) * account_count;
+  header.code_offset = header.slots_offset + sizeof(struct evmc_snapshot_slot) * slot_count;
+  header.code_size = code_size;
+
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) {
+    free(by_hash);
+    free(code_offsets);
+    return "Unable to create snapshot";
+  }
+
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+  // Bucket b holds the index of the first account whose prefix is >= b.
+  size_t bucket_count = (size_t) 1 << header.bucket_bits;
+  size_t account = 0;
+  size_t bucket;
+  for (bucket = 0; ok && bucket <= bucket_count; bucket++) {
+    while (account < account_count && address_bucket(&accounts[account].address, header.bucket_bits) < bucket) {
+      account++;
+    }
+    uint64_t start = account;
+    ok = fwrite(&start, sizeof(start), 1, file) == 1;
+  }
+
+  uint64_t slot_index = 0;
+  for (i = 0; ok && i < account_count; i++) {
+    struct evmc_snapshot_account entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.address = accounts[i].address;
+    entry.balance = accounts[i].balance;
+    entry.code_hash = accounts[i].code_hash;
+    entry.code_offset = code_offsets[i];
+    entry.code_size = accounts[i].code_size;
+    entry.slot_index = slot_index;
+    entry.slot_count = accounts[i].slot_count;
+    slot_index += accounts[i].slot_count;
+    ok = fwrite(&entry, sizeof(entry), 1, file) == 1;
+  }
+
+  for (i = 0; ok && i < account_count; i++) {
+    ok = fwrite(accounts[i].slots, sizeof(struct evmc_snapshot_slot), accounts[i].slot_count, file) == accounts[i].slot_count;
+  }
+
+  for (i = 0; ok && i < with_code; i++) {
+    if (i > 0 && compare_code(&by_hash[i - 1], &by_hash[i]) == 0) {
+      continue;
+    }
+    ok = fwrite(by_hash[i]->code, 1, by_hash[i]->code_size, file) == by_hash[i]->code_size;
+  }
+
+  free(by_hash);
+  free(code_offsets);
+
+  if (fclose(file) != 0 || !ok) {
+    return "Unable to write snapshot";
+  }
+  return NULL;
+}
@@ -0,0 +1,112 @@
+#ifndef EVMC_JS_SNAPSHOT_H
+#define EVMC_JS_SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "evmc/evmc.h"
+
+/**
+ * Read-only state snapshot.
+ *
+ * A snapshot is a single file which is mapped into memory and never copied.
+ * All integers are little-endian and every section is 8-byte aligned:
+ *
+ *   header    struct evmc_snapshot_header
+ *   buckets   uint64_t[(1 << bucket_bits) + 1], first account index per
+ *             address prefix
+ *   accounts  struct evmc_snapshot_account[account_count], sorted by address
+ *   slots     struct evmc_snapshot_slot[slot_count], grouped by account and
+ *             sorted by key within each account
+ *   code      deduplicated contract code, one copy per code hash
+ */
+
+#define EVMC_SNAPSHOT_MAGIC "EVMCSNAP"
+#define EVMC_SNAPSHOT_VERSION 1
+#define EVMC_SNAPSHOT_MAX_BUCKET_BITS 16
+
+struct evmc_snapshot_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t bucket_bits;
+  uint64_t account_count;
+  uint64_t slot_count;
+  uint64_t buckets_offset;
+  uint64_t accounts_offset;
+  uint64_t slots_offset;
+  uint64_t code_offset;
+  uint64_t code_size;
+};
+
+struct evmc_snapshot_account {
+  evmc_address address;
+  uint32_t reserved;
+  evmc_bytes32 balance;
+  evmc_bytes32 code_hash;
+  /** Offset of the code, relative to the code section. */
+  uint64_t code_offset;
+  uint64_t code_size;
+  /** Index of the first storage slot of this account. */
+  uint64_t slot_index;
+  uint64_t slot_count;
+};
+
+struct evmc_snapshot_slot {
+  evmc_bytes32 key;
+  evmc_bytes32 value;
+};
+
+/** An account to be written by evmc_snapshot_write. */
+struct evmc_snapshot_input_account {
+  evmc_address address;
+  evmc_bytes32 balance;
+  evmc_bytes32 code_hash;
+  const uint8_t* code;
+  size_t code_size;
+  /** Storage slots, in any order. */
+  struct evmc_snapshot_slot* slots;
+  size_t slot_count;
+};
+
+struct evmc_snapshot;
+
+/**
+ * Maps the snapshot at path. Returns NULL and sets *error to a static message
+ * if the file cannot be mapped or is not a valid snapshot. The returned
+ * snapshot holds one reference.
+ */
+struct evmc_snapshot* evmc_snapshot_open(const char* path, const char** error);
+
+void evmc_snapshot_retain(struct evmc_snapshot* snapshot);
+
+/** Drops a reference, unmapping the file once the last one is gone. */
+void evmc_snapshot_release(struct evmc_snapshot* snapshot);
+
+/** Returns the account at address, or NULL if it is not in the snapshot. */
+const struct evmc_snapshot_account* evmc_snapshot_find_account(
+    const struct evmc_snapshot* snapshot, const evmc_address* address);
+
+/** Returns the value of the storage slot key of account, or zero. */
+evmc_bytes32 evmc_snapshot_get_storage(const struct evmc_snapshot* snapshot,
+                                       const struct evmc_snapshot_account* account,
+                                       const evmc_bytes32* key);
+
+/** Returns a pointer to the code of account, or NULL if it has none. */
+const uint8_t* evmc_snapshot_get_code(const struct evmc_snapshot* snapshot,
+                                      const struct evmc_snapshot_account* account);
+
+uint64_t evmc_snapshot_account_count(const struct evmc_snapshot* snapshot);
+uint64_t evmc_snapshot_slot_count(const struct evmc_snapshot* snapshot);
+uint64_t evmc_snapshot_code_size(const struct evmc_snapshot* snapshot);
+size_t evmc_snapshot_mapped_size(const struct evmc_snapshot* snapshot);
+
+/**
+ * Writes a snapshot of accounts to path. The accounts and their slots are
+ * sorted in place. Returns NULL on success, or a static error message.
+ */
+const char* evmc_snapshot_write(const char* path,
+                                struct evmc_snapshot_input_account* accounts,
+                                size_t account_count);
+
+#endif
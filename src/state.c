@@ -0,0 +1,479 @@
+#include "state.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <uv.h>
+
+#define INITIAL_CAPACITY 8
+
+struct evmc_state_slot {
+  bool used;
+  evmc_address address;
+  evmc_bytes32 key;
+  /** The value when the current execution started. */
+  evmc_bytes32 original;
+  evmc_bytes32 current;
+};
+
+struct evmc_state_account {
+  bool used;
+  /** The evmc_account_cache_field bits which are filled in. */
+  uint8_t known;
+  bool code_known;
+  evmc_address address;
+  struct evmc_account_cache_value value;
+  uint8_t* code;
+  size_t code_size;
+};
+
+struct evmc_state_block_hash {
+  int64_t number;
+  evmc_bytes32 hash;
+};
+
+struct evmc_state {
+  /** The state this one was forked from, or NULL for the root. */
+  struct evmc_state* parent;
+  /** Guards the root, which is filled by every member of the family. */
+  uv_rwlock_t lock;
+
+  struct evmc_state_slot* slots;
+  size_t slot_capacity;
+  size_t slot_count;
+
+  /* Only the root has accounts, a transaction context and block hashes. */
+  struct evmc_state_account* accounts;
+  size_t account_capacity;
+  size_t account_count;
+  bool tx_context_known;
+  struct evmc_tx_context tx_context;
+  /** Only the last 256 blocks can be asked for, so a list will do. */
+  struct evmc_state_block_hash* block_hashes;
+  size_t block_hash_count;
+  size_t block_hash_capacity;
+
+  /** Bytes allocated, kept apart so it can be read while the state is in use. */
+  size_t allocated;
+  bool executing;
+  bool forked;
+  int refs;
+};
+
+static const uint8_t empty_code[1];
+
+static uint64_t hash_bytes(const uint8_t* bytes, size_t size) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  size_t i;
+  for (i = 0; i + 8 <= size; i += 8) {
+    uint64_t word;
+    memcpy(&word, bytes + i, sizeof(word));
+    h = (h ^ word) * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 29;
+  }
+  for (; i < size; i++) {
+    h = (h ^ bytes[i]) * 0x100000001b3ULL;
+  }
+  return h ^ (h >> 32);
+}
+
+static uint64_t hash_slot(const evmc_address* address, const evmc_bytes32* key) {
+  return hash_bytes(address->bytes, sizeof(address->bytes)) ^
+         (hash_bytes(key->bytes, sizeof(key->bytes)) * 0xff51afd7ed558ccdULL);
+}
+
+static void add_allocated(struct evmc_state* state, size_t bytes) {
+  __atomic_add_fetch(&state->allocated, bytes, __ATOMIC_RELAXED);
+}
+
+static struct evmc_state* new_state(struct evmc_state* parent) {
+  struct evmc_state* state = (struct evmc_state*) calloc(1, sizeof(struct evmc_state));
+  state->parent = parent;
+  state->allocated = sizeof(struct evmc_state);
+  state->refs = 1;
+  if (parent == NULL) {
+    uv_rwlock_init(&state->lock);
+  }
+  return state;
+}
+
+struct evmc_state* evmc_state_create(void) {
+  return new_state(NULL);
+}
+
+struct evmc_state* evmc_state_fork(struct evmc_state* parent) {
+  if (parent->executing) {
+    return NULL;
+  }
+  parent->forked = true;
+  evmc_state_retain(parent);
+  return new_state(parent);
+}
+
+void evmc_state_retain(struct evmc_state* state) {
+  __atomic_add_fetch(&state->refs, 1, __ATOMIC_RELAXED);
+}
+
+void evmc_state_release(struct evmc_state* state) {
+  while (state != NULL && __atomic_sub_fetch(&state->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    struct evmc_state* parent = state->parent;
+    size_t i;
+    for (i = 0; i < state->account_capacity; i++) {
+      free(state->accounts[i].code);
+    }
+    free(state->accounts);
+    free(state->slots);
+    free(state->block_hashes);
+    if (parent == NULL) {
+      uv_rwlock_destroy(&state->lock);
+    }
+    free(state);
+    state = parent;
+  }
+}
+
+static struct evmc_state* root_of(struct evmc_state* state) {
+  while (state->parent != NULL) {
+    state = state->parent;
+  }
+  return state;
+}
+
+/*
+ * Only the root is locked. Any other state is either frozen by a fork, or
+ * written and read by the one execution which has claimed it.
+ */
+
+static void read_lock(struct evmc_state* state) {
+  if (state->parent == NULL) {
+    uv_rwlock_rdlock(&state->lock);
+  }
+}
+
+static void read_unlock(struct evmc_state* state) {
+  if (state->parent == NULL) {
+    uv_rwlock_rdunlock(&state->lock);
+  }
+}
+
+static void write_lock(struct evmc_state* state) {
+  if (state->parent == NULL) {
+    uv_rwlock_wrlock(&state->lock);
+  }
+}
+
+static void write_unlock(struct evmc_state* state) {
+  if (state->parent == NULL) {
+    uv_rwlock_wrunlock(&state->lock);
+  }
+}
+
+bool evmc_state_begin(struct evmc_state* state) {
+  if (state->executing || state->forked) {
+    return false;
+  }
+  state->executing = true;
+
+  write_lock(state);
+  size_t i;
+  for (i = 0; i < state->slot_capacity; i++) {
+    state->slots[i].original = state->slots[i].current;
+  }
+  write_unlock(state);
+  return true;
+}
+
+void evmc_state_end(struct evmc_state* state) {
+  state->executing = false;
+}
+
+static struct evmc_state_slot* find_slot(struct evmc_state_slot* slots, size_t capacity,
+                                         const evmc_address* address, const evmc_bytes32* key) {
+  size_t i = hash_slot(address, key) & (capacity - 1);
+  while (slots[i].used && (memcmp(&slots[i].address, address, sizeof(*address)) != 0 ||
+                           memcmp(&slots[i].key, key, sizeof(*key)) != 0)) {
+    i = (i + 1) & (capacity - 1);
+  }
+  return &slots[i];
+}
+
+static struct evmc_state_account* find_account(struct evmc_state_account* accounts, size_t capacity,
+                                               const evmc_address* address) {
+  size_t i = hash_bytes(address->bytes, sizeof(address->bytes)) & (capacity - 1);
+  while (accounts[i].used && memcmp(&accounts[i].address, address, sizeof(*address)) != 0) {
+    i = (i + 1) & (capacity - 1);
+  }
+  return &accounts[i];
+}
+
+/** Keeps the tables at most half full, so probes stay short. */
+static void grow_slots(struct evmc_state* state) {
+  if (2 * (state->slot_count + 1) <= state->slot_capacity) {
+    return;
+  }
+  size_t capacity = state->slot_capacity == 0 ? INITIAL_CAPACITY : 2 * state->slot_capacity;
+  struct evmc_state_slot* slots = (struct evmc_state_slot*) calloc(capacity, sizeof(struct evmc_state_slot));
+  size_t i;
+  for (i = 0; i < state->slot_capacity; i++) {
+    if (state->slots[i].used) {
+      *find_slot(slots, capacity, &state->slots[i].address, &state->slots[i].key) = state->slots[i];
+    }
+  }
+  free(state->slots);
+  add_allocated(state, (capacity - state->slot_capacity) * sizeof(struct evmc_state_slot));
+  state->slots = slots;
+  state->slot_capacity = capacity;
+}
+
+static void grow_accounts(struct evmc_state* state) {
+  if (2 * (state->account_count + 1) <= state->account_capacity) {
+    return;
+  }
+  size_t capacity = state->account_capacity == 0 ? INITIAL_CAPACITY : 2 * state->account_capacity;
+  struct evmc_state_account* accounts = (struct evmc_state_account*) calloc(capacity, sizeof(struct evmc_state_account));
+  size_t i;
+  for (i = 0; i < state->account_capacity; i++) {
+    if (state->accounts[i].used) {
+      *find_account(accounts, capacity, &state->accounts[i].address) = state->accounts[i];
+    }
+  }
+  free(state->accounts);
+  add_allocated(state, (capacity - state->account_capacity) * sizeof(struct evmc_state_account));
+  state->accounts = accounts;
+  state->account_capacity = capacity;
+}
+
+/** Looks up a slot in the state itself, without its parents. */
+static struct evmc_state_slot* own_slot(struct evmc_state* state, const evmc_address* address,
+                                        const evmc_bytes32* key) {
+  if (state->slot_capacity == 0) {
+    return NULL;
+  }
+  struct evmc_state_slot* slot = find_slot(state->slots, state->slot_capacity, address, key);
+  return slot->used ? slot : NULL;
+}
+
+static struct evmc_state_account* own_account(struct evmc_state* state, const evmc_address* address) {
+  if (state->account_capacity == 0) {
+    return NULL;
+  }
+  struct evmc_state_account* account = find_account(state->accounts, state->account_capacity, address);
+  return account->used ? account : NULL;
+}
+
+/** Adds a slot to the state itself, which must be write locked. */
+static struct evmc_state_slot* insert_slot(struct evmc_state* state, const evmc_address* address,
+                                           const evmc_bytes32* key, const evmc_bytes32* value) {
+  grow_slots(state);
+  struct evmc_state_slot* slot = find_slot(state->slots, state->slot_capacity, address, key);
+  if (!slot->used) {
+    slot->used = true;
+    slot->address = *address;
+    slot->key = *key;
+    slot->original = *value;
+    slot->current = *value;
+    state->slot_count++;
+  }
+  return slot;
+}
+
+static struct evmc_state_account* insert_account(struct evmc_state* state, const evmc_address* address) {
+  grow_accounts(state);
+  struct evmc_state_account* account = find_account(state->accounts, state->account_capacity, address);
+  if (!account->used) {
+    account->used = true;
+    account->address = *address;
+    state->account_count++;
+  }
+  return account;
+}
+
+bool evmc_state_get_storage(struct evmc_state* state, const evmc_address* address,
+                            const evmc_bytes32* key, evmc_bytes32* value) {
+  for (; state != NULL; state = state->parent) {
+    read_lock(state);
+    struct evmc_state_slot* slot = own_slot(state, address, key);
+    if (slot != NULL) {
+      *value = slot->current;
+    }
+    read_unlock(state);
+    if (slot != NULL) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void evmc_state_fill_storage(struct evmc_state* state, const evmc_address* address,
+                             const evmc_bytes32* key, const evmc_bytes32* value) {
+  struct evmc_state* root = root_of(state);
+  write_lock(root);
+  insert_slot(root, address, key, value);
+  write_unlock(root);
+}
+
+static bool is_zero(const evmc_bytes32* value) {
+  static const evmc_bytes32 zero;
+  return memcmp(value, &zero, sizeof(zero)) == 0;
+}
+
+enum evmc_storage_status evmc_state_set_storage(struct evmc_state* state,
+                                                const evmc_address* address,
+                                                const evmc_bytes32* key,
+                                                const evmc_bytes32* value) {
+  // A write to a slot read through to a parent copies it first.
+  evmc_bytes32 known;
+  memset(&known, 0, sizeof(known));
+  evmc_state_get_storage(state, address, key, &known);
+
+  write_lock(state);
+  struct evmc_state_slot* slot = insert_slot(state, address, key, &known);
+
+  enum evmc_storage_status status;
+  if (memcmp(&slot->current, value, sizeof(*value)) == 0) {
+    status = EVMC_STORAGE_UNCHANGED;
+  } else if (memcmp(&slot->original, &slot->current, sizeof(*value)) != 0) {
+    status = EVMC_STORAGE_MODIFIED_AGAIN;
+  } else if (is_zero(&slot->original)) {
+    status = EVMC_STORAGE_ADDED;
+  } else if (is_zero(value)) {
+    status = EVMC_STORAGE_DELETED;
+  } else {
+    status = EVMC_STORAGE_MODIFIED;
+  }
+  slot->current = *value;
+  write_unlock(state);
+  return status;
+}
+
+bool evmc_state_get_account(struct evmc_state* state, const evmc_address* address,
+                            enum evmc_account_cache_field field,
+                            struct evmc_account_cache_value* value) {
+  struct evmc_state* root = root_of(state);
+  read_lock(root);
+  struct evmc_state_account* account = own_account(root, address);
+  bool found = account != NULL && (account->known & field);
+  if (found) {
+    *value = account->value;
+  }
+  read_unlock(root);
+  return found;
+}
+
+void evmc_state_fill_account(struct evmc_state* state, const evmc_address* address,
+                             enum evmc_account_cache_field field,
+                             const struct evmc_account_cache_value* value) {
+  struct evmc_state* root = root_of(state);
+  write_lock(root);
+  struct evmc_state_account* account = insert_account(root, address);
+  account->known |= field;
+  switch (field) {
+    case EVMC_ACCOUNT_CACHE_EXISTS:
+      account->value.exists = value->exists;
+      break;
+    case EVMC_ACCOUNT_CACHE_BALANCE:
+      account->value.balance = value->balance;
+      break;
+    case EVMC_ACCOUNT_CACHE_CODE_SIZE:
+      account->value.code_size = value->code_size;
+      break;
+    case EVMC_ACCOUNT_CACHE_CODE_HASH:
+      account->value.code_hash = value->code_hash;
+      break;
+  }
+  write_unlock(root);
+}
+
+const uint8_t* evmc_state_get_code(struct evmc_state* state, const evmc_address* address,
+                                   size_t* size) {
+  struct evmc_state* root = root_of(state);
+  const uint8_t* code = NULL;
+  read_lock(root);
+  struct evmc_state_account* account = own_account(root, address);
+  if (account != NULL && account->code_known) {
+    *size = account->code_size;
+    code = account->code != NULL ? account->code : empty_code;
+  }
+  read_unlock(root);
+  return code;
+}
+
+void evmc_state_fill_code(struct evmc_state* state, const evmc_address* address,
+                          const uint8_t* code, size_t size) {
+  struct evmc_state* root = root_of(state);
+  write_lock(root);
+  struct evmc_state_account* account = insert_account(root, address);
+  if (!account->code_known) {
+    account->code_known = true;
+    account->code_size = size;
+    if (size > 0) {
+      account->code = (uint8_t*) malloc(size);
+      memcpy(account->code, code, size);
+      add_allocated(root, size);
+    }
+  }
+  write_unlock(root);
+}
+
+bool evmc_state_get_tx_context(struct evmc_state* state, struct evmc_tx_context* context) {
+  struct evmc_state* root = root_of(state);
+  read_lock(root);
+  bool found = root->tx_context_known;
+  if (found) {
+    *context = root->tx_context;
+  }
+  read_unlock(root);
+  return found;
+}
+
+void evmc_state_fill_tx_context(struct evmc_state* state, const struct evmc_tx_context* context) {
+  struct evmc_state* root = root_of(state);
+  write_lock(root);
+  root->tx_context = *context;
+  root->tx_context_known = true;
+  write_unlock(root);
+}
+
+bool evmc_state_get_block_hash(struct evmc_state* state, int64_t number, evmc_bytes32* hash) {
+  struct evmc_state* root = root_of(state);
+  bool found = false;
+  size_t i;
+  read_lock(root);
+  for (i = 0; i < root->block_hash_count && !found; i++) {
+    if (root->block_hashes[i].number == number) {
+      *hash = root->block_hashes[i].hash;
+      found = true;
+    }
+  }
+  read_unlock(root);
+  return found;
+}
+
+void evmc_state_fill_block_hash(struct evmc_state* state, int64_t number, const evmc_bytes32* hash) {
+  struct evmc_state* root = root_of(state);
+  write_lock(root);
+  if (root->block_hash_count == root->block_hash_capacity) {
+    size_t capacity = root->block_hash_capacity == 0 ? 8 : 2 * root->block_hash_capacity;
+    root->block_hashes = (struct evmc_state_block_hash*) realloc(
+        root->block_hashes, capacity * sizeof(struct evmc_state_block_hash));
+    add_allocated(root, (capacity - root->block_hash_capacity) * sizeof(struct evmc_state_block_hash));
+    root->block_hash_capacity = capacity;
+  }
+  root->block_hashes[root->block_hash_count].number = number;
+  root->block_hashes[root->block_hash_count].hash = *hash;
+  root->block_hash_count++;
+  write_unlock(root);
+}
+
+void evmc_state_revert(struct evmc_state* state) {
+  write_lock(state);
+  size_t i;
+  for (i = 0; i < state->slot_capacity; i++) {
+    state->slots[i].current = state->slots[i].original;
+  }
+  write_unlock(state);
+}
+
+size_t evmc_state_memory_usage(struct evmc_state* state) {
+  return __atomic_load_n(&state->allocated, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,106 @@
+#ifndef EVMC_JS_STATE_H
+#define EVMC_JS_STATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "evmc/evmc.h"
+
+#include "account_cache.h"
+
+/**
+ * A native copy of the state executions have read from the host, plus the
+ * storage writes they made on top of it.
+ *
+ * Reads miss until the host's answer is filled in, after which they are served
+ * natively. Writes keep the value the slot had when the transaction started,
+ * so they can be reverted to run the same transaction again without asking the
+ * host twice, or committed to run the next one on top of them.
+ *
+ * A state can be forked into children which read through to it and keep their
+ * own writes; only writes allocate in a child. Once forked, a state no longer
+ * takes writes, so its children see it as it was. Host answers are always
+ * filled into the root of the family, where every member can read them, so a
+ * family may be read and filled from any number of threads. Each state is
+ * written by one execution at a time.
+ */
+
+struct evmc_state;
+
+/** Creates an empty root state. The returned state holds one reference. */
+struct evmc_state* evmc_state_create(void);
+
+/**
+ * Creates a child of parent, which then no longer takes writes. Returns NULL if
+ * parent is being executed on. The returned state holds one reference.
+ */
+struct evmc_state* evmc_state_fork(struct evmc_state* parent);
+
+void evmc_state_retain(struct evmc_state* state);
+
+/** Drops a reference, freeing the state and releasing its parent once the last one is gone. */
+void evmc_state_release(struct evmc_state* state);
+
+/**
+ * Claims the state for an execution, committing the writes of the previous
+ * one. Returns false if the state is being executed on or has been forked.
+ * Claims must be made and ended on one thread.
+ */
+bool evmc_state_begin(struct evmc_state* state);
+
+void evmc_state_end(struct evmc_state* state);
+
+/** Looks up the current value of a storage slot, including writes. */
+bool evmc_state_get_storage(struct evmc_state* state, const evmc_address* address,
+                            const evmc_bytes32* key, evmc_bytes32* value);
+
+/** Fills in the value of a storage slot, as answered by the host. */
+void evmc_state_fill_storage(struct evmc_state* state, const evmc_address* address,
+                             const evmc_bytes32* key, const evmc_bytes32* value);
+
+/**
+ * Writes a storage slot whose value is known, and returns the status of the
+ * write as defined by EIP-1283.
+ */
+enum evmc_storage_status evmc_state_set_storage(struct evmc_state* state,
+                                                const evmc_address* address,
+                                                const evmc_bytes32* key,
+                                                const evmc_bytes32* value);
+
+/** Looks up one field of the account at address. */
+bool evmc_state_get_account(struct evmc_state* state, const evmc_address* address,
+                            enum evmc_account_cache_field field,
+                            struct evmc_account_cache_value* value);
+
+/** Fills in one field of the account at address, as answered by the host. */
+void evmc_state_fill_account(struct evmc_state* state, const evmc_address* address,
+                             enum evmc_account_cache_field field,
+                             const struct evmc_account_cache_value* value);
+
+/**
+ * Returns the code of the account at address, or NULL if not filled in. The
+ * code stays valid as long as the state.
+ */
+const uint8_t* evmc_state_get_code(struct evmc_state* state, const evmc_address* address,
+                                   size_t* size);
+
+/** Fills in the code of the account at address, which is copied. */
+void evmc_state_fill_code(struct evmc_state* state, const evmc_address* address,
+                          const uint8_t* code, size_t size);
+
+bool evmc_state_get_tx_context(struct evmc_state* state, struct evmc_tx_context* context);
+
+void evmc_state_fill_tx_context(struct evmc_state* state, const struct evmc_tx_context* context);
+
+bool evmc_state_get_block_hash(struct evmc_state* state, int64_t number, evmc_bytes32* hash);
+
+void evmc_state_fill_block_hash(struct evmc_state* state, int64_t number, const evmc_bytes32* hash);
+
+/** Drops the writes of the current execution. */
+void evmc_state_revert(struct evmc_state* state);
+
+/** Bytes allocated by the state itself, not counting its parent. */
+size_t evmc_state_memory_usage(struct evmc_state* state);
+
+#endif
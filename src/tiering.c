@@ -0,0 +1,144 @@
+#include "tiering.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <uv.h>
+
+#include "hash.h"
+
+#define SETS 1024
+#define WAYS 4
+
+struct evmc_tier {
+  struct evmc_instance* instance;
+  struct evmc_tier_stats stats;
+};
+
+struct evmc_code_count {
+  uint64_t hash;
+  uint64_t count;
+};
+
+struct evmc_tiering {
+  struct evmc_tier tiers[EVMC_TIERING_MAX_TIERS];
+  size_t count;
+  uv_mutex_t lock;
+  struct evmc_code_count counts[SETS][WAYS];
+  int refs;
+};
+
+struct evmc_tiering* evmc_tiering_create(struct evmc_instance* base) {
+  struct evmc_tiering* tiering = (struct evmc_tiering*) calloc(1, sizeof(struct evmc_tiering));
+  if (tiering == NULL) {
+    return NULL;
+  }
+  tiering->tiers[0].instance = base;
+  tiering->count = 1;
+  tiering->refs = 1;
+  uv_mutex_init(&tiering->lock);
+  return tiering;
+}
+
+bool evmc_tiering_add(struct evmc_tiering* tiering, struct evmc_instance* instance,
+                      uint64_t threshold) {
+  if (tiering->count == EVMC_TIERING_MAX_TIERS ||
+      threshold <= tiering->tiers[tiering->count - 1].stats.threshold) {
+    return false;
+  }
+  struct evmc_tier* tier = &tiering->tiers[tiering->count++];
+  tier->instance = instance;
+  tier->stats.threshold = threshold;
+  return true;
+}
+
+void evmc_tiering_retain(struct evmc_tiering* tiering) {
+  __atomic_add_fetch(&tiering->refs, 1, __ATOMIC_RELAXED);
+}
+
+void evmc_tiering_release(struct evmc_tiering* tiering) {
+  if (__atomic_sub_fetch(&tiering->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    size_t i;
+    for (i = 1; i < tiering->count; i++) {
+      tiering->tiers[i].instance->destroy(tiering->tiers[i].instance);
+    }
+    uv_mutex_destroy(&tiering->lock);
+    free(tiering);
+  }
+}
+
+/** Returns how many executions of the code with this hash have started. */
+static uint64_t count_execution(struct evmc_tiering* tiering, uint64_t hash) {
+  struct evmc_code_count* set = tiering->counts[hash % SETS];
+  struct evmc_code_count* coldest = &set[0];
+  uint64_t count;
+  int i;
+
+  uv_mutex_lock(&tiering->lock);
+  for (i = 0; i < WAYS; i++) {
+    if (set[i].hash == hash) {
+      count = ++set[i].count;
+      uv_mutex_unlock(&tiering->lock);
+      return count;
+    }
+    if (set[i].count < coldest->count) {
+      coldest = &set[i];
+    }
+  }
+  if (coldest->count <= 1) {
+    coldest->hash = hash;
+    coldest->count = 1;
+  } else {
+    coldest->count--;
+  }
+  uv_mutex_unlock(&tiering->lock);
+  return 1;
+}
+
+struct evmc_result evmc_tiering_execute(struct evmc_tiering* tiering, struct evmc_context* context,
+                                        enum evmc_revision revision, const struct evmc_message* msg,
+                                        const uint8_t* code, size_t code_size) {
+  size_t tier = 0;
+  if (tiering->count > 1) {
+    uint64_t count = count_execution(tiering, hash_code64(code, code_size));
+    while (tier + 1 < tiering->count && tiering->tiers[tier + 1].stats.threshold <= count) {
+      tier++;
+    }
+    if (tier > 0 && tiering->tiers[tier].stats.threshold == count) {
+      __atomic_add_fetch(&tiering->tiers[tier].stats.promotions, 1, __ATOMIC_RELAXED);
+    }
+  }
+
+  for (;;) {
+    struct evmc_tier_stats* stats = &tiering->tiers[tier].stats;
+    struct evmc_instance* instance = tiering->tiers[tier].instance;
+
+    uint64_t start = uv_hrtime();
+    struct evmc_result result = instance->execute(instance, context, revision, msg, code, code_size);
+    __atomic_add_fetch(&stats->elapsed_ns, uv_hrtime() - start, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats->executions, 1, __ATOMIC_RELAXED);
+
+    if (result.status_code != EVMC_REJECTED || tier == 0) {
+      return result;
+    }
+    __atomic_add_fetch(&stats->rejections, 1, __ATOMIC_RELAXED);
+    if (result.release != NULL) {
+      result.release(&result);
+    }
+    tier--;
+  }
+}
+
+size_t evmc_tiering_count(struct evmc_tiering* tiering) {
+  return tiering->count;
+}
+
+void evmc_tiering_get_stats(struct evmc_tiering* tiering, size_t tier,
+                            struct evmc_tier_stats* stats) {
+  struct evmc_tier_stats* source = &tiering->tiers[tier].stats;
+  stats->threshold = source->threshold;
+  stats->executions = __atomic_load_n(&source->executions, __ATOMIC_RELAXED);
+  stats->rejections = __atomic_load_n(&source->rejections, __ATOMIC_RELAXED);
+  stats->promotions = __atomic_load_n(&source->promotions, __ATOMIC_RELAXED);
+  stats->elapsed_ns = __atomic_load_n(&source->elapsed_ns, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,69 @@
+#ifndef EVMC_JS_TIERING_H
+#define EVMC_JS_TIERING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "evmc/evmc.h"
+
+/**
+ * Routes executions between several VMs by how often their code has run.
+ *
+ * Tier 0 is the base VM and runs everything until it gets hot. Every other
+ * tier has a threshold, and code which has started at least that many
+ * executions runs on the tier with the highest threshold it has reached. A tier
+ * which returns EVMC_REJECTED hands the execution down to the tier below it.
+ *
+ * Executions are counted per hash of the code in a fixed table, where colliding
+ * code wears down the count of the code it would replace instead of evicting
+ * it outright, so hot code keeps its slot. A tiering may be used from any
+ * number of threads at once.
+ */
+
+#define EVMC_TIERING_MAX_TIERS 8
+
+struct evmc_tier_stats {
+  uint64_t threshold;
+  uint64_t executions;
+  /** Executions this tier returned EVMC_REJECTED for. */
+  uint64_t rejections;
+  /** Code which has reached this tier's threshold. */
+  uint64_t promotions;
+  /** Time spent in the VM's execute, including host calls. */
+  uint64_t elapsed_ns;
+};
+
+struct evmc_tiering;
+
+/**
+ * Creates a tiering with base as tier 0. The base VM stays owned by the
+ * caller. The returned tiering holds one reference.
+ */
+struct evmc_tiering* evmc_tiering_create(struct evmc_instance* base);
+
+/**
+ * Adds a VM above the existing tiers, which is destroyed with the tiering.
+ * Thresholds must grow with each tier. Returns false without taking the VM if
+ * the threshold is not above the previous one or there are too many tiers.
+ * Tiers must all be added before the tiering is used to execute.
+ */
+bool evmc_tiering_add(struct evmc_tiering* tiering, struct evmc_instance* instance,
+                      uint64_t threshold);
+
+void evmc_tiering_retain(struct evmc_tiering* tiering);
+
+/** Drops a reference, destroying the added VMs once the last one is gone. */
+void evmc_tiering_release(struct evmc_tiering* tiering);
+
+/** Counts an execution of code and runs it on the tier it has reached. */
+struct evmc_result evmc_tiering_execute(struct evmc_tiering* tiering, struct evmc_context* context,
+                                        enum evmc_revision revision, const struct evmc_message* msg,
+                                        const uint8_t* code, size_t code_size);
+
+size_t evmc_tiering_count(struct evmc_tiering* tiering);
+
+void evmc_tiering_get_stats(struct evmc_tiering* tiering, size_t tier,
+                            struct evmc_tier_stats* stats);
+
+#endif
@@ -0,0 +1,513 @@
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <uv.h>
+
+void evmc_trace_buffer_init(struct evmc_trace_buffer* buffer) {
+  buffer->data = NULL;
+  buffer->size = 0;
+  buffer->capacity = 0;
+}
+
+void evmc_trace_buffer_free(struct evmc_trace_buffer* buffer) {
+  free(buffer->data);
+  evmc_trace_buffer_init(buffer);
+}
+
+void evmc_trace_put_bytes(struct evmc_trace_buffer* buffer, const void* data, size_t size) {
+  if (buffer->size + size > buffer->capacity) {
+    size_t capacity = buffer->capacity == 0 ? 256 : buffer->capacity;
+    while (capacity < buffer->size + size) {
+      capacity *= 2;
+    }
+    buffer->data = (uint8_t*) realloc(buffer->data, capacity);
+    buffer->capacity = capacity;
+  }
+  if (size > 0) {
+    memcpy(buffer->data + buffer->size, data, size);
+  }
+  buffer->size += size;
+}
+
+void evmc_trace_put_u8(struct evmc_trace_buffer* buffer, uint8_t value) {
+  evmc_trace_put_bytes(buffer, &value, 1);
+}
+
+void evmc_trace_put_u32(struct evmc_trace_buffer* buffer, uint32_t value) {
+  uint8_t bytes[4];
+  int i;
+  for (i = 0; i < 4; i++) {
+    bytes[i] = (uint8_t) (value >> (8 * i));
+  }
+  evmc_trace_put_bytes(buffer, bytes, sizeof(bytes));
+}
+
+void evmc_trace_put_u64(struct evmc_trace_buffer* buffer, uint64_t value) {
+  uint8_t bytes[8];
+  int i;
+  for (i = 0; i < 8; i++) {
+    bytes[i] = (uint8_t) (value >> (8 * i));
+  }
+  evmc_trace_put_bytes(buffer, bytes, sizeof(bytes));
+}
+
+void evmc_trace_put_message(struct evmc_trace_buffer* buffer, const struct evmc_message* message) {
+  evmc_trace_put_u8(buffer, (uint8_t) message->kind);
+  evmc_trace_put_u32(buffer, message->flags);
+  evmc_trace_put_u32(buffer, (uint32_t) message->depth);
+  evmc_trace_put_u64(buffer, (uint64_t) message->gas);
+  evmc_trace_put_bytes(buffer, &message->destination, sizeof(evmc_address));
+  evmc_trace_put_bytes(buffer, &message->sender, sizeof(evmc_address));
+  evmc_trace_put_bytes(buffer, &message->value, sizeof(evmc_uint256be));
+  evmc_trace_put_bytes(buffer, &message->create2_salt, sizeof(evmc_bytes32));
+  evmc_trace_put_u32(buffer, (uint32_t) message->input_size);
+  evmc_trace_put_bytes(buffer, message->input_data, message->input_size);
+}
+
+void evmc_trace_put_result(struct evmc_trace_buffer* buffer, const struct evmc_result* result) {
+  evmc_trace_put_u32(buffer, (uint32_t) result->status_code);
+  evmc_trace_put_u64(buffer, (uint64_t) result->gas_left);
+  evmc_trace_put_u32(buffer, (uint32_t) result->output_size);
+  evmc_trace_put_bytes(buffer, result->output_data, result->output_size);
+  evmc_trace_put_bytes(buffer, &result->create_address, sizeof(evmc_address));
+}
+
+void evmc_trace_put_tx_context(struct evmc_trace_buffer* buffer, const struct evmc_tx_context* context) {
+  evmc_trace_put_bytes(buffer, &context->tx_gas_price, sizeof(evmc_uint256be));
+  evmc_trace_put_bytes(buffer, &context->tx_origin, sizeof(evmc_address));
+  evmc_trace_put_bytes(buffer, &context->block_coinbase, sizeof(evmc_address));
+  evmc_trace_put_u64(buffer, (uint64_t) context->block_number);
+  evmc_trace_put_u64(buffer, (uint64_t) context->block_timestamp);
+  evmc_trace_put_u64(buffer, (uint64_t) context->block_gas_limit);
+  evmc_trace_put_bytes(buffer, &context->block_difficulty, sizeof(evmc_uint256be));
+}
+
+struct evmc_trace_writer {
+  FILE* file;
+  uv_mutex_t lock;
+  bool ok;
+  int refs;
+};
+
+struct evmc_trace_writer* evmc_trace_writer_open(const char* path, const char** error) {
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) {
+    *error = "Unable to create trace";
+    return NULL;
+  }
+
+  struct evmc_trace_buffer header;
+  evmc_trace_buffer_init(&header);
+  evmc_trace_put_bytes(&header, EVMC_TRACE_MAGIC, 8);
+  evmc_trace_put_u32(&header, EVMC_TRACE_VERSION);
+  bool ok = fwrite(header.data, 1, header.size, file) == header.size;
+  evmc_trace_buffer_free(&header);
+  if (!ok) {
+    fclose(file);
+    *error = "Unable to write trace";
+    return NULL;
+  }
+
+  struct evmc_trace_writer* writer = (struct evmc_trace_writer*) malloc(sizeof(struct evmc_trace_writer));
+  writer->file = file;
+  writer->ok = true;
+  writer->refs = 1;
+  uv_mutex_init(&writer->lock);
+  return writer;
+}
+
+void evmc_trace_writer_retain(struct evmc_trace_writer* writer) {
+  __atomic_add_fetch(&writer->refs, 1, __ATOMIC_RELAXED);
+}
+
+void evmc_trace_writer_release(struct evmc_trace_writer* writer) {
+  if (__atomic_sub_fetch(&writer->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    fclose(writer->file);
+    uv_mutex_destroy(&writer->lock);
+    free(writer);
+  }
+}
+
+void evmc_trace_writer_append(struct evmc_trace_writer* writer,
+                              const struct evmc_trace_buffer* buffer) {
+  struct evmc_trace_buffer size;
+  evmc_trace_buffer_init(&size);
+  evmc_trace_put_u64(&size, buffer->size);
+
+  uv_mutex_lock(&writer->lock);
+  if (fwrite(size.data, 1, size.size, writer->file) != size.size ||
+      fwrite(buffer->data, 1, buffer->size, writer->file) != buffer->size) {
+    writer->ok = false;
+  }
+  uv_mutex_unlock(&writer->lock);
+
+  evmc_trace_buffer_free(&size);
+}
+
+bool evmc_trace_writer_ok(struct evmc_trace_writer* writer) {
+  uv_mutex_lock(&writer->lock);
+  bool ok = writer->ok && fflush(writer->file) == 0;
+  uv_mutex_unlock(&writer->lock);
+  return ok;
+}
+
+/**
+ * The evmc_context of a replayed execution. Host calls are encoded the same
+ * way they were recorded and compared byte for byte with the trace; after the
+ * first difference the execution has diverged and every response is zero.
+ */
+struct replay_context {
+  /** Must come first, as this is the evmc_context of the execution. */
+  const struct evmc_host_interface* host;
+  const uint8_t* cursor;
+  const uint8_t* end;
+  /** The encoding of the current host call, reused across calls. */
+  struct evmc_trace_buffer request;
+  uint64_t host_calls;
+  bool diverged;
+};
+
+static bool read_bytes(struct replay_context* replay, void* out, size_t size) {
+  if (replay->diverged || (size_t) (replay->end - replay->cursor) < size) {
+    replay->diverged = true;
+    memset(out, 0, size);
+    return false;
+  }
+  memcpy(out, replay->cursor, size);
+  replay->cursor += size;
+  return true;
+}
+
+static uint8_t read_u8(struct replay_context* replay) {
+  uint8_t value;
+  read_bytes(replay, &value, 1);
+  return value;
+}
+
+static uint32_t read_u32(struct replay_context* replay) {
+  uint8_t bytes[4];
+  read_bytes(replay, bytes, sizeof(bytes));
+  return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) |
+         ((uint32_t) bytes[3] << 24);
+}
+
+static uint64_t read_u64(struct replay_context* replay) {
+  uint8_t bytes[8];
+  read_bytes(replay, bytes, sizeof(bytes));
+  uint64_t value = 0;
+  int i;
+  for (i = 7; i >= 0; i--) {
+    value = (value << 8) | bytes[i];
+  }
+  return value;
+}
+
+/** Returns a pointer to the next size bytes of the trace, or NULL. */
+static const uint8_t* read_span(struct replay_context* replay, size_t size) {
+  if (replay->diverged || (size_t) (replay->end - replay->cursor) < size) {
+    replay->diverged = true;
+    return NULL;
+  }
+  const uint8_t* span = replay->cursor;
+  replay->cursor += size;
+  return span;
+}
+
+static void read_message(struct replay_context* replay, struct evmc_message* message) {
+  message->kind = (enum evmc_call_kind) read_u8(replay);
+  message->flags = read_u32(replay);
+  message->depth = (int32_t) read_u32(replay);
+  message->gas = (int64_t) read_u64(replay);
+  read_bytes(replay, &message->destination, sizeof(evmc_address));
+  read_bytes(replay, &message->sender, sizeof(evmc_address));
+  read_bytes(replay, &message->value, sizeof(evmc_uint256be));
+  read_bytes(replay, &message->create2_salt, sizeof(evmc_bytes32));
+  message->input_size = read_u32(replay);
+  message->input_data = read_span(replay, message->input_size);
+  if (message->input_data == NULL) {
+    message->input_size = 0;
+  }
+}
+
+/** Reads a result whose output points into the trace. */
+static void read_result(struct replay_context* replay, struct evmc_result* result) {
+  memset(result, 0, sizeof(*result));
+  result->status_code = (enum evmc_status_code) (int32_t) read_u32(replay);
+  result->gas_left = (int64_t) read_u64(replay);
+  result->output_size = read_u32(replay);
+  result->output_data = read_span(replay, result->output_size);
+  if (result->output_data == NULL) {
+    result->output_size = 0;
+  }
+  read_bytes(replay, &result->create_address, sizeof(evmc_address));
+}
+
+static void begin_request(struct replay_context* replay, enum evmc_trace_record type) {
+  replay->request.size = 0;
+  evmc_trace_put_u8(&replay->request, (uint8_t) type);
+}
+
+/** Consumes the request from the trace if it is the one recorded next. */
+static bool match_request(struct replay_context* replay) {
+  replay->host_calls++;
+  if (replay->diverged) {
+    return false;
+  }
+  size_t size = replay->request.size;
+  if ((size_t) (replay->end - replay->cursor) < size ||
+      memcmp(replay->cursor, replay->request.data, size) != 0) {
+    replay->diverged = true;
+    return false;
+  }
+  replay->cursor += size;
+  return true;
+}
+
+static bool replay_account_exists(struct replay_context* replay, const evmc_address* address) {
+  begin_request(replay, EVMC_TRACE_ACCOUNT_EXISTS);
+  evmc_trace_put_bytes(&replay->request, address, sizeof(*address));
+  match_request(replay);
+  return read_u8(replay) != 0;
+}
+
+static evmc_bytes32 replay_get_storage(struct replay_context* replay, const evmc_address* address,
+                                       const evmc_bytes32* key) {
+  begin_request(replay, EVMC_TRACE_GET_STORAGE);
+  evmc_trace_put_bytes(&replay->request, address, sizeof(*address));
+  evmc_trace_put_bytes(&replay->request, key, sizeof(*key));
+  match_request(replay);
+  evmc_bytes32 value;
+  read_bytes(replay, &value, sizeof(value));
+  return value;
+}
+
+static enum evmc_storage_status replay_set_storage(struct replay_context* replay,
+                                                   const evmc_address* address,
+                                                   const evmc_bytes32* key,
+                                                   const evmc_bytes32* value) {
+  begin_request(replay, EVMC_TRACE_SET_STORAGE);
+  evmc_trace_put_bytes(&replay->request, address, sizeof(*address));
+  evmc_trace_put_bytes(&replay->request, key, sizeof(*key));
+  evmc_trace_put_bytes(&replay->request, value, sizeof(*value));
+  match_request(replay);
+  return (enum evmc_storage_status) read_u8(replay);
+}
+
+static evmc_uint256be replay_get_balance(struct replay_context* replay, const evmc_address* address) {
+  begin_request(replay, EVMC_TRACE_GET_BALANCE);
+  evmc_trace_put_bytes(&replay->request, address, sizeof(*address));
+  match_request(replay);
+  evmc_uint256be balance;
+  read_bytes(replay, &balance, sizeof(balance));
+  return balance;
+}
+
+static size_t replay_get_code_size(struct replay_context* replay, const evmc_address* address) {
+  begin_request(replay, EVMC_TRACE_GET_CODE_SIZE);
+  evmc_trace_put_bytes(&replay->request, address, sizeof(*address));
+  match_request(replay);
+  return (size_t) read_u64(replay);
+}
+
+static evmc_bytes32 replay_get_code_hash(struct replay_context* replay, const evmc_address* address) {
+  begin_request(replay, EVMC_TRACE_GET_CODE_HASH);
+  evmc_trace_put_bytes(&replay->request, address, sizeof(*address));
+  match_request(replay);
+  evmc_bytes32 hash;
+  read_bytes(replay, &hash, sizeof(hash));
+  return hash;
+}
+
+static size_t replay_copy_code(struct replay_context* replay, const evmc_address* address,
+                               size_t code_offset, uint8_t* buffer_data, size_t buffer_size) {
+  begin_request(replay, EVMC_TRACE_COPY_CODE);
+  evmc_trace_put_bytes(&replay->request, address, sizeof(*address));
+  evmc_trace_put_u64(&replay->request, code_offset);
+  evmc_trace_put_u64(&replay->request, buffer_size);
+  match_request(replay);
+  size_t written = (size_t) read_u64(replay);
+  if (written > buffer_size) {
+    replay->diverged = true;
+    return 0;
+  }
+  if (!read_bytes(replay, buffer_data, written)) {
+    return 0;
+  }
+  return written;
+}
+
+static void replay_selfdestruct(struct replay_context* replay, const evmc_address* address,
+                                const evmc_address* beneficiary) {
+  begin_request(replay, EVMC_TRACE_SELFDESTRUCT);
+  evmc_trace_put_bytes(&replay->request, address, sizeof(*address));
+  evmc_trace_put_bytes(&replay->request, beneficiary, sizeof(*beneficiary));
+  match_request(replay);
+}
+
+static struct evmc_result replay_call(struct replay_context* replay, const struct evmc_message* msg) {
+  begin_request(replay, EVMC_TRACE_CALL);
+  evmc_trace_put_message(&replay->request, msg);
+  match_request(replay);
+  struct evmc_result result;
+  read_result(replay, &result);
+  if (replay->diverged) {
+    memset(&result, 0, sizeof(result));
+    result.status_code = EVMC_FAILURE;
+  }
+  return result;
+}
+
+static struct evmc_tx_context replay_get_tx_context(struct replay_context* replay) {
+  begin_request(replay, EVMC_TRACE_GET_TX_CONTEXT);
+  match_request(replay);
+  struct evmc_tx_context context;
+  read_bytes(replay, &context.tx_gas_price, sizeof(evmc_uint256be));
+  read_bytes(replay, &context.tx_origin, sizeof(evmc_address));
+  read_bytes(replay, &context.block_coinbase, sizeof(evmc_address));
+  context.block_number = (int64_t) read_u64(replay);
+  context.block_timestamp = (int64_t) read_u64(replay);
+  context.block_gas_limit = (int64_t) read_u64(replay);
+  read_bytes(replay, &context.block_difficulty, sizeof(evmc_uint256be));
+  return context;
+}
+
+static evmc_bytes32 replay_get_block_hash(struct replay_context* replay, int64_t number) {
+  begin_request(replay, EVMC_TRACE_GET_BLOCK_HASH);
+  evmc_trace_put_u64(&replay->request, (uint64_t) number);
+  match_request(replay);
+  evmc_bytes32 hash;
+  read_bytes(replay, &hash, sizeof(hash));
+  return hash;
+}
+
+static void replay_emit_log(struct replay_context* replay, const evmc_address* address,
+                            const uint8_t* data, size_t data_size,
+                            const evmc_bytes32 topics[], size_t topics_count) {
+  begin_request(replay, EVMC_TRACE_EMIT_LOG);
+  evmc_trace_put_bytes(&replay->request, address, sizeof(*address));
+  evmc_trace_put_u32(&replay->request, (uint32_t) data_size);
+  evmc_trace_put_bytes(&replay->request, data, data_size);
+  evmc_trace_put_u32(&replay->request, (uint32_t) topics_count);
+  evmc_trace_put_bytes(&replay->request, topics, topics_count * sizeof(evmc_bytes32));
+  match_request(replay);
+}
+
+static const struct evmc_host_interface replay_host_interface = {
+    (evmc_account_exists_fn) replay_account_exists,
+    (evmc_get_storage_fn) replay_get_storage,
+    (evmc_set_storage_fn) replay_set_storage,
+    (evmc_get_balance_fn) replay_get_balance,
+    (evmc_get_code_size_fn) replay_get_code_size,
+    (evmc_get_code_hash_fn) replay_get_code_hash,
+    (evmc_copy_code_fn) replay_copy_code,
+    (evmc_selfdestruct_fn) replay_selfdestruct,
+    (evmc_call_fn) replay_call,
+    (evmc_get_tx_context_fn) replay_get_tx_context,
+    (evmc_get_block_hash_fn) replay_get_block_hash,
+    (evmc_emit_log_fn) replay_emit_log,
+};
+
+static bool results_equal(const struct evmc_result* a, const struct evmc_result* b) {
+  return a->status_code == b->status_code && a->gas_left == b->gas_left &&
+         a->output_size == b->output_size &&
+         (a->output_size == 0 || memcmp(a->output_data, b->output_data, a->output_size) == 0);
+}
+
+const char* evmc_trace_replay(const char* path, struct evmc_instance* instance,
+                              struct evmc_trace_replay_stats* stats) {
+  memset(stats, 0, sizeof(*stats));
+
+  FILE* file = fopen(path, "rb");
+  if (file == NULL) {
+    return "Unable to open trace";
+  }
+  fseek(file, 0, SEEK_END);
+  long file_size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if (file_size < 12) {
+    fclose(file);
+    return "Trace is truncated";
+  }
+
+  uint8_t* data = (uint8_t*) malloc((size_t) file_size);
+  bool read_ok = fread(data, 1, (size_t) file_size, file) == (size_t) file_size;
+  fclose(file);
+  if (!read_ok) {
+    free(data);
+    return "Unable to read trace";
+  }
+
+  struct replay_context replay;
+  replay.host = &replay_host_interface;
+  replay.cursor = data;
+  replay.end = data + file_size;
+  replay.host_calls = 0;
+  replay.diverged = false;
+  evmc_trace_buffer_init(&replay.request);
+
+  if (memcmp(data, EVMC_TRACE_MAGIC, 8) != 0) {
+    free(data);
+    return "Not a trace";
+  }
+  replay.cursor += 8;
+  if (read_u32(&replay) != EVMC_TRACE_VERSION) {
+    free(data);
+    return "Unsupported trace version";
+  }
+
+  const char* error = NULL;
+  const uint8_t* file_end = data + file_size;
+  while (replay.cursor < file_end) {
+    replay.end = file_end;
+    replay.diverged = false;
+    uint64_t block_size = read_u64(&replay);
+    if (replay.diverged || block_size > (uint64_t) (file_end - replay.cursor)) {
+      error = "Trace is truncated";
+      break;
+    }
+    const uint8_t* block_end = replay.cursor + block_size;
+    replay.end = block_end;
+
+    enum evmc_revision revision = (enum evmc_revision) read_u32(&replay);
+    struct evmc_message message;
+    read_message(&replay, &message);
+    size_t code_size = read_u32(&replay);
+    const uint8_t* code = read_span(&replay, code_size);
+    if (replay.diverged) {
+      error = "Trace is corrupt";
+      break;
+    }
+
+    uint64_t start = uv_hrtime();
+    struct evmc_result result = instance->execute(instance, (struct evmc_context*) &replay,
+                                                  revision, &message, code, code_size);
+    stats->elapsed_ns += uv_hrtime() - start;
+    stats->executions++;
+
+    if (!replay.diverged && read_u8(&replay) != EVMC_TRACE_END) {
+      replay.diverged = true;
+    }
+    if (replay.diverged) {
+      stats->divergences++;
+    } else {
+      struct evmc_result recorded;
+      read_result(&replay, &recorded);
+      if (replay.diverged || !results_equal(&result, &recorded)) {
+        stats->mismatches++;
+      }
+    }
+    if (result.release != NULL) {
+      result.release(&result);
+    }
+
+    replay.cursor = block_end;
+  }
+  stats->host_calls = replay.host_calls;
+
+  evmc_trace_buffer_free(&replay.request);
+  free(data);
+  return error;
+}
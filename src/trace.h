@@ -0,0 +1,118 @@
+#ifndef EVMC_JS_TRACE_H
+#define EVMC_JS_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "evmc/evmc.h"
+
+/**
+ * Binary traces of executions and their host interactions.
+ *
+ * A trace file starts with the magic "EVMCTRCE" and a u32 version, followed by
+ * one block per execution: a u64 payload size and the payload. All integers
+ * are little-endian. A payload is
+ *
+ *   u32 revision, message, u32 code size, code
+ *   host records, in the order the VM made them, each a u8 record type
+ *   followed by the arguments and then the response
+ *   u8 EVMC_TRACE_END, result
+ *
+ * where a message is u8 kind, u32 flags, i32 depth, i64 gas, destination,
+ * sender, value, create2 salt, u32 input size, input, and a result is i32
+ * status, i64 gas left, u32 output size, output, create address.
+ *
+ * Executions are buffered while they run and appended whole when they finish,
+ * so concurrent executions never interleave.
+ */
+
+#define EVMC_TRACE_MAGIC "EVMCTRCE"
+#define EVMC_TRACE_VERSION 1
+
+enum evmc_trace_record {
+  EVMC_TRACE_END = 0,
+  /** address -> u8 exists */
+  EVMC_TRACE_ACCOUNT_EXISTS = 1,
+  /** address, key -> value */
+  EVMC_TRACE_GET_STORAGE = 2,
+  /** address, key, value -> u8 status */
+  EVMC_TRACE_SET_STORAGE = 3,
+  /** address -> balance */
+  EVMC_TRACE_GET_BALANCE = 4,
+  /** address -> u64 size */
+  EVMC_TRACE_GET_CODE_SIZE = 5,
+  /** address -> hash */
+  EVMC_TRACE_GET_CODE_HASH = 6,
+  /** address, u64 offset, u64 buffer size -> u64 written, code */
+  EVMC_TRACE_COPY_CODE = 7,
+  /** address, beneficiary -> nothing */
+  EVMC_TRACE_SELFDESTRUCT = 8,
+  /** message -> result */
+  EVMC_TRACE_CALL = 9,
+  /** nothing -> gas price, origin, coinbase, i64 number, timestamp, gas limit, difficulty */
+  EVMC_TRACE_GET_TX_CONTEXT = 10,
+  /** i64 number -> hash */
+  EVMC_TRACE_GET_BLOCK_HASH = 11,
+  /** address, u32 data size, data, u32 topic count, topics -> nothing */
+  EVMC_TRACE_EMIT_LOG = 12
+};
+
+/** A growable buffer holding the payload of one execution. */
+struct evmc_trace_buffer {
+  uint8_t* data;
+  size_t size;
+  size_t capacity;
+};
+
+void evmc_trace_buffer_init(struct evmc_trace_buffer* buffer);
+void evmc_trace_buffer_free(struct evmc_trace_buffer* buffer);
+
+void evmc_trace_put_bytes(struct evmc_trace_buffer* buffer, const void* data, size_t size);
+void evmc_trace_put_u8(struct evmc_trace_buffer* buffer, uint8_t value);
+void evmc_trace_put_u32(struct evmc_trace_buffer* buffer, uint32_t value);
+void evmc_trace_put_u64(struct evmc_trace_buffer* buffer, uint64_t value);
+void evmc_trace_put_message(struct evmc_trace_buffer* buffer, const struct evmc_message* message);
+void evmc_trace_put_result(struct evmc_trace_buffer* buffer, const struct evmc_result* result);
+void evmc_trace_put_tx_context(struct evmc_trace_buffer* buffer, const struct evmc_tx_context* context);
+
+struct evmc_trace_writer;
+
+/**
+ * Creates or truncates the trace file at path. Returns NULL and sets *error
+ * to a static message on failure. The returned writer holds one reference.
+ */
+struct evmc_trace_writer* evmc_trace_writer_open(const char* path, const char** error);
+
+void evmc_trace_writer_retain(struct evmc_trace_writer* writer);
+
+/** Drops a reference, closing the file once the last one is gone. */
+void evmc_trace_writer_release(struct evmc_trace_writer* writer);
+
+/** Appends the payload of one execution. Safe to call from any thread. */
+void evmc_trace_writer_append(struct evmc_trace_writer* writer,
+                              const struct evmc_trace_buffer* buffer);
+
+/** Returns false if any append has failed to reach the file. */
+bool evmc_trace_writer_ok(struct evmc_trace_writer* writer);
+
+struct evmc_trace_replay_stats {
+  uint64_t executions;
+  uint64_t host_calls;
+  /** Executions whose host calls differed from the recorded ones. */
+  uint64_t divergences;
+  /** Executions whose result differed from the recorded one. */
+  uint64_t mismatches;
+  /** Time spent executing, excluding loading the trace. */
+  uint64_t elapsed_ns;
+};
+
+/**
+ * Runs every execution in the trace at path on instance, answering host calls
+ * from the trace. Returns NULL on success, or a static error message if the
+ * trace cannot be read.
+ */
+const char* evmc_trace_replay(const char* path, struct evmc_instance* instance,
+                              struct evmc_trace_replay_stats* stats);
+
+#endif
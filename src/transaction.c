@@ -0,0 +1,114 @@
+#include "transaction.h"
+
+#include <string.h>
+
+#include "hash.h"
+
+int64_t evmc_tx_intrinsic_gas(enum evmc_revision revision, bool create, const uint8_t* data,
+                              size_t data_size) {
+  int64_t gas = EVMC_TX_GAS;
+  if (create && revision >= EVMC_HOMESTEAD) {
+    gas += EVMC_TX_CREATE_GAS;
+  }
+  // EIP-2028 made non-zero data cheaper from Istanbul on.
+  int64_t non_zero_gas = revision >= EVMC_ISTANBUL ? 16 : 68;
+  size_t i;
+  for (i = 0; i < data_size; i++) {
+    gas += data[i] == 0 ? 4 : non_zero_gas;
+  }
+  return gas;
+}
+
+/** Multiplies a by m into out, returning the part which overflows. */
+static uint64_t mul_u64(const evmc_uint256be* a, uint64_t m, evmc_uint256be* out) {
+  unsigned __int128 carry = 0;
+  int i;
+  for (i = 31; i >= 0; i--) {
+    carry += (unsigned __int128) a->bytes[i] * m;
+    out->bytes[i] = (uint8_t) carry;
+    carry >>= 8;
+  }
+  return (uint64_t) carry;
+}
+
+/** Adds b to a in place, returning if it overflows. */
+static bool add(evmc_uint256be* a, const evmc_uint256be* b) {
+  unsigned carry = 0;
+  int i;
+  for (i = 31; i >= 0; i--) {
+    carry += (unsigned) a->bytes[i] + b->bytes[i];
+    a->bytes[i] = (uint8_t) carry;
+    carry >>= 8;
+  }
+  return carry != 0;
+}
+
+bool evmc_tx_upfront_cost(int64_t gas_limit, const evmc_uint256be* gas_price,
+                          const evmc_uint256be* value, evmc_uint256be* cost) {
+  if (mul_u64(gas_price, (uint64_t) gas_limit, cost) != 0) {
+    return false;
+  }
+  return !add(cost, value);
+}
+
+void evmc_tx_fee(int64_t gas, const evmc_uint256be* gas_price, evmc_uint256be* fee) {
+  mul_u64(gas_price, (uint64_t) gas, fee);
+}
+
+int evmc_uint256be_compare(const evmc_uint256be* a, const evmc_uint256be* b) {
+  return memcmp(a->bytes, b->bytes, sizeof(a->bytes));
+}
+
+void evmc_tx_create_address(const evmc_address* sender, uint64_t nonce, evmc_address* address) {
+  // RLP of [sender, nonce], which is always a short list.
+  uint8_t rlp[1 + 1 + sizeof(sender->bytes) + 1 + sizeof(nonce)];
+  size_t size = 0;
+  rlp[size++] = 0;
+  rlp[size++] = 0x80 + sizeof(sender->bytes);
+  memcpy(rlp + size, sender->bytes, sizeof(sender->bytes));
+  size += sizeof(sender->bytes);
+  if (nonce == 0) {
+    rlp[size++] = 0x80;
+  } else if (nonce < 0x80) {
+    rlp[size++] = (uint8_t) nonce;
+  } else {
+    size_t length = 0;
+    uint64_t rest;
+    for (rest = nonce; rest != 0; rest >>= 8) {
+      length++;
+    }
+    rlp[size++] = (uint8_t) (0x80 + length);
+    size_t i;
+    for (i = 0; i < length; i++) {
+      rlp[size++] = (uint8_t) (nonce >> (8 * (length - 1 - i)));
+    }
+  }
+  rlp[0] = (uint8_t) (0xc0 + size - 1);
+
+  uint8_t hash[32];
+  keccak256(rlp, size, hash);
+  memcpy(address->bytes, hash + 12, sizeof(address->bytes));
+}
+
+int64_t evmc_tx_storage_refund(enum evmc_storage_status status) {
+  return status == EVMC_STORAGE_DELETED ? EVMC_SSTORE_CLEAR_REFUND : 0;
+}
+
+bool evmc_tx_deposit_code(enum evmc_revision revision, struct evmc_result* result) {
+  int64_t cost = (int64_t) result->output_size * EVMC_CODE_DEPOSIT_GAS;
+  bool too_large = revision >= EVMC_SPURIOUS_DRAGON && result->output_size > EVMC_MAX_CODE_SIZE;
+  if (!too_large && cost <= result->gas_left) {
+    result->gas_left -= cost;
+    return true;
+  }
+  if (revision >= EVMC_HOMESTEAD) {
+    result->status_code = EVMC_OUT_OF_GAS;
+    result->gas_left = 0;
+  }
+  result->output_size = 0;
+  return false;
+}
+
+int64_t evmc_tx_capped_refund(int64_t refund, int64_t gas_used) {
+  return refund < gas_used / 2 ? refund : gas_used / 2;
+}
@@ -0,0 +1,64 @@
+#ifndef EVMC_JS_TRANSACTION_H
+#define EVMC_JS_TRANSACTION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "evmc/evmc.h"
+
+/**
+ * The rules of running a transaction around its top-level message: the gas
+ * charged before it starts, what the sender must be able to pay for, the
+ * address a create deploys to, the cost of depositing the created code, and
+ * the refunds given back at the end.
+ *
+ * Refunds are counted from what EVMC 6 hosts report: storage slots cleared
+ * and contracts self-destructed. Net gas metering refunds for slots restored
+ * to their original value are not told apart by the storage status, so they
+ * are left out.
+ */
+
+#define EVMC_TX_GAS 21000
+#define EVMC_TX_CREATE_GAS 32000
+#define EVMC_CODE_DEPOSIT_GAS 200
+/** EIP-170 */
+#define EVMC_MAX_CODE_SIZE 24576
+#define EVMC_SSTORE_CLEAR_REFUND 15000
+#define EVMC_SELFDESTRUCT_REFUND 24000
+
+/** Gas charged before the message runs, for the transaction and its data. */
+int64_t evmc_tx_intrinsic_gas(enum evmc_revision revision, bool create, const uint8_t* data,
+                              size_t data_size);
+
+/**
+ * Computes gas_limit * gas_price + value, which the sender must hold. Returns
+ * false if it does not fit in 256 bits.
+ */
+bool evmc_tx_upfront_cost(int64_t gas_limit, const evmc_uint256be* gas_price,
+                          const evmc_uint256be* value, evmc_uint256be* cost);
+
+/** Computes gas * gas_price, which does not overflow for gas within a gas limit. */
+void evmc_tx_fee(int64_t gas, const evmc_uint256be* gas_price, evmc_uint256be* fee);
+
+int evmc_uint256be_compare(const evmc_uint256be* a, const evmc_uint256be* b);
+
+/** The address a create by sender with the given nonce deploys to. */
+void evmc_tx_create_address(const evmc_address* sender, uint64_t nonce, evmc_address* address);
+
+/** The refund for a write to storage with the given status. */
+int64_t evmc_tx_storage_refund(enum evmc_storage_status status);
+
+/**
+ * Charges a successful create for depositing its code, which is the output of
+ * the result, failing it if the code is too large or the gas left does not
+ * cover it from Homestead on. Before Homestead, code which cannot be paid for
+ * is not deposited and the create still succeeds.
+ * @return   If the code is deposited.
+ */
+bool evmc_tx_deposit_code(enum evmc_revision revision, struct evmc_result* result);
+
+/** Caps the refund of a transaction which used gas_used. */
+int64_t evmc_tx_capped_refund(int64_t refund, int64_t gas_used);
+
+#endif
@@ -0,0 +1,436 @@
+#include "trie.h"
+
+#include <string.h>
+
+#include "arena.h"
+#include "hash.h"
+
+enum trie_node_type {
+  TRIE_LEAF,
+  TRIE_EXTENSION,
+  TRIE_BRANCH,
+  /** A node of the witness which has not been loaded yet */
+  TRIE_HASH
+};
+
+struct trie_node {
+  enum trie_node_type type;
+  /** If hash is the hash of the node as it is now, so it needs no encoding */
+  bool hashed;
+  uint8_t hash[32];
+  /** The rest of the key at a leaf, or the part skipped by an extension, a nibble per byte */
+  uint8_t path[64];
+  size_t path_size;
+  /** The child of an extension */
+  struct trie_node* child;
+  struct trie_node* children[16];
+  /** The value of a leaf */
+  const uint8_t* value;
+  size_t value_size;
+};
+
+struct evmc_trie {
+  struct evmc_witness* witness;
+  /** Owns the nodes, and values put */
+  struct evmc_arena* arena;
+  struct trie_node* root;
+};
+
+static struct trie_node* new_node(struct evmc_trie* trie, enum trie_node_type type) {
+  struct trie_node* node = (struct trie_node*) evmc_arena_alloc(trie->arena, sizeof(struct trie_node));
+  memset(node, 0, sizeof(*node));
+  node->type = type;
+  return node;
+}
+
+static struct trie_node* new_hash(struct evmc_trie* trie, const uint8_t hash[32]) {
+  struct trie_node* node = new_node(trie, TRIE_HASH);
+  node->hashed = true;
+  memcpy(node->hash, hash, 32);
+  return node;
+}
+
+static struct trie_node* new_leaf(struct evmc_trie* trie, const uint8_t* path, size_t path_size,
+                                  const uint8_t* value, size_t value_size) {
+  struct trie_node* node = new_node(trie, TRIE_LEAF);
+  memcpy(node->path, path, path_size);
+  node->path_size = path_size;
+  node->value = value;
+  node->value_size = value_size;
+  return node;
+}
+
+static struct trie_node* decode_node(struct evmc_trie* trie, const struct rlp_item* item);
+
+/** Decodes a reference to a child, which is empty, a hash or the child itself. */
+static bool decode_ref(struct evmc_trie* trie, const struct rlp_item* item,
+                       struct trie_node** child) {
+  if (item->list) {
+    *child = decode_node(trie, item);
+    return *child != NULL;
+  }
+  if (item->size == 0) {
+    *child = NULL;
+    return true;
+  }
+  if (item->size != 32) {
+    return false;
+  }
+  *child = new_hash(trie, item->data);
+  return true;
+}
+
+/** Decodes a node, leaving the children it refers to by hash to be loaded. Returns NULL if malformed. */
+static struct trie_node* decode_node(struct evmc_trie* trie, const struct rlp_item* item) {
+  struct rlp_item items[17];
+  int count = rlp_decode_list(item, items, 17);
+  struct trie_node* node;
+  if (count == 17) {
+    // Keys of the state and storage tries all have the same length, so no
+    // branch has a value.
+    if (items[16].list || items[16].size != 0) {
+      return NULL;
+    }
+    node = new_node(trie, TRIE_BRANCH);
+    int i;
+    for (i = 0; i < 16; i++) {
+      if (!decode_ref(trie, &items[i], &node->children[i])) {
+        return NULL;
+      }
+    }
+    return node;
+  }
+  if (count != 2 || items[0].list || items[0].size == 0) {
+    return NULL;
+  }
+
+  // The hex-prefix encoded path, flagged as leaf or extension.
+  const uint8_t* encoded = items[0].data;
+  uint8_t flag = encoded[0] >> 4;
+  size_t path_size = 2 * (items[0].size - 1) + (flag & 1);
+  if (flag > 3 || path_size > 64) {
+    return NULL;
+  }
+  node = new_node(trie, flag & 2 ? TRIE_LEAF : TRIE_EXTENSION);
+  size_t i;
+  for (i = 0; i < path_size; i++) {
+    size_t n = i + 2 - (flag & 1);
+    node->path[i] = n % 2 == 0 ? encoded[n / 2] >> 4 : encoded[n / 2] & 0x0f;
+  }
+  node->path_size = path_size;
+  if (node->type == TRIE_LEAF) {
+    if (items[1].list) {
+      return NULL;
+    }
+    node->value = items[1].data;
+    node->value_size = items[1].size;
+  } else if (!decode_ref(trie, &items[1], &node->child) || node->child == NULL) {
+    return NULL;
+  }
+  return node;
+}
+
+/** Replaces a node referred to by hash with the node from the witness. */
+static bool load(struct evmc_trie* trie, struct trie_node** slot) {
+  if ((*slot)->type != TRIE_HASH) {
+    return true;
+  }
+  size_t size;
+  const uint8_t* data = evmc_witness_get_node(trie->witness, (*slot)->hash, &size);
+  struct rlp_item item;
+  if (data == NULL || !rlp_decode(data, size, &item)) {
+    return false;
+  }
+  struct trie_node* node = decode_node(trie, &item);
+  if (node == NULL) {
+    return false;
+  }
+  node->hashed = true;
+  memcpy(node->hash, (*slot)->hash, 32);
+  *slot = node;
+  return true;
+}
+
+static size_t common_prefix(const uint8_t* a, size_t a_size, const uint8_t* b, size_t b_size) {
+  size_t i = 0;
+  while (i < a_size && i < b_size && a[i] == b[i]) {
+    i++;
+  }
+  return i;
+}
+
+static bool insert(struct evmc_trie* trie, struct trie_node** slot, const uint8_t* key,
+                   size_t key_size, const uint8_t* value, size_t value_size, bool* changed) {
+  *changed = false;
+  if (*slot == NULL) {
+    *slot = new_leaf(trie, key, key_size, value, value_size);
+    *changed = true;
+    return true;
+  }
+  if (!load(trie, slot)) {
+    return false;
+  }
+  struct trie_node* node = *slot;
+
+  if (node->type == TRIE_BRANCH) {
+    if (key_size == 0 ||
+        !insert(trie, &node->children[key[0]], key + 1, key_size - 1, value, value_size, changed)) {
+      return false;
+    }
+    node->hashed = node->hashed && !*changed;
+    return true;
+  }
+
+  size_t common = common_prefix(node->path, node->path_size, key, key_size);
+  if (node->type == TRIE_LEAF && common == node->path_size && common == key_size) {
+    if (node->value_size != value_size || memcmp(node->value, value, value_size) != 0) {
+      node->value = value;
+      node->value_size = value_size;
+      node->hashed = false;
+      *changed = true;
+    }
+    return true;
+  }
+  if (node->type == TRIE_EXTENSION && common == node->path_size) {
+    if (!insert(trie, &node->child, key + common, key_size - common, value, value_size, changed)) {
+      return false;
+    }
+    node->hashed = node->hashed && !*changed;
+    return true;
+  }
+  // Keys of the same length never prefix each other.
+  if (common == node->path_size || common == key_size) {
+    return false;
+  }
+
+  // Branch at the first nibble which differs.
+  struct trie_node* branch = new_node(trie, TRIE_BRANCH);
+  if (node->type == TRIE_EXTENSION && common + 1 == node->path_size) {
+    branch->children[node->path[common]] = node->child;
+  } else {
+    struct trie_node* rest = new_node(trie, node->type);
+    memcpy(rest->path, node->path + common + 1, node->path_size - common - 1);
+    rest->path_size = node->path_size - common - 1;
+    rest->child = node->child;
+    rest->value = node->value;
+    rest->value_size = node->value_size;
+    branch->children[node->path[common]] = rest;
+  }
+  branch->children[key[common]] =
+      new_leaf(trie, key + common + 1, key_size - common - 1, value, value_size);
+  if (common > 0) {
+    struct trie_node* extension = new_node(trie, TRIE_EXTENSION);
+    memcpy(extension->path, key, common);
+    extension->path_size = common;
+    extension->child = branch;
+    *slot = extension;
+  } else {
+    *slot = branch;
+  }
+  *changed = true;
+  return true;
+}
+
+/** Joins an extension with its child if that is a leaf or extension, as a trie must. */
+static bool join(struct evmc_trie* trie, struct trie_node** slot) {
+  struct trie_node* extension = *slot;
+  if (extension->child == NULL) {
+    *slot = NULL;
+    return true;
+  }
+  if (!load(trie, &extension->child)) {
+    return false;
+  }
+  struct trie_node* child = extension->child;
+  if (child->type == TRIE_BRANCH) {
+    return true;
+  }
+  if (extension->path_size + child->path_size > 64) {
+    return false;
+  }
+  struct trie_node* joined = new_node(trie, child->type);
+  memcpy(joined->path, extension->path, extension->path_size);
+  memcpy(joined->path + extension->path_size, child->path, child->path_size);
+  joined->path_size = extension->path_size + child->path_size;
+  joined->child = child->child;
+  joined->value = child->value;
+  joined->value_size = child->value_size;
+  *slot = joined;
+  return true;
+}
+
+static bool remove_key(struct evmc_trie* trie, struct trie_node** slot, const uint8_t* key,
+                       size_t key_size, bool* changed) {
+  *changed = false;
+  if (*slot == NULL) {
+    return true;
+  }
+  if (!load(trie, slot)) {
+    return false;
+  }
+  struct trie_node* node = *slot;
+
+  if (node->type == TRIE_LEAF) {
+    if (node->path_size == key_size && memcmp(node->path, key, key_size) == 0) {
+      *slot = NULL;
+      *changed = true;
+    }
+    return true;
+  }
+
+  if (node->type == TRIE_EXTENSION) {
+    if (key_size < node->path_size || memcmp(node->path, key, node->path_size) != 0) {
+      return true;
+    }
+    if (!remove_key(trie, &node->child, key + node->path_size, key_size - node->path_size,
+                    changed)) {
+      return false;
+    }
+    if (!*changed) {
+      return true;
+    }
+    node->hashed = false;
+    return join(trie, slot);
+  }
+
+  if (key_size == 0 || !remove_key(trie, &node->children[key[0]], key + 1, key_size - 1, changed)) {
+    return false;
+  }
+  if (!*changed) {
+    return true;
+  }
+  node->hashed = false;
+
+  // A branch left with one child becomes an extension to it, joined with it
+  // unless it is a branch itself.
+  int count = 0;
+  int last = 0;
+  int i;
+  for (i = 0; i < 16; i++) {
+    if (node->children[i] != NULL) {
+      count++;
+      last = i;
+    }
+  }
+  if (count > 1) {
+    return true;
+  }
+  if (count == 0) {
+    *slot = NULL;
+    return true;
+  }
+  struct trie_node* extension = new_node(trie, TRIE_EXTENSION);
+  extension->path[0] = (uint8_t) last;
+  extension->path_size = 1;
+  extension->child = node->children[last];
+  *slot = extension;
+  return join(trie, slot);
+}
+
+struct evmc_trie* evmc_trie_create(struct evmc_witness* witness, const evmc_bytes32* root) {
+  struct evmc_arena* arena = evmc_arena_acquire();
+  struct evmc_trie* trie = (struct evmc_trie*) evmc_arena_alloc(arena, sizeof(struct evmc_trie));
+  trie->witness = witness;
+  trie->arena = arena;
+  trie->root = memcmp(root->bytes, evmc_empty_trie_root.bytes, 32) == 0 ? NULL : new_hash(trie, root->bytes);
+  return trie;
+}
+
+bool evmc_trie_put(struct evmc_trie* trie, const uint8_t key[32], const uint8_t* value,
+                   size_t size) {
+  uint8_t path[64];
+  size_t i;
+  for (i = 0; i < 32; i++) {
+    path[2 * i] = key[i] >> 4;
+    path[2 * i + 1] = key[i] & 0x0f;
+  }
+  bool changed;
+  if (size == 0) {
+    return remove_key(trie, &trie->root, path, 64, &changed);
+  }
+  uint8_t* copy = (uint8_t*) evmc_arena_alloc(trie->arena, size);
+  memcpy(copy, value, size);
+  return insert(trie, &trie->root, path, 64, copy, size, &changed);
+}
+
+static void encode_node(struct trie_node* node, struct rlp_buffer* out, struct rlp_buffer* nodes);
+
+/**
+ * Appends how a parent refers to a node: by its encoding if that is shorter
+ * than a hash, or by its hash, in which case the encoding goes to nodes.
+ */
+static void encode_ref(struct trie_node* node, struct rlp_buffer* out, struct rlp_buffer* nodes) {
+  if (node == NULL) {
+    rlp_put_string(out, NULL, 0);
+    return;
+  }
+  if (node->hashed) {
+    rlp_put_string(out, node->hash, 32);
+    return;
+  }
+  struct rlp_buffer encoding = {NULL, 0, 0};
+  encode_node(node, &encoding, nodes);
+  if (encoding.size < 32) {
+    rlp_put_raw(out, encoding.data, encoding.size);
+  } else {
+    keccak256(encoding.data, encoding.size, node->hash);
+    node->hashed = true;
+    rlp_put_raw(nodes, encoding.data, encoding.size);
+    rlp_put_string(out, node->hash, 32);
+  }
+  rlp_buffer_free(&encoding);
+}
+
+static void encode_node(struct trie_node* node, struct rlp_buffer* out, struct rlp_buffer* nodes) {
+  size_t start = rlp_begin_list(out);
+  if (node->type == TRIE_BRANCH) {
+    int i;
+    for (i = 0; i < 16; i++) {
+      encode_ref(node->children[i], out, nodes);
+    }
+    rlp_put_string(out, NULL, 0);
+  } else {
+    // Hex-prefix encoding: a flag nibble for leaf and odd length, padded to
+    // whole bytes.
+    uint8_t encoded[33];
+    size_t odd = node->path_size % 2;
+    uint8_t flag = (uint8_t) ((node->type == TRIE_LEAF ? 2 : 0) + odd);
+    size_t size = 1 + node->path_size / 2;
+    encoded[0] = (uint8_t) (flag << 4);
+    if (odd) {
+      encoded[0] |= node->path[0];
+    }
+    size_t i;
+    for (i = 1; i < size; i++) {
+      encoded[i] = (uint8_t) (node->path[odd + 2 * (i - 1)] << 4 | node->path[odd + 2 * (i - 1) + 1]);
+    }
+    rlp_put_string(out, encoded, size);
+    if (node->type == TRIE_LEAF) {
+      rlp_put_string(out, node->value, node->value_size);
+    } else {
+      encode_ref(node->child, out, nodes);
+    }
+  }
+  rlp_end_list(out, start);
+}
+
+void evmc_trie_commit(struct evmc_trie* trie, evmc_bytes32* root, struct rlp_buffer* nodes) {
+  if (trie->root == NULL) {
+    *root = evmc_empty_trie_root;
+    return;
+  }
+  if (!trie->root->hashed) {
+    // The root is always referred to by hash, however short.
+    struct rlp_buffer encoding = {NULL, 0, 0};
+    encode_node(trie->root, &encoding, nodes);
+    keccak256(encoding.data, encoding.size, trie->root->hash);
+    trie->root->hashed = true;
+    rlp_put_raw(nodes, encoding.data, encoding.size);
+    rlp_buffer_free(&encoding);
+  }
+  memcpy(root->bytes, trie->root->hash, 32);
+}
+
+void evmc_trie_destroy(struct evmc_trie* trie) {
+  evmc_arena_release(trie->arena);
+}
@@ -0,0 +1,44 @@
+#ifndef EVMC_JS_TRIE_H
+#define EVMC_JS_TRIE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "evmc/evmc.h"
+#include "rlp.h"
+#include "witness.h"
+
+/**
+ * A Merkle-Patricia trie being updated on top of the nodes of a witness.
+ *
+ * Only the nodes on the paths of the keys put are loaded from the witness, and
+ * the rest of the trie is kept as the hashes referring to it, so the witness
+ * must prove every key put, and for keys removed, the sibling a branch left
+ * with one child collapses into. Keys are hashed by the caller, as in the
+ * state and storage tries. A trie is used by one thread, which must also be
+ * the one that destroys it.
+ */
+
+struct evmc_trie;
+
+/** Starts updating the trie with the given root, whose nodes are in the witness. */
+struct evmc_trie* evmc_trie_create(struct evmc_witness* witness, const evmc_bytes32* root);
+
+/**
+ * Sets the value under a hashed key, removing the key if size is 0. The value
+ * is copied. Returns false if the witness is missing a node it needs, after
+ * which the trie must only be destroyed.
+ */
+bool evmc_trie_put(struct evmc_trie* trie, const uint8_t key[32], const uint8_t* value,
+                   size_t size);
+
+/**
+ * Computes the root of the updated trie, appending the encoding of each node
+ * which changed and is referred to by hash to nodes.
+ */
+void evmc_trie_commit(struct evmc_trie* trie, evmc_bytes32* root, struct rlp_buffer* nodes);
+
+void evmc_trie_destroy(struct evmc_trie* trie);
+
+#endif
@@ -0,0 +1,328 @@
+#include "witness.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+#include "rlp.h"
+
+const evmc_bytes32 evmc_empty_trie_root = {{
+    0x56, 0xe8, 0x1f, 0x17, 0x1b, 0xcc, 0x55, 0xa6, 0xff, 0x83, 0x45, 0xe6, 0x92, 0xc0, 0xf8, 0x6e,
+    0x5b, 0x48, 0xe0, 0x1b, 0x99, 0x6c, 0xad, 0xc0, 0x01, 0x62, 0x2f, 0xb5, 0xe3, 0x63, 0xb4, 0x21}};
+
+const evmc_bytes32 evmc_empty_code_hash = {{
+    0xc5, 0xd2, 0x46, 0x01, 0x86, 0xf7, 0x23, 0x3c, 0x92, 0x7e, 0x7d, 0xb2, 0xdc, 0xc7, 0x03, 0xc0,
+    0xe5, 0x00, 0xb6, 0x53, 0xca, 0x82, 0x27, 0x3b, 0x7b, 0xfa, 0xd8, 0x04, 0x5d, 0x85, 0xa4, 0x70}};
+
+/** A node or code, keyed by its hash. */
+struct witness_entry {
+  uint8_t hash[32];
+  uint8_t* data;
+  size_t size;
+};
+
+/** An open-addressing table of entries, which is never more than half full. */
+struct witness_table {
+  struct witness_entry* entries;
+  size_t mask;
+  size_t count;
+};
+
+struct evmc_witness {
+  evmc_bytes32 state_root;
+  struct witness_table nodes;
+  struct witness_table codes;
+  int refs;
+};
+
+static size_t entry_index(const uint8_t hash[32]) {
+  size_t index;
+  memcpy(&index, hash, sizeof(index));
+  return index;
+}
+
+static struct witness_entry* table_find(const struct witness_table* table, const uint8_t hash[32]) {
+  if (table->entries == NULL) {
+    return NULL;
+  }
+  size_t i = entry_index(hash) & table->mask;
+  while (table->entries[i].data != NULL) {
+    if (memcmp(table->entries[i].hash, hash, 32) == 0) {
+      return &table->entries[i];
+    }
+    i = (i + 1) & table->mask;
+  }
+  return NULL;
+}
+
+static void table_grow(struct witness_table* table) {
+  size_t capacity = table->entries == NULL ? 64 : (table->mask + 1) * 2;
+  struct witness_entry* entries =
+      (struct witness_entry*) calloc(capacity, sizeof(struct witness_entry));
+  size_t i;
+  for (i = 0; table->entries != NULL && i <= table->mask; i++) {
+    if (table->entries[i].data != NULL) {
+      size_t j = entry_index(table->entries[i].hash) & (capacity - 1);
+      while (entries[j].data != NULL) {
+        j = (j + 1) & (capacity - 1);
+      }
+      entries[j] = table->entries[i];
+    }
+  }
+  free(table->entries);
+  table->entries = entries;
+  table->mask = capacity - 1;
+}
+
+static void table_put(struct witness_table* table, const uint8_t* data, size_t size) {
+  uint8_t hash[32];
+  keccak256(data, size, hash);
+  if (table_find(table, hash) != NULL) {
+    return;
+  }
+  if (table->entries == NULL || (table->count + 1) * 2 > table->mask + 1) {
+    table_grow(table);
+  }
+  size_t i = entry_index(hash) & table->mask;
+  while (table->entries[i].data != NULL) {
+    i = (i + 1) & table->mask;
+  }
+  struct witness_entry* entry = &table->entries[i];
+  memcpy(entry->hash, hash, 32);
+  // Empty code still needs a pointer, which marks the slot as used.
+  entry->data = (uint8_t*) malloc(size == 0 ? 1 : size);
+  memcpy(entry->data, data, size);
+  entry->size = size;
+  table->count++;
+}
+
+static void table_free(struct witness_table* table) {
+  size_t i;
+  for (i = 0; table->entries != NULL && i <= table->mask; i++) {
+    free(table->entries[i].data);
+  }
+  free(table->entries);
+}
+
+struct evmc_witness* evmc_witness_create(const evmc_bytes32* state_root) {
+  struct evmc_witness* witness = (struct evmc_witness*) calloc(1, sizeof(struct evmc_witness));
+  if (witness == NULL) {
+    return NULL;
+  }
+  witness->state_root = *state_root;
+  witness->refs = 1;
+  return witness;
+}
+
+bool evmc_witness_add_node(struct evmc_witness* witness, const uint8_t* node, size_t size) {
+  struct rlp_item item;
+  if (!rlp_decode(node, size, &item) || !item.list || item.raw_size != size) {
+    return false;
+  }
+  table_put(&witness->nodes, node, size);
+  return true;
+}
+
+void evmc_witness_add_code(struct evmc_witness* witness, const uint8_t* code, size_t size) {
+  table_put(&witness->codes, code, size);
+}
+
+void evmc_witness_retain(struct evmc_witness* witness) {
+  __atomic_add_fetch(&witness->refs, 1, __ATOMIC_RELAXED);
+}
+
+void evmc_witness_release(struct evmc_witness* witness) {
+  if (__atomic_sub_fetch(&witness->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    table_free(&witness->nodes);
+    table_free(&witness->codes);
+    free(witness);
+  }
+}
+
+/**
+ * Follows a reference to a child node, which is either embedded in its parent
+ * or the hash of a node in the witness.
+ */
+static enum evmc_witness_result resolve(struct evmc_witness* witness, const struct rlp_item* ref,
+                                        struct rlp_item* node) {
+  if (ref->list) {
+    *node = *ref;
+    return EVMC_WITNESS_FOUND;
+  }
+  if (ref->size == 0) {
+    return EVMC_WITNESS_ABSENT;
+  }
+  if (ref->size != 32) {
+    return EVMC_WITNESS_MISSING;
+  }
+  const struct witness_entry* entry = table_find(&witness->nodes, ref->data);
+  if (entry == NULL) {
+    return EVMC_WITNESS_MISSING;
+  }
+  rlp_decode(entry->data, entry->size, node);
+  return EVMC_WITNESS_FOUND;
+}
+
+/** Looks up the value stored under the hash of a key in the trie with the given root. */
+static enum evmc_witness_result trie_get(struct evmc_witness* witness, const uint8_t root[32],
+                                         const uint8_t key[32], struct rlp_item* value) {
+  if (memcmp(root, evmc_empty_trie_root.bytes, 32) == 0) {
+    return EVMC_WITNESS_ABSENT;
+  }
+
+  uint8_t path[64];
+  size_t i;
+  for (i = 0; i < 32; i++) {
+    path[2 * i] = key[i] >> 4;
+    path[2 * i + 1] = key[i] & 0x0f;
+  }
+
+  struct rlp_item root_ref = {root, 32, false, NULL, 0};
+  struct rlp_item node;
+  enum evmc_witness_result result = resolve(witness, &root_ref, &node);
+  size_t depth = 0;
+  while (result == EVMC_WITNESS_FOUND) {
+    struct rlp_item items[17];
+    int count = rlp_decode_list(&node, items, 17);
+    struct rlp_item* child;
+    if (count == 17) {
+      if (depth == 64) {
+        *value = items[16];
+        return value->size == 0 ? EVMC_WITNESS_ABSENT : EVMC_WITNESS_FOUND;
+      }
+      child = &items[path[depth++]];
+    } else if (count == 2 && !items[0].list && items[0].size > 0) {
+      // The hex-prefix encoded part of the path, flagged as leaf or extension.
+      const uint8_t* encoded = items[0].data;
+      uint8_t flag = encoded[0] >> 4;
+      if (flag > 3) {
+        return EVMC_WITNESS_MISSING;
+      }
+      size_t length = 2 * (items[0].size - 1) + (flag & 1);
+      if (depth + length > 64) {
+        return EVMC_WITNESS_ABSENT;
+      }
+      size_t j;
+      for (j = 0; j < length; j++) {
+        size_t n = j + 2 - (flag & 1);
+        uint8_t nibble = n % 2 == 0 ? encoded[n / 2] >> 4 : encoded[n / 2] & 0x0f;
+        if (nibble != path[depth + j]) {
+          return EVMC_WITNESS_ABSENT;
+        }
+      }
+      depth += length;
+      if (flag & 2) {
+        if (depth != 64) {
+          return EVMC_WITNESS_ABSENT;
+        }
+        *value = items[1];
+        return EVMC_WITNESS_FOUND;
+      }
+      child = &items[1];
+    } else {
+      return EVMC_WITNESS_MISSING;
+    }
+    result = resolve(witness, child, &node);
+  }
+  return result;
+}
+
+/** Right-aligns a big-endian integer of up to 32 bytes into a word. */
+static bool read_word(const struct rlp_item* item, uint8_t word[32]) {
+  if (item->list || item->size > 32) {
+    return false;
+  }
+  memset(word, 0, 32);
+  memcpy(word + 32 - item->size, item->data, item->size);
+  return true;
+}
+
+enum evmc_witness_result evmc_witness_get_account(struct evmc_witness* witness,
+                                                  const evmc_address* address,
+                                                  struct evmc_witness_account* account) {
+  memset(account, 0, sizeof(*account));
+
+  uint8_t key[32];
+  keccak256(address->bytes, sizeof(address->bytes), key);
+  struct rlp_item leaf;
+  enum evmc_witness_result result = trie_get(witness, witness->state_root.bytes, key, &leaf);
+  if (result != EVMC_WITNESS_FOUND) {
+    return result;
+  }
+
+  // The leaf holds the RLP of [nonce, balance, storage root, code hash].
+  struct rlp_item encoded;
+  struct rlp_item fields[4];
+  uint8_t nonce[32];
+  if (leaf.list || !rlp_decode(leaf.data, leaf.size, &encoded) ||
+      rlp_decode_list(&encoded, fields, 4) != 4 || fields[0].size > 8 ||
+      !read_word(&fields[0], nonce) || !read_word(&fields[1], account->balance.bytes) ||
+      fields[2].size != 32 || !read_word(&fields[2], account->storage_root.bytes) ||
+      fields[3].size != 32 || !read_word(&fields[3], account->code_hash.bytes)) {
+    return EVMC_WITNESS_MISSING;
+  }
+  size_t i;
+  for (i = 24; i < 32; i++) {
+    account->nonce = (account->nonce << 8) | nonce[i];
+  }
+  return EVMC_WITNESS_FOUND;
+}
+
+enum evmc_witness_result evmc_witness_get_storage(struct evmc_witness* witness,
+                                                  const struct evmc_witness_account* account,
+                                                  const evmc_bytes32* key, evmc_bytes32* value) {
+  memset(value, 0, sizeof(*value));
+
+  uint8_t hashed_key[32];
+  keccak256(key->bytes, sizeof(key->bytes), hashed_key);
+  struct rlp_item leaf;
+  enum evmc_witness_result result =
+      trie_get(witness, account->storage_root.bytes, hashed_key, &leaf);
+  if (result != EVMC_WITNESS_FOUND) {
+    return result;
+  }
+
+  // The leaf holds the RLP of the value without leading zeros.
+  struct rlp_item encoded;
+  if (leaf.list || !rlp_decode(leaf.data, leaf.size, &encoded) ||
+      !read_word(&encoded, value->bytes)) {
+    return EVMC_WITNESS_MISSING;
+  }
+  return EVMC_WITNESS_FOUND;
+}
+
+const uint8_t* evmc_witness_get_code(struct evmc_witness* witness, const evmc_bytes32* code_hash,
+                                     size_t* size) {
+  if (memcmp(code_hash->bytes, evmc_empty_code_hash.bytes, 32) == 0) {
+    *size = 0;
+    return evmc_empty_code_hash.bytes;
+  }
+  const struct witness_entry* entry = table_find(&witness->codes, code_hash->bytes);
+  if (entry == NULL) {
+    return NULL;
+  }
+  *size = entry->size;
+  return entry->data;
+}
+
+const evmc_bytes32* evmc_witness_state_root(struct evmc_witness* witness) {
+  return &witness->state_root;
+}
+
+const uint8_t* evmc_witness_get_node(struct evmc_witness* witness, const uint8_t hash[32],
+                                     size_t* size) {
+  const struct witness_entry* entry = table_find(&witness->nodes, hash);
+  if (entry == NULL) {
+    return NULL;
+  }
+  *size = entry->size;
+  return entry->data;
+}
+
+size_t evmc_witness_node_count(struct evmc_witness* witness) {
+  return witness->nodes.count;
+}
+
+size_t evmc_witness_code_count(struct evmc_witness* witness) {
+  return witness->codes.count;
+}
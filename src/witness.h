@@ -0,0 +1,80 @@
+#ifndef EVMC_JS_WITNESS_H
+#define EVMC_JS_WITNESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "evmc/evmc.h"
+
+/**
+ * The state a stateless execution may touch, given as the Merkle-Patricia
+ * trie nodes proving it against a state root, plus the code of the accounts.
+ *
+ * Nodes are indexed by their Keccak-256 hash, and lookups walk the trie from
+ * the state root through the index, so only nodes which are part of a proof
+ * are ever used. A lookup either finds its key, proves the key is absent, or
+ * reports that the witness is missing a node on the way. Once built, a
+ * witness is read-only and may be used from any number of threads.
+ */
+
+enum evmc_witness_result {
+  EVMC_WITNESS_FOUND,
+  /** The trie proves the key is not in it. */
+  EVMC_WITNESS_ABSENT,
+  /** A node on the path to the key is not in the witness, or is malformed. */
+  EVMC_WITNESS_MISSING
+};
+
+/** The root of a trie with nothing in it, the hash of an empty RLP string. */
+extern const evmc_bytes32 evmc_empty_trie_root;
+
+/** The hash of empty code. */
+extern const evmc_bytes32 evmc_empty_code_hash;
+
+struct evmc_witness_account {
+  uint64_t nonce;
+  evmc_uint256be balance;
+  evmc_bytes32 storage_root;
+  evmc_bytes32 code_hash;
+};
+
+struct evmc_witness;
+
+/** Creates an empty witness for the state root. The returned witness holds one reference. */
+struct evmc_witness* evmc_witness_create(const evmc_bytes32* state_root);
+
+/** Adds a trie node, which is copied. Returns false if it is not an RLP list. */
+bool evmc_witness_add_node(struct evmc_witness* witness, const uint8_t* node, size_t size);
+
+/** Adds the code of an account, which is copied. */
+void evmc_witness_add_code(struct evmc_witness* witness, const uint8_t* code, size_t size);
+
+void evmc_witness_retain(struct evmc_witness* witness);
+
+void evmc_witness_release(struct evmc_witness* witness);
+
+enum evmc_witness_result evmc_witness_get_account(struct evmc_witness* witness,
+                                                  const evmc_address* address,
+                                                  struct evmc_witness_account* account);
+
+/** Looks up a slot in the storage trie of an account, which is zero if absent. */
+enum evmc_witness_result evmc_witness_get_storage(struct evmc_witness* witness,
+                                                  const struct evmc_witness_account* account,
+                                                  const evmc_bytes32* key, evmc_bytes32* value);
+
+/** Returns the code with the given hash, or NULL if the witness does not have it. */
+const uint8_t* evmc_witness_get_code(struct evmc_witness* witness, const evmc_bytes32* code_hash,
+                                     size_t* size);
+
+const evmc_bytes32* evmc_witness_state_root(struct evmc_witness* witness);
+
+/** Returns the trie node with the given hash, or NULL if the witness does not have it. */
+const uint8_t* evmc_witness_get_node(struct evmc_witness* witness, const uint8_t hash[32],
+                                     size_t* size);
+
+size_t evmc_witness_node_count(struct evmc_witness* witness);
+
+size_t evmc_witness_code_count(struct evmc_witness* witness);
+
+#endif
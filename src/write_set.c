@@ -0,0 +1,330 @@
+#include "write_set.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <uv.h>
+
+#include "hash.h"
+#include "rlp.h"
+#include "trie.h"
+
+struct evmc_write_set {
+  uv_mutex_t lock;
+  struct evmc_write* writes;
+  size_t size;
+  size_t capacity;
+  int refs;
+};
+
+struct evmc_write_set* evmc_write_set_create(void) {
+  struct evmc_write_set* write_set = (struct evmc_write_set*) calloc(1, sizeof(struct evmc_write_set));
+  if (write_set == NULL) {
+    return NULL;
+  }
+  uv_mutex_init(&write_set->lock);
+  write_set->refs = 1;
+  return write_set;
+}
+
+void evmc_write_set_retain(struct evmc_write_set* write_set) {
+  __atomic_add_fetch(&write_set->refs, 1, __ATOMIC_RELAXED);
+}
+
+void evmc_write_set_release(struct evmc_write_set* write_set) {
+  if (__atomic_sub_fetch(&write_set->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    uv_mutex_destroy(&write_set->lock);
+    free(write_set->writes);
+    free(write_set);
+  }
+}
+
+void evmc_write_set_append(struct evmc_write_set* write_set, const struct evmc_write* write) {
+  uv_mutex_lock(&write_set->lock);
+  if (write_set->size == write_set->capacity) {
+    write_set->capacity = write_set->capacity == 0 ? 64 : write_set->capacity * 2;
+    write_set->writes = (struct evmc_write*) realloc(
+        write_set->writes, write_set->capacity * sizeof(struct evmc_write));
+  }
+  write_set->writes[write_set->size++] = *write;
+  uv_mutex_unlock(&write_set->lock);
+}
+
+size_t evmc_write_set_mark(struct evmc_write_set* write_set) {
+  uv_mutex_lock(&write_set->lock);
+  size_t mark = write_set->size;
+  uv_mutex_unlock(&write_set->lock);
+  return mark;
+}
+
+void evmc_write_set_revert(struct evmc_write_set* write_set, size_t mark) {
+  uv_mutex_lock(&write_set->lock);
+  if (mark < write_set->size) {
+    write_set->size = mark;
+  }
+  uv_mutex_unlock(&write_set->lock);
+}
+
+size_t evmc_write_set_size(struct evmc_write_set* write_set) {
+  return evmc_write_set_mark(write_set);
+}
+
+/** A write and its place in the journal, which decides between writes to the same thing. */
+struct sequenced_write {
+  const struct evmc_write* write;
+  size_t sequence;
+};
+
+struct commit_account {
+  struct evmc_committed_account result;
+  /** The writes to the account, in journal order */
+  struct sequenced_write* writes;
+  size_t write_count;
+  /** If the witness had no proof for the account, or for missing_key of its storage */
+  bool missing;
+  bool missing_storage;
+  evmc_bytes32 missing_key;
+  /** The RLP of the account, to put in the state trie if it exists */
+  struct rlp_buffer leaf;
+  /** Storage trie nodes which changed */
+  struct rlp_buffer nodes;
+};
+
+struct evmc_commitment {
+  struct evmc_witness* witness;
+  /** The journal as it was when the commitment was created */
+  struct evmc_write* journal;
+  struct sequenced_write* writes;
+  struct commit_account* accounts;
+  size_t account_count;
+  evmc_bytes32 state_root;
+  const evmc_address* missing_address;
+  const evmc_bytes32* missing_key;
+  struct rlp_buffer nodes;
+};
+
+static int compare_sequence(size_t a, size_t b) {
+  return a < b ? -1 : a > b;
+}
+
+static int compare_by_address(const void* a, const void* b) {
+  const struct sequenced_write* x = (const struct sequenced_write*) a;
+  const struct sequenced_write* y = (const struct sequenced_write*) b;
+  int order = memcmp(x->write->address.bytes, y->write->address.bytes, sizeof(x->write->address.bytes));
+  return order != 0 ? order : compare_sequence(x->sequence, y->sequence);
+}
+
+static int compare_by_key(const void* a, const void* b) {
+  const struct sequenced_write* x = (const struct sequenced_write*) a;
+  const struct sequenced_write* y = (const struct sequenced_write*) b;
+  int order = memcmp(x->write->key.bytes, y->write->key.bytes, sizeof(x->write->key.bytes));
+  return order != 0 ? order : compare_sequence(x->sequence, y->sequence);
+}
+
+struct evmc_commitment* evmc_commitment_create(struct evmc_write_set* write_set,
+                                               struct evmc_witness* witness) {
+  struct evmc_commitment* commitment =
+      (struct evmc_commitment*) calloc(1, sizeof(struct evmc_commitment));
+  commitment->witness = witness;
+  evmc_witness_retain(witness);
+
+  uv_mutex_lock(&write_set->lock);
+  size_t count = write_set->size;
+  commitment->journal = (struct evmc_write*) malloc((count > 0 ? count : 1) * sizeof(struct evmc_write));
+  memcpy(commitment->journal, write_set->writes, count * sizeof(struct evmc_write));
+  uv_mutex_unlock(&write_set->lock);
+
+  commitment->writes =
+      (struct sequenced_write*) malloc((count > 0 ? count : 1) * sizeof(struct sequenced_write));
+  size_t i;
+  for (i = 0; i < count; i++) {
+    commitment->writes[i].write = &commitment->journal[i];
+    commitment->writes[i].sequence = i;
+  }
+  qsort(commitment->writes, count, sizeof(struct sequenced_write), compare_by_address);
+
+  commitment->accounts =
+      (struct commit_account*) calloc(count > 0 ? count : 1, sizeof(struct commit_account));
+  for (i = 0; i < count; i++) {
+    const evmc_address* address = &commitment->writes[i].write->address;
+    struct commit_account* account = &commitment->accounts[commitment->account_count];
+    if (i == 0 || memcmp(address, &account[-1].result.address, sizeof(*address)) != 0) {
+      account->result.address = *address;
+      account->writes = &commitment->writes[i];
+      commitment->account_count++;
+    }
+    commitment->accounts[commitment->account_count - 1].write_count++;
+  }
+  return commitment;
+}
+
+size_t evmc_commitment_account_count(struct evmc_commitment* commitment) {
+  return commitment->account_count;
+}
+
+void evmc_commitment_commit_account(struct evmc_commitment* commitment, size_t index) {
+  struct commit_account* account = &commitment->accounts[index];
+
+  // A delete wipes out the account and everything written to it before.
+  size_t start = 0;
+  size_t i;
+  for (i = 0; i < account->write_count; i++) {
+    if (account->writes[i].write->type == EVMC_WRITE_DELETE) {
+      start = i + 1;
+    }
+  }
+
+  struct evmc_witness_account state;
+  bool exists;
+  if (start > 0) {
+    memset(&state, 0, sizeof(state));
+    exists = false;
+  } else {
+    enum evmc_witness_result result =
+        evmc_witness_get_account(commitment->witness, &account->result.address, &state);
+    if (result == EVMC_WITNESS_MISSING) {
+      account->missing = true;
+      return;
+    }
+    exists = result == EVMC_WITNESS_FOUND;
+  }
+  if (!exists) {
+    state.storage_root = evmc_empty_trie_root;
+    state.code_hash = evmc_empty_code_hash;
+  }
+
+  struct sequenced_write* slots = (struct sequenced_write*) malloc(
+      (account->write_count - start + 1) * sizeof(struct sequenced_write));
+  size_t slot_count = 0;
+  for (i = start; i < account->write_count; i++) {
+    const struct evmc_write* write = account->writes[i].write;
+    if (write->type == EVMC_WRITE_STORAGE) {
+      slots[slot_count++] = account->writes[i];
+      continue;
+    }
+    if (write->fields & EVMC_WRITE_NONCE) {
+      state.nonce = write->nonce;
+    }
+    if (write->fields & EVMC_WRITE_BALANCE) {
+      state.balance = write->balance;
+    }
+    if (write->fields & EVMC_WRITE_CODE_HASH) {
+      state.code_hash = write->code_hash;
+    }
+    exists = true;
+  }
+
+  if (slot_count > 0) {
+    // The last write to each slot is the one which counts.
+    qsort(slots, slot_count, sizeof(struct sequenced_write), compare_by_key);
+    struct evmc_trie* trie = evmc_trie_create(commitment->witness, &state.storage_root);
+    struct rlp_buffer value = {NULL, 0, 0};
+    for (i = 0; i < slot_count; i++) {
+      const struct evmc_write* write = slots[i].write;
+      if (i + 1 < slot_count && memcmp(&write->key, &slots[i + 1].write->key, sizeof(write->key)) == 0) {
+        continue;
+      }
+      uint8_t key[32];
+      keccak256(write->key.bytes, sizeof(write->key.bytes), key);
+      value.size = 0;
+      rlp_put_uint(&value, write->value.bytes, sizeof(write->value.bytes));
+      // Zero is stored as no value at all.
+      bool removed = value.size == 1 && value.data[0] == 0x80;
+      if (!evmc_trie_put(trie, key, value.data, removed ? 0 : value.size)) {
+        account->missing = true;
+        account->missing_storage = true;
+        account->missing_key = write->key;
+        break;
+      }
+    }
+    rlp_buffer_free(&value);
+    if (!account->missing) {
+      evmc_trie_commit(trie, &state.storage_root, &account->nodes);
+    }
+    evmc_trie_destroy(trie);
+  }
+  free(slots);
+  if (account->missing) {
+    return;
+  }
+
+  // Storage written to an account which did not exist creates it.
+  if (memcmp(&state.storage_root, &evmc_empty_trie_root, sizeof(state.storage_root)) != 0) {
+    exists = true;
+  }
+  account->result.exists = exists;
+  account->result.storage_root = state.storage_root;
+  if (exists) {
+    uint8_t nonce[8];
+    for (i = 0; i < 8; i++) {
+      nonce[i] = (uint8_t) (state.nonce >> (8 * (7 - i)));
+    }
+    size_t list = rlp_begin_list(&account->leaf);
+    rlp_put_uint(&account->leaf, nonce, sizeof(nonce));
+    rlp_put_uint(&account->leaf, state.balance.bytes, sizeof(state.balance.bytes));
+    rlp_put_string(&account->leaf, state.storage_root.bytes, sizeof(state.storage_root.bytes));
+    rlp_put_string(&account->leaf, state.code_hash.bytes, sizeof(state.code_hash.bytes));
+    rlp_end_list(&account->leaf, list);
+  }
+}
+
+void evmc_commitment_commit_state(struct evmc_commitment* commitment) {
+  size_t i;
+  for (i = 0; i < commitment->account_count; i++) {
+    struct commit_account* account = &commitment->accounts[i];
+    if (account->missing) {
+      commitment->missing_address = &account->result.address;
+      commitment->missing_key = account->missing_storage ? &account->missing_key : NULL;
+      return;
+    }
+  }
+
+  struct evmc_trie* trie =
+      evmc_trie_create(commitment->witness, evmc_witness_state_root(commitment->witness));
+  for (i = 0; i < commitment->account_count; i++) {
+    struct commit_account* account = &commitment->accounts[i];
+    uint8_t key[32];
+    keccak256(account->result.address.bytes, sizeof(account->result.address.bytes), key);
+    if (!evmc_trie_put(trie, key, account->leaf.data, account->leaf.size)) {
+      commitment->missing_address = &account->result.address;
+      evmc_trie_destroy(trie);
+      return;
+    }
+    rlp_put_raw(&commitment->nodes, account->nodes.data, account->nodes.size);
+  }
+  evmc_trie_commit(trie, &commitment->state_root, &commitment->nodes);
+  evmc_trie_destroy(trie);
+}
+
+const evmc_address* evmc_commitment_missing(struct evmc_commitment* commitment,
+                                            const evmc_bytes32** key) {
+  *key = commitment->missing_key;
+  return commitment->missing_address;
+}
+
+const evmc_bytes32* evmc_commitment_state_root(struct evmc_commitment* commitment) {
+  return &commitment->state_root;
+}
+
+const struct evmc_committed_account* evmc_commitment_get_account(
+    struct evmc_commitment* commitment, size_t index) {
+  return &commitment->accounts[index].result;
+}
+
+const uint8_t* evmc_commitment_nodes(struct evmc_commitment* commitment, size_t* size) {
+  *size = commitment->nodes.size;
+  return commitment->nodes.data;
+}
+
+void evmc_commitment_destroy(struct evmc_commitment* commitment) {
+  size_t i;
+  for (i = 0; i < commitment->account_count; i++) {
+    rlp_buffer_free(&commitment->accounts[i].leaf);
+    rlp_buffer_free(&commitment->accounts[i].nodes);
+  }
+  rlp_buffer_free(&commitment->nodes);
+  evmc_witness_release(commitment->witness);
+  free(commitment->accounts);
+  free(commitment->writes);
+  free(commitment->journal);
+  free(commitment);
+}
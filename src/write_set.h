@@ -0,0 +1,112 @@
+#ifndef EVMC_JS_WRITE_SET_H
+#define EVMC_JS_WRITE_SET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "evmc/evmc.h"
+#include "witness.h"
+
+/**
+ * The state writes of the executions of a block, in the order they were made,
+ * and their commitment to the state trie.
+ *
+ * Writes are appended to a journal. An execution marks the journal when it
+ * starts and cuts it back to the mark if it fails, which also drops the writes
+ * of the calls made inside it. Executions sharing a write set must therefore
+ * run one at a time, apart from those nested in each other.
+ *
+ * A commitment applies the journal as it is to the tries of a witness. The
+ * storage trie of each account written is updated on its own, so accounts can
+ * be committed on different threads at once, and the state trie is updated
+ * with all of them after.
+ */
+
+enum evmc_write_type {
+  EVMC_WRITE_STORAGE,
+  /** Sets some fields of an account */
+  EVMC_WRITE_ACCOUNT,
+  /** Removes an account and its storage, as a self-destruct does */
+  EVMC_WRITE_DELETE
+};
+
+/** The fields an account write sets. */
+#define EVMC_WRITE_NONCE 1
+#define EVMC_WRITE_BALANCE 2
+#define EVMC_WRITE_CODE_HASH 4
+
+struct evmc_write {
+  enum evmc_write_type type;
+  evmc_address address;
+  evmc_bytes32 key;
+  evmc_bytes32 value;
+  unsigned fields;
+  uint64_t nonce;
+  evmc_uint256be balance;
+  evmc_bytes32 code_hash;
+};
+
+struct evmc_write_set;
+
+/** Creates an empty write set. The returned write set holds one reference. */
+struct evmc_write_set* evmc_write_set_create(void);
+
+void evmc_write_set_retain(struct evmc_write_set* write_set);
+
+void evmc_write_set_release(struct evmc_write_set* write_set);
+
+/** Appends a write, which is copied. */
+void evmc_write_set_append(struct evmc_write_set* write_set, const struct evmc_write* write);
+
+/** Returns the length of the journal, to revert to. */
+size_t evmc_write_set_mark(struct evmc_write_set* write_set);
+
+/** Drops the writes appended since the mark was taken. */
+void evmc_write_set_revert(struct evmc_write_set* write_set, size_t mark);
+
+size_t evmc_write_set_size(struct evmc_write_set* write_set);
+
+struct evmc_committed_account {
+  evmc_address address;
+  /** If the account is in the state after the writes */
+  bool exists;
+  evmc_bytes32 storage_root;
+};
+
+struct evmc_commitment;
+
+/**
+ * Prepares to commit the writes so far on top of the witness, which is
+ * retained until the commitment is destroyed.
+ */
+struct evmc_commitment* evmc_commitment_create(struct evmc_write_set* write_set,
+                                               struct evmc_witness* witness);
+
+/** The accounts written, in the order of their addresses. */
+size_t evmc_commitment_account_count(struct evmc_commitment* commitment);
+
+/** Updates the storage trie of one account. */
+void evmc_commitment_commit_account(struct evmc_commitment* commitment, size_t index);
+
+/** Updates the state trie, once every account has been committed. */
+void evmc_commitment_commit_state(struct evmc_commitment* commitment);
+
+/**
+ * Returns the first account the witness had no proof for, and the slot if it
+ * was a storage proof, or NULL if the commitment succeeded.
+ */
+const evmc_address* evmc_commitment_missing(struct evmc_commitment* commitment,
+                                            const evmc_bytes32** key);
+
+const evmc_bytes32* evmc_commitment_state_root(struct evmc_commitment* commitment);
+
+const struct evmc_committed_account* evmc_commitment_get_account(
+    struct evmc_commitment* commitment, size_t index);
+
+/** The encodings of the trie nodes which changed, one after the other. */
+const uint8_t* evmc_commitment_nodes(struct evmc_commitment* commitment, size_t* size);
+
+void evmc_commitment_destroy(struct evmc_commitment* commitment);
+
+#endif